@@ -0,0 +1,281 @@
+/** @file DocumentBuilderBench.cpp
+ *
+ *  Measures how fast DocumentBuilder builds a JsonDocument from a
+ *  FlexibleEventStream, how much memory the document takes per byte of
+ *  input, and how long it takes to free, with and without referencing
+ *  the input.  For comparison, builds the same tree out of std::map,
+ *  std::vector and std::string from the same events, and times the
+ *  events alone.
+ *
+ *  Memory is measured by counting the bytes operator new hands out, so
+ *  it includes every allocation the document holds on to, not just
+ *  what JsonDocument::bytesAllocated() reports.
+ *
+ *  Usage: DocumentBuilderBench [megabytes]
+ */
+#include <pistis/json/dom/DocumentBuilder.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/detail/InMemoryStreamAdapter.hpp>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace pistis::json;
+using namespace pistis::json::dom;
+using namespace pistis::json::streaming;
+
+namespace {
+  /** @brief Bytes handed out by operator new and not yet freed */
+  size_t liveBytes = 0;
+
+  /** @brief Room in front of each block for its size, big enough to
+   *         keep the block aligned
+   */
+  constexpr const size_t HEADER_SIZE = alignof(std::max_align_t);
+}
+
+void* operator new(size_t size) {
+  char* p = (char*)::malloc(size + HEADER_SIZE);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  *(size_t*)p = size;
+  liveBytes += size;
+  return p + HEADER_SIZE;
+}
+
+void operator delete(void* p) noexcept {
+  if (p) {
+    char* block = (char*)p - HEADER_SIZE;
+    liveBytes -= *(size_t*)block;
+    ::free(block);
+  }
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+namespace {
+  typedef FlexibleEventStream<detail::InMemoryStreamAdapter,
+			      DefaultPayloadFactory> EventStream;
+
+  /** @brief An array of records like those of a user database export,
+   *         with an escape sequence in about one string in eight
+   */
+  std::string makeDocument(size_t size) {
+    static const char* const CITIES[] = {
+      "Lisbon", "Osaka", "Toronto", "S\\u00e3o Paulo", "Nairobi", "Oslo",
+      "Lima", "Perth"
+    };
+    std::mt19937_64 rng(18);
+    std::string text = "[";
+    char buffer[512];
+    for (uint64_t id = 0; text.size() < size; ++id) {
+      ::snprintf(buffer, sizeof(buffer),
+		 "%s\n  {\"id\": %llu, \"name\": \"user%llu\", "
+		 "\"email\": \"user%llu@example.com\", \"active\": %s, "
+		 "\"score\": %.3f, \"tags\": [\"t%u\", \"t%u\"], "
+		 "\"address\": {\"city\": \"%s\", \"zip\": \"%05u\"}, "
+		 "\"note\": %s}",
+		 id ? "," : "", (unsigned long long)id,
+		 (unsigned long long)id, (unsigned long long)id,
+		 (rng() % 2) ? "true" : "false",
+		 (double)(rng() % 100000) / 1000, (unsigned)(rng() % 50),
+		 (unsigned)(rng() % 50), CITIES[rng() % 8],
+		 (unsigned)(rng() % 100000),
+		 (rng() % 4) ? "null" : "\"line one\\nline two\"");
+      text += buffer;
+    }
+    return text + "\n]\n";
+  }
+
+  /** @brief The tree a program that doesn't use JsonDocument might
+   *         build
+   */
+  struct MapNode {
+    JsonValueType type;
+    bool b;
+    int64_t i;
+    double d;
+    std::string s;
+    std::vector<MapNode> elements;
+    std::map<std::string, MapNode> members;
+
+    MapNode(JsonValueType t = JsonValueType::NULL_VALUE):
+	type(t), b(false), i(0), d(0.0), s(), elements(), members() {
+    }
+  };
+
+  MapNode readMapNode(EventStream& events, JsonEventType t) {
+    switch (t) {
+      case JsonEventType::BEGIN_OBJECT: {
+	MapNode node(JsonValueType::OBJECT);
+	while ((t = events.next()) == JsonEventType::FIELD_NAME) {
+	  const JsonString name = events.payloadText();
+	  MapNode& value = node.members[std::string(name.begin(), name.end())];
+	  value = readMapNode(events, events.next());
+	}
+	return node;
+      }
+
+      case JsonEventType::BEGIN_ARRAY: {
+	MapNode node(JsonValueType::ARRAY);
+	while ((t = events.next()) != JsonEventType::END_ARRAY) {
+	  node.elements.push_back(readMapNode(events, t));
+	}
+	return node;
+      }
+
+      case JsonEventType::STRING_VALUE: {
+	MapNode node(JsonValueType::STRING);
+	node.s.assign(events.payloadText().begin(),
+		      events.payloadText().end());
+	return node;
+      }
+
+      case JsonEventType::INT_VALUE: {
+	MapNode node(JsonValueType::INT);
+	node.i = events.intPayload();
+	return node;
+      }
+
+      case JsonEventType::FLOAT_VALUE: {
+	MapNode node(JsonValueType::FLOAT);
+	node.d = events.floatPayload();
+	return node;
+      }
+
+      case JsonEventType::TRUE_VALUE:
+      case JsonEventType::FALSE_VALUE: {
+	MapNode node(JsonValueType::BOOL);
+	node.b = (t == JsonEventType::TRUE_VALUE);
+	return node;
+      }
+
+      default:
+	return MapNode();
+    }
+  }
+
+  uint64_t countNodes(const JsonValue& v) {
+    uint64_t n = 1;
+    if (v.isArray()) {
+      for (const JsonValue* e = v.beginElements(); e != v.endElements();
+	   ++e) {
+	n += countNodes(*e);
+      }
+    } else if (v.isObject()) {
+      for (const JsonMember* m = v.beginMembers(); m != v.endMembers();
+	   ++m) {
+	n += countNodes(m->value());
+      }
+    }
+    return n;
+  }
+
+  uint64_t countNodes(const JsonDocument<>& doc) {
+    return countNodes(doc.root());
+  }
+
+  uint64_t countNodes(const MapNode& node) {
+    uint64_t n = 1;
+    for (const MapNode& e : node.elements) {
+      n += countNodes(e);
+    }
+    for (const auto& m : node.members) {
+      n += countNodes(m.second);
+    }
+    return n;
+  }
+
+  typedef std::chrono::duration<double> Seconds;
+
+  Seconds since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::steady_clock::now() - start;
+  }
+
+  /** @brief Best build and free times of a few runs, and the memory
+   *         the last document held
+   */
+  struct Result {
+    double build;
+    double free;
+    size_t memory;
+    uint64_t numNodes;
+  };
+
+  void print(const char* name, const std::string& text, const Result& r) {
+    printf("  %-26s %8.0f MB/s %10.2f %10.1f ms %10llu\n", name,
+	   text.size() / r.build / 1e6, (double)r.memory / text.size(),
+	   r.free * 1e3, (unsigned long long)r.numNodes);
+  }
+
+  /** @brief Build a document from @c text with @c build, which returns
+   *         the document and its node count, then destroy it
+   */
+  template <typename Build>
+  Result run(const std::string& text, Build build) {
+    Result best{ 1e30, 1e30, 0, 0 };
+    for (int rep = 0; rep < 3; ++rep) {
+      EventStream events("bench", detail::InMemoryStreamAdapter(text),
+			 DefaultPayloadFactory(), 65536);
+      const size_t before = liveBytes;
+      auto start = std::chrono::steady_clock::now();
+      {
+	auto doc = build(events);
+	best.build = std::min(best.build, since(start).count());
+	best.memory = liveBytes - before;
+	best.numNodes = countNodes(doc);
+	start = std::chrono::steady_clock::now();
+      }
+      best.free = std::min(best.free, since(start).count());
+    }
+    return best;
+  }
+}
+
+int main(int argc, char** argv) {
+  const size_t size = ((argc > 1) ? ::atol(argv[1]) : 50) << 20;
+  const std::string text = makeDocument(size);
+  printf("%.1f MB array of records\n", text.size() / 1e6);
+  printf("  %-26s %13s %10s %13s %10s\n", "", "build", "bytes per",
+	 "free", "nodes");
+  printf("  %-26s %13s %10s %13s\n", "", "", "input byte", "");
+
+  double eventsOnly = 1e30;
+  for (int rep = 0; rep < 3; ++rep) {
+    EventStream events("bench", detail::InMemoryStreamAdapter(text),
+		       DefaultPayloadFactory(), 65536);
+    const auto start = std::chrono::steady_clock::now();
+    while (events.next() != JsonEventType::END) {
+    }
+    eventsOnly = std::min(eventsOnly, since(start).count());
+  }
+  printf("  %-26s %8.0f MB/s\n", "Events only",
+	 text.size() / eventsOnly / 1e6);
+
+  // The documents hold on to the builder's arena, but the builder's
+  // stacks are freed with the builder, so they don't count
+  print("Arena, referencing input", text,
+	run(text, [](EventStream& events) {
+	  return JsonDocument<>(readDocument(events, true));
+	}));
+  print("Arena, copying strings", text,
+	run(text, [](EventStream& events) {
+	  return JsonDocument<>(readDocument(events, false));
+	}));
+  print("std::map + std::string", text,
+	run(text, [](EventStream& events) {
+	  return readMapNode(events, events.next());
+	}));
+  return 0;
+}
@@ -0,0 +1,155 @@
+/** @file ParallelNdjsonParserBench.cpp
+ *
+ *  Measures ParallelNdjsonParser with different numbers of threads
+ *  against a single FlexibleEventStream reading the same NDJSON
+ *  document, and checks that every run sees the same number of events.
+ *
+ *  Usage: ParallelNdjsonParserBench [megabytes] [threads...]
+ *
+ *  The default is a 64 MB document and 1, 2, 4 and 8 threads.  A
+ *  speedup needs at least as many cores as threads, so compare the
+ *  results with the output of nproc.
+ */
+#include <pistis/json/streaming/ParallelNdjsonParser.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/detail/MemoryViewStreamAdapter.hpp>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+
+namespace {
+  typedef ParallelNdjsonParser<DefaultPayloadFactory> Parser;
+
+  /** @brief Records shaped like a trade log, about 200 bytes each */
+  std::string makeDocument(size_t size) {
+    static const char* const SYMBOLS[] = {
+      "AAPL", "MSFT", "GOOG", "AMZN", "NVDA", "TSLA", "META", "BRK.B"
+    };
+    std::mt19937_64 rng(16);
+    std::string text;
+    char buffer[512];
+    for (uint64_t id = 0; text.size() < size; ++id) {
+      ::snprintf(buffer, sizeof(buffer),
+		 "{\"id\": %llu, \"symbol\": \"%s\", \"price\": %.2f, "
+		 "\"quantity\": %u, \"side\": \"%s\", \"flags\": [%s], "
+		 "\"venue\": {\"name\": \"X%02u\", \"lit\": %s}, "
+		 "\"note\": \"%s\"}\n",
+		 (unsigned long long)id, SYMBOLS[rng() % 8],
+		 (double)(rng() % 1000000) / 100, (unsigned)(rng() % 10000),
+		 (rng() % 2) ? "buy" : "sell",
+		 (rng() % 3) ? "\"odd-lot\", \"iso\"" : "",
+		 (unsigned)(rng() % 40), (rng() % 2) ? "true" : "false",
+		 (rng() % 4) ? "" : "partial fill, see \\\"amend\\\"");
+      text += buffer;
+    }
+    return text;
+  }
+
+  uint64_t countEvents(Parser::EventStreamType& events) {
+    uint64_t n = 0;
+    while (events.next() != JsonEventType::END) {
+      ++n;
+    }
+    return n;
+  }
+
+  /** @brief Run @c parse a few times and print the best time, and the
+   *         speedup over @c baseline seconds if it is nonzero.  Returns
+   *         the best time.  @c parse returns the number of events it
+   *         saw, which must be @c expectedEvents unless that is zero.
+   */
+  template <typename Parse>
+  double run(const char* name, const std::string& text,
+	     uint64_t expectedEvents, double baseline, Parse parse) {
+    double best = 1e30;
+    uint64_t numEvents = 0;
+    for (int rep = 0; rep < 5; ++rep) {
+      const auto start = std::chrono::steady_clock::now();
+      numEvents = parse();
+      const std::chrono::duration<double> elapsed =
+	  std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+    printf("  %-32s %8.1f ms %8.0f MB/s", name, best * 1e3,
+	   text.size() / best / 1e6);
+    if (baseline > 0) {
+      printf("  %5.2fx", baseline / best);
+    }
+    if (expectedEvents && (numEvents != expectedEvents)) {
+      printf("  (%llu events, expected %llu)",
+	     (unsigned long long)numEvents,
+	     (unsigned long long)expectedEvents);
+    }
+    printf("\n");
+    return best;
+  }
+}
+
+int main(int argc, char** argv) {
+  const size_t size = ((argc > 1) ? ::atol(argv[1]) : 64) << 20;
+  std::vector<uint32_t> threadCounts;
+  for (int i = 2; i < argc; ++i) {
+    threadCounts.push_back(::atoi(argv[i]));
+  }
+  if (threadCounts.empty()) {
+    threadCounts = { 1, 2, 4, 8 };
+  }
+
+  const std::string text = makeDocument(size);
+  const char* const begin = text.data();
+  const char* const end = text.data() + text.size();
+  printf("%.1f MB of NDJSON, %u hardware threads\n", text.size() / 1e6,
+	 std::thread::hardware_concurrency());
+
+  uint64_t expectedEvents = 0;
+  const double baseline = run(
+      "FlexibleEventStream, one thread", text, 0, 0.0,
+      [begin, end, &expectedEvents]() {
+	FlexibleEventStream<detail::MemoryViewStreamAdapter,
+			    DefaultPayloadFactory> events(
+	    std::string(), detail::MemoryViewStreamAdapter(begin, end),
+	    DefaultPayloadFactory(), 65536
+	);
+	events.setMultipleValues(true);
+	uint64_t n = 0;
+	while (events.next() != JsonEventType::END) {
+	  ++n;
+	}
+	return expectedEvents = n;
+      }
+  );
+
+  for (uint32_t numThreads : threadCounts) {
+    Parser parser((DefaultPayloadFactory()), numThreads);
+    for (ChunkResultOrder order : { ChunkResultOrder::IN_ORDER,
+				    ChunkResultOrder::AS_COMPLETED }) {
+      char name[64];
+      ::snprintf(name, sizeof(name), "%u thread%s, %s", numThreads,
+		 (numThreads == 1) ? "" : "s",
+		 (order == ChunkResultOrder::IN_ORDER) ? "in order"
+		                                       : "as completed");
+      run(name, text, expectedEvents, baseline,
+	  [&parser, begin, end, order]() {
+	    uint64_t total = 0;
+	    parser.parse(
+		begin, end,
+		[](Parser::EventStreamType& events, const NdjsonChunk&) {
+		  return countEvents(events);
+		},
+		[&total](uint64_t n, const NdjsonChunk&) { total += n; },
+		order
+	    );
+	    return total;
+	  });
+    }
+  }
+  return 0;
+}
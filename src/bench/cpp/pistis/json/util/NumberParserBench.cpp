@@ -0,0 +1,143 @@
+/** @file NumberParserBench.cpp
+ *
+ *  Compares util::parseDouble() and util::toDouble() with strtod() and
+ *  std::from_chars() on several kinds of numbers, and checks that all
+ *  of them agree bit for bit while it is at it.
+ *
+ *  Usage: NumberParserBench [count]
+ */
+#include <pistis/json/util/NumberParser.hpp>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace pistis::json;
+using namespace pistis::json::util;
+
+namespace {
+  struct DataSet {
+    std::string name;
+    std::vector<std::string> numbers;
+    size_t numBytes;
+  };
+
+  template <typename Generate>
+  DataSet makeDataSet(const std::string& name, size_t count,
+		      Generate generate) {
+    std::mt19937_64 rng(1);
+    DataSet data{ name, std::vector<std::string>(), 0 };
+    char buffer[128];
+    for (size_t i = 0; i < count; ++i) {
+      generate(rng, buffer, sizeof(buffer));
+      data.numbers.push_back(buffer);
+      data.numBytes += data.numbers.back().size();
+    }
+    return data;
+  }
+
+  JsonString textOf(const std::string& s) {
+    return JsonString(s.data(), s.data() + s.size());
+  }
+
+  /** @brief Run @c convert over every number in @c data a few times
+   *         and print the best time
+   */
+  template <typename Convert>
+  void run(const char* name, const DataSet& data,
+	   const std::vector<double>& expected, Convert convert) {
+    double best = 1e30;
+    size_t mismatches = 0;
+    for (int rep = 0; rep < 5; ++rep) {
+      mismatches = 0;
+      const auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < data.numbers.size(); ++i) {
+	const double v = convert(i);
+	mismatches += ::memcmp(&v, &expected[i], sizeof(double)) != 0;
+      }
+      const std::chrono::duration<double> elapsed =
+	  std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+    printf("  %-34s %7.1f ns/number %7.0f MB/s",
+	   name, best * 1e9 / data.numbers.size(),
+	   data.numBytes / best / 1e6);
+    if (mismatches) {
+      printf("  (%zu differ from strtod)", mismatches);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  const size_t count = (argc > 1) ? ::atol(argv[1]) : 1000000;
+  std::vector<DataSet> dataSets;
+
+  dataSets.push_back(makeDataSet(
+      "Coordinates (%.7f)", count,
+      [](std::mt19937_64& rng, char* buffer, size_t size) {
+	::snprintf(buffer, size, "%.7f",
+		   (double)(rng() % 360000000) / 1e6 - 180.0);
+      }
+  ));
+  dataSets.push_back(makeDataSet(
+      "Prices (%.2f)", count,
+      [](std::mt19937_64& rng, char* buffer, size_t size) {
+	::snprintf(buffer, size, "%.2f", (double)(rng() % 10000000) / 100);
+      }
+  ));
+  dataSets.push_back(makeDataSet(
+      "Random doubles (%.17g)", count,
+      [](std::mt19937_64& rng, char* buffer, size_t size) {
+	double d;
+	do {
+	  const uint64_t bits = rng();
+	  ::memcpy(&d, &bits, sizeof(d));
+	} while (!std::isfinite(d));
+	::snprintf(buffer, size, "%.17g", d);
+      }
+  ));
+  dataSets.push_back(makeDataSet(
+      "Long significands (30 digits)", count / 4,
+      [](std::mt19937_64& rng, char* buffer, size_t size) {
+	::snprintf(buffer, size, "0.%015llu%015llue%d",
+		   (unsigned long long)(rng() % 1000000000000000ull),
+		   (unsigned long long)(rng() % 1000000000000000ull),
+		   (int)(rng() % 600) - 300);
+      }
+  ));
+
+  for (const DataSet& data : dataSets) {
+    std::vector<double> expected;
+    std::vector<JsonNumber> scanned(data.numbers.size());
+    for (size_t i = 0; i < data.numbers.size(); ++i) {
+      expected.push_back(::strtod(data.numbers[i].c_str(), nullptr));
+      scanNumber(textOf(data.numbers[i]), scanned[i]);
+    }
+
+    printf("%s, %zu numbers, %.1f bytes/number\n", data.name.c_str(),
+	   data.numbers.size(), (double)data.numBytes / data.numbers.size());
+    run("strtod()", data, expected, [&](size_t i) {
+      return ::strtod(data.numbers[i].c_str(), nullptr);
+    });
+    run("std::from_chars()", data, expected, [&](size_t i) {
+      double v = 0.0;
+      const std::string& s = data.numbers[i];
+      std::from_chars(s.data(), s.data() + s.size(), v);
+      return v;
+    });
+    run("util::parseDouble()", data, expected, [&](size_t i) {
+      double v = 0.0;
+      parseDouble(textOf(data.numbers[i]), v);
+      return v;
+    });
+    run("util::toDouble(), already scanned", data, expected,
+	[&](size_t i) { return toDouble(scanned[i]); });
+  }
+  return 0;
+}
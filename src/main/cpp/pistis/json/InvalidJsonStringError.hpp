@@ -0,0 +1,35 @@
+#ifndef __PISTIS__JSON__INVALIDJSONSTRINGERROR_HPP__
+#define __PISTIS__JSON__INVALIDJSONSTRINGERROR_HPP__
+
+#include <pistis/exceptions/PistisException.hpp>
+#include <pistis/json/streaming/JsonEventOrigin.hpp>
+#include <string>
+
+namespace pistis {
+  namespace json {
+
+    /** @brief Thrown when a string contains an invalid escape sequence.
+     *
+     *  The details say what is wrong with the string, and origin() is
+     *  where the reader found the problem.
+     */
+    class InvalidJsonStringError
+	: public pistis::exceptions::PistisException {
+    public:
+      InvalidJsonStringError(
+	  const std::string& details,
+	  const streaming::JsonEventOrigin& origin,
+	  const pistis::exceptions::ExceptionOrigin& exceptionOrigin
+      ):
+	  PistisException(details, exceptionOrigin), origin_(origin) {
+      }
+
+      const streaming::JsonEventOrigin& origin() const { return origin_; }
+
+    private:
+      streaming::JsonEventOrigin origin_;
+    };
+
+  }
+}
+#endif
@@ -0,0 +1,115 @@
+#ifndef __PISTIS__JSON__JSONNUMBER_HPP__
+#define __PISTIS__JSON__JSONNUMBER_HPP__
+
+#include <pistis/json/JsonString.hpp>
+#include <limits>
+#include <ostream>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+
+    /** @brief A JSON number, along with the decimal significand and
+     *         exponent the reader computed while it scanned the number.
+     *
+     *  The value of the number is
+     *  (negative() ? -1 : 1) * significand() * 10^exponent().  At most
+     *  19 significant digits fit in the significand.  If the number has
+     *  more, the rest are dropped and truncated() returns true, in which
+     *  case consumers that need the exact value must convert text()
+     *  themselves.  text() is always the number exactly as it appeared
+     *  in the input.
+     */
+    class JsonNumber {
+    public:
+      /** @brief Maximum number of digits kept in the significand */
+      static constexpr const uint32_t MAX_SIGNIFICANT_DIGITS = 19;
+
+    public:
+      JsonNumber():
+	  text_(), significand_(0), exponent_(0), significantDigits_(0),
+	  negative_(false), truncated_(false) {
+      }
+      JsonNumber(const JsonString& text, uint64_t significand,
+		 int32_t exponent, bool negative, bool truncated):
+	  text_(text), significand_(significand), exponent_(exponent),
+	  significantDigits_(0), negative_(negative), truncated_(truncated) {
+      }
+
+      const JsonString& text() const { return text_; }
+      uint64_t significand() const { return significand_; }
+      int32_t exponent() const { return exponent_; }
+      bool negative() const { return negative_; }
+      bool truncated() const { return truncated_; }
+
+      /** @brief Convert to an int64_t, if possible.
+       *
+       *  Returns true and stores the value in @c value if the number is an
+       *  integer that fits in an int64_t.  Otherwise, returns false and
+       *  leaves @c value unchanged.
+       */
+      bool toInt64(int64_t& value) const {
+	const uint64_t limit =
+	    (uint64_t)std::numeric_limits<int64_t>::max() + negative_;
+	if (truncated_ || exponent_ || (significand_ > limit)) {
+	  return false;
+	}
+	value = negative_ ? (int64_t)(0 - significand_)
+	                  : (int64_t)significand_;
+	return true;
+      }
+
+      /** @brief Reset to zero, in preparation for scanning a new number */
+      void reset() {
+	text_ = JsonString();
+	significand_ = 0;
+	exponent_ = 0;
+	significantDigits_ = 0;
+	negative_ = false;
+	truncated_ = false;
+      }
+
+      void setText(const JsonString& text) { text_ = text; }
+      void setNegative(bool negative) { negative_ = negative; }
+
+      /** @brief Append a digit from the integer part of the number */
+      void addIntegerDigit(uint32_t d) {
+	if (significantDigits_ < MAX_SIGNIFICANT_DIGITS) {
+	  significand_ = significand_ * 10 + d;
+	  significantDigits_ += (significand_ != 0);
+	} else {
+	  ++exponent_;
+	  truncated_ |= (d != 0);
+	}
+      }
+
+      /** @brief Append a digit from the fraction part of the number */
+      void addFractionDigit(uint32_t d) {
+	if (significantDigits_ < MAX_SIGNIFICANT_DIGITS) {
+	  significand_ = significand_ * 10 + d;
+	  significantDigits_ += (significand_ != 0);
+	  --exponent_;
+	} else {
+	  truncated_ |= (d != 0);
+	}
+      }
+
+      /** @brief Add the explicit exponent that follows the 'e' or 'E' */
+      void addExponent(int32_t e) { exponent_ += e; }
+
+    private:
+      JsonString text_;
+      uint64_t significand_;
+      int32_t exponent_;
+      uint32_t significantDigits_;
+      bool negative_;
+      bool truncated_;
+    };
+
+    inline std::ostream& operator<<(std::ostream& out, const JsonNumber& n) {
+      return out << n.text();
+    }
+  }
+}
+
+#endif
@@ -1,10 +1,12 @@
 #include "JsonString.hpp"
+#include <stdint.h>
+#include <string.h>
 
 using namespace pistis::json;
 
 size_t JsonString::hash() const {
   size_t result = 0;
-  for (auto c : s) {
+  for (auto c : *this) {
     result = result * 31 + (unsigned char)c;
   }
   return result;
@@ -15,19 +17,19 @@ int JsonString::cmp(const JsonString& other) const {
   const size_t otherSz = other.size();
   
   if (sz < otherSz) {
-    int o = ::strncmp(begin(), other.begin(), sz);
+    int o = sz ? ::memcmp(begin(), other.begin(), sz) : 0;
     return o ? o : -1;
   } else {
-    int o = ::strncmp(begin(), other.begin(), otherSz);
-    return o ? o :  otherSz - sz;
+    int o = otherSz ? ::memcmp(begin(), other.begin(), otherSz) : 0;
+    return o ? o : (sz > otherSz);
   }
 }
 
 int JsonString::cmp(const char* other) const {
   const char* p = begin();
-  const char* q = other.begin();
+  const char* q = other;
   while ((p != end()) && *q) {
-    const int delta = (int)(*p) - (int)(*q);
+    const int delta = (int)(uint8_t)*p - (int)(uint8_t)*q;
     if (delta) {
       return delta;
     }
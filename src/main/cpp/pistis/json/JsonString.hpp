@@ -8,17 +8,11 @@
 #define JSON_STRING_RELATIONAL_OP(OP, CMP) \
   bool OP(const JsonString& other) const { return CMP; } \
   bool OP(const std::string& other) const { return CMP; } \
-  bool OP(const char* other) const { return CMP; } \
-  template <int N> bool OP(const char other[N]) const { return CMP; } \
-  template <int N> bool OP(char other[N]) const { return CMP; }
+  bool OP(const char* other) const { return CMP; }
 
 #define JSON_STRING_REV_RELATIONAL_OP(OP, CMP) \
-  bool OP(const std::string& x, const JsonString& y) const { return CMP; }   \
-  bool OP(const char* x, const JsonString& y) const { return CMP; }	     \
-  template <int N> bool OP(const char x[N], const JsonString& y) {           \
-    return CMP;                                                              \
-  }                                                                          \
-  template <int N> bool OP(char x[N], const JsonString& y) { return CMP; }
+  inline bool OP(const std::string& x, const JsonString& y) { return CMP; } \
+  inline bool OP(const char* x, const JsonString& y) { return CMP; }
 
 namespace pistis {
   namespace json {
@@ -36,21 +30,11 @@ namespace pistis {
 
       int cmp(const JsonString& other) const;
       int cmp(const char* other) const;
-      
+
       int cmp(const std::string& other) const {
 	return cmp(JsonString(other.c_str(), other.c_str() + other.size()));
       }
 
-      template <int N>
-      int cmp(const char other[N]) const {
-	return cmp(JsonString(&other, &other[N]));
-      }
-
-      template <int N>
-      int cmp(char other[N]) const {
-	return cmp(JsonString(&other, &other[N]));
-      }
-
       size_t hash() const;
       std::string toString() const { return std::string(begin(), end()); }
 
@@ -66,17 +50,18 @@ namespace pistis {
       const char* end_;
     };
 
-    std::ostream& operator<<(std::ostream& out, const JsonString& s) {
+    inline std::ostream& operator<<(std::ostream& out,
+				    const JsonString& s) {
       out.write(s.begin(), s.size());
       return out;
     }
 
     JSON_STRING_REV_RELATIONAL_OP(operator==, !y.cmp(x));
     JSON_STRING_REV_RELATIONAL_OP(operator!=, (bool)y.cmp(x));
-    JSON_STRING_REV_RELATIONAL_OP(operator<, y.cmp(x) < 0);
-    JSON_STRING_REV_RELATIONAL_OP(operator>, y.cmp(x) > 0);
-    JSON_STRING_REV_RELATIONAL_OP(operator<=, y.cmp(x) <= 0);
-    JSON_STRING_REV_RELATIONAL_OP(operator>=, y.cmp(x) >= 0);
+    JSON_STRING_REV_RELATIONAL_OP(operator<, y.cmp(x) > 0);
+    JSON_STRING_REV_RELATIONAL_OP(operator>, y.cmp(x) < 0);
+    JSON_STRING_REV_RELATIONAL_OP(operator<=, y.cmp(x) >= 0);
+    JSON_STRING_REV_RELATIONAL_OP(operator>=, y.cmp(x) <= 0);
   }
 }
 
@@ -0,0 +1,120 @@
+#ifndef __PISTIS__JSON__BINDING__FIELDMATCHER_HPP__
+#define __PISTIS__JSON__BINDING__FIELDMATCHER_HPP__
+
+#include <array>
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace binding {
+
+      /** @brief Finds which of @c N field names a string is, with a
+       *         perfect hash computed at compile time.
+       *
+       *  The hash only looks at the length of the name and its first,
+       *  middle and last characters, so it costs the same for any name.
+       *  The constructor searches for a table size and seed that give
+       *  every name a slot of its own.  find() then compares the string
+       *  with one candidate.  If no such table exists, because two names
+       *  have the same length and the same first, middle and last
+       *  characters, find() compares the string with every name instead.
+       */
+      template <size_t N>
+      class FieldMatcher {
+      public:
+	/** @brief Returned by find() for names that match no field */
+	static constexpr const uint32_t NO_FIELD = 0xFFFFFFFF;
+
+      private:
+	static constexpr size_t minTableSize_() {
+	  size_t size = 1;
+	  while (size < N) {
+	    size <<= 1;
+	  }
+	  return size;
+	}
+
+	static constexpr const size_t MAX_TABLE_SIZE_ = minTableSize_() * 8;
+	static constexpr const uint32_t NUM_SEEDS_ = 64;
+
+      public:
+	constexpr FieldMatcher(const std::array<std::string_view, N>& names):
+	    names_(names), slots_(), mask_(0), seed_(0), perfect_(false) {
+	  for (size_t size = minTableSize_();
+	       !perfect_ && (size <= MAX_TABLE_SIZE_); size <<= 1) {
+	    for (uint32_t seed = 0; !perfect_ && (seed < NUM_SEEDS_); ++seed) {
+	      perfect_ = tryTable_(size - 1, seed);
+	    }
+	  }
+	}
+
+	/** @brief True if find() only compares with one name */
+	constexpr bool perfect() const { return perfect_; }
+
+	constexpr const std::array<std::string_view, N>& names() const {
+	  return names_;
+	}
+
+	/** @brief Index of the field named @c name, or NO_FIELD */
+	uint32_t find(const char* name, size_t size) const {
+	  if (perfect_) {
+	    const uint32_t i = slots_[slot_(name, size, mask_, seed_)];
+	    return ((i != NO_FIELD) && equal_(names_[i], name, size))
+	               ? i : NO_FIELD;
+	  }
+	  for (uint32_t i = 0; i < N; ++i) {
+	    if (equal_(names_[i], name, size)) {
+	      return i;
+	    }
+	  }
+	  return NO_FIELD;
+	}
+
+      private:
+	std::array<std::string_view, N> names_;
+	std::array<uint32_t, MAX_TABLE_SIZE_> slots_;
+	uint32_t mask_;
+	uint32_t seed_;
+	bool perfect_;
+
+	static constexpr uint32_t slot_(const char* name, size_t size,
+					uint32_t mask, uint32_t seed) {
+	  const uint32_t first = size ? (unsigned char)name[0] : 0;
+	  const uint32_t middle = size ? (unsigned char)name[size / 2] : 0;
+	  const uint32_t last = size ? (unsigned char)name[size - 1] : 0;
+	  const uint32_t h = ((uint32_t)size * 0x9E3779B1u) ^
+			     (first * 0x85EBCA77u) ^ (middle * 0xC2B2AE3Du) ^
+			     (last * 0x27D4EB2Fu);
+	  return ((h * (2 * seed + 1)) >> 13) & mask;
+	}
+
+	static bool equal_(std::string_view s, const char* name,
+			   size_t size) {
+	  return (s.size() == size) && !::memcmp(s.data(), name, size);
+	}
+
+	constexpr bool tryTable_(uint32_t mask, uint32_t seed) {
+	  for (size_t i = 0; i <= mask; ++i) {
+	    slots_[i] = NO_FIELD;
+	  }
+	  for (uint32_t i = 0; i < N; ++i) {
+	    const uint32_t s = slot_(names_[i].data(), names_[i].size(),
+				     mask, seed);
+	    if (slots_[s] != NO_FIELD) {
+	      return false;
+	    }
+	    slots_[s] = i;
+	  }
+	  mask_ = mask;
+	  seed_ = seed;
+	  return true;
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,417 @@
+#ifndef __PISTIS__JSON__BINDING__OBJECTBINDING_HPP__
+#define __PISTIS__JSON__BINDING__OBJECTBINDING_HPP__
+
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <pistis/json/binding/FieldMatcher.hpp>
+#include <pistis/json/streaming/JsonEventType.hpp>
+#include <pistis/json/util/NumberParser.hpp>
+#include <array>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace binding {
+
+      /** @brief What a ValueBinding did with the event that starts a
+       *         value
+       */
+      enum class BindAction {
+	DONE,    ///< The event was the whole value
+	OBJECT,  ///< The value is an object.  Its fields follow.
+	ARRAY    ///< The value is an array.  Its elements follow.
+      };
+
+      /** @brief The event a ValueBinding reads a value from */
+      struct BindEvent {
+	streaming::JsonEventType type;
+	const JsonString& text;
+	const JsonNumber& number;
+      };
+
+      struct BindFrame;
+
+      /** @brief Type-erased ValueBinding<V>::read() */
+      typedef BindAction (*ReadValueFn)(void* target, const BindEvent& e,
+					BindFrame& frame);
+
+      /** @brief How to read one field of a bound object */
+      struct FieldBinding {
+	/** @brief Address of the field, given the object */
+	void* (*member)(void* object);
+	ReadValueFn read;
+      };
+
+      /** @brief Everything needed to read a bound object without knowing
+       *         its type
+       */
+      struct ObjectOps {
+	uint32_t (*find)(const char* name, size_t size);
+	const FieldBinding* fields;
+      };
+
+      /** @brief Everything needed to read an array without knowing its
+       *         element type
+       */
+      struct ArrayOps {
+	/** @brief Append an element to the array and return its address */
+	void* (*append)(void* array);
+	ReadValueFn read;
+      };
+
+      /** @brief An object or array a ValueReader is inside of */
+      struct BindFrame {
+	void* target;
+	const ObjectOps* object;
+	const ArrayOps* array;
+
+	/** @brief Field whose value comes next, or 0xFFFFFFFF if a field
+	 *         name comes next
+	 */
+	uint32_t field;
+      };
+
+      /** @brief Declares the fields of a struct.  Specialized by
+       *         PISTIS_JSON_BIND().
+       *
+       *  A specialization has a member
+       *  <tt>static const ObjectOps& ops()</tt>.
+       */
+      template <typename T>
+      struct ObjectBinding;
+
+      namespace detail {
+	template <typename T, typename Enable = void>
+	struct IsBound : std::false_type { };
+
+	template <typename T>
+	struct IsBound<T, std::void_t<decltype(ObjectBinding<T>::ops())> >
+	    : std::true_type {
+	};
+
+	[[noreturn]] inline void cannotConvert(streaming::JsonEventType t,
+					       const char* expected) {
+	  std::ostringstream msg;
+	  msg << "Expected " << expected << ", but got " << t;
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+
+	[[noreturn]] inline void outOfRange(const JsonNumber& n,
+					    const char* type) {
+	  std::ostringstream msg;
+	  msg << n.text() << " is out of the range of " << type;
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+      }
+
+      /** @brief How to read a value of type @c V from the event that
+       *         starts it.
+       *
+       *  Specialized for integers, floating point numbers, bool,
+       *  std::string, std::optional, std::vector and types bound with
+       *  PISTIS_JSON_BIND().  Specialize it to bind other types.
+       */
+      template <typename V, typename Enable = void>
+      struct ValueBinding;
+
+      template <>
+      struct ValueBinding<bool> {
+	static BindAction read(bool& v, const BindEvent& e, BindFrame&) {
+	  if (e.type == streaming::JsonEventType::TRUE_VALUE) {
+	    v = true;
+	  } else if (e.type == streaming::JsonEventType::FALSE_VALUE) {
+	    v = false;
+	  } else {
+	    detail::cannotConvert(e.type, "a boolean");
+	  }
+	  return BindAction::DONE;
+	}
+      };
+
+      /** @brief Integers are converted from the significand and exponent
+       *         the reader computed, without looking at the digits again.
+       */
+      template <typename V>
+      struct ValueBinding<
+	  V, std::enable_if_t<std::is_integral<V>::value>
+      > {
+	static BindAction read(V& v, const BindEvent& e, BindFrame&) {
+	  if (e.type != streaming::JsonEventType::INT_VALUE) {
+	    detail::cannotConvert(e.type, "an integer");
+	  }
+
+	  const JsonNumber& n = e.number;
+	  if (n.truncated() || n.exponent()) {
+	    detail::outOfRange(n, "an integer");
+	  } else if (n.negative()) {
+	    const uint64_t limit =
+		(uint64_t)0 - (uint64_t)std::numeric_limits<V>::min();
+	    if (!std::is_signed<V>::value || (n.significand() > limit)) {
+	      detail::outOfRange(n, "the field's type");
+	    }
+	    v = (V)(0 - n.significand());
+	  } else {
+	    if (n.significand() > (uint64_t)std::numeric_limits<V>::max()) {
+	      detail::outOfRange(n, "the field's type");
+	    }
+	    v = (V)n.significand();
+	  }
+	  return BindAction::DONE;
+	}
+      };
+
+      template <typename V>
+      struct ValueBinding<
+	  V, std::enable_if_t<std::is_floating_point<V>::value>
+      > {
+	static BindAction read(V& v, const BindEvent& e, BindFrame&) {
+	  if ((e.type != streaming::JsonEventType::INT_VALUE) &&
+	      (e.type != streaming::JsonEventType::FLOAT_VALUE)) {
+	    detail::cannotConvert(e.type, "a number");
+	  }
+	  v = (V)util::toDouble(e.number);
+	  return BindAction::DONE;
+	}
+      };
+
+      template <>
+      struct ValueBinding<std::string> {
+	static BindAction read(std::string& v, const BindEvent& e,
+			       BindFrame&) {
+	  if (e.type != streaming::JsonEventType::STRING_VALUE) {
+	    detail::cannotConvert(e.type, "a string");
+	  }
+	  v.assign(e.text.begin(), e.text.end());
+	  return BindAction::DONE;
+	}
+      };
+
+      /** @brief null resets the optional.  Anything else is read into
+       *         its value.
+       */
+      template <typename V>
+      struct ValueBinding<std::optional<V> > {
+	static BindAction read(std::optional<V>& v, const BindEvent& e,
+			       BindFrame& frame) {
+	  if (e.type == streaming::JsonEventType::NULL_VALUE) {
+	    v.reset();
+	    return BindAction::DONE;
+	  }
+	  v.emplace();
+	  return ValueBinding<V>::read(*v, e, frame);
+	}
+      };
+
+      template <typename V>
+      struct ValueBinding<std::vector<V> > {
+	static BindAction read(std::vector<V>& v, const BindEvent& e,
+			       BindFrame& frame) {
+	  if (e.type != streaming::JsonEventType::BEGIN_ARRAY) {
+	    detail::cannotConvert(e.type, "an array");
+	  }
+	  v.clear();
+	  frame.target = &v;
+	  frame.array = &OPS;
+	  return BindAction::ARRAY;
+	}
+
+      private:
+	static void* append_(void* array) {
+	  std::vector<V>& v = *static_cast<std::vector<V>*>(array);
+	  v.emplace_back();
+	  return &v.back();
+	}
+
+	static BindAction readElement_(void* target, const BindEvent& e,
+				       BindFrame& frame) {
+	  return ValueBinding<V>::read(*static_cast<V*>(target), e, frame);
+	}
+
+	static constexpr const ArrayOps OPS = { &append_, &readElement_ };
+      };
+
+      template <typename V>
+      struct ValueBinding<V, std::enable_if_t<detail::IsBound<V>::value> > {
+	static BindAction read(V& v, const BindEvent& e, BindFrame& frame) {
+	  if (e.type != streaming::JsonEventType::BEGIN_OBJECT) {
+	    detail::cannotConvert(e.type, "an object");
+	  }
+	  frame.target = &v;
+	  frame.object = &ObjectBinding<V>::ops();
+	  return BindAction::OBJECT;
+	}
+      };
+
+      namespace detail {
+	template <typename T, typename M, M T::*member>
+	struct MemberBinding {
+	  static void* address(void* object) {
+	    return &(static_cast<T*>(object)->*member);
+	  }
+
+	  static BindAction read(void* target, const BindEvent& e,
+				 BindFrame& frame) {
+	    return ValueBinding<M>::read(*static_cast<M*>(target), e, frame);
+	  }
+
+	  static constexpr FieldBinding field() {
+	    return FieldBinding{ &address, &read };
+	  }
+	};
+      }
+
+    }
+  }
+}
+
+// PISTIS_JSON_FOR_EACH_(M, T, a, b, ...) expands to M(T, a) M(T, b) ...
+// for up to 32 arguments.
+#define PISTIS_JSON_EXPAND_(x) x
+#define PISTIS_JSON_FE_1_(M, T, x) M(T, x)
+#define PISTIS_JSON_FE_2_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_1_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_3_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_2_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_4_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_3_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_5_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_4_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_6_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_5_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_7_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_6_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_8_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_7_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_9_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_8_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_10_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_9_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_11_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_10_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_12_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_11_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_13_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_12_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_14_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_13_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_15_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_14_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_16_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_15_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_17_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_16_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_18_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_17_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_19_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_18_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_20_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_19_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_21_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_20_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_22_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_21_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_23_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_22_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_24_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_23_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_25_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_24_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_26_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_25_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_27_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_26_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_28_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_27_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_29_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_28_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_30_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_29_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_31_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_30_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_32_(M, T, x, ...) \
+  M(T, x) PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_31_(M, T, __VA_ARGS__))
+#define PISTIS_JSON_FE_PICK_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10,  \
+			     _11, _12, _13, _14, _15, _16, _17, _18, _19, \
+			     _20, _21, _22, _23, _24, _25, _26, _27, _28, \
+			     _29, _30, _31, _32, NAME, ...) NAME
+#define PISTIS_JSON_FOR_EACH_(M, T, ...)                               \
+  PISTIS_JSON_EXPAND_(PISTIS_JSON_FE_PICK_(__VA_ARGS__,                \
+      PISTIS_JSON_FE_32_, PISTIS_JSON_FE_31_, PISTIS_JSON_FE_30_,      \
+      PISTIS_JSON_FE_29_, PISTIS_JSON_FE_28_, PISTIS_JSON_FE_27_,      \
+      PISTIS_JSON_FE_26_, PISTIS_JSON_FE_25_, PISTIS_JSON_FE_24_,      \
+      PISTIS_JSON_FE_23_, PISTIS_JSON_FE_22_, PISTIS_JSON_FE_21_,      \
+      PISTIS_JSON_FE_20_, PISTIS_JSON_FE_19_, PISTIS_JSON_FE_18_,      \
+      PISTIS_JSON_FE_17_, PISTIS_JSON_FE_16_, PISTIS_JSON_FE_15_,      \
+      PISTIS_JSON_FE_14_, PISTIS_JSON_FE_13_, PISTIS_JSON_FE_12_,      \
+      PISTIS_JSON_FE_11_, PISTIS_JSON_FE_10_, PISTIS_JSON_FE_9_,       \
+      PISTIS_JSON_FE_8_, PISTIS_JSON_FE_7_, PISTIS_JSON_FE_6_,         \
+      PISTIS_JSON_FE_5_, PISTIS_JSON_FE_4_, PISTIS_JSON_FE_3_,         \
+      PISTIS_JSON_FE_2_, PISTIS_JSON_FE_1_)(M, T, __VA_ARGS__))
+
+#define PISTIS_JSON_FIELD_NAME_(T, member) std::string_view(#member),
+#define PISTIS_JSON_FIELD_BINDING_(T, member)                          \
+  ::pistis::json::binding::detail::MemberBinding<                      \
+      T, decltype(T::member), &T::member                               \
+  >::field(),
+
+/** @brief Bind the fields of struct @c T to JSON fields of the same
+ *         names.
+ *
+ *  Use it at global scope, after the definition of @c T, listing the
+ *  members that correspond to JSON fields, up to 32 of them:
+ *
+ *    struct Trade { int64_t id; double price; std::string symbol; };
+ *    PISTIS_JSON_BIND(Trade, id, price, symbol)
+ *
+ *  The field names are matched with a FieldMatcher built at compile
+ *  time, and each field's value is read straight into its member by
+ *  the member type's ValueBinding.  Fields of the JSON object that are
+ *  not listed are skipped, and listed fields missing from it keep
+ *  their values.
+ */
+#define PISTIS_JSON_BIND(T, ...)                                       \
+  namespace pistis {                                                   \
+    namespace json {                                                   \
+      namespace binding {                                              \
+	template <>                                                    \
+	struct ObjectBinding<T> {                                      \
+	  static constexpr const std::array<                           \
+	      std::string_view,                                        \
+	      std::initializer_list<std::string_view>{                 \
+	          PISTIS_JSON_FOR_EACH_(PISTIS_JSON_FIELD_NAME_, T,    \
+					__VA_ARGS__)                   \
+	      }.size()                                                 \
+	  > NAMES = { {                                                \
+	      PISTIS_JSON_FOR_EACH_(PISTIS_JSON_FIELD_NAME_, T,        \
+				    __VA_ARGS__)                       \
+	  } };                                                         \
+	  static constexpr const FieldMatcher<NAMES.size()> MATCHER =  \
+	      FieldMatcher<NAMES.size()>(NAMES);                       \
+	  static constexpr const FieldBinding FIELDS[] = {             \
+	      PISTIS_JSON_FOR_EACH_(PISTIS_JSON_FIELD_BINDING_, T,     \
+				    __VA_ARGS__)                       \
+	  };                                                           \
+	  static uint32_t find(const char* name, size_t size) {        \
+	    return MATCHER.find(name, size);                           \
+	  }                                                            \
+	  static const ObjectOps& ops() {                              \
+	    static constexpr const ObjectOps OPS = { &find, FIELDS };  \
+	    return OPS;                                                \
+	  }                                                            \
+	};                                                             \
+      }                                                                \
+    }                                                                  \
+  }
+
+#endif
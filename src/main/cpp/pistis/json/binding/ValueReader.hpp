@@ -0,0 +1,158 @@
+#ifndef __PISTIS__JSON__BINDING__VALUEREADER_HPP__
+#define __PISTIS__JSON__BINDING__VALUEREADER_HPP__
+
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/json/binding/ObjectBinding.hpp>
+#include <pistis/json/streaming/JsonEventType.hpp>
+#include <vector>
+
+namespace pistis {
+  namespace json {
+    namespace binding {
+
+      /** @brief Reads the next value of a FlexibleEventStream into a
+       *         value of type @c T, as described by its ValueBinding.
+       *
+       *  The reader keeps its own stack of the objects and arrays it is
+       *  in, so it can stop whenever the stream returns AGAIN and carry
+       *  on from the same place the next time read() is called.  It
+       *  works the same with blocking and non-blocking streams.
+       *
+       *    Trade trade;
+       *    ValueReader<Trade> reader(trade);
+       *    while (!reader.read(stream)) {
+       *      // Wait for more data
+       *    }
+       *
+       *  Fields of an object that @c T's binding does not list are skipped
+       *  with FlexibleEventStream::skipValue(), so they are never
+       *  decoded.  Values that don't fit the types they are bound to
+       *  throw pistis::exceptions::IllegalValueError.
+       */
+      template <typename T>
+      class ValueReader {
+      public:
+	ValueReader(T& target):
+	    target_(&target), stack_(), skipping_(false), done_(false) {
+	}
+
+	/** @brief The value read() reads into */
+	T& target() const { return *target_; }
+
+	/** @brief True once read() has read a whole value */
+	bool done() const { return done_; }
+
+	/** @brief Read the next value of @c stream into target().
+	 *
+	 *  Returns true once the whole value has been read, and false if
+	 *  the stream ran out of data first.  Call read() again when more
+	 *  data is available.
+	 */
+	template <typename EventStream>
+	bool read(EventStream& stream) {
+	  using streaming::JsonEventType;
+
+	  while (!done_) {
+	    if (skipping_) {
+	      if (!stream.skipValue()) {
+		return false;
+	      }
+	      skipping_ = false;
+	    }
+
+	    const JsonEventType eventType = stream.next();
+	    if (eventType == JsonEventType::AGAIN) {
+	      return false;
+	    } else if (eventType == JsonEventType::END) {
+	      throw pistis::exceptions::IllegalStateError(
+		  "Stream ended before the value was read", PISTIS_EX_HERE
+	      );
+	    }
+
+	    const BindEvent e{ eventType, stream.payloadText(),
+			       stream.numberPayload() };
+	    BindFrame frame{ nullptr, nullptr, nullptr, NO_FIELD_ };
+	    BindAction action;
+
+	    if (stack_.empty()) {
+	      if (eventType == JsonEventType::END_RECORD) {
+		// The end of the previous record of an NDJSON stream
+		continue;
+	      }
+	      action = ValueBinding<T>::read(*target_, e, frame);
+	    } else {
+	      BindFrame& top = stack_.back();
+	      if (top.object) {
+		if (eventType == JsonEventType::END_OBJECT) {
+		  pop_();
+		  continue;
+		} else if (eventType == JsonEventType::FIELD_NAME) {
+		  top.field = top.object->find(e.text.begin(), e.text.size());
+		  skipping_ = (top.field == NO_FIELD_);
+		  continue;
+		}
+
+		const FieldBinding& field = top.object->fields[top.field];
+		top.field = NO_FIELD_;
+		action = field.read(field.member(top.target), e, frame);
+	      } else if (eventType == JsonEventType::END_ARRAY) {
+		pop_();
+		continue;
+	      } else {
+		action = top.array->read(top.array->append(top.target), e,
+					 frame);
+	      }
+	    }
+
+	    if (action != BindAction::DONE) {
+	      stack_.push_back(frame);
+	    } else if (stack_.empty()) {
+	      done_ = true;
+	    }
+	  }
+	  return true;
+	}
+
+	/** @brief Read the next value into @c target, for example the next
+	 *         record of an NDJSON stream.
+	 */
+	void reset(T& target) {
+	  target_ = &target;
+	  stack_.clear();
+	  skipping_ = false;
+	  done_ = false;
+	}
+
+      private:
+	static constexpr const uint32_t NO_FIELD_ = 0xFFFFFFFF;
+
+	T* target_;
+	std::vector<BindFrame> stack_;
+	bool skipping_;
+	bool done_;
+
+	void pop_() {
+	  stack_.pop_back();
+	  done_ = stack_.empty();
+	}
+      };
+
+      /** @brief Read the next value of @c stream into a new value of
+       *         type @c T.
+       *
+       *  Meant for blocking streams.  With a non-blocking stream, spins
+       *  until the whole value has arrived.
+       */
+      template <typename T, typename EventStream>
+      T readValue(EventStream& stream) {
+	T value{};
+	ValueReader<T> reader(value);
+	while (!reader.read(stream)) {
+	}
+	return value;
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,267 @@
+#ifndef __PISTIS__JSON__DOM__DOCUMENTBUILDER_HPP__
+#define __PISTIS__JSON__DOM__DOCUMENTBUILDER_HPP__
+
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/json/dom/JsonDocument.hpp>
+#include <pistis/json/dom/JsonValue.hpp>
+#include <pistis/json/memory/MonotonicArena.hpp>
+#include <pistis/json/streaming/JsonEventType.hpp>
+#include <pistis/json/util/NumberParser.hpp>
+#include <memory>
+#include <vector>
+
+namespace pistis {
+  namespace json {
+    namespace dom {
+
+      /** @brief Builds a JsonDocument from the next value of a
+       *         FlexibleEventStream.
+       *
+       *  Every node and string is allocated from one MonotonicArena,
+       *  which the document takes over.  While an array or object is
+       *  open, its children collect on a stack in the builder, and when
+       *  it closes they are copied into the arena in one piece.  So the
+       *  children of each node are contiguous, and building a document
+       *  costs one copy per node and no allocation beyond the arena's
+       *  blocks.  The stacks are kept from one document to the next.
+       *
+       *  If @c referenceInput is true and the stream parses its input in
+       *  place (see FlexibleEventStream::inputText()), strings and field
+       *  names without escape sequences are not copied.  The document
+       *  points into the input instead, so it must not outlive the
+       *  stream.  Otherwise, every string is copied into the arena.
+       *
+       *  Like binding::ValueReader, the builder stops whenever the
+       *  stream returns AGAIN and carries on from the same place the
+       *  next time read() is called.
+       */
+      template <typename Allocator = std::allocator<char> >
+      class DocumentBuilder {
+      public:
+	typedef JsonDocument<Allocator> DocumentType;
+	typedef memory::MonotonicArena<Allocator> ArenaType;
+
+      public:
+	DocumentBuilder(bool referenceInput = true,
+			size_t initialBlockSize = 4096,
+			size_t maxBlockSize = 1024 * 1024,
+			const Allocator& allocator = Allocator()):
+	    referenceInput_(referenceInput),
+	    arena_(initialBlockSize, maxBlockSize, allocator), input_(),
+	    stack_(), values_(), members_(), fieldName_(), root_(nullptr) {
+	}
+	DocumentBuilder(const DocumentBuilder&) = delete;
+	DocumentBuilder(DocumentBuilder&&) = default;
+
+	bool referenceInput() const { return referenceInput_; }
+
+	/** @brief True once read() has read a whole value */
+	bool done() const { return root_ != nullptr; }
+
+	/** @brief Read the next value of @c stream.
+	 *
+	 *  Returns true once the whole value has been read, and false if
+	 *  the stream ran out of data first.  Call read() again when more
+	 *  data is available, and document() once it returns true.
+	 */
+	template <typename EventStream>
+	bool read(EventStream& stream) {
+	  using streaming::JsonEventType;
+
+	  if (referenceInput_) {
+	    input_ = stream.inputText();
+	  }
+
+	  while (!root_) {
+	    const JsonEventType eventType = stream.next();
+	    switch (eventType) {
+	      case JsonEventType::AGAIN:
+		return false;
+
+	      case JsonEventType::END:
+		throw pistis::exceptions::IllegalStateError(
+		    "Stream ended before the value was read", PISTIS_EX_HERE
+		);
+
+	      case JsonEventType::END_RECORD:
+		// The end of the previous record of an NDJSON stream
+		break;
+
+	      case JsonEventType::FIELD_NAME:
+		fieldName_ = string_(stream.payloadText());
+		break;
+
+	      case JsonEventType::BEGIN_OBJECT:
+		stack_.push_back(Frame_{ true, members_.size(), fieldName_ });
+		break;
+
+	      case JsonEventType::BEGIN_ARRAY:
+		stack_.push_back(Frame_{ false, values_.size(), fieldName_ });
+		break;
+
+	      case JsonEventType::END_OBJECT:
+		endObject_();
+		break;
+
+	      case JsonEventType::END_ARRAY:
+		endArray_();
+		break;
+
+	      case JsonEventType::STRING_VALUE:
+		add_(JsonValue::string(string_(stream.payloadText())));
+		break;
+
+	      case JsonEventType::INT_VALUE:
+		addInteger_(stream.numberPayload());
+		break;
+
+	      case JsonEventType::FLOAT_VALUE:
+		add_(JsonValue::floating(
+		    util::toDouble(stream.numberPayload())
+		));
+		break;
+
+	      case JsonEventType::TRUE_VALUE:
+		add_(JsonValue::boolean(true));
+		break;
+
+	      case JsonEventType::FALSE_VALUE:
+		add_(JsonValue::boolean(false));
+		break;
+
+	      case JsonEventType::NULL_VALUE:
+		add_(JsonValue());
+		break;
+
+	      default:
+		throw pistis::exceptions::IllegalStateError(
+		    "Unknown event type", PISTIS_EX_HERE
+		);
+	    }
+	  }
+	  return true;
+	}
+
+	/** @brief Hand the value read() just read over as a document, and
+	 *         get ready to read the next one.
+	 */
+	DocumentType document() {
+	  if (!root_) {
+	    throw pistis::exceptions::IllegalStateError(
+		"read() has not read a whole value yet", PISTIS_EX_HERE
+	    );
+	  }
+
+	  DocumentType doc(std::move(arena_), root_);
+	  root_ = nullptr;
+	  return doc;
+	}
+
+	/** @brief Forget the value read() is in the middle of */
+	void reset() {
+	  stack_.clear();
+	  values_.clear();
+	  members_.clear();
+	  arena_.clear();
+	  root_ = nullptr;
+	}
+
+	DocumentBuilder& operator=(const DocumentBuilder&) = delete;
+	DocumentBuilder& operator=(DocumentBuilder&&) = default;
+
+      private:
+	struct Frame_ {
+	  bool object;
+
+	  // Where the children of the array or object start on values_ or
+	  // members_
+	  size_t begin;
+
+	  // Name of the field the array or object is the value of
+	  JsonString fieldName;
+	};
+
+	bool referenceInput_;
+	ArenaType arena_;
+	JsonString input_;
+	std::vector<Frame_> stack_;
+	std::vector<JsonValue> values_;
+	std::vector<JsonMember> members_;
+	JsonString fieldName_;
+	const JsonValue* root_;
+
+	JsonString string_(const JsonString& text) {
+	  if (text.size() > 0xFFFFFFFF) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Strings longer than 4GB are not supported", PISTIS_EX_HERE
+	    );
+	  } else if ((text.begin() >= input_.begin()) &&
+		     (text.end() <= input_.end()) && input_.size()) {
+	    return text;
+	  } else {
+	    return arena_.copy(text);
+	  }
+	}
+
+	void addInteger_(const JsonNumber& n) {
+	  int64_t value;
+	  if (n.toInt64(value)) {
+	    add_(JsonValue::integer(value));
+	  } else {
+	    // Too big for an int64_t
+	    add_(JsonValue::floating(util::toDouble(n)));
+	  }
+	}
+
+	void add_(const JsonValue& value) {
+	  if (stack_.empty()) {
+	    root_ = arena_.copy(&value, 1);
+	  } else if (stack_.back().object) {
+	    members_.emplace_back(fieldName_, value);
+	  } else {
+	    values_.push_back(value);
+	  }
+	}
+
+	void endObject_() {
+	  const Frame_ frame = stack_.back();
+	  const size_t n = members_.size() - frame.begin;
+	  const JsonMember* members =
+	      arena_.copy(members_.data() + frame.begin, n);
+	  members_.erase(members_.begin() + frame.begin, members_.end());
+	  stack_.pop_back();
+	  fieldName_ = frame.fieldName;
+	  add_(JsonValue::object(members, n));
+	}
+
+	void endArray_() {
+	  const Frame_ frame = stack_.back();
+	  const size_t n = values_.size() - frame.begin;
+	  const JsonValue* values =
+	      arena_.copy(values_.data() + frame.begin, n);
+	  values_.erase(values_.begin() + frame.begin, values_.end());
+	  stack_.pop_back();
+	  fieldName_ = frame.fieldName;
+	  add_(JsonValue::array(values, n));
+	}
+      };
+
+      /** @brief Read the next value of @c stream into a new document.
+       *
+       *  Meant for blocking streams.  With a non-blocking stream, spins
+       *  until the whole value has arrived.
+       */
+      template <typename EventStream>
+      JsonDocument<> readDocument(EventStream& stream,
+				  bool referenceInput = true) {
+	DocumentBuilder<> builder(referenceInput);
+	while (!builder.read(stream)) {
+	}
+	return builder.document();
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,51 @@
+#ifndef __PISTIS__JSON__DOM__JSONDOCUMENT_HPP__
+#define __PISTIS__JSON__DOM__JSONDOCUMENT_HPP__
+
+#include <pistis/json/dom/JsonValue.hpp>
+#include <pistis/json/memory/MonotonicArena.hpp>
+#include <memory>
+
+namespace pistis {
+  namespace json {
+    namespace dom {
+
+      /** @brief A JSON value held in memory as a tree of JsonValue nodes.
+       *
+       *  The document owns the arena its nodes and strings were
+       *  allocated from, so destroying it frees the whole tree at once,
+       *  without visiting a single node.  Strings that a DocumentBuilder
+       *  took straight from its input point into that input instead, and
+       *  are only valid as long as it is.  Documents can be moved but not
+       *  copied.
+       */
+      template <typename Allocator = std::allocator<char> >
+      class JsonDocument {
+      public:
+	typedef memory::MonotonicArena<Allocator> ArenaType;
+
+      public:
+	JsonDocument(ArenaType&& arena, const JsonValue* root):
+	    arena_(std::move(arena)), root_(root) {
+	}
+	JsonDocument(const JsonDocument&) = delete;
+	JsonDocument(JsonDocument&&) = default;
+
+	const JsonValue& root() const { return *root_; }
+
+	/** @brief Memory the document holds, not counting strings that
+	 *         point into the input
+	 */
+	size_t bytesAllocated() const { return arena_.bytesAllocated(); }
+
+	JsonDocument& operator=(const JsonDocument&) = delete;
+	JsonDocument& operator=(JsonDocument&&) = default;
+
+      private:
+	ArenaType arena_;
+	const JsonValue* root_;
+      };
+
+    }
+  }
+}
+#endif
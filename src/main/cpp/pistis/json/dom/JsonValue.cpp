@@ -0,0 +1,24 @@
+#include "JsonValue.hpp"
+#include <sstream>
+
+using namespace pistis::json::dom;
+
+std::ostream& pistis::json::dom::operator<<(std::ostream& out,
+					    JsonValueType t) {
+  switch (t) {
+    case JsonValueType::NULL_VALUE: return out << "NULL_VALUE";
+    case JsonValueType::BOOL:       return out << "BOOL";
+    case JsonValueType::INT:        return out << "INT";
+    case JsonValueType::FLOAT:      return out << "FLOAT";
+    case JsonValueType::STRING:     return out << "STRING";
+    case JsonValueType::ARRAY:      return out << "ARRAY";
+    case JsonValueType::OBJECT:     return out << "OBJECT";
+    default:                        return out << "**UNKNOWN**";
+  }
+}
+
+void JsonValue::wrongType_(JsonValueType expected) const {
+  std::ostringstream msg;
+  msg << "Value is " << type_ << ", not " << expected;
+  throw pistis::exceptions::IllegalStateError(msg.str(), PISTIS_EX_HERE);
+}
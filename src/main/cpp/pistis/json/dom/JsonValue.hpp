@@ -0,0 +1,218 @@
+#ifndef __PISTIS__JSON__DOM__JSONVALUE_HPP__
+#define __PISTIS__JSON__DOM__JSONVALUE_HPP__
+
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace dom {
+
+      enum class JsonValueType : uint8_t {
+	NULL_VALUE,
+	BOOL,
+	INT,
+	FLOAT,
+	STRING,
+	ARRAY,
+	OBJECT
+      };
+
+      std::ostream& operator<<(std::ostream& out, JsonValueType t);
+
+      class JsonMember;
+
+      /** @brief A node of a JsonDocument.
+       *
+       *  Sixteen bytes: the type, the length of a string or the number
+       *  of children of an array or object, and the value itself or a
+       *  pointer to the string or the children.  The elements of an
+       *  array and the members of an object lie next to each other in
+       *  memory, so walking them is a linear scan, and they and the
+       *  strings live in the document's arena.  Nodes never change once
+       *  the document is built.
+       *
+       *  Object members are kept in the order they appeared in the
+       *  input, duplicates and all, and find() returns the first one
+       *  with the given name.
+       */
+      class JsonValue {
+      public:
+	/** @brief Null */
+	JsonValue(): type_(JsonValueType::NULL_VALUE), size_(0) {
+	  value_.i = 0;
+	}
+
+	static JsonValue boolean(bool b) {
+	  JsonValue v(JsonValueType::BOOL, 0);
+	  v.value_.b = b;
+	  return v;
+	}
+
+	static JsonValue integer(int64_t i) {
+	  JsonValue v(JsonValueType::INT, 0);
+	  v.value_.i = i;
+	  return v;
+	}
+
+	static JsonValue floating(double d) {
+	  JsonValue v(JsonValueType::FLOAT, 0);
+	  v.value_.d = d;
+	  return v;
+	}
+
+	/** @brief A string whose text is @c text, which must outlive the
+	 *         value and be shorter than 4GB.
+	 */
+	static JsonValue string(const JsonString& text) {
+	  JsonValue v(JsonValueType::STRING, text.size());
+	  v.value_.s = text.begin();
+	  return v;
+	}
+
+	/** @brief An array of the @c n values at @c elements */
+	static JsonValue array(const JsonValue* elements, uint32_t n) {
+	  JsonValue v(JsonValueType::ARRAY, n);
+	  v.value_.elements = elements;
+	  return v;
+	}
+
+	/** @brief An object with the @c n members at @c members */
+	static JsonValue object(const JsonMember* members, uint32_t n) {
+	  JsonValue v(JsonValueType::OBJECT, n);
+	  v.value_.members = members;
+	  return v;
+	}
+
+	JsonValueType type() const { return type_; }
+	bool isNull() const { return type_ == JsonValueType::NULL_VALUE; }
+	bool isBool() const { return type_ == JsonValueType::BOOL; }
+	bool isInt() const { return type_ == JsonValueType::INT; }
+	bool isFloat() const { return type_ == JsonValueType::FLOAT; }
+	bool isNumber() const { return isInt() || isFloat(); }
+	bool isString() const { return type_ == JsonValueType::STRING; }
+	bool isArray() const { return type_ == JsonValueType::ARRAY; }
+	bool isObject() const { return type_ == JsonValueType::OBJECT; }
+
+	bool boolValue() const {
+	  check_(JsonValueType::BOOL);
+	  return value_.b;
+	}
+
+	int64_t intValue() const {
+	  check_(JsonValueType::INT);
+	  return value_.i;
+	}
+
+	/** @brief The value of a number, converting integers to double */
+	double floatValue() const {
+	  if (isInt()) {
+	    return (double)value_.i;
+	  }
+	  check_(JsonValueType::FLOAT);
+	  return value_.d;
+	}
+
+	JsonString stringValue() const {
+	  check_(JsonValueType::STRING);
+	  return JsonString(value_.s, value_.s + size_);
+	}
+
+	/** @brief Number of elements of an array or members of an object,
+	 *         or zero for anything else
+	 */
+	uint32_t size() const {
+	  return (isArray() || isObject()) ? size_ : 0;
+	}
+
+	/** @brief The elements of an array */
+	const JsonValue* beginElements() const {
+	  check_(JsonValueType::ARRAY);
+	  return value_.elements;
+	}
+	const JsonValue* endElements() const {
+	  return beginElements() + size_;
+	}
+
+	/** @brief The members of an object */
+	const JsonMember* beginMembers() const {
+	  check_(JsonValueType::OBJECT);
+	  return value_.members;
+	}
+	const JsonMember* endMembers() const;
+
+	/** @brief Element @c i of an array */
+	const JsonValue& operator[](uint32_t i) const {
+	  return beginElements()[i];
+	}
+
+	/** @brief Value of the first member of an object named @c name, or
+	 *         null if it has no such member
+	 */
+	const JsonValue* find(const JsonString& name) const;
+	const JsonValue* find(const char* name) const {
+	  return find(JsonString(name, name + ::strlen(name)));
+	}
+
+      private:
+	JsonValueType type_;
+	uint32_t size_;
+	union {
+	  bool b;
+	  int64_t i;
+	  double d;
+	  const char* s;
+	  const JsonValue* elements;
+	  const JsonMember* members;
+	} value_;
+
+	JsonValue(JsonValueType type, uint32_t size):
+	    type_(type), size_(size) {
+	}
+
+	void check_(JsonValueType type) const {
+	  if (type_ != type) {
+	    wrongType_(type);
+	  }
+	}
+
+	[[noreturn]] void wrongType_(JsonValueType expected) const;
+      };
+
+      /** @brief A member of an object: its name and its value */
+      class JsonMember {
+      public:
+	JsonMember(const JsonString& name, const JsonValue& value):
+	    name_(name), value_(value) {
+	}
+
+	const JsonString& name() const { return name_; }
+	const JsonValue& value() const { return value_; }
+
+      private:
+	JsonString name_;
+	JsonValue value_;
+      };
+
+      inline const JsonMember* JsonValue::endMembers() const {
+	return beginMembers() + size_;
+      }
+
+      inline const JsonValue* JsonValue::find(const JsonString& name) const {
+	for (const JsonMember* m = beginMembers(); m != endMembers(); ++m) {
+	  if ((m->name().size() == name.size()) &&
+	      !::memcmp(m->name().begin(), name.begin(), name.size())) {
+	    return &m->value();
+	  }
+	}
+	return nullptr;
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,36 @@
+#ifndef __PISTIS__JSON__EXCEPTIONS__JSONPARSEERROR_HPP__
+#define __PISTIS__JSON__EXCEPTIONS__JSONPARSEERROR_HPP__
+
+#include <pistis/exceptions/PistisException.hpp>
+#include <pistis/json/streaming/JsonEventOrigin.hpp>
+#include <string>
+
+namespace pistis {
+  namespace json {
+    namespace exceptions {
+
+      /** @brief Thrown when a JSON document is malformed.
+       *
+       *  The details say what is wrong and where, and origin() is the
+       *  location of the error in the document.
+       */
+      class JsonParseError : public pistis::exceptions::PistisException {
+      public:
+	JsonParseError(
+	    const std::string& details,
+	    const streaming::JsonEventOrigin& origin,
+	    const pistis::exceptions::ExceptionOrigin& exceptionOrigin
+	):
+	    PistisException(details, exceptionOrigin), origin_(origin) {
+	}
+
+	const streaming::JsonEventOrigin& origin() const { return origin_; }
+
+      private:
+	streaming::JsonEventOrigin origin_;
+      };
+
+    }
+  }
+}
+#endif
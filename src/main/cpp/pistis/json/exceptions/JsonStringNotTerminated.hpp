@@ -0,0 +1,44 @@
+#ifndef __PISTIS__JSON__EXCEPTIONS__JSONSTRINGNOTTERMINATED_HPP__
+#define __PISTIS__JSON__EXCEPTIONS__JSONSTRINGNOTTERMINATED_HPP__
+
+#include <pistis/exceptions/PistisException.hpp>
+#include <pistis/json/streaming/JsonEventOrigin.hpp>
+#include <sstream>
+#include <string>
+
+namespace pistis {
+  namespace json {
+    namespace exceptions {
+
+      /** @brief Thrown when the stream ends, or a line ends, inside a
+       *         string.  origin() is where the reader stopped.
+       */
+      class JsonStringNotTerminated
+	  : public pistis::exceptions::PistisException {
+      public:
+	JsonStringNotTerminated(
+	    const streaming::JsonEventOrigin& origin,
+	    const pistis::exceptions::ExceptionOrigin& exceptionOrigin
+	):
+	    PistisException(createMessage_(origin), exceptionOrigin),
+	    origin_(origin) {
+	}
+
+	const streaming::JsonEventOrigin& origin() const { return origin_; }
+
+      private:
+	streaming::JsonEventOrigin origin_;
+
+	static std::string createMessage_(
+	    const streaming::JsonEventOrigin& origin
+	) {
+	  std::ostringstream msg;
+	  msg << "String not terminated at " << origin;
+	  return msg.str();
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,96 @@
+#include "BufferPool.hpp"
+#include <new>
+#include <string.h>
+
+using namespace pistis::json::memory;
+
+BufferPool::State_::State_(size_t maxBytes):
+    maxBytesCached(maxBytes), stats(), open(true) {
+  ::memset(free, 0, sizeof(free));
+}
+
+void* BufferPool::State_::allocate(size_t size) {
+  const uint32_t c = sizeClass_(size);
+  const size_t n = (size_t)1 << c;
+  void* p;
+
+  if (!open) {
+    return ::operator new(n);
+  } else if (free[c]) {
+    p = free[c];
+    free[c] = free[c]->next;
+    stats.bytesCached -= n;
+    ++stats.numReused;
+  } else {
+    p = ::operator new(n);
+  }
+
+  ++stats.numAllocated;
+  stats.bytesInUse += n;
+  if (stats.bytesInUse > stats.peakBytesInUse) {
+    stats.peakBytesInUse = stats.bytesInUse;
+  }
+  return p;
+}
+
+void BufferPool::State_::deallocate(void* p, size_t size) {
+  const uint32_t c = sizeClass_(size);
+  const size_t n = (size_t)1 << c;
+
+  if (!open) {
+    ::operator delete(p);
+    return;
+  }
+
+  stats.bytesInUse -= n;
+  if ((stats.bytesCached + n) <= maxBytesCached) {
+    FreeBuffer_* b = (FreeBuffer_*)p;
+    b->next = free[c];
+    free[c] = b;
+    stats.bytesCached += n;
+  } else {
+    ::operator delete(p);
+    ++stats.numFreed;
+  }
+}
+
+void BufferPool::State_::trim() {
+  for (uint32_t c = 0; c < NUM_CLASSES_; ++c) {
+    while (free[c]) {
+      FreeBuffer_* b = free[c];
+      free[c] = b->next;
+      ::operator delete(b);
+      ++stats.numFreed;
+    }
+  }
+  stats.bytesCached = 0;
+}
+
+void* BufferPool::Handle::allocate(size_t size) const {
+  return state_->allocate(size);
+}
+
+void BufferPool::Handle::deallocate(void* p, size_t size) const {
+  state_->deallocate(p, size);
+}
+
+BufferPool::BufferPool(size_t maxBytesCached):
+    state_(std::make_shared<State_>(maxBytesCached)) {
+}
+
+BufferPool::~BufferPool() {
+  state_->trim();
+  state_->open = false;
+}
+
+void BufferPool::resetStatistics() {
+  state_->stats.numAllocated = 0;
+  state_->stats.numReused = 0;
+  state_->stats.numFreed = 0;
+  state_->stats.peakBytesInUse = state_->stats.bytesInUse;
+}
+
+BufferPool& BufferPool::local() {
+  static thread_local BufferPool pool;
+  return pool;
+}
@@ -0,0 +1,160 @@
+#ifndef __PISTIS__JSON__MEMORY__BUFFERPOOL_HPP__
+#define __PISTIS__JSON__MEMORY__BUFFERPOOL_HPP__
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace memory {
+
+      /** @brief Counts of what a BufferPool has done */
+      struct BufferPoolStatistics {
+	/** @brief Buffers handed out, new or reused */
+	uint64_t numAllocated;
+
+	/** @brief Buffers handed out that came from the cache */
+	uint64_t numReused;
+
+	/** @brief Buffers returned to the heap because the cache was
+	 *         full, or by trim()
+	 */
+	uint64_t numFreed;
+
+	/** @brief Bytes in buffers that have been handed out and not
+	 *         returned yet
+	 */
+	uint64_t bytesInUse;
+	uint64_t peakBytesInUse;
+
+	/** @brief Bytes in buffers waiting in the cache to be reused */
+	uint64_t bytesCached;
+      };
+
+      /** @brief Recycles buffers, so a parser that keeps allocating and
+       *         freeing them doesn't go to the heap each time.
+       *
+       *  Sizes are rounded up to a power of two, at least 64 bytes, and
+       *  buffers that are freed wait in a list for their size until
+       *  someone asks for that size again.  Once maxBytesCached() bytes
+       *  are waiting, further buffers go back to the heap.
+       *
+       *  A pool is not thread-safe.  Use one per stream, or one per
+       *  thread (see local()), and share it between the reader, its
+       *  string buffers and the event stream with BufferPoolAllocator.
+       *  Buffers returned through a Handle after the pool is destroyed
+       *  go straight back to the heap, so containers may outlive the
+       *  pool they allocate from.
+       */
+      class BufferPool {
+      private:
+	struct State_;
+
+      public:
+	/** @brief Reference to a pool that stays valid after the pool is
+	 *         destroyed.  BufferPoolAllocator holds one.
+	 *
+	 *  Once the pool is gone, allocate() and deallocate() use the heap
+	 *  directly.
+	 */
+	class Handle {
+	public:
+	  void* allocate(size_t size) const;
+	  void deallocate(void* p, size_t size) const;
+
+	  bool operator==(const Handle& other) const {
+	    return state_ == other.state_;
+	  }
+	  bool operator!=(const Handle& other) const {
+	    return state_ != other.state_;
+	  }
+
+	private:
+	  std::shared_ptr<State_> state_;
+
+	  explicit Handle(const std::shared_ptr<State_>& state):
+	      state_(state) {
+	  }
+
+	  friend class BufferPool;
+	};
+
+      public:
+	explicit BufferPool(size_t maxBytesCached = 64 * 1024 * 1024);
+	BufferPool(const BufferPool&) = delete;
+	~BufferPool();
+
+	size_t maxBytesCached() const { return state_->maxBytesCached; }
+	const BufferPoolStatistics& statistics() const {
+	  return state_->stats;
+	}
+
+	/** @brief Number of bytes a request for @c size bytes gets */
+	static size_t roundedSize(size_t size) {
+	  return (size_t)1 << sizeClass_(size);
+	}
+
+	Handle handle() const { return Handle(state_); }
+
+	/** @brief Get a buffer of at least @c size bytes */
+	void* allocate(size_t size) { return state_->allocate(size); }
+
+	/** @brief Return a buffer got from allocate(@c size) */
+	void deallocate(void* p, size_t size) { state_->deallocate(p, size); }
+
+	/** @brief Return all the cached buffers to the heap */
+	void trim() { state_->trim(); }
+
+	/** @brief Zero the counts in statistics(), except for the bytes in
+	 *         use and in the cache
+	 */
+	void resetStatistics();
+
+	/** @brief The pool for the calling thread, which lasts until the
+	 *         thread exits
+	 */
+	static BufferPool& local();
+
+	BufferPool& operator=(const BufferPool&) = delete;
+
+      private:
+	static constexpr const uint32_t MIN_CLASS_ = 6;
+	static constexpr const uint32_t NUM_CLASSES_ = 64;
+
+	// Cached buffers keep the next buffer of their list in their
+	// first bytes
+	struct FreeBuffer_ {
+	  FreeBuffer_* next;
+	};
+
+	// What the pool and its handles share.  Lives until the last of
+	// them is gone.
+	struct State_ {
+	  size_t maxBytesCached;
+	  FreeBuffer_* free[NUM_CLASSES_];
+	  BufferPoolStatistics stats;
+
+	  // False once the pool is destroyed
+	  bool open;
+
+	  explicit State_(size_t maxBytesCached);
+
+	  void* allocate(size_t size);
+	  void deallocate(void* p, size_t size);
+	  void trim();
+	};
+
+	std::shared_ptr<State_> state_;
+
+	static uint32_t sizeClass_(size_t size) {
+	  return (size <= ((size_t)1 << MIN_CLASS_))
+	             ? MIN_CLASS_
+	             : 64 - __builtin_clzll((unsigned long long)size - 1);
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,75 @@
+#ifndef __PISTIS__JSON__MEMORY__BUFFERPOOLALLOCATOR_HPP__
+#define __PISTIS__JSON__MEMORY__BUFFERPOOLALLOCATOR_HPP__
+
+#include <pistis/json/memory/BufferPool.hpp>
+#include <stddef.h>
+
+namespace pistis {
+  namespace json {
+    namespace memory {
+
+      /** @brief Allocator that gets its memory from a BufferPool.
+       *
+       *  Copies share the same pool, so giving one to a
+       *  FlexibleEventStream makes its reader's buffer, its string
+       *  buffers, its symbol table and its shape cache all recycle
+       *  memory through that pool.  A default-constructed allocator uses
+       *  the calling thread's pool, BufferPool::local().  Allocators hold
+       *  a BufferPool::Handle, so they may outlive their pool.
+       *
+       *    memory::BufferPool pool;
+       *    FlexibleEventStream<Stream, Factory, util::Utf8CharEncoder,
+       *                        memory::BufferPoolAllocator<> >
+       *        events(name, std::move(stream), factory, 65536,
+       *               PathProjection(),
+       *               memory::BufferPoolAllocator<>(pool));
+       */
+      template <typename T = char>
+      class BufferPoolAllocator {
+      public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind {
+	  typedef BufferPoolAllocator<U> other;
+	};
+
+      public:
+	BufferPoolAllocator(): pool_(BufferPool::local().handle()) { }
+	explicit BufferPoolAllocator(BufferPool& pool):
+	    pool_(pool.handle()) {
+	}
+
+	template <typename U>
+	BufferPoolAllocator(const BufferPoolAllocator<U>& other):
+	    pool_(other.handle()) {
+	}
+
+	const BufferPool::Handle& handle() const { return pool_; }
+
+	T* allocate(size_t n) {
+	  return (T*)pool_.allocate(n * sizeof(T));
+	}
+
+	void deallocate(T* p, size_t n) {
+	  pool_.deallocate(p, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const BufferPoolAllocator<U>& other) const {
+	  return pool_ == other.handle();
+	}
+
+	template <typename U>
+	bool operator!=(const BufferPoolAllocator<U>& other) const {
+	  return pool_ != other.handle();
+	}
+
+      private:
+	BufferPool::Handle pool_;
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef __PISTIS__JSON__MEMORY__MONOTONICARENA_HPP__
+#define __PISTIS__JSON__MEMORY__MONOTONICARENA_HPP__
+
+#include <pistis/json/JsonString.hpp>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace memory {
+
+      /** @brief Hands out memory from large blocks and frees it all at
+       *         once.
+       *
+       *  Each allocation just bumps a pointer into the current block.
+       *  When a block fills up, the arena allocates a new one from
+       *  @c Allocator, twice the size of the last, up to maxBlockSize().
+       *  Requests larger than that get a block of their own.  Nothing is
+       *  freed until clear() is called or the arena is destroyed, and
+       *  then each block is freed with one call, however many objects
+       *  were allocated in it.  Destructors are never run, so only
+       *  trivially destructible objects belong in an arena.
+       */
+      template <typename Allocator = std::allocator<char> >
+      class MonotonicArena : Allocator {
+      public:
+	MonotonicArena(size_t initialBlockSize = 4096,
+		       size_t maxBlockSize = 1024 * 1024,
+		       const Allocator& allocator = Allocator()):
+	    Allocator(allocator), initialBlockSize_(initialBlockSize),
+	    maxBlockSize_(std::max(initialBlockSize, maxBlockSize)),
+	    nextBlockSize_(initialBlockSize), blocks_(), current_(nullptr),
+	    eob_(nullptr), bytesAllocated_(0) {
+	}
+	MonotonicArena(const MonotonicArena&) = delete;
+	MonotonicArena(MonotonicArena&& other):
+	    Allocator(std::move(other)),
+	    initialBlockSize_(other.initialBlockSize_),
+	    maxBlockSize_(other.maxBlockSize_),
+	    nextBlockSize_(other.nextBlockSize_),
+	    blocks_(std::move(other.blocks_)), current_(other.current_),
+	    eob_(other.eob_), bytesAllocated_(other.bytesAllocated_) {
+	  other.blocks_.clear();
+	  other.current_ = nullptr;
+	  other.eob_ = nullptr;
+	  other.bytesAllocated_ = 0;
+	}
+	~MonotonicArena() { clear(); }
+
+	const Allocator& allocator() const { return (const Allocator&)*this; }
+	size_t initialBlockSize() const { return initialBlockSize_; }
+	size_t maxBlockSize() const { return maxBlockSize_; }
+
+	/** @brief Total size of the blocks the arena holds */
+	size_t bytesAllocated() const { return bytesAllocated_; }
+
+	/** @brief Allocate @c size bytes aligned to @c alignment, which
+	 *         must be a power of two.
+	 */
+	void* allocate(size_t size, size_t alignment = alignof(max_align_t)) {
+	  char* p = align_(current_, alignment);
+	  if (!current_ || ((size_t)(eob_ - p) < size)) {
+	    return allocateSlow_(size, alignment);
+	  }
+	  current_ = p + size;
+	  return p;
+	}
+
+	/** @brief Allocate room for @c n objects of type @c T, without
+	 *         constructing them
+	 */
+	template <typename T>
+	T* allocate(size_t n) {
+	  return (T*)allocate(n * sizeof(T), alignof(T));
+	}
+
+	/** @brief Copy @c n objects of type @c T from @c p into the arena
+	 *         and return the copy
+	 */
+	template <typename T>
+	T* copy(const T* p, size_t n) {
+	  static_assert(std::is_trivially_copyable<T>::value,
+			"Only trivially copyable objects can be copied");
+	  if (!n) {
+	    return nullptr;
+	  }
+	  T* q = allocate<T>(n);
+	  ::memcpy((void*)q, p, n * sizeof(T));
+	  return q;
+	}
+
+	/** @brief Copy @c text into the arena */
+	JsonString copy(const JsonString& text) {
+	  const char* p = copy(text.begin(), text.size());
+	  return JsonString(p, p + text.size());
+	}
+
+	/** @brief Free every block, and everything allocated from them */
+	void clear() {
+	  for (const auto& block : blocks_) {
+	    this->deallocate(block.first, block.second);
+	  }
+	  blocks_.clear();
+	  current_ = nullptr;
+	  eob_ = nullptr;
+	  bytesAllocated_ = 0;
+	  nextBlockSize_ = initialBlockSize_;
+	}
+
+	MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+      private:
+	size_t initialBlockSize_;
+	size_t maxBlockSize_;
+	size_t nextBlockSize_;
+	std::vector<std::pair<char*, size_t> > blocks_;
+	char* current_;
+	char* eob_;
+	size_t bytesAllocated_;
+
+	static char* align_(char* p, size_t alignment) {
+	  return (char*)(((uintptr_t)p + alignment - 1) & ~(alignment - 1));
+	}
+
+	char* allocateSlow_(size_t size, size_t alignment) {
+	  const size_t needed = size + alignment - 1;
+	  if (needed > (maxBlockSize_ / 2)) {
+	    // Give it a block of its own, and keep filling the current
+	    // block
+	    return align_(newBlock_(needed), alignment);
+	  }
+
+	  current_ = newBlock_(std::max(nextBlockSize_, needed));
+	  eob_ = current_ + blocks_.back().second;
+	  nextBlockSize_ = std::min(maxBlockSize_, 2 * nextBlockSize_);
+
+	  char* p = align_(current_, alignment);
+	  current_ = p + size;
+	  return p;
+	}
+
+	char* newBlock_(size_t size) {
+	  char* block = Allocator::allocate(size);
+	  blocks_.emplace_back(block, size);
+	  bytesAllocated_ += size;
+	  return block;
+	}
+      };
+
+    }
+  }
+}
+#endif
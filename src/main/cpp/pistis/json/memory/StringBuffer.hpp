@@ -4,6 +4,7 @@
 #include <pistis/json/JsonString.hpp>
 #include <pistis/memory/AllocationUtils.hpp>
 #include <memory>
+#include <tuple>
 #include <string.h>
 
 namespace pistis {
@@ -16,15 +17,15 @@ namespace pistis {
 	StringBuffer(size_t initialSize = 16, size_t maxSize = (size_t)-1,
 		     const Allocator& allocator = Allocator()):
 	    Allocator(allocator), initialSize_(initialSize), maxSize_(maxSize),
-	    begin_(initalSize ? this->allocate(initialSize) : nullptr),
-	    end(begin_ + initialSize) {
+	    begin_(initialSize ? this->allocate(initialSize) : nullptr),
+	    end_(begin_), eos_(begin_ + initialSize) {
 	}
 	StringBuffer(const StringBuffer&) = delete;
-	StringBuffer(StringBuffer&& other) nothrow:
-	    Allocator(std::move(other)), initialSize_(other.initialSize()),
-	    maxSize(other.maxSize()), begin_(other.begin()), end_(other.end()),
-	    eos_(other.eos_) {
-	  other.reset();
+	StringBuffer(StringBuffer&& other) noexcept:
+	    Allocator(std::move((Allocator&)other)),
+	    initialSize_(other.initialSize()), maxSize_(other.maxSize()),
+	    begin_(other.begin_), end_(other.end_), eos_(other.eos_) {
+	  other.begin_ = other.end_ = other.eos_ = nullptr;
 	}
 	~StringBuffer() {
 	  free_();
@@ -49,7 +50,7 @@ namespace pistis {
 	void write(const char* begin, const char* end) {
 	  if (begin < end) {
 	    const size_t sz = end - begin;
-	    while ((eos_ - end_) < sz) {
+	    while ((size_t)(eos_ - end_) < sz) {
 	      increaseAllocation_();
 	    }
 	    ::memcpy(end_, begin, sz);
@@ -71,9 +72,16 @@ namespace pistis {
 	}
 
 	StringBuffer& operator=(const StringBuffer& other) = delete;
-	StringBuffer& operator=(StringBuffer&& other) {
-	  if (begin() != other.begin()) {
+	StringBuffer& operator=(StringBuffer&& other) noexcept {
+	  if (this != &other) {
 	    free_();
+	    (Allocator&)*this = std::move((Allocator&)other);
+	    initialSize_ = other.initialSize_;
+	    maxSize_ = other.maxSize_;
+	    begin_ = other.begin_;
+	    end_ = other.end_;
+	    eos_ = other.eos_;
+	    other.begin_ = other.end_ = other.eos_ = nullptr;
 	  }
 	  return *this;
 	}
@@ -91,12 +99,11 @@ namespace pistis {
 	  }
 	}
 
-	void increaseSize_() {
+	void increaseAllocation_() {
 	  std::tie(begin_, end_, eos_) =
 	    pistis::memory::increaseAllocation((Allocator&)*this, initialSize(),
 					       maxSize(), begin(), end(), eos_);
 	}
-	
       };
       
     }
@@ -0,0 +1,262 @@
+#ifndef __PISTIS__JSON__MEMORY__SYMBOLTABLE_HPP__
+#define __PISTIS__JSON__MEMORY__SYMBOLTABLE_HPP__
+
+#include <pistis/json/JsonString.hpp>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace memory {
+
+      /** @brief Interns strings, assigning each one a small integer id.
+       *
+       *  Ids are assigned in the order strings are added, starting at
+       *  zero, and never change until the table is cleared.  So strings
+       *  added before parsing starts get fixed ids that code can switch
+       *  on.  The text of each string is copied into blocks allocated
+       *  from @c Allocator that are only freed when the table is cleared
+       *  or destroyed, so the strings returned by name() stay valid
+       *  as long as the table does.
+       *
+       *  Lookups hash the string and probe an open-addressed table.  But
+       *  the table also remembers which string was interned after each
+       *  one, and tries that string first.  Documents with a fixed
+       *  schema, such as most NDJSON files, have their field names in
+       *  the same order in every record, so most lookups are then a
+       *  single comparison and no hashing at all.
+       */
+      template <typename Allocator = std::allocator<char> >
+      class SymbolTable : Allocator {
+      public:
+	/** @brief Id meaning "no symbol" */
+	static constexpr const uint32_t NO_SYMBOL = 0xFFFFFFFF;
+
+      public:
+	/** @brief Create an empty table.
+	 *
+	 *  intern() stops adding strings once the table holds
+	 *  @c maxSymbols strings, so a document with an unbounded number
+	 *  of distinct field names can't make it grow without limit.
+	 *  Text is allocated in blocks of @c blockSize bytes.
+	 */
+	SymbolTable(uint32_t maxSymbols = 65536, size_t blockSize = 4096,
+		    const Allocator& allocator = Allocator()):
+	    Allocator(allocator), maxSymbols_(maxSymbols),
+	    blockSize_(blockSize), symbols_(), slots_(), blocks_(),
+	    current_(nullptr), eob_(nullptr), last_(NO_SYMBOL) {
+	}
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable(SymbolTable&&) = default;
+	~SymbolTable() { free_(); }
+
+	const Allocator& allocator() const { return (const Allocator&)*this; }
+	uint32_t maxSymbols() const { return maxSymbols_; }
+	size_t blockSize() const { return blockSize_; }
+	uint32_t size() const { return symbols_.size(); }
+	bool empty() const { return symbols_.empty(); }
+
+	/** @brief The string with id @c symbol */
+	JsonString name(uint32_t symbol) const {
+	  return symbols_[symbol].name;
+	}
+
+	/** @brief The id of @c s, or NO_SYMBOL if it is not in the table */
+	uint32_t find(const JsonString& s) const {
+	  return lookup_(s, hash_(s));
+	}
+
+	uint32_t find(const std::string& s) const {
+	  return find(JsonString(s.data(), s.data() + s.size()));
+	}
+
+	/** @brief Add @c s to the table if it isn't there already and
+	 *         return its id.
+	 *
+	 *  Unlike intern(), ignores maxSymbols().
+	 */
+	uint32_t add(const JsonString& s) {
+	  const uint32_t h = hash_(s);
+	  const uint32_t symbol = lookup_(s, h);
+	  return (symbol != NO_SYMBOL) ? symbol : insert_(s, h);
+	}
+
+	uint32_t add(const std::string& s) {
+	  return add(JsonString(s.data(), s.data() + s.size()));
+	}
+
+	/** @brief Return the id of @c s, adding it to the table if it isn't
+	 *         there already and the table is not full.
+	 *
+	 *  Returns NO_SYMBOL if @c s is not in the table and the table
+	 *  already holds maxSymbols() strings.
+	 */
+	uint32_t intern(const JsonString& s) {
+	  if (last_ != NO_SYMBOL) {
+	    const uint32_t predicted = symbols_[last_].next;
+	    if ((predicted != NO_SYMBOL) &&
+		equal_(symbols_[predicted].name, s)) {
+	      return last_ = predicted;
+	    }
+	  }
+
+	  const uint32_t h = hash_(s);
+	  uint32_t symbol = lookup_(s, h);
+	  if ((symbol == NO_SYMBOL) && (symbols_.size() < maxSymbols_)) {
+	    symbol = insert_(s, h);
+	  }
+	  if ((symbol != NO_SYMBOL) && (last_ != NO_SYMBOL)) {
+	    symbols_[last_].next = symbol;
+	  }
+	  return last_ = symbol;
+	}
+
+	/** @brief Remove every string from the table and free its text */
+	void clear() {
+	  free_();
+	  symbols_.clear();
+	  slots_.clear();
+	  last_ = NO_SYMBOL;
+	}
+
+	SymbolTable& operator=(const SymbolTable&) = delete;
+	SymbolTable& operator=(SymbolTable&& other) {
+	  if (this != &other) {
+	    free_();
+	    Allocator::operator=(std::move(other));
+	    maxSymbols_ = other.maxSymbols_;
+	    blockSize_ = other.blockSize_;
+	    symbols_ = std::move(other.symbols_);
+	    slots_ = std::move(other.slots_);
+	    blocks_ = std::move(other.blocks_);
+	    current_ = other.current_;
+	    eob_ = other.eob_;
+	    last_ = other.last_;
+	    other.blocks_.clear();
+	    other.current_ = nullptr;
+	    other.eob_ = nullptr;
+	  }
+	  return *this;
+	}
+
+      private:
+	struct Symbol_ {
+	  JsonString name;
+	  uint32_t hash;
+
+	  /** @brief The symbol interned after this one last time */
+	  uint32_t next;
+	};
+
+	uint32_t maxSymbols_;
+	size_t blockSize_;
+	std::vector<Symbol_> symbols_;
+
+	// Open-addressed hash table of ids.  Its size is zero or a power of
+	// two, and it is never more than half full.
+	std::vector<uint32_t> slots_;
+	std::vector<std::pair<char*, size_t> > blocks_;
+	char* current_;
+	char* eob_;
+
+	// The last symbol intern() returned
+	uint32_t last_;
+
+	static bool equal_(const JsonString& x, const JsonString& y) {
+	  return (x.size() == y.size()) &&
+	         !::memcmp(x.begin(), y.begin(), x.size());
+	}
+
+	static uint32_t hash_(const JsonString& s) {
+	  // FNV-1a, eight bytes at a time
+	  const char* p = s.begin();
+	  const char* const end = s.end();
+	  uint64_t h = 0xcbf29ce484222325ULL ^ s.size();
+	  for (; (end - p) >= 8; p += 8) {
+	    uint64_t word;
+	    ::memcpy(&word, p, 8);
+	    h = (h ^ word) * 0x100000001b3ULL;
+	  }
+	  for (; p != end; ++p) {
+	    h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+	  }
+	  return (uint32_t)(h ^ (h >> 32));
+	}
+
+	uint32_t lookup_(const JsonString& s, uint32_t h) const {
+	  if (slots_.empty()) {
+	    return NO_SYMBOL;
+	  }
+
+	  const size_t mask = slots_.size() - 1;
+	  for (size_t i = h & mask; slots_[i] != NO_SYMBOL;
+	       i = (i + 1) & mask) {
+	    const Symbol_& symbol = symbols_[slots_[i]];
+	    if ((symbol.hash == h) && equal_(symbol.name, s)) {
+	      return slots_[i];
+	    }
+	  }
+	  return NO_SYMBOL;
+	}
+
+	uint32_t insert_(const JsonString& s, uint32_t h) {
+	  const uint32_t symbol = symbols_.size();
+	  symbols_.push_back(Symbol_{ copy_(s), h, NO_SYMBOL });
+	  if ((symbols_.size() * 2) > slots_.size()) {
+	    rehash_(std::max((size_t)16, slots_.size() * 2));
+	  } else {
+	    place_(symbol);
+	  }
+	  return symbol;
+	}
+
+	void rehash_(size_t numSlots) {
+	  slots_.assign(numSlots, NO_SYMBOL);
+	  for (uint32_t i = 0; i < symbols_.size(); ++i) {
+	    place_(i);
+	  }
+	}
+
+	void place_(uint32_t symbol) {
+	  const size_t mask = slots_.size() - 1;
+	  size_t i = symbols_[symbol].hash & mask;
+	  while (slots_[i] != NO_SYMBOL) {
+	    i = (i + 1) & mask;
+	  }
+	  slots_[i] = symbol;
+	}
+
+	JsonString copy_(const JsonString& s) {
+	  if ((size_t)(eob_ - current_) < s.size()) {
+	    const size_t sz = std::max(blockSize_, s.size());
+	    current_ = this->allocate(sz);
+	    eob_ = current_ + sz;
+	    blocks_.push_back(std::make_pair(current_, sz));
+	  }
+
+	  char* const p = current_;
+	  if (s.size()) {
+	    ::memcpy(p, s.begin(), s.size());
+	  }
+	  current_ += s.size();
+	  return JsonString(p, current_);
+	}
+
+	void free_() noexcept {
+	  for (const auto& block : blocks_) {
+	    this->deallocate(block.first, block.second);
+	  }
+	  blocks_.clear();
+	  current_ = nullptr;
+	  eob_ = nullptr;
+	}
+      };
+
+    }
+  }
+}
+#endif
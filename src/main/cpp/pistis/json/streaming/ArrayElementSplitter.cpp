@@ -0,0 +1,158 @@
+#include "ArrayElementSplitter.hpp"
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <pistis/json/util/SimdScanner.hpp>
+#include <algorithm>
+#include <sstream>
+
+using namespace pistis::json::streaming;
+using namespace pistis::json::util;
+
+namespace {
+  // Only used for errors, so it doesn't matter that this is slow
+  JsonEventOrigin originOf(const char* begin, const char* p) {
+    const uint32_t line = 1 + std::count(begin, p, '\n');
+    const char* lineStart = p;
+    while ((lineStart != begin) && (lineStart[-1] != '\n')) {
+      --lineStart;
+    }
+    return JsonEventOrigin(line, p - lineStart + 1, p - begin);
+  }
+
+  const char* skipWhitespace(const char* p, const char* end) {
+    while ((p != end) && isJsonWhitespace(*p)) {
+      ++p;
+    }
+    return p;
+  }
+}
+
+ArrayElementSplitter::ArrayElementSplitter(const std::string& streamName,
+					   const char* begin,
+					   const char* end,
+					   size_t chunkSize, bool strict):
+    streamName_(streamName), begin_(begin), end_(end),
+    chunkSize_(chunkSize ? chunkSize : 1), strict_(strict),
+    current_(begin), afterComma_(false), started_(false),
+    finished_(false), nextIndex_(0) {
+}
+
+bool ArrayElementSplitter::next(ArrayChunk& chunk) {
+  if (finished_) {
+    return false;
+  } else if (!started_) {
+    start_();
+  }
+
+  // The array's own bracket counts, so the depth is one between its
+  // elements
+  NestingState state(1);
+  NewlineCount newlines;
+  const char* p = skipNested(
+      current_, current_ + std::min(chunkSize_, (size_t)(end_ - current_)),
+      state, newlines
+  );
+  if (!state.depth) {
+    return lastChunk_(chunk, p - 1);
+  }
+
+  const char* separator = findSeparator_(p, state);
+  if (*separator != ',') {
+    return lastChunk_(chunk, separator);
+  }
+
+  chunk.index = nextIndex_++;
+  chunk.offset = current_ - begin_;
+  chunk.begin = current_;
+  chunk.end = separator;
+  current_ = separator + 1;
+  afterComma_ = true;
+  return true;
+}
+
+void ArrayElementSplitter::start_() {
+  const char* p = skipWhitespace(begin_, end_);
+  if ((p == end_) || (*p != '[')) {
+    error_(p, "\"[\" expected");
+  }
+  current_ = p + 1;
+  started_ = true;
+}
+
+const char* ArrayElementSplitter::findSeparator_(const char* p,
+						 NestingState& state) {
+  NewlineCount newlines;
+  while (p != end_) {
+    if (state.depth > 1) {
+      // Skip to the end of the object or array the comma can't be in
+      NestingState inner(state.depth - 1);
+      inner.inString = state.inString;
+      inner.escaped = state.escaped;
+      p = skipNested(p, end_, inner, newlines);
+      if (inner.depth) {
+	break;
+      }
+      state = NestingState(1);
+      continue;
+    }
+
+    const char c = *p;
+    if (state.escaped) {
+      state.escaped = 0;
+    } else if (c == '\\') {
+      state.escaped = 1;
+    } else if (c == '"') {
+      state.inString = ~state.inString;
+    } else if (!state.inString) {
+      if ((c == '{') || (c == '[')) {
+	++state.depth;
+      } else if ((c == ',') || (c == '}') || (c == ']')) {
+	return p;
+      }
+    }
+    ++p;
+  }
+  error_(end_, "Array not terminated");
+}
+
+bool ArrayElementSplitter::lastChunk_(ArrayChunk& chunk,
+				      const char* closingBracket) {
+  finished_ = true;
+  if (strict_) {
+    if (*closingBracket != ']') {
+      error_(closingBracket, "\"]\" expected");
+    }
+    const char* p = skipWhitespace(closingBracket + 1, end_);
+    if (p != end_) {
+      error_(p, "Text after the end of the array");
+    }
+  }
+
+  if (skipWhitespace(current_, closingBracket) == closingBracket) {
+    // Nothing but whitespace, so either the array is empty or there
+    // is a comma before its closing bracket
+    if (afterComma_) {
+      error_(closingBracket, "Value expected");
+    }
+    return false;
+  }
+
+  chunk.index = nextIndex_++;
+  chunk.offset = current_ - begin_;
+  chunk.begin = current_;
+  chunk.end = closingBracket;
+  return true;
+}
+
+void ArrayElementSplitter::error_(const char* p,
+				  const std::string& details) {
+  const JsonEventOrigin origin = originOf(begin_, p);
+  std::ostringstream msg;
+  msg << "Error on line " << origin.line() << ", column "
+      << origin.column() << " (offset " << origin.offset() << ")";
+  if (!streamName_.empty()) {
+    msg << " of " << streamName_;
+  }
+  msg << ": " << details;
+  throw pistis::json::exceptions::JsonParseError(msg.str(), origin,
+						 PISTIS_EX_HERE);
+}
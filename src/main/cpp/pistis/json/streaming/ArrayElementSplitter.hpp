@@ -0,0 +1,90 @@
+#ifndef __PISTIS__JSON__STREAMING__ARRAYELEMENTSPLITTER_HPP__
+#define __PISTIS__JSON__STREAMING__ARRAYELEMENTSPLITTER_HPP__
+
+#include <pistis/json/streaming/JsonEventOrigin.hpp>
+#include <pistis/json/util/NestingScanner.hpp>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief A run of whole elements of a top-level array */
+      struct ArrayChunk {
+	/** @brief Position of the chunk in the array, counting from zero */
+	uint64_t index;
+
+	/** @brief Offset of the chunk's first byte in the document */
+	uint64_t offset;
+
+	/** @brief The elements and the commas between them, without the
+	 *         commas before the first element and after the last one
+	 */
+	const char* begin;
+	const char* end;
+      };
+
+      /** @brief Cuts the elements of a document's top-level array into
+       *         chunks that can be parsed separately.
+       *
+       *  Each chunk is cut in two steps.  First util::skipNested() runs
+       *  over the next chunkSize() bytes, 64 bytes at a time, keeping
+       *  track of how deeply nested it is and whether it is inside a
+       *  string.  Then the splitter walks forward to the next comma
+       *  between two elements of the array, skipping any objects and
+       *  arrays in the way with skipNested() too.  Commas and brackets
+       *  inside strings, escaped quotes and all, are never mistaken for
+       *  structure.  Elements are not parsed, so this runs at the speed
+       *  of skipNested().
+       *
+       *  Throws JsonParseError if the document is not an array or the
+       *  array is not terminated.  In strict mode, it also throws if the
+       *  array is closed by a '}' or followed by anything but
+       *  whitespace.  Everything else is left to whoever parses the
+       *  chunks.
+       */
+      class ArrayElementSplitter {
+      public:
+	ArrayElementSplitter(const std::string& streamName,
+			     const char* begin, const char* end,
+			     size_t chunkSize, bool strict);
+	ArrayElementSplitter(const ArrayElementSplitter&) = delete;
+
+	size_t chunkSize() const { return chunkSize_; }
+	bool strict() const { return strict_; }
+
+	/** @brief Cut the next chunk off the array.  Returns false once
+	 *         the whole array has been cut up.
+	 */
+	bool next(ArrayChunk& chunk);
+
+	ArrayElementSplitter& operator=(const ArrayElementSplitter&)
+	    = delete;
+
+      private:
+	std::string streamName_;
+	const char* begin_;
+	const char* end_;
+	size_t chunkSize_;
+	bool strict_;
+
+	// Where the next chunk starts, and whether a comma comes right
+	// before it
+	const char* current_;
+	bool afterComma_;
+	bool started_;
+	bool finished_;
+	uint64_t nextIndex_;
+
+	void start_();
+	const char* findSeparator_(const char* p, util::NestingState& state);
+	bool lastChunk_(ArrayChunk& chunk, const char* closingBracket);
+	[[noreturn]] void error_(const char* p, const std::string& details);
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,22 @@
+#ifndef __PISTIS__JSON__STREAMING__CHUNKRESULTORDER_HPP__
+#define __PISTIS__JSON__STREAMING__CHUNKRESULTORDER_HPP__
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief The order the parallel parsers hand the results of their
+       *         chunks back in
+       */
+      enum class ChunkResultOrder {
+	/** @brief In the order of the chunks in the document */
+	IN_ORDER,
+
+	/** @brief As soon as each chunk has been parsed */
+	AS_COMPLETED
+      };
+
+    }
+  }
+}
+#endif
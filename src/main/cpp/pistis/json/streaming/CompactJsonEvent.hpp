@@ -0,0 +1,75 @@
+#ifndef __PISTIS__JSON__STREAMING__COMPACTJSONEVENT_HPP__
+#define __PISTIS__JSON__STREAMING__COMPACTJSONEVENT_HPP__
+
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <pistis/json/streaming/JsonEventOrigin.hpp>
+#include <pistis/json/streaming/JsonEventType.hpp>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief One event in a batch returned by
+       *         FlexibleEventStream::nextBatch().
+       *
+       *  The payload text is not stored in the event itself, but in a
+       *  buffer owned by the stream that holds the text of every event in
+       *  the batch.  The event records where its text is in that buffer,
+       *  so the events stay valid until the next call to nextBatch(), no
+       *  matter how many events the batch contains.  Number events also
+       *  carry the significand and exponent the reader computed while it
+       *  scanned the number, so consumers do not have to scan the text
+       *  again.
+       */
+      struct CompactJsonEvent {
+	JsonEventType type;
+
+	/** @brief Sign of a number payload */
+	bool negative;
+
+	/** @brief True if a number payload had more significant digits
+	 *         than fit in the significand
+	 */
+	bool truncated;
+
+	/** @brief Decimal exponent of a number payload */
+	int32_t exponent;
+
+	/** @brief Length of the payload text */
+	uint32_t payloadLength;
+
+	/** @brief Symbol id of a field name.  See
+	 *         FlexibleEventStream::fieldSymbol().
+	 */
+	uint32_t symbol;
+
+	/** @brief Offset of the payload text in the batch's text */
+	uint64_t payloadOffset;
+
+	/** @brief Decimal significand of a number payload */
+	uint64_t significand;
+
+	/** @brief Where the event occurred.  Only filled in if the batch
+	 *         was requested with origins.
+	 */
+	JsonEventOrigin origin;
+
+	/** @brief The payload text, given the batch's text */
+	JsonString payloadText(const char* batchText) const {
+	  const char* const p = batchText + payloadOffset;
+	  return JsonString(p, p + payloadLength);
+	}
+
+	/** @brief The number payload, given the batch's text */
+	JsonNumber numberPayload(const char* batchText) const {
+	  return JsonNumber(payloadText(batchText), significand, exponent,
+			    negative, truncated);
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,78 @@
+#ifndef __PISTIS__JSON__STREAMING__DEFAULTPAYLOADFACTORY_HPP__
+#define __PISTIS__JSON__STREAMING__DEFAULTPAYLOADFACTORY_HPP__
+
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <pistis/json/util/NumberParser.hpp>
+#include <sstream>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief PayloadFactory that converts integers to int64_t, floats
+       *         to double and leaves strings as JsonString instances.
+       *
+       *  None of the conversions allocate memory or depend on the current
+       *  locale.  When used with FlexibleEventStream, numbers are converted
+       *  from the significand and exponent the reader computed while
+       *  scanning them, so their digits are only read once.  Floats are
+       *  always rounded correctly.
+       *
+       *  String payloads point into the reader's buffers, so they are
+       *  only valid until the next call to next().  Consumers that keep
+       *  them longer must copy them.
+       */
+      class DefaultPayloadFactory {
+      public:
+	int64_t intValue(const JsonNumber& n) const {
+	  int64_t value;
+	  if (!n.toInt64(value)) {
+	    outOfRange_(n.text());
+	  }
+	  return value;
+	}
+
+	int64_t intValue(const JsonString& text) const {
+	  int64_t value;
+	  if (!util::parseInt64(text, value)) {
+	    outOfRange_(text);
+	  }
+	  return value;
+	}
+
+	double floatValue(const JsonNumber& n) const {
+	  return util::toDouble(n);
+	}
+
+	double floatValue(const JsonString& text) const {
+	  double value;
+	  if (!util::parseDouble(text, value)) {
+	    std::ostringstream msg;
+	    msg << "\"" << text << "\" is not a number";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return value;
+	}
+
+	const JsonString& stringValue(const JsonString& text) const {
+	  return text;
+	}
+
+      private:
+	[[noreturn]] static void outOfRange_(const JsonString& text) {
+	  std::ostringstream msg;
+	  msg << "\"" << text << "\" is not an integer in the range of an "
+	      << "int64_t";
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+      };
+      
+    }
+  }
+}
+#endif
@@ -6,15 +6,30 @@
 #define __PISTIS__JSON__STREAMING__FLEXIBLEEVENTSTREAM_HPP__
 
 #include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
 #include <pistis/json/InvalidJsonStringError.hpp>
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <pistis/json/memory/StringBuffer.hpp>
+#include <pistis/json/memory/SymbolTable.hpp>
+#include <pistis/json/streaming/CompactJsonEvent.hpp>
 #include <pistis/json/streaming/FlexibleStreamReader.hpp>
 #include <pistis/json/streaming/JsonEventType.hpp>
 #include <pistis/json/streaming/JsonEventOrigin.hpp>
 #include <pistis/json/streaming/JsonLookAhead.hpp>
-#include <pistis/json/streaming/Utf8CharEncoder.hpp>
+#include <pistis/json/streaming/PathProjection.hpp>
+#include <pistis/json/streaming/SaxHandler.hpp>
+#include <pistis/json/streaming/ShapeCache.hpp>
+#include <pistis/json/streaming/detail/PayloadConversion.hpp>
+#include <pistis/json/util/Base64Decoder.hpp>
+#include <pistis/json/util/Utf8CharEncoder.hpp>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
+#include <string.h>
 
 namespace pistis {
   namespace json {
@@ -25,83 +40,643 @@ namespace pistis {
 		typename Allocator = std::allocator<char> >
       class FlexibleEventStream {
       public:
-	typedef typename std::remove_cv<
-	            typename std::remove_reference<
-		        decltype(((*PayloadFactory*)0)->
-				     intValue((*(JsonString*)0)))
-	            >::type
-	        >::type
+	typedef typename detail::PayloadTypes<PayloadFactory>::IntPayloadType
 	        IntPayloadType;
-	typedef typename std::remove_cv<
-	            typename std::remove_reference<
-		        decltype(((*PayloadFactory*)0)->
-				     floatValue((*(JsonString*)0)))
-	            >::type
-	        >::type
+	typedef typename detail::PayloadTypes<PayloadFactory>::FloatPayloadType
 	        FloatPayloadType;
-	typedef typename std::remove_cv<
-	            typename std::remove_reference<
-		        decltype(((*PayloadFactory*)0)->
-				     stringValue((*(JsonString*)0)))
-	            >::type
-	        >::type
+	typedef typename detail::PayloadTypes<PayloadFactory>::StringPayloadType
 	        StringPayloadType;
+	typedef memory::SymbolTable<Allocator> SymbolTableType;
+
+	/** @brief Value of predictedKey() for field names that were not
+	 *         predicted
+	 */
+	static constexpr const uint32_t NOT_PREDICTED = 0xFFFFFFFF;
+
+	/** @brief Default value of maxDepth() */
+	static constexpr const uint32_t DEFAULT_MAX_DEPTH = 1024;
 	
       private:
+	/** @brief The parser's states.
+	 *
+	 *  Each state but DONE has a function that reads what comes next
+	 *  in that state and returns the event and the state that follow.
+	 *  step_() maps the states to their functions.  The RESTART states
+	 *  carry on with a value the reader started and ran out of data
+	 *  in the middle of.  The AFTER states start a value after a
+	 *  separator that was followed by the end of the data.
+	 */
+	enum class StateId_ : uint8_t {
+	  DONE,                  ///< The stream has ended
+	  INITIAL_VALUE,         ///< parseInitialValue_()
+	  RECORD_END,            ///< parseRecordEnd_()
+	  FIRST_ELEMENT,         ///< parseFirstElement_()
+	  ELEMENT_END,           ///< parseElementEnd_()
+	  NEXT_ELEMENT,          ///< parseNextElement_()
+	  RESTART_ELEMENT,       ///< restartElement_(true)
+	  ELEMENT_AFTER_COMMA,   ///< restartElement_(false)
+	  FIRST_KEY,             ///< parseFirstKey_()
+	  NEXT_KEY,              ///< parseNextKey_()
+	  RESTART_NEXT_KEY,      ///< parseKey_(true)
+	  KEY_AFTER_COMMA,       ///< parseKey_(false)
+	  OBJECT_VALUE,          ///< parseObjectValue_()
+	  RESTART_OBJECT_VALUE,  ///< restartObjectValue_(true)
+	  VALUE_AFTER_COLON,     ///< restartObjectValue_(false)
+	  FIRST_ARRAY_VALUE,     ///< parseFirstArrayValue_()
+	  NEXT_ARRAY_VALUE,      ///< parseNextArrayValue_()
+	  RESTART_ARRAY_VALUE,   ///< restartArrayValue_(true)
+	  ARRAY_VALUE_AFTER_COMMA,  ///< restartArrayValue_(false)
+	  STRING_PART,           ///< parseStringPart_()
+	  STRING_END             ///< parseStringEnd_()
+	};
+
+	/** @brief The state the parser is in and the event it returned on
+	 *         entering it.  Two bytes, so it lives in a register.
+	 */
 	class State {
 	public:
-	  State(): f_(nullptr), event_(JsonEventType::AGAIN) { }
-	  State(State (FlexibleEventStream::* f)(), JsonEventType event)
-	      : f_(f), event_(event) {
+	  State(): id_(StateId_::DONE), event_((uint8_t)JsonEventType::AGAIN) {
+	  }
+	  State(StateId_ id, JsonEventType event)
+	      : id_(id), event_((uint8_t)event) {
 	  }
 
-	  State next(FlexibleEventStream* s) const { return (s->*f_)(); }
-	  JsonEventType event() const { return event_; }
-	  operator bool() const { return (bool)next_; }
+	  State next(FlexibleEventStream* s) const { return s->step_(id_); }
+	  StateId_ id() const { return id_; }
+	  JsonEventType event() const { return (JsonEventType)event_; }
+	  operator bool() const { return id_ != StateId_::DONE; }
 	    
 	private:
-	  State (FlexibleEventStream::* f_)();
-	  JsonEventType event_;
+	  StateId_ id_;
+	  uint8_t event_;
+	};
+
+	/** @brief Where skipValue() is in the value it is skipping */
+	enum class SkipPhase_ {
+	  NONE,           ///< Not skipping anything
+	  COLON,          ///< Before the ':' that follows a field name
+	  FIRST_ELEMENT,  ///< Before an array's first element or ']'
+	  SEPARATOR,      ///< Before the ',' or ']' after an array element
+	  VALUE,          ///< Before the value
+	  SCAN,           ///< About to start the reader's scan
+	  RESUME          ///< Resuming the reader's scan after AGAIN
+	};
+
+	enum class SkipResult_ {
+	  SKIPPED,  ///< Skipped the value
+	  AGAIN,    ///< No data available, but more available later
+	  NO_VALUE  ///< Found the ']' that ends the array instead
+	};
+
+	/** @brief An object or array on the paths of a PathProjection */
+	struct ProjectionFrame_ {
+	  /** @brief Where this frame's nodes start in projectionNodes_ */
+	  size_t nodesBegin;
+
+	  /** @brief Index of the next element, if this is an array */
+	  uint64_t index;
+
+	  bool array;
 	};
 
-	typedef FlexibleStreamReader<Stream, Allocator>::IncorrectAlignment
-	        IncorrectAlignmentError;
+	typedef typename FlexibleStreamReader<
+	    Stream, CharEncoder, Allocator
+	>::IncorrectAlignment IncorrectAlignmentError;
 	
       public:
+	/** @brief Create a new event stream.
+	 *
+	 *  If @c projection is not empty, the stream only reports the
+	 *  values it selects, along with the objects, arrays and field
+	 *  names on the way to them.  See nextProjected_().
+	 *
+	 *  The reader's buffer, the stream's string buffers and its shape
+	 *  cache all allocate from copies of @c allocator.  Pass a
+	 *  memory::BufferPoolAllocator to have them recycle their memory
+	 *  through one memory::BufferPool.
+	 */
 	FlexibleEventStream(const std::string& streamName,
 			    Stream&& stream,
 			    const PayloadFactory& payloadFactory,
-			    size_t bufferSize)
-	    : streamName_(streamName), reader_(std::move(stream), bufferSize),
+			    size_t bufferSize,
+			    const PathProjection& projection = PathProjection(),
+			    const Allocator& allocator = Allocator())
+	    : streamName_(streamName),
+	      reader_(std::move(stream), bufferSize, CharEncoder(), allocator),
 	      payloadFactory_(std::move(payloadFactory)),
-	      payload_(), origin_(0, 0, 0),
-	      current_(&FlexibleEventStream::parseInitialValue_,
-		       JsonEventType::AGAIN),
-	      stateStack_() {
+	      payload_(), number_(), origin_(0, 0, 0),
+	      current_(StateId_::INITIAL_VALUE, JsonEventType::AGAIN),
+	      stateStack_(DEFAULT_MAX_DEPTH), depth_(0),
+	      maxDepth_(DEFAULT_MAX_DEPTH),
+	      batchText_(16, (size_t)-1, allocator),
+	      skipPhase_(SkipPhase_::NONE),
+	      skipNextState_(StateId_::DONE), skipEvent_(JsonEventType::AGAIN),
+	      skipDepth_(0), projection_(projection), projectionFrames_(),
+	      projectionNodes_(), valueNodes_(1, projection_.root()),
+	      selectedNodes_(), selectedDepth_(0),
+	      seen_(projection_.numSelections(), false), numSeen_(0),
+	      projectionDone_(false), symbols_(nullptr),
+	      fieldSymbol_(SymbolTableType::NO_SYMBOL),
+	      shapes_(4096, allocator), shape_(shapes_.root()),
+	      predictShapes_(false),
+	      predictedKey_(NOT_PREDICTED), shapeStatistics_(),
+	      multipleValues_(false), arrayElements_(false),
+	      stringChunkSize_(0), stringNextState_(StateId_::DONE),
+	      parseSkipping_(false) {
 	}
 	
 	FlexibleEventStream(const FlexibleEventStream&) = delete;
 	FlexibleEventStream(FlexibleEventStream&&) = default;
 
 	JsonEventType next() {
-	  if (!current_) {
-	    return JsonEventType::END;
-	  } else {
-	    current_ = current_.next();
-	    return current_.event();
+	  return projection_.empty() ? nextEvent_() : nextProjected_();
+	}
+
+	/** @brief The entire input, if the stream parses it in place (see
+	 *         FlexibleStreamReader::IN_PLACE), or an empty string.
+	 *
+	 *  String payloads and field names that lie within it point
+	 *  straight into the input, and stay valid for the life of the
+	 *  stream, not just until the next call to next().
+	 */
+	JsonString inputText() const { return reader_.inputText(); }
+
+	/** @brief Size above which string values are split, or zero if
+	 *         they never are
+	 */
+	size_t stringChunkSize() const { return stringChunkSize_; }
+
+	/** @brief Return string values longer than @c size bytes in parts.
+	 *
+	 *  Such a string arrives as a series of STRING_CHUNK events, each
+	 *  with the next part of its text as its payload, and then a
+	 *  STRING_END event.  Shorter strings still arrive as STRING_VALUE
+	 *  events.  Parts hold at most about @c size bytes of decoded text,
+	 *  or a buffer's worth of raw text, which is returned without being
+	 *  copied, so memory use does not grow with the length of the
+	 *  string.  Field names are never split.  Zero, the default, turns
+	 *  splitting off.
+	 */
+	void setStringChunkSize(size_t size) { stringChunkSize_ = size; }
+
+	/** @brief True if payloads stay valid until releaseBuffers() */
+	bool pinBuffers() const { return reader_.pinBuffers(); }
+
+	/** @brief Keep the text of strings, numbers and field names valid
+	 *         past the next event, until releaseBuffers() is called.
+	 *
+	 *  Lets a consumer hold on to the payloads of a whole record
+	 *  without copying them, then release them all at its END_RECORD
+	 *  event.  See FlexibleStreamReader::setPinBuffers().
+	 */
+	void setPinBuffers(bool pin) { reader_.setPinBuffers(pin); }
+
+	/** @brief Let go of the payloads read so far */
+	void releaseBuffers() { reader_.releaseBuffers(); }
+
+	/** @brief Bytes held for payloads waiting for releaseBuffers() */
+	size_t bytesPinned() const { return reader_.bytesPinned(); }
+
+	/** @brief The projection the stream applies to the document */
+	const PathProjection& projection() const { return projection_; }
+
+	/** @brief The table field names are interned in, or null if they
+	 *         are not interned.
+	 */
+	SymbolTableType* symbolTable() const { return symbols_; }
+
+	/** @brief Intern field names in @c symbols.
+	 *
+	 *  After next() returns FIELD_NAME, fieldSymbol() returns the field
+	 *  name's id in @c symbols.  Names added to @c symbols before
+	 *  parsing keep their ids, so code can register the names it knows
+	 *  and switch on their ids instead of comparing strings.  The
+	 *  stream does not own @c symbols, which must outlive it.  Several
+	 *  streams may share a table, as long as only one of them is being
+	 *  read at a time.  Passing null turns interning off.
+	 */
+	void setSymbolTable(SymbolTableType* symbols) {
+	  symbols_ = symbols;
+	  fieldSymbol_ = SymbolTableType::NO_SYMBOL;
+	  shapes_.clearSymbols();
+	}
+
+	/** @brief Id of the field name the last FIELD_NAME event reported.
+	 *
+	 *  Returns SymbolTableType::NO_SYMBOL if field names are not being
+	 *  interned, or if the name is new and the symbol table is full.
+	 */
+	uint32_t fieldSymbol() const { return fieldSymbol_; }
+
+	/** @brief True if the stream predicts field names */
+	bool shapePrediction() const { return predictShapes_; }
+
+	/** @brief Turn field name prediction on or off.
+	 *
+	 *  When it is on, the stream remembers the field names of the
+	 *  objects it reads, in order, and expects the objects that follow
+	 *  to have the same ones (see ShapeCache).  Before reading a field
+	 *  name, it compares the stream's bytes with the predicted name,
+	 *  and if they match, it skips over them without scanning the
+	 *  string.  This pays off for arrays of records and for NDJSON,
+	 *  where every object usually has the same fields in the same
+	 *  order.  shapeStatistics() says how often it pays off.  Objects
+	 *  that started before prediction was turned on are not predicted.
+	 */
+	void setShapePrediction(bool enabled) { predictShapes_ = enabled; }
+
+	/** @brief If the field name the last FIELD_NAME event reported was
+	 *         the predicted one, its position in its object, starting
+	 *         at one.  Otherwise, NOT_PREDICTED.
+	 *
+	 *  Consumers that remember what they did with field number k of
+	 *  the last object with the same shape can do it again without
+	 *  looking at the name.
+	 */
+	uint32_t predictedKey() const { return predictedKey_; }
+
+	/** @brief How many field names prediction got right and wrong */
+	const ShapeStatistics& shapeStatistics() const {
+	  return shapeStatistics_;
+	}
+
+	/** @brief Fill @c events with up to @c maxEvents events.
+	 *
+	 *  Returns the number of events stored.  The batch ends early after
+	 *  an AGAIN or END event, which is stored as the batch's last event
+	 *  so the caller knows why the batch is short.  The payload text of
+	 *  every event in the batch is copied to batchText(), where it
+	 *  stays until the next call to nextBatch().  Use the overloads of
+	 *  payloadText(), numberPayload(), intPayload(), floatPayload(),
+	 *  stringPayload() and base64Payload() that take an event to get at
+	 *  the payloads.  An error throws exceptions::JsonParseError, as
+	 *  next() does, and the events stored before it are lost.
+	 *
+	 *  Handing out events in batches lets the caller process them in a
+	 *  tight loop without calling back into the stream, and lets the
+	 *  stream keep its current state in a register across the whole
+	 *  batch.  Origins cost a 16-byte copy per event, so they are only
+	 *  recorded if @c withOrigins is true, in which case each event's
+	 *  origin is what origin() would have returned after the
+	 *  corresponding call to next().
+	 */
+	size_t nextBatch(CompactJsonEvent* events, size_t maxEvents,
+			 bool withOrigins = false) {
+	  size_t n = 0;
+
+	  batchText_.clear();
+	  if (!projection_.empty()) {
+	    // The projection keeps its own state, so go through next()
+	    while ((n < maxEvents) &&
+		   addToBatch_(events[n++], next(), withOrigins)) {
+	    }
+	    return n;
+	  }
+
+	  // As in nextEvent_(), the state that ends the document still
+	  // carries the event of its last value
+	  State state = current_;
+	  while (n < maxEvents) {
+	    JsonEventType event = JsonEventType::END;
+	    if (state) {
+	      state = state.next(this);
+	      event = state.event();
+	    }
+	    if (!addToBatch_(events[n++], event, withOrigins)) {
+	      break;
+	    }
+	  }
+
+	  current_ = state;
+	  return n;
+	}
+
+	/** @brief Skip the value the stream is positioned in.
+	 *
+	 *  Valid right after next() returns FIELD_NAME, BEGIN_OBJECT or
+	 *  BEGIN_ARRAY.  After FIELD_NAME, skips the field's value, and the
+	 *  next call to next() returns the next field name or END_OBJECT.
+	 *  After BEGIN_OBJECT or BEGIN_ARRAY, skips the rest of the object
+	 *  or array including its closing bracket, and next() continues
+	 *  with whatever follows it.
+	 *
+	 *  The skipped text is not parsed.  The reader just counts brackets
+	 *  and keeps track of strings and escapes, so skipping generates no
+	 *  events, decodes no escapes and converts no numbers.  The only
+	 *  error it detects is a value that does not end before the
+	 *  stream does.
+	 *
+	 *  Returns true once the value has been skipped, or false if the
+	 *  stream ran out of data first.  In that case, call skipValue()
+	 *  again (and not next()) when more data is available.
+	 */
+	bool skipValue() {
+	  if (skipPhase_ == SkipPhase_::NONE) {
+	    switch (current_.event()) {
+	      case JsonEventType::FIELD_NAME:
+		// The skipped value produces no event
+		skipPhase_ = SkipPhase_::COLON;
+		skipNextState_ = StateId_::NEXT_KEY;
+		skipEvent_ = JsonEventType::AGAIN;
+		skipDepth_ = 0;
+		break;
+
+	      case JsonEventType::BEGIN_OBJECT:
+		skipPhase_ = SkipPhase_::SCAN;
+		skipNextState_ = popState_();
+		skipEvent_ = JsonEventType::END_OBJECT;
+		skipDepth_ = 1;
+		break;
+
+	      case JsonEventType::BEGIN_ARRAY:
+		skipPhase_ = SkipPhase_::SCAN;
+		skipNextState_ = popState_();
+		skipEvent_ = JsonEventType::END_ARRAY;
+		skipDepth_ = 1;
+		break;
+
+	      default:
+		throw pistis::exceptions::IllegalStateError(
+		    "skipValue() must follow FIELD_NAME, BEGIN_OBJECT or "
+		    "BEGIN_ARRAY", PISTIS_EX_HERE
+		);
+	    }
+	  }
+
+	  if (continueSkip_() == SkipResult_::AGAIN) {
+	    return false;
+	  } else if (!projection_.empty()) {
+	    projectionSkipped_();
+	  }
+	  return true;
+	}
+
+	/** @brief Push the stream's events to @c handler.
+	 *
+	 *  Calls the callback of @c handler that goes with each event (see
+	 *  SaxHandler) until the stream ends, runs out of data, or a
+	 *  callback returns ParseAction::STOP.  A callback that returns
+	 *  ParseAction::SKIP for an object, an array or a field has the
+	 *  value skipped as skipValue() would, so it produces no more
+	 *  callbacks.  Payloads are converted by the stream's
+	 *  PayloadFactory only when the event reaches its callback.
+	 *
+	 *  @c Handler is a template parameter, so its callbacks are
+	 *  inlined into the loop, and the caller does not have to switch
+	 *  on each event itself.  parse() can be mixed with next(): after
+	 *  it returns STOPPED, next() returns the event after the one
+	 *  that stopped it.  After AGAIN, call parse() again, and not
+	 *  next(), since it may be in the middle of a skip.
+	 */
+	template <typename Handler>
+	ParseResult parse(Handler& handler) {
+	  if (parseSkipping_) {
+	    if (!skipValue()) {
+	      return ParseResult::AGAIN;
+	    }
+	    parseSkipping_ = false;
+	  }
+
+	  while (true) {
+	    const JsonEventType eventType = next();
+	    ParseAction action;
+
+	    switch (eventType) {
+	      case JsonEventType::END:
+		return ParseResult::END;
+
+	      case JsonEventType::AGAIN:
+		return ParseResult::AGAIN;
+
+	      case JsonEventType::BEGIN_OBJECT:
+		action = handler.onBeginObject();
+		break;
+
+	      case JsonEventType::END_OBJECT:
+		action = handler.onEndObject();
+		break;
+
+	      case JsonEventType::BEGIN_ARRAY:
+		action = handler.onBeginArray();
+		break;
+
+	      case JsonEventType::END_ARRAY:
+		action = handler.onEndArray();
+		break;
+
+	      case JsonEventType::FIELD_NAME:
+		action = handler.onKey(payload_);
+		break;
+
+	      case JsonEventType::INT_VALUE:
+		action = handler.onInt(intPayload());
+		break;
+
+	      case JsonEventType::FLOAT_VALUE:
+		action = handler.onFloat(floatPayload());
+		break;
+
+	      case JsonEventType::STRING_VALUE:
+		action = handler.onString(stringPayload());
+		break;
+
+	      case JsonEventType::TRUE_VALUE:
+		action = handler.onBool(true);
+		break;
+
+	      case JsonEventType::FALSE_VALUE:
+		action = handler.onBool(false);
+		break;
+
+	      case JsonEventType::NULL_VALUE:
+		action = handler.onNull();
+		break;
+
+	      case JsonEventType::END_RECORD:
+		action = handler.onEndRecord();
+		break;
+
+	      case JsonEventType::STRING_CHUNK:
+		action = handler.onStringChunk(payload_);
+		break;
+
+	      case JsonEventType::STRING_END:
+		action = handler.onStringEnd();
+		break;
+
+	      default:
+		throw pistis::exceptions::IllegalStateError(
+		    "Unknown event type", PISTIS_EX_HERE
+		);
+	    }
+
+	    if (action == ParseAction::STOP) {
+	      return ParseResult::STOPPED;
+	    } else if ((action == ParseAction::SKIP) &&
+		       ((eventType == JsonEventType::BEGIN_OBJECT) ||
+			(eventType == JsonEventType::BEGIN_ARRAY) ||
+			(eventType == JsonEventType::FIELD_NAME)) &&
+		       !skipValue()) {
+	      parseSkipping_ = true;
+	      return ParseResult::AGAIN;
+	    }
+	  }
+	}
+
+	/** @brief Most objects and arrays that may be open at once */
+	uint32_t maxDepth() const { return maxDepth_; }
+
+	/** @brief Set the most objects and arrays that may be open at once.
+	 *
+	 *  The stack of open objects and arrays takes eight bytes per level
+	 *  and is allocated up front, so it never grows while parsing.  A
+	 *  document nested more deeply is a parse error.  @c depth must
+	 *  be at least the number of objects and arrays open now.
+	 */
+	void setMaxDepth(uint32_t depth) {
+	  if (depth < depth_) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Maximum depth is less than the current depth", PISTIS_EX_HERE
+	    );
+	  }
+	  stateStack_.resize(depth);
+	  maxDepth_ = depth;
+	}
+
+	/** @brief True if the stream reads a sequence of top-level values */
+	bool multipleValues() const { return multipleValues_; }
+
+	/** @brief Read a sequence of top-level values instead of just one.
+	 *
+	 *  For NDJSON (JSON Lines) files and other streams of JSON values
+	 *  separated by whitespace.  Each value is a record, and next()
+	 *  returns END_RECORD after the last event of each one, then END
+	 *  after the last record.  Starting a new record just empties the
+	 *  stream's stacks, so records cost no allocation.  Call it before
+	 *  the first call to next().
+	 */
+	void setMultipleValues(bool multiple) { multipleValues_ = multiple; }
+
+	/** @brief True if the stream reads the elements of an array */
+	bool arrayElements() const { return arrayElements_; }
+
+	/** @brief Read a comma-separated list of values, as if the stream
+	 *         began just inside an array.
+	 *
+	 *  For a range of elements cut out of a larger array, such as the
+	 *  chunks ParallelArrayParser hands to its threads.  There are no
+	 *  brackets around the elements.  Each element is a record, as with
+	 *  setMultipleValues(), which this implies, and the stream must end
+	 *  after an element and not after a comma.  Call it before the
+	 *  first call to next().
+	 */
+	void setArrayElements(bool elements) {
+	  arrayElements_ = elements;
+	  multipleValues_ = multipleValues_ || elements;
+	  current_ = State(elements ? StateId_::FIRST_ELEMENT
+				    : StateId_::INITIAL_VALUE,
+			   JsonEventType::AGAIN);
+	}
+
+	/** @brief Discard the rest of the current line and start a new
+	 *         record at the next one.
+	 *
+	 *  Meant for NDJSON streams with malformed records.  When next()
+	 *  throws a JsonParseError, which says where the error is, call
+	 *  skipRecord() to carry on with the next line instead of giving up
+	 *  on the stream.  It can also skip a record that is not wanted,
+	 *  at any point before its END_RECORD event.
+	 *
+	 *  Returns true once it has skipped the line, or when the stream
+	 *  ends first, in which case next() returns END.  Returns false if
+	 *  the stream ran out of data first.  In that case, call
+	 *  skipRecord() again (and not next()) when more data is
+	 *  available.
+	 */
+	bool skipRecord() {
+	  typedef typename FlexibleStreamReader<
+	      Stream, CharEncoder, Allocator
+	  >::SkipResult SkipResult;
+
+	  depth_ = 0;
+	  shape_ = shapes_.root();
+	  skipPhase_ = SkipPhase_::NONE;
+	  parseSkipping_ = false;
+	  if (!projection_.empty()) {
+	    resetProjection_();
+	  }
+
+	  switch (reader_.skipLine()) {
+	    case SkipResult::AGAIN:
+	      return false;
+
+	    case SkipResult::END_OF_STREAM:
+	      current_ = State();
+	      return true;
+
+	    default:
+	      current_ = State(StateId_::INITIAL_VALUE, JsonEventType::AGAIN);
+	      return true;
 	  }
 	}
 
+	/** @brief Payload text of all the events returned by the last call
+	 *         to nextBatch()
+	 */
+	const char* batchText() const { return batchText_.begin(); }
+
 	const JsonEventOrigin& origin() { return origin_; }
 	const JsonString& payloadText() const { return payload_; }
-	auto intPayload() const { return payloadFactory_.intValue(payload_); }
+	const JsonNumber& numberPayload() const { return number_; }
+	auto intPayload() const {
+	  return detail::intValue(payloadFactory_, number_, 0);
+	}
 	auto floatPayload() const {
-	  return payloadFactory_.floatValue(payload_);
+	  return detail::floatValue(payloadFactory_, number_, 0);
 	}
 	auto stringPayload() const {
 	  return payloadFactory_.stringValue(payload_);
 	}
 
+	/** @brief Decode the payload of a STRING_VALUE or STRING_CHUNK
+	 *         event as base64.
+	 *
+	 *  The text is decoded where it lies in the reader's buffer and the
+	 *  bytes are written to @c out, which must have room for
+	 *  util::Base64Decoder::maxDecodedSize(payloadText().size()) of
+	 *  them.  Returns the number of bytes written.  Pass the same
+	 *  @c decoder for every STRING_CHUNK of a string, and call
+	 *  @c decoder.finish() after its STRING_END event, or after the
+	 *  STRING_VALUE event of a string that wasn't split.  With
+	 *  setStringChunkSize(), a blob of any size can be decoded into a
+	 *  buffer of a fixed size without ever holding all of its text.
+	 */
+	size_t base64Payload(util::Base64Decoder& decoder,
+			     uint8_t* out) const {
+	  return decoder.decode(payload_, out);
+	}
+
+	JsonString payloadText(const CompactJsonEvent& evt) const {
+	  return evt.payloadText(batchText());
+	}
+	JsonNumber numberPayload(const CompactJsonEvent& evt) const {
+	  return evt.numberPayload(batchText());
+	}
+	auto intPayload(const CompactJsonEvent& evt) const {
+	  return detail::intValue(payloadFactory_, numberPayload(evt), 0);
+	}
+	auto floatPayload(const CompactJsonEvent& evt) const {
+	  return detail::floatValue(payloadFactory_, numberPayload(evt), 0);
+	}
+	auto stringPayload(const CompactJsonEvent& evt) const {
+	  return payloadFactory_.stringValue(payloadText(evt));
+	}
+	size_t base64Payload(const CompactJsonEvent& evt,
+			     util::Base64Decoder& decoder,
+			     uint8_t* out) const {
+	  return decoder.decode(payloadText(evt), out);
+	}
+
 	template <typename ArrayBuilderFactory, typename ObjectBuilderFactory>
 	auto readObject(const ArrayBuilderFactory& createArrayBuilder,
 			const ObjectBuilderFactory& createObjectBuilder) {
@@ -121,6 +696,9 @@ namespace pistis {
 
 	      default:
 		// Should not happen
+		throw pistis::exceptions::IllegalStateError(
+		    "Unknown event type", PISTIS_EX_HERE
+		);
 	    }
 	  }
 	  return builder.done();
@@ -188,76 +766,677 @@ namespace pistis {
 	FlexibleStreamReader<Stream, CharEncoder, Allocator> reader_;
 	PayloadFactory payloadFactory_;
 	JsonString payload_;
+	JsonNumber number_;
 	JsonEventOrigin origin_;
 	State current_;
-	std::vector<State (FlexibleEventStream::*)()> stateStack_;
 
-	State parseInitialValue_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::parseInitialValue_,
-			 JsonEventType::AGAIN);
+	/** @brief An open object or array: the state to return to when it
+	 *         ends, and the shape node of the object or array it is in
+	 */
+	struct Frame_ {
+	  StateId_ nextState;
+	  uint32_t shape;
+	};
+
+	// Frame for each open object or array.  Its size is fixed at
+	// maxDepth_, and depth_ of its entries are in use.
+	std::vector<Frame_> stateStack_;
+	uint32_t depth_;
+	uint32_t maxDepth_;
+	memory::StringBuffer<Allocator> batchText_;
+	SkipPhase_ skipPhase_;
+	StateId_ skipNextState_;
+	JsonEventType skipEvent_;
+	uint32_t skipDepth_;
+	PathProjection projection_;
+	std::vector<ProjectionFrame_> projectionFrames_;
+
+	// Automaton nodes for all the frames in projectionFrames_
+	std::vector<uint32_t> projectionNodes_;
+
+	// Nodes for the value that is about to start
+	std::vector<uint32_t> valueNodes_;
+
+	// Nodes that select the current selected value, and how deeply
+	// nested the stream is inside that value
+	std::vector<uint32_t> selectedNodes_;
+	uint32_t selectedDepth_;
+
+	// Which of the projection's selected values have been seen
+	std::vector<bool> seen_;
+	uint32_t numSeen_;
+	bool projectionDone_;
+	SymbolTableType* symbols_;
+	uint32_t fieldSymbol_;
+	ShapeCache<Allocator> shapes_;
+
+	// Shape node for the innermost open object or array, or root()
+	// outside of them.  For arrays, the node of the field the array is
+	// the value of.  NO_NODE if it is not being predicted.
+	uint32_t shape_;
+	bool predictShapes_;
+	uint32_t predictedKey_;
+	ShapeStatistics shapeStatistics_;
+	bool multipleValues_;
+	bool arrayElements_;
+
+	// String values longer than this are returned in parts, and the
+	// state that follows the string being returned that way
+	size_t stringChunkSize_;
+	StateId_ stringNextState_;
+
+	// True if parse() ran out of data while skipping a value
+	bool parseSkipping_;
+
+	void pushState_(StateId_ nextState, bool object) {
+	  if (depth_ == maxDepth_) {
+	    error_(reader_.position(),
+		   "Objects and arrays nested more than " +
+		       std::to_string(maxDepth_) + " deep");
+	  }
+	  stateStack_[depth_++] = Frame_{ nextState, shape_ };
+	  if (!predictShapes_) {
+	    shape_ = ShapeCache<Allocator>::NO_NODE;
+	  } else if (object) {
+	    shape_ = shapes_.objectShape(shape_);
 	  }
-	  return parseValue_(lookAhead.ch, nullptr,
-			     &FlexibleEventStream::parseInitialValue_);
 	}
-	
-	State parseFirstKey_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
+
+	StateId_ popState_() {
+	  const Frame_& frame = stateStack_[--depth_];
+	  shape_ = frame.shape;
+	  return frame.nextState;
+	}
+
+	/** @brief Continue the skip started by skipValue() or
+	 *         skipElement_()
+	 */
+	SkipResult_ continueSkip_() {
+	  JsonLookAhead lookAhead = JsonLookAhead::AGAIN;
+	  switch (skipPhase_) {
+	    case SkipPhase_::COLON:
+	      lookAhead = reader_.lookAhead();
+	      if (lookAhead.again) {
+		return SkipResult_::AGAIN;
+	      } else if (lookAhead.ch != ':') {
+		error_(reader_.position(), "\":\" missing");
+	      }
+	      reader_.advance();
+	      skipPhase_ = SkipPhase_::VALUE;
+	      break;
+
+	    case SkipPhase_::FIRST_ELEMENT:
+	      lookAhead = reader_.lookAhead();
+	      if (lookAhead.again) {
+		return SkipResult_::AGAIN;
+	      } else if (lookAhead.ch == ']') {
+		skipPhase_ = SkipPhase_::NONE;
+		return SkipResult_::NO_VALUE;
+	      }
+	      skipPhase_ = SkipPhase_::VALUE;
+	      break;
+
+	    case SkipPhase_::SEPARATOR:
+	      lookAhead = reader_.lookAhead();
+	      if (lookAhead.again) {
+		return SkipResult_::AGAIN;
+	      } else if (lookAhead.ch == ']') {
+		skipPhase_ = SkipPhase_::NONE;
+		return SkipResult_::NO_VALUE;
+	      } else if (lookAhead.ch != ',') {
+		error_(reader_.position(), "\",\" expected");
+	      }
+	      reader_.advance();
+	      skipPhase_ = SkipPhase_::VALUE;
+	      break;
+
+	    default:
+	      break;
+	  }
+
+	  if (skipPhase_ == SkipPhase_::VALUE) {
+	    lookAhead = reader_.lookAhead();
+	    if (lookAhead.again) {
+	      return SkipResult_::AGAIN;
+	    }
+	    switch (lookAhead.ch) {
+	      case 0:
+	      case '}':
+	      case ']':
+	      case ',':
+	      case ':':
+		// The reader would skip these as an empty scalar
+		error_(reader_.position(), "Value expected");
+
+	      default:
+		break;
+	    }
+	    skipPhase_ = SkipPhase_::SCAN;
+	  }
+
+	  typedef typename FlexibleStreamReader<
+	      Stream, CharEncoder, Allocator
+	  >::SkipResult SkipResult;
+
+	  switch (reader_.skipValue(skipDepth_,
+				    skipPhase_ == SkipPhase_::RESUME)) {
+	    case SkipResult::AGAIN:
+	      skipPhase_ = SkipPhase_::RESUME;
+	      return SkipResult_::AGAIN;
+
+	    case SkipResult::END_OF_STREAM:
+	      error_(reader_.position(), "Unexpected end of stream");
+
+	    default:
+	      break;
+	  }
+
+	  skipPhase_ = SkipPhase_::NONE;
+	  current_ = State(skipNextState_, skipEvent_);
+	  return SkipResult_::SKIPPED;
+	}
+
+	/** @brief Skip the next element of the array the stream is in, or
+	 *         find the ']' that ends the array.
+	 *
+	 *  Like skipValue(), but for arrays, which skipValue() can't do
+	 *  element by element because no event precedes an element.
+	 */
+	SkipResult_ skipElement_() {
+	  if (skipPhase_ == SkipPhase_::NONE) {
+	    const StateId_ f = current_.id();
+	    if (f == StateId_::FIRST_ARRAY_VALUE) {
+	      skipPhase_ = SkipPhase_::FIRST_ELEMENT;
+	    } else if (f == StateId_::NEXT_ARRAY_VALUE) {
+	      skipPhase_ = SkipPhase_::SEPARATOR;
+	    } else {
+	      // RESTART_ARRAY_VALUE or ARRAY_VALUE_AFTER_COMMA, which have
+	      // already read the ','
+	      skipPhase_ = SkipPhase_::VALUE;
+	    }
+	    skipNextState_ = StateId_::NEXT_ARRAY_VALUE;
+	    skipEvent_ = JsonEventType::AGAIN;
+	    skipDepth_ = 0;
+	  }
+	  return continueSkip_();
+	}
+
+	/** @brief Run the function for state @c id.
+	 *
+	 *  The states are numbered densely from zero, so the switches
+	 *  compile to jumps through tables, and the state functions, which
+	 *  are only called from here and from each other, can be inlined
+	 *  into it.  next(), nextBatch() and parse() all come through here.
+	 *
+	 *  Every state but the ones that end records and strings starts by
+	 *  looking at the next character, so step_() does that for them,
+	 *  and stays in the state if the reader has no data.
+	 */
+	State step_(StateId_ id) {
+	  switch (id) {
+	    case StateId_::DONE:
+	      return State(StateId_::DONE, JsonEventType::END);
+	    case StateId_::RECORD_END: return parseRecordEnd_();
+	    case StateId_::ELEMENT_END: return parseElementEnd_();
+	    case StateId_::STRING_PART: return parseStringPart_();
+	    case StateId_::STRING_END: return parseStringEnd_();
+	    default: break;
+	  }
+
+	  const JsonLookAhead lookAhead = reader_.lookAhead();
 	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::parseFirstKey_,
-			 JsonEventType::AGAIN);
-	  } else if (lookAhead.ch == '}') {
-	    return State(stateStack_.pop_back(), JsonEventType::END_OBJECT);
+	    return State(id, JsonEventType::AGAIN);
+	  }
+
+	  const char ch = lookAhead.ch;
+	  switch (id) {
+	    case StateId_::INITIAL_VALUE: return parseInitialValue_(ch);
+	    case StateId_::FIRST_ELEMENT: return parseFirstElement_(ch);
+	    case StateId_::NEXT_ELEMENT: return parseNextElement_(ch);
+	    case StateId_::RESTART_ELEMENT: return restartElement_(ch, true);
+	    case StateId_::ELEMENT_AFTER_COMMA:
+	      return restartElement_(ch, false);
+	    case StateId_::FIRST_KEY: return parseFirstKey_(ch);
+	    case StateId_::NEXT_KEY: return parseNextKey_(ch);
+	    case StateId_::RESTART_NEXT_KEY: return parseKey_(ch, true);
+	    case StateId_::KEY_AFTER_COMMA: return parseKey_(ch, false);
+	    case StateId_::OBJECT_VALUE: return parseObjectValue_(ch);
+	    case StateId_::RESTART_OBJECT_VALUE:
+	      return restartObjectValue_(ch, true);
+	    case StateId_::VALUE_AFTER_COLON:
+	      return restartObjectValue_(ch, false);
+	    case StateId_::FIRST_ARRAY_VALUE: return parseFirstArrayValue_(ch);
+	    case StateId_::NEXT_ARRAY_VALUE: return parseNextArrayValue_(ch);
+	    case StateId_::RESTART_ARRAY_VALUE:
+	      return restartArrayValue_(ch, true);
+	    case StateId_::ARRAY_VALUE_AFTER_COMMA:
+	      return restartArrayValue_(ch, false);
+	    default: return State(StateId_::DONE, JsonEventType::END);
+	  }
+	}
+
+	/** @brief next() without a projection */
+	JsonEventType nextEvent_() {
+	  if (!current_) {
+	    return JsonEventType::END;
 	  } else {
-	    return parseKey_(lookAhead.ch, false);
+	    current_ = current_.next(this);
+	    return current_.event();
 	  }
 	}
-	
-	State parseNextKey_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::parseNextKey_,
-			 JsonEventType::AGAIN);
-	  } else if (lookAhead.ch == '}') {
-	    return State(stateStack_.pop_back(), JsonEventType::END_OBJECT);
-	  } else if (lookAhead.ch != ',') {
-	    error_(reader_.position(), "\",\" missing");
+
+	/** @brief next() with a projection.
+	 *
+	 *  Runs the projection's automaton alongside the parser.  Each
+	 *  object or array on the projection's paths gets a frame holding
+	 *  the automaton's nodes for it (a set, since a wildcard and a
+	 *  field name can both match).  When a field name or an array index
+	 *  matches no node, the value is skipped with the reader's skip
+	 *  scan, so it is never decoded and never reaches the payload
+	 *  factory.  Values that a node selects are passed through whole.
+	 *  Everything else on the way to a selected value (the objects and
+	 *  arrays that contain it, and its field names) is reported too, so
+	 *  the events still describe a valid document.
+	 *
+	 *  If the projection is definite, the stream stops reading once it
+	 *  has seen every selected value.  It then closes the objects and
+	 *  arrays that are still open and returns END.
+	 */
+	JsonEventType nextProjected_() {
+	  while (true) {
+	    if (projectionDone_) {
+	      if (!multipleValues_ || !projectionFrames_.empty()) {
+		return closeProjection_();
+	      }
+	      skipRestOfRecord_();
+	    }
+
+	    if (skipPhase_ != SkipPhase_::NONE) {
+	      // Resume the skip that ran out of data last time
+	      switch (continueSkip_()) {
+		case SkipResult_::AGAIN: return JsonEventType::AGAIN;
+		case SkipResult_::SKIPPED:
+		  projectionSkipped_();
+		  continue;
+		default:
+		  break;
+	      }
+	    } else if (!selectedDepth_ && !projectionFrames_.empty() &&
+		       projectionFrames_.back().array) {
+	      const ProjectionFrame_& frame = projectionFrames_.back();
+	      valueNodes_.clear();
+	      for (size_t i = frame.nodesBegin; i < projectionNodes_.size();
+		   ++i) {
+		projection_.matchIndex(projectionNodes_[i], frame.index,
+				       valueNodes_);
+	      }
+	      if (valueNodes_.empty()) {
+		switch (skipElement_()) {
+		  case SkipResult_::AGAIN: return JsonEventType::AGAIN;
+		  case SkipResult_::SKIPPED:
+		    projectionSkipped_();
+		    continue;
+		  default:
+		    break;  // Let the parser return END_ARRAY
+		}
+	      }
+	    }
+
+	    const JsonEventType eventType = nextEvent_();
+	    if (selectedDepth_) {
+	      // Inside a selected value
+	      if ((eventType == JsonEventType::BEGIN_OBJECT) ||
+		  (eventType == JsonEventType::BEGIN_ARRAY)) {
+		++selectedDepth_;
+	      } else if (((eventType == JsonEventType::END_OBJECT) ||
+			  (eventType == JsonEventType::END_ARRAY)) &&
+			 !--selectedDepth_) {
+		selectedValueEnded_();
+	      }
+	      return eventType;
+	    }
+
+	    switch (eventType) {
+	      case JsonEventType::AGAIN:
+	      case JsonEventType::END:
+	      case JsonEventType::STRING_CHUNK:
+		// The parts of a string are reported as the string is.  Its
+		// STRING_END event counts as the value.
+		return eventType;
+
+	      case JsonEventType::END_RECORD:
+		resetProjection_();
+		return eventType;
+
+	      case JsonEventType::FIELD_NAME: {
+		const ProjectionFrame_& frame = projectionFrames_.back();
+		valueNodes_.clear();
+		for (size_t i = frame.nodesBegin;
+		     i < projectionNodes_.size(); ++i) {
+		  projection_.matchField(projectionNodes_[i], payload_,
+					 valueNodes_);
+		}
+		if (valueNodes_.empty()) {
+		  if (!skipValue()) {
+		    return JsonEventType::AGAIN;
+		  }
+		  continue;
+		}
+		return eventType;
+	      }
+
+	      case JsonEventType::END_OBJECT:
+	      case JsonEventType::END_ARRAY:
+		projectionNodes_.resize(projectionFrames_.back().nodesBegin);
+		projectionFrames_.pop_back();
+		projectedValueEnded_();
+		return eventType;
+
+	      case JsonEventType::BEGIN_OBJECT:
+	      case JsonEventType::BEGIN_ARRAY:
+		if (selectValue_()) {
+		  selectedDepth_ = 1;
+		} else {
+		  projectionFrames_.push_back(ProjectionFrame_{
+		      projectionNodes_.size(), 0,
+		      eventType == JsonEventType::BEGIN_ARRAY
+		  });
+		  projectionNodes_.insert(projectionNodes_.end(),
+					  valueNodes_.begin(),
+					  valueNodes_.end());
+		}
+		return eventType;
+
+	      default:
+		// A scalar.  Reported even if no node selects it, since
+		// the field name before it has been reported already.
+		if (selectValue_()) {
+		  selectedValueEnded_();
+		} else {
+		  projectedValueEnded_();
+		}
+		return eventType;
+	    }
+	  }
+	}
+
+	/** @brief Returns true if a node in valueNodes_ selects the value
+	 *         that is starting, and remembers which ones do.
+	 */
+	bool selectValue_() {
+	  selectedNodes_.clear();
+	  for (uint32_t node : valueNodes_) {
+	    if (projection_.selection(node) != PathProjection::NO_NODE) {
+	      selectedNodes_.push_back(node);
+	    }
+	  }
+	  return !selectedNodes_.empty();
+	}
+
+	/** @brief Called when a selected value ends */
+	void selectedValueEnded_() {
+	  for (uint32_t node : selectedNodes_) {
+	    const uint32_t selection = projection_.selection(node);
+	    if (!seen_[selection]) {
+	      seen_[selection] = true;
+	      ++numSeen_;
+	    }
+	  }
+	  projectedValueEnded_();
+	  projectionDone_ = projection_.definite() &&
+	                    (numSeen_ == projection_.numSelections());
+	}
+
+	/** @brief Called when a value in the current frame ends */
+	void projectedValueEnded_() {
+	  if (!projectionFrames_.empty() && projectionFrames_.back().array) {
+	    ++projectionFrames_.back().index;
+	  }
+	}
+
+	/** @brief Bring the projection up to date after a skip */
+	void projectionSkipped_() {
+	  if (skipEvent_ == JsonEventType::AGAIN) {
+	    // Skipped a field's value or an array element
+	    if (!selectedDepth_) {
+	      projectedValueEnded_();
+	    }
+	  } else if (selectedDepth_ && !--selectedDepth_) {
+	    selectedValueEnded_();
+	  } else if (!selectedDepth_ && !projectionFrames_.empty()) {
+	    projectionNodes_.resize(projectionFrames_.back().nodesBegin);
+	    projectionFrames_.pop_back();
+	    projectedValueEnded_();
+	  }
+	}
+
+	/** @brief Start over with the next record of a stream with
+	 *         multiple values
+	 */
+	void resetProjection_() {
+	  projectionFrames_.clear();
+	  projectionNodes_.clear();
+	  valueNodes_.assign(1, projection_.root());
+	  selectedNodes_.clear();
+	  selectedDepth_ = 0;
+	  seen_.assign(seen_.size(), false);
+	  numSeen_ = 0;
+	  projectionDone_ = false;
+	}
+
+	/** @brief Once a definite projection has seen everything it selects
+	 *         in a record, skip the rest of the record.
+	 */
+	void skipRestOfRecord_() {
+	  projectionDone_ = false;
+	  if (depth_) {
+	    skipPhase_ = SkipPhase_::SCAN;
+	    skipNextState_ = arrayElements_ ? StateId_::ELEMENT_END
+				            : StateId_::RECORD_END;
+	    skipEvent_ = JsonEventType::AGAIN;
+	    skipDepth_ = depth_;
+	    depth_ = 0;
+	    shape_ = shapes_.root();
+	  }
+	}
+
+	/** @brief Close the objects and arrays that are still open after
+	 *         a definite projection has seen everything it selects.
+	 */
+	JsonEventType closeProjection_() {
+	  if (projectionFrames_.empty()) {
+	    current_ = State();
+	    return JsonEventType::END;
+	  }
+
+	  const bool array = projectionFrames_.back().array;
+	  projectionNodes_.resize(projectionFrames_.back().nodesBegin);
+	  projectionFrames_.pop_back();
+	  return array ? JsonEventType::END_ARRAY : JsonEventType::END_OBJECT;
+	}
+
+	/** @brief Record an event in a batch.  Returns false if the batch
+	 *         must end after it.
+	 */
+	bool addToBatch_(CompactJsonEvent& evt, JsonEventType eventType,
+			 bool withOrigins) {
+	  evt.type = eventType;
+	  if (withOrigins) {
+	    evt.origin = origin_;
+	  }
+	  switch (eventType) {
+	    case JsonEventType::INT_VALUE:
+	    case JsonEventType::FLOAT_VALUE:
+	      evt.negative = number_.negative();
+	      evt.truncated = number_.truncated();
+	      evt.exponent = number_.exponent();
+	      evt.significand = number_.significand();
+	      copyToBatch_(evt, number_.text());
+	      return true;
+
+	    case JsonEventType::FIELD_NAME:
+	      evt.symbol = fieldSymbol_;
+	      copyToBatch_(evt, payload_);
+	      return true;
+
+	    case JsonEventType::STRING_VALUE:
+	    case JsonEventType::STRING_CHUNK:
+	      copyToBatch_(evt, payload_);
+	      return true;
+
+	    default:
+	      evt.payloadLength = 0;
+	      return (eventType != JsonEventType::AGAIN) &&
+		     (eventType != JsonEventType::END);
+	  }
+	}
+
+	/** @brief If the next field name is the one the shape cache
+	 *         predicts, consume it and return true.
+	 */
+	bool matchPredictedKey_() {
+	  if (shape_ == ShapeCache<Allocator>::NO_NODE) {
+	    return false;
+	  }
+
+	  const uint32_t predicted = shapes_.predicted(shape_);
+	  if ((predicted == ShapeCache<Allocator>::NO_NODE) ||
+	      !reader_.matchString(shapes_.key(predicted), origin_)) {
+	    return false;
+	  }
+
+	  payload_ = shapes_.key(predicted);
+	  if (symbols_) {
+	    uint32_t& symbol = shapes_.symbol(predicted);
+	    if (symbol == SymbolTableType::NO_SYMBOL) {
+	      symbol = symbols_->intern(payload_);
+	    }
+	    fieldSymbol_ = symbol;
+	  }
+	  shape_ = predicted;
+	  predictedKey_ = shapes_.index(predicted);
+	  ++shapeStatistics_.hits;
+	  return true;
+	}
+
+	/** @brief Update the shape cache and symbol id after reading a
+	 *         field name the slow way
+	 */
+	void keyRead_() {
+	  predictedKey_ = NOT_PREDICTED;
+	  if (symbols_) {
+	    fieldSymbol_ = symbols_->intern(payload_);
+	  }
+	  if (shape_ != ShapeCache<Allocator>::NO_NODE) {
+	    const bool matchable =
+		!reader_.stringDecoded() &&
+		!::memchr(payload_.begin(), '\n', payload_.size());
+	    const uint32_t next = shapes_.addKey(shape_, payload_, matchable);
+	    if ((next != ShapeCache<Allocator>::NO_NODE) && symbols_) {
+	      shapes_.symbol(next) = fieldSymbol_;
+	    }
+	    shape_ = next;
+	    ++shapeStatistics_.misses;
+	  }
+	}
+
+	void copyToBatch_(CompactJsonEvent& evt, const JsonString& text) {
+	  evt.payloadOffset = batchText_.size();
+	  evt.payloadLength = text.size();
+	  batchText_.write(text.begin(), text.end());
+	}
+
+	State parseInitialValue_(char lookAhead) {
+	  if (!multipleValues_) {
+	    return parseValue_(lookAhead, StateId_::DONE,
+			       StateId_::INITIAL_VALUE);
+	  } else if (!lookAhead) {
+	    return State(StateId_::DONE, JsonEventType::END);
+	  } else {
+	    return parseValue_(lookAhead, StateId_::RECORD_END,
+			       StateId_::INITIAL_VALUE);
+	  }
+	}
+
+	State parseRecordEnd_() {
+	  return State(StateId_::INITIAL_VALUE, JsonEventType::END_RECORD);
+	}
+
+	State parseFirstElement_(char lookAhead) {
+	  if (!lookAhead) {
+	    return State(StateId_::DONE, JsonEventType::END);
+	  } else {
+	    return parseValue_(lookAhead, StateId_::ELEMENT_END,
+			       StateId_::RESTART_ELEMENT);
+	  }
+	}
+
+	State parseElementEnd_() {
+	  return State(StateId_::NEXT_ELEMENT, JsonEventType::END_RECORD);
+	}
+
+	State parseNextElement_(char lookAhead) {
+	  if (!lookAhead) {
+	    return State(StateId_::DONE, JsonEventType::END);
+	  } else if (lookAhead != ',') {
+	    error_(reader_.position(), "\",\" expected");
 	  } else {
 	    reader_.advance();
-	    lookAhead = reader_.lookAhead();
-	    if (lookAhead.again) {
-	      return State(&FlexibleEventStream::restartNextKey_,
-			   JsonEventType::AGAIN);
+	    const JsonLookAhead next = reader_.lookAhead();
+	    if (next.again) {
+	      return State(StateId_::ELEMENT_AFTER_COMMA, JsonEventType::AGAIN);
 	    } else {
-	      return parseKey_(lookAhead.ch, false);
+	      return parseValue_(next.ch, StateId_::ELEMENT_END,
+				 StateId_::RESTART_ELEMENT);
 	    }
 	  }
 	}
 
-	State restartNextKey_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::restartNextKey_,
-			 JsonEventType::AGAIN);
+	State restartElement_(char lookAhead, bool resumed) {
+	  return parseValue_(lookAhead, StateId_::ELEMENT_END,
+			     StateId_::RESTART_ELEMENT, resumed);
+	}
+	
+	State parseFirstKey_(char lookAhead) {
+	  if (lookAhead == '}') {
+	    reader_.advance();
+	    return State(popState_(), JsonEventType::END_OBJECT);
 	  } else {
-	    return parseKey_(lookAhead.ch, true);
+	    return parseKey_(lookAhead, false);
 	  }
 	}
 	
+	State parseNextKey_(char lookAhead) {
+	  if (lookAhead == '}') {
+	    reader_.advance();
+	    return State(popState_(), JsonEventType::END_OBJECT);
+	  } else if (lookAhead != ',') {
+	    error_(reader_.position(), "\",\" missing");
+	  } else {
+	    reader_.advance();
+	    const JsonLookAhead next = reader_.lookAhead();
+	    if (next.again) {
+	      return State(StateId_::KEY_AFTER_COMMA, JsonEventType::AGAIN);
+	    } else {
+	      return parseKey_(next.ch, false);
+	    }
+	  }
+	}
+
 	State parseKey_(char lookAhead, bool resumed) {
 	  if (lookAhead != '"') {
 	    error_(reader_.position(), "'\"' missing");
+	  } else if (!resumed && matchPredictedKey_()) {
+	    return State(StateId_::OBJECT_VALUE, JsonEventType::FIELD_NAME);
 	  } else {
 	    try {
-	      if (reader_.nextString(payload_, origin, stringStart, resumed)) {
-		return State(&FlexibleEventStream::parseObjectValue_,
-			     JsonEventType::FIELD_NAME);
+	      if (reader_.nextString(payload_, origin_, resumed)) {
+		keyRead_();
+		return State(StateId_::OBJECT_VALUE, JsonEventType::FIELD_NAME);
 	      } else {
-		return State(&FlexibleEventStream::restartNextKey_,
-			     JsonEventType::AGAIN);
+		return State(StateId_::RESTART_NEXT_KEY, JsonEventType::AGAIN);
 	      }
-	    } catch(const FlexibleStreamReader<Stream>::StringNotTerminated& e) {
+	    } catch(const exceptions::JsonStringNotTerminated& e) {
 	      error_(e.origin(), "Field name not terminated");
 	    } catch(const InvalidJsonStringError& e) {
 	      error_(origin_, e.details());
@@ -265,103 +1444,76 @@ namespace pistis {
 	  }
 	}
 
-	State parseObjectValue_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::parseObjectValue_,
-			 JsonEventType::AGAIN);
-	  } else if (lookAhead.ch != ':') {
+	State parseObjectValue_(char lookAhead) {
+	  if (lookAhead != ':') {
 	    error_(reader_.position(), "\":\" missing");
 	  } else {
 	    reader_.advance();
-	    lookAhead = reader_.lookAhead();
-	    if (lookAhead.again) {
-	      return State(&FlexibleEventStream::restartObjectValue_,
+	    const JsonLookAhead next = reader_.lookAhead();
+	    if (next.again) {
+	      return State(StateId_::VALUE_AFTER_COLON,
 			   JsonEventType::AGAIN);
 	    }
-	    return parseValue_(lookAhead.ch,
-			       &FlexibleEventStream::parseNextKey_,
-			       &FlexibleEventStream::restartObjectValue_);
+	    return parseValue_(next.ch, StateId_::NEXT_KEY,
+			       StateId_::RESTART_OBJECT_VALUE);
 	  }
 	}
 
-	State restartObjectValue_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::restartObjectValue_,
-			 JsonEventType::AGAIN);
-	  } else {
-	    return parseValue_(lookAhead.ch,
-			       &FlexibleEventStream::parseNextKey_,
-			       &FlexibleEventStream::restartObjectValue_,
-			       true);
-	  }
+	State restartObjectValue_(char lookAhead, bool resumed) {
+	  return parseValue_(lookAhead, StateId_::NEXT_KEY,
+			     StateId_::RESTART_OBJECT_VALUE, resumed);
 	}
 	
-	State parseFirstArrayValue_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::parseFirstArrayValue_,
-			 JsonEventType::AGAIN);
-	  } else if (lookAhead.ch == ']') {
-	    return State(stateStack_.pop_back(), JsonEventType::END_ARRAY);
+	State parseFirstArrayValue_(char lookAhead) {
+	  if (lookAhead == ']') {
+	    reader_.advance();
+	    return State(popState_(), JsonEventType::END_ARRAY);
 	  } else {
-	    return parseValue_(lookAhead.ch,
-			       &FlexibleEventStream::parseNextArrayValue_,
-			       &FlexibleEventStream::restartArrayValue_);
+	    return parseValue_(lookAhead, StateId_::NEXT_ARRAY_VALUE,
+			       StateId_::RESTART_ARRAY_VALUE);
 	  }
 	}
 	
-	State parseNextArrayValue_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::parseNextArrayValue_,
-			 JsonEventType::AGAIN);
-	  } else if (lookAhead.ch == ']') {
-	    return State(stateStack_.pop_back(), JsonEventType::END_ARRAY);
-	  } else if (lookAhead.ch != ',') {
+	State parseNextArrayValue_(char lookAhead) {
+	  if (lookAhead == ']') {
+	    reader_.advance();
+	    return State(popState_(), JsonEventType::END_ARRAY);
+	  } else if (lookAhead != ',') {
 	    error_(reader_.position(), "\",\" expected");
 	  } else {
 	    reader_.advance();
-	    lookAhead = reader_.lookAhead();
-	    if (lookAhead.again) {
-	      return State(&FlexibleEventStream::restartArrayValue_,
+	    const JsonLookAhead next = reader_.lookAhead();
+	    if (next.again) {
+	      return State(StateId_::ARRAY_VALUE_AFTER_COMMA,
 			   JsonEventType::AGAIN);
 	    } else {
-	      return parseValue_(lookAhead.ch,
-				 &FlexibleEventStream::parseNextArrayValue_,
-				 &FlexibleEventStream::restartArrayValue_);
+	      return parseValue_(next.ch, StateId_::NEXT_ARRAY_VALUE,
+				 StateId_::RESTART_ARRAY_VALUE);
 	    }
 	  }
 	}
 
-	State restartArrayValue_() {
-	  JsonLookAhead lookAhead = reader_.lookAhead();
-	  if (lookAhead.again) {
-	    return State(&FlexibleEventStream::restartArrayValue_,
-			 JsonEventType::AGAIN);
-	  } else {
-	    return parseValue_(lookAhead.ch,
-			       &FlexibleEventStream::parseNextArrayValue_,
-			       &FlexibleEventStream::restartArrayValue_,
-			       true);
-	  }
+	State restartArrayValue_(char lookAhead, bool resumed) {
+	  return parseValue_(lookAhead, StateId_::NEXT_ARRAY_VALUE,
+			     StateId_::RESTART_ARRAY_VALUE, resumed);
 	}
 	
-	State parseValue_(char lookAhead,
-			  State (FlexibleEventStream::*nextState)(),
-			  State (FlexibleEventStream::*restartState)(),
-			  bool resumed) {
-	  if (lookAhead == '"') {
-	    if (reader_.nextString(payload_, origin_, resumed))
-	      return State(nextState, JsonEventType::STRING);
+	State parseValue_(char lookAhead, StateId_ nextState,
+			  StateId_ restartState, bool resumed = false) {
+	  if ((lookAhead == '"') && stringChunkSize_) {
+	    stringNextState_ = nextState;
+	    return parseStringPart_();
+	  } else if (lookAhead == '"') {
+	    if (reader_.nextString(payload_, origin_, resumed)) {
+	      return State(nextState, JsonEventType::STRING_VALUE);
 	    } else {
 	      return State(restartState, JsonEventType::AGAIN);
 	    }
 	  } else if (std::isdigit(lookAhead) || (lookAhead == '-')) {
 	    try {
 	      JsonEventType eventType;
-	      if (reader_.nextNumber(eventType, payload_, origin_, resumed)) {
+	      if (reader_.nextNumber(eventType, number_, origin_, resumed)) {
+		payload_ = number_.text();
 		return State(nextState, eventType);
 	      } else {
 		return State(restartState, JsonEventType::AGAIN);
@@ -372,26 +1524,27 @@ namespace pistis {
 	  } else {
 	    switch (lookAhead) {
 	      case '{':
+		origin_ = reader_.position();
 		reader_.advance();
-		stateStack_.push_back(nextState);
-		return State(&FlexibleEventStream::parseFirstKey_,
-			     JsonEventType::BEGIN_OBJECT);
+		pushState_(nextState, true);
+		return State(StateId_::FIRST_KEY, JsonEventType::BEGIN_OBJECT);
 
 	      case '[':
-		origin_ = reader_.advance();
-		stateStack_.push_back(nextState);
-		return State(&FlexibleEventStream::parseFirstArrayValue_,
+		origin_ = reader_.position();
+		reader_.advance();
+		pushState_(nextState, false);
+		return State(StateId_::FIRST_ARRAY_VALUE,
 			     JsonEventType::BEGIN_ARRAY);
 
 	      case 'T':
 	      case 't':
 		return parseWord_("true", 4, JsonEventType::TRUE_VALUE,
-				  nextStart, restartState, resumed);
+				  nextState, restartState, resumed);
 
 	      case 'F':
 	      case 'f':
 		return parseWord_("false", 5, JsonEventType::FALSE_VALUE,
-				  nextStart, restartState, resumed);
+				  nextState, restartState, resumed);
 
 	      case 'N':
 	      case 'n':
@@ -404,11 +1557,49 @@ namespace pistis {
 	  }
 	}
 
+	/** @brief Read a string value, or the next part of one, when
+	 *         strings are split
+	 */
+	State parseStringPart_() {
+	  typedef typename FlexibleStreamReader<
+	      Stream, CharEncoder, Allocator
+	  >::StringPartResult StringPartResult;
+
+	  try {
+	    switch (reader_.nextStringPart(payload_, origin_,
+					   stringChunkSize_)) {
+	      case StringPartResult::WHOLE:
+		return State(stringNextState_, JsonEventType::STRING_VALUE);
+
+	      case StringPartResult::PART:
+		return State(StateId_::STRING_PART,
+			     JsonEventType::STRING_CHUNK);
+
+	      case StringPartResult::LAST:
+		if (payload_.size()) {
+		  return State(StateId_::STRING_END,
+			       JsonEventType::STRING_CHUNK);
+		}
+		return State(stringNextState_, JsonEventType::STRING_END);
+
+	      default:
+		return State(StateId_::STRING_PART, JsonEventType::AGAIN);
+	    }
+	  } catch(const exceptions::JsonStringNotTerminated& e) {
+	    error_(e.origin(), "String not terminated");
+	  } catch(const InvalidJsonStringError& e) {
+	    error_(origin_, e.details());
+	  }
+	}
+
+	State parseStringEnd_() {
+	  payload_ = JsonString();
+	  return State(stringNextState_, JsonEventType::STRING_END);
+	}
+
 	State parseWord_(const char* word, size_t length,
-			 JsonEventType eventType,
-			 State (FlexibleEventStream::*nextState)(),
-			 State (FlexibleEventStream::*restartState)(),
-			 bool resumed) {
+			 JsonEventType eventType, StateId_ nextState,
+			 StateId_ restartState, bool resumed) {
 	  try {
 	    if (reader_.recognizeWord(word, length, origin_, resumed)) {
 	      return State(nextState, eventType);
@@ -482,7 +1673,7 @@ namespace pistis {
 	    msg << " of " << streamName_;
 	  }
 	  msg << ": " << details;
-	  throw JsonParseError(msg.str(), origin);
+	  throw exceptions::JsonParseError(msg.str(), origin, PISTIS_EX_HERE);
 	}
       };
 
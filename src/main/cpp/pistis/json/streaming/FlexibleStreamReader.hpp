@@ -2,13 +2,22 @@
 #define __PISTIS__JSON__STREAMING__FLEXIBLESTREAMREADER_HPP__
 
 #include <pistis/exceptions/IllegalStateError.hpp>
-#include <pistis/json/exceptions/JsonStringNotTerminated.hpp>
+#include <pistis/json/InvalidJsonStringError.hpp>
 #include <pistis/json/exceptions/InvalidJsonNumberError.hpp>
+#include <pistis/json/exceptions/JsonStringNotTerminated.hpp>
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/memory/MonotonicArena.hpp>
+#include <pistis/json/memory/StringBuffer.hpp>
 #include <pistis/json/streaming/JsonEventOrigin.hpp>
 #include <pistis/json/streaming/JsonEventType.hpp>
 #include <pistis/json/streaming/JsonLookAhead.hpp>
+#include <pistis/json/streaming/detail/StreamTraits.hpp>
+#include <pistis/json/util/SimdScanner.hpp>
+#include <pistis/json/util/NestingScanner.hpp>
 #include <cctype>
 #include <memory>
+#include <string>
+#include <vector>
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -20,25 +29,72 @@ namespace pistis {
 
       template <typename Stream, typename CharEncoder, typename Allocator>
       class FlexibleStreamReader : Allocator, CharEncoder {
+      public:
+	/** @brief True if the reader parses its stream in place.
+	 *
+	 *  When the stream holds its entire content in memory (see
+	 *  detail::IsContiguousStream), the reader does not allocate a
+	 *  buffer or copy anything on refill, and payloads that do not
+	 *  need decoding point straight into the stream's memory.
+	 */
+	static constexpr const bool IN_PLACE =
+	    detail::IsContiguousStream<Stream>::value;
+
+	/** @brief Thrown when the reader is asked for a token that does
+	 *         not start at the current position, such as a string
+	 *         where there is no '"'.  origin() is that position.
+	 */
+	class IncorrectAlignment
+	    : public pistis::exceptions::IllegalStateError {
+	public:
+	  IncorrectAlignment(
+	      const std::string& details, const JsonEventOrigin& origin,
+	      const pistis::exceptions::ExceptionOrigin& exceptionOrigin
+	  ):
+	      IllegalStateError(details, exceptionOrigin), origin_(origin) {
+	  }
+
+	  const JsonEventOrigin& origin() const { return origin_; }
+
+	private:
+	  JsonEventOrigin origin_;
+	};
+
       public:
 	FlexibleStreamReader(Stream&& stream, size_t chunkSize,
 			     const CharEncoder charEncoder = CharEncoder(),
 			     const Allocator& allocator = Allocator()):
 	    Allocator(allocator), CharEncoder(charEncoder),
-	    buffer_(this->allocate(chunkSize_)),
-	    stream_(std::move(stream)), stringBuffer_(), chunkSize_(chunkSize),
+	    buffer_(IN_PLACE ? BufferPtr_() : allocateBuffer_(chunkSize)),
+	    stream_(std::move(stream)),
+	    stringBuffer_(16, (size_t)-1, allocator), chunkSize_(chunkSize),
 	    bufferExtensionLimit_(chunkSize_ - (chunkSize_ >> 8)),
-	    bufferEos_(buffer_.get() + chunkSize_), bufferEnd_(buffer_.get()),
+	    base_(buffer_.get()),
+	    bufferEos_(IN_PLACE ? nullptr : buffer_.get() + chunkSize_),
+	    bufferEnd_(buffer_.get()),
 	    current_(buffer_.get()), bufferOffset_(0), lineStartOffset_(0),
 	    lineNumber_(1), saved_(), numberParseState_(0),
-	    numberEventType_(JsonEventType::INT_VALUE), lastBuffer_(nullptr) {
+	    numberEventType_(JsonEventType::INT_VALUE), number_(),
+	    digitCount_(0), exponentValue_(0), exponentNegative_(false),
+	    lastBuffer_(nullptr), skipState_(SkipState_::VALUE),
+	    skipNesting_(), inStringPart_(false), partsEnded_(false),
+	    partDecoded_(false), partReturned_(false), numParts_(0),
+	    pinBuffers_(false), pinned_(),
+	    pinnedText_(4096, 1024 * 1024, allocator) {
+	  if constexpr (IN_PLACE) {
+	    base_ = stream_.begin();
+	    bufferEos_ = stream_.end();
+	    bufferEnd_ = stream_.end();
+	    current_ = base_;
+	  }
 	}
 	FlexibleStreamReader(const FlexibleStreamReader&) = delete;
 	FlexibleStreamReader(FlexibleStreamReader&&) = default;
 
 	JsonEventOrigin position() const {
-	  return JsonEventOrigin(lineNumber_, (current_ - lineStart_ + 1),
-				 bufferOffset_ + (current_ - buffer_.get()));
+	  const uint64_t offset = offsetOf_(current_);
+	  return JsonEventOrigin(lineNumber_, offset - lineStartOffset_ + 1,
+				 offset);
 	}
 	
 	JsonLookAhead lookAhead() {
@@ -48,18 +104,21 @@ namespace pistis {
 	        case FillResult::AGAIN: return JsonLookAhead::AGAIN;
 	        case FillResult::END_OF_STREAM:
 		  return JsonLookAhead::END_OF_STREAM;
+	        default:
+		  break;
 	      }
 	    }
 
-	    const char c = *current_;
-	    if (c == '\n') {
-	      lineStartOffset_ = bufferOffset_ + (current_ - buffer_.get());
-	      ++lineNumber_;
-	    } else if ((c != ' ') && (c != '\t') && (c != '\n') &&
-		       (c != '\r')) {
-	      return JsonLookAhead(c);
+	    if (!util::isJsonWhitespace(*current_)) {
+	      return JsonLookAhead(*current_);
+	    }
+
+	    util::NewlineCount newlines;
+	    current_ = util::skipWhitespace(current_, bufferEnd_, newlines);
+	    if (newlines.count) {
+	      lineNumber_ += newlines.count;
+	      lineStartOffset_ = offsetOf_(newlines.last) + 1;
 	    }
-	    ++current_;
 	  }
 	}
 	
@@ -77,16 +136,30 @@ namespace pistis {
 	  origin = position();
 
 	  if (resumed) {
-	    current_ = saved_.restore(*this);
+	    saved_.restore(*this);
 	  } else {
 	    stringBuffer_.clear();
 	    lastBuffer_ = nullptr;
 	    ++current_;
 	  }
 
+	  // lastBuffer_ is null until the first escape sequence.  After that,
+	  // it marks the start of the text that has not been copied to
+	  // stringBuffer_ yet, and that text is copied before the buffer is
+	  // refilled or the next escape sequence is decoded.
 	  while (true) {
+	    current_ = util::findStringDelimiter(current_, bufferEnd_);
 	    if (current_ == bufferEnd_) {
-	      switch(fillBuffer_(startingState)) {
+	      if (lastBuffer_) {
+		stringBuffer_.write(lastBuffer_, current_);
+	      }
+
+	      const FillResult fillResult = fillBuffer_(startingState);
+	      if (lastBuffer_) {
+		lastBuffer_ = current_;
+	      }
+
+	      switch(fillResult) {
 	        case FillResult::AGAIN:
 		  saved_.save(*this);
 		  startingState.restore(*this);
@@ -95,42 +168,258 @@ namespace pistis {
 	        case FillResult::END_OF_STREAM:
 		  throw exceptions::JsonStringNotTerminated(position(),
 							    PISTIS_EX_HERE);
+
+	        default:
+		  continue;
 	      }
 	    }
 
 	    if (*current_ == '"') {
 	      if (lastBuffer_) {
-		text = JsonString(stringBuffer_.begin(), stringBuffer_.end());
+		stringBuffer_.write(lastBuffer_, current_);
+		text = pinBuffers_ ? pinnedText_.copy(stringBuffer_.str())
+		                   : stringBuffer_.str();
 	      } else {
 		text = JsonString(startingState.current() + 1, current_);
 	      }
 	      ++current_; // Consume the '"'
 	      return true;
 	    } else if (*current_ == '\n') {
-	      lineStartOffset_ = bufferOffset_ + (current_ - buffer_.get() + 1);
+	      lineStartOffset_ = offsetOf_(current_) + 1;
 	      ++lineNumber_;
-	    } else if (*currnet_ == '\\') {
+	      ++current_;
+	    } else {
 	      if (!lastBuffer_) {
-		lastBuffer_ = initialState.current() + 1;
-	      }
-	      if (current_ > lastBuffer_) {
-		stringBuffer_.write(lastBuffer_, current_);
+		lastBuffer_ = startingState.current() + 1;
 	      }
-	      if (decodeEscapeSequence_(initialState) == DecodeResult::AGAIN) {
-		lastBuffer_ = current_;
+	      stringBuffer_.write(lastBuffer_, current_);
+	      const DecodeResult decodeResult =
+		  decodeEscapeSequence_(startingState);
+	      lastBuffer_ = current_;
+	      if (decodeResult == DecodeResult::AGAIN) {
 		saved_.save(*this);
-		initialState.restore(*this);
+		startingState.restore(*this);
 		return false;
-	      } else {
-		lastBuffer_ = current_;
-		--current_; // Will be undone by the ++current_ below
 	      }
 	    }
-	    ++current_;
 	  }
 	}
 	
-	bool nextNumber(JsonEventType& eventType, JsonString& payload,
+	/** @brief Result of nextStringPart() */
+	enum class StringPartResult {
+	  WHOLE,  ///< Read an entire string of at most the part size
+	  PART,   ///< Read part of a longer string, with more to come
+	  LAST,   ///< Read the last part of a longer string
+	  AGAIN   ///< No data available, but more available later
+	};
+
+	/** @brief Read a string a part at a time, so a huge string never
+	 *         has to fit in memory all at once.
+	 *
+	 *  Called at the opening quote, reads the string into @c text and
+	 *  returns WHOLE if its decoded text is at most @c partSize bytes.
+	 *  Otherwise, returns PART with the first part of it.  Each later
+	 *  call returns the next part, and the last one returns LAST, with
+	 *  the reader just past the closing quote.  The last part may be
+	 *  empty.
+	 *
+	 *  Parts without escape sequences point straight into the buffer,
+	 *  and end wherever the buffer does.  Decoded text is collected in
+	 *  the string buffer until it reaches @c partSize bytes, so the
+	 *  string buffer never grows much beyond that.  Each part is only
+	 *  valid until the next call.
+	 *
+	 *  If this method returns AGAIN, call it again, with the same
+	 *  @c partSize, when more data is available.
+	 */
+	StringPartResult nextStringPart(JsonString& text,
+					JsonEventOrigin& origin,
+					size_t partSize) {
+	  if (!inStringPart_) {
+	    if ((current_ == bufferEnd_) || (*current_ != '"')) {
+	      throw IncorrectAlignment("Must be aligned to a double-quote",
+				       position(), PISTIS_EX_HERE);
+	    }
+	    origin = position();
+	    ++current_;
+	    inStringPart_ = true;
+	    partsEnded_ = false;
+	    numParts_ = 0;
+	    partDecoded_ = false;
+	    partReturned_ = false;
+	    stringBuffer_.clear();
+	  } else if (partsEnded_) {
+	    text = JsonString();
+	    inStringPart_ = false;
+	    return StringPartResult::LAST;
+	  } else if (partReturned_) {
+	    stringBuffer_.clear();
+	    partDecoded_ = false;
+	    partReturned_ = false;
+	  }
+
+	  // Text in [start, current_) has not been returned or copied to
+	  // stringBuffer_ yet
+	  const char* start = current_;
+	  while (true) {
+	    current_ = util::findStringDelimiter(current_, bufferEnd_);
+	    const size_t pending =
+	        (partDecoded_ ? stringBuffer_.size() : 0) + (current_ - start);
+
+	    if (current_ == bufferEnd_) {
+	      if (pending && (numParts_ || (pending > partSize))) {
+		return returnPart_(text, start, StringPartResult::PART);
+	      }
+
+	      // Keep the start of a string that may yet turn out to be
+	      // short, so it can be returned whole
+	      if (start != current_) {
+		stringBuffer_.write(start, current_);
+		partDecoded_ = true;
+	      }
+	      switch (fillBuffer_()) {
+	        case FillResult::AGAIN:
+		  return StringPartResult::AGAIN;
+
+	        case FillResult::END_OF_STREAM:
+		  throw exceptions::JsonStringNotTerminated(position(),
+							    PISTIS_EX_HERE);
+
+	        default:
+		  start = current_;
+		  continue;
+	      }
+	    }
+
+	    if (*current_ == '"') {
+	      if (!numParts_ && (pending > partSize)) {
+		// Too long to return whole, so end with an empty part
+		returnPart_(text, start, StringPartResult::PART);
+		++current_;
+		partsEnded_ = true;
+		return StringPartResult::PART;
+	      }
+
+	      const StringPartResult result =
+		  numParts_ ? StringPartResult::LAST : StringPartResult::WHOLE;
+	      returnPart_(text, start, result);
+	      ++current_;
+	      inStringPart_ = false;
+	      return result;
+	    } else if (*current_ == '\n') {
+	      lineStartOffset_ = offsetOf_(current_) + 1;
+	      ++lineNumber_;
+	      ++current_;
+	    } else {
+	      stringBuffer_.write(start, current_);
+	      partDecoded_ = true;
+
+	      SavedState escapeStart(*this);
+	      const DecodeResult decodeResult =
+		  decodeEscapeSequence_(escapeStart);
+	      start = current_;
+	      if (decodeResult == DecodeResult::AGAIN) {
+		return StringPartResult::AGAIN;
+	      } else if (stringBuffer_.size() > partSize) {
+		return returnPart_(text, start, StringPartResult::PART);
+	      }
+	    }
+	  }
+	}
+
+	/** @brief True if the last string nextString() read contained
+	 *         escape sequences, so its text differs from its raw bytes.
+	 */
+	bool stringDecoded() const { return lastBuffer_ != nullptr; }
+
+	/** @brief The stream's entire content if the reader parses it in
+	 *         place, or an empty string if it does not.
+	 */
+	JsonString inputText() const {
+	  if constexpr (IN_PLACE) {
+	    return JsonString(stream_.begin(), stream_.end());
+	  } else {
+	    return JsonString();
+	  }
+	}
+
+	/** @brief True if the reader keeps every buffer it fills until
+	 *         releaseBuffers() is called.
+	 */
+	bool pinBuffers() const { return pinBuffers_; }
+
+	/** @brief Keep payloads valid until releaseBuffers() is called.
+	 *
+	 *  Normally the text of a string or number points into the
+	 *  reader's buffer, or into its string buffer if the string had
+	 *  escape sequences, and is overwritten by the next refill or the
+	 *  next string.  With pinning on, the reader never reuses a
+	 *  buffer.  When one fills up it starts a new one and keeps the
+	 *  old one, and decoded strings are copied into an arena, so
+	 *  payloads stay valid until the caller releases them, for
+	 *  example at the end of each record.
+	 *
+	 *  Each buffer keeps its last chunkSize() bytes free for the token
+	 *  that crosses its end, which is read into that space instead of
+	 *  being copied into a new buffer.  Only tokens longer than a chunk
+	 *  are still copied.  Has no effect on a reader that parses its
+	 *  stream in place, whose payloads are always stable.
+	 */
+	void setPinBuffers(bool pin) {
+	  if (!pin) {
+	    releaseBuffers();
+	  }
+	  pinBuffers_ = pin;
+	}
+
+	/** @brief Free the buffers pinned so far, except the one the reader
+	 *         is reading from, and the decoded strings.  Invalidates
+	 *         every payload read before the current position.
+	 */
+	void releaseBuffers() {
+	  pinned_.clear();
+	  pinnedText_.clear();
+	}
+
+	/** @brief Bytes held by buffers and decoded strings waiting for
+	 *         releaseBuffers()
+	 */
+	size_t bytesPinned() const {
+	  size_t n = pinnedText_.bytesAllocated();
+	  for (const BufferPtr_& b : pinned_) {
+	    n += b.get_deleter().size();
+	  }
+	  return n;
+	}
+
+	/** @brief If the string at the current position is @c text, with
+	 *         no escape sequences, consume it and return true.
+	 *
+	 *  Returns false without consuming anything if the string is
+	 *  something else, or if the buffer does not hold all of it yet.
+	 *  Then the caller reads the string with nextString() instead.
+	 *  @c text must not contain newlines.
+	 */
+	bool matchString(const JsonString& text, JsonEventOrigin& origin) {
+	  const size_t n = text.size();
+	  if (((size_t)(bufferEnd_ - current_) < (n + 2)) ||
+	      (*current_ != '"') || (current_[n + 1] != '"') ||
+	      ::memcmp(current_ + 1, text.begin(), n)) {
+	    return false;
+	  }
+	  origin = position();
+	  current_ += n + 2;
+	  return true;
+	}
+
+	/** @brief Read the number at the current position.
+	 *
+	 *  Besides finding the extent of the number, converts it to a
+	 *  decimal significand and exponent as its digits are scanned, so
+	 *  payload factories that accept a JsonNumber never have to look at
+	 *  the digits again.
+	 */
+	bool nextNumber(JsonEventType& eventType, JsonNumber& number,
 			JsonEventOrigin& origin, bool restarted = false) {
 	  if ((current_ == bufferEnd_) ||
 	      !(std::isdigit(*current_) || (*current_ == '-'))) {
@@ -140,28 +429,36 @@ namespace pistis {
 
 	  SavedState initialState(*this);	  
 
-	  
 	  origin = position();
 	  if (restarted) {
 	    saved_.restore(*this);
 	  } else {
-	    ++current_;
+	    number_.reset();
 	    numberParseState_ = 1;
 	    numberEventType_ = JsonEventType::INT_VALUE;
+	    digitCount_ = 0;
+	    exponentValue_ = 0;
+	    exponentNegative_ = false;
+	    if (*current_ == '-') {
+	      number_.setNegative(true);
+	      ++current_;
+	    }
 	  }
 
 	  while (numberParseState_) {
 	    switch(numberParseState_) {
 	      case 1: // Parsing initial digits
-		switch(scanDigits_(numberStart, initialState)) {
+		switch(scanDigits_(initialState, DigitKind::INTEGER)) {
 		  case DigitScanResult::NONE:
 		  case DigitScanResult::END_OF_STREAM:
-		    throw IncorrectAlignment("Must be aligned to a number",
-					     position(), PISTIS_EX_HERE);
+		    throw exceptions::InvalidJsonNumberError(origin,
+							     PISTIS_EX_HERE);
 		  case DigitScanResult::AGAIN:
 		    saved_.save(*this);
 		    initialState.restore(*this);
 		    return false;
+		  default:
+		    break;
 		}
 		numberParseState_ = 2;
 		// Fall through
@@ -177,9 +474,10 @@ namespace pistis {
 		if (current_ == bufferEnd_) {
 		  numberParseState_ = 0; // Nothing more to read
 		  break;
-		} else if ((*current_ == 'e') || (*current == 'E')) {
+		} else if ((*current_ == 'e') || (*current_ == 'E')) {
 		  numberEventType_ = JsonEventType::FLOAT_VALUE;
 		  numberParseState_ = 5;
+		  ++current_;
 		  break;
 		} else if (*current_ != '.') {
 		  numberParseState_ = 0;  // Hit end of number
@@ -187,24 +485,28 @@ namespace pistis {
 		} else {
 		  numberEventType_ = JsonEventType::FLOAT_VALUE;
 		  numberParseState_ = 3;
+		  digitCount_ = 0;
 		  ++current_;
 		}
-		// Fall through to state 3
+		// Fall through
 
 	      case 3: // Reading digits after '.'
-		switch(scanDigits_(numberStart, initialState)) {
+		switch(scanDigits_(initialState, DigitKind::FRACTION)) {
 		  case DigitScanResult::NONE:
 		  case DigitScanResult::END_OF_STREAM:
-		    throw exceptions:: InvalidJsonNumberError(origin,
-							      PISTIS_EX_HERE);
+		    throw exceptions::InvalidJsonNumberError(origin,
+							     PISTIS_EX_HERE);
 
 		  case DigitScanResult::AGAIN:
 		    saved_.save(*this);
 		    initialState.restore(*this);
 		    return false;
+
+		  default:
+		    break;
 		}
 		numberParseState_ = 4;
-		// Fall through to state 4
+		// Fall through
 
 	      case 4: // Checking for 'E' or 'e' after digits following '.'
 		if ((current_ == bufferEnd_) &&
@@ -215,13 +517,14 @@ namespace pistis {
 		  return false;
 		}
 		if ((current_ == bufferEnd_) ||
-		    ((*current_ != 'e') && (*current != 'E'))) {
+		    ((*current_ != 'e') && (*current_ != 'E'))) {
 		  numberParseState_ = 0;
 		  break;
 		} else {
 		  numberParseState_ = 5;
 		  ++current_;
 		}
+		// Fall through
 
 	      case 5: // Checking for '+' or '-' after 'E' or 'e'
 		if ((current_ == bufferEnd_) &&
@@ -236,14 +539,16 @@ namespace pistis {
 							   PISTIS_EX_HERE);
 		} else {
 		  if ((*current_ == '+') || (*current_ == '-')) {
+		    exponentNegative_ = (*current_ == '-');
 		    ++current_;
 		  }
 		  numberParseState_ = 6;
+		  digitCount_ = 0;
 		}
-		// Fall through to state 6
+		// Fall through
 
 	      case 6:  // Reading digits after 'E', 'e', '+' or '-'
-		switch(scanDigits_(numberStart, initialState)) {
+		switch(scanDigits_(initialState, DigitKind::EXPONENT)) {
 		  case DigitScanResult::NONE:
 		  case DigitScanResult::END_OF_STREAM:
 		    throw exceptions::InvalidJsonNumberError(origin,
@@ -253,26 +558,32 @@ namespace pistis {
 		    saved_.save(*this);
 		    initialState.restore(*this);
 		    return false;
+
+		  default:
+		    break;
 		}
+		number_.addExponent(exponentNegative_ ? -exponentValue_
+				                      : exponentValue_);
 		numberParseState_ = 0;
 		break;
 
 	      default:
-		throw pistis::exception::IllegalStateError(
+		throw pistis::exceptions::IllegalStateError(
 		    "Entered invalid state", PISTIS_EX_HERE
 		);
 	    }
 	  }
 
 	  eventType = numberEventType_;
-	  payload = JsonString(initialState.current(), current_);
+	  number_.setText(JsonString(initialState.current(), current_));
+	  number = number_;
 	  return true;
 	}
 	
 	bool recognizeWord(const char* word, size_t length,
 			   JsonEventOrigin& origin, bool restart) {
-	  if ((current_ == bufferEnd_) || (*current != word[0])) {
-	    throw IncorrectAlignment("Not aligned to word", location(),
+	  if ((current_ == bufferEnd_) || (*current_ != word[0])) {
+	    throw IncorrectAlignment("Not aligned to word", position(),
 				     PISTIS_EX_HERE);
 	  }
 
@@ -282,20 +593,10 @@ namespace pistis {
 	  if (restart) {
 	    saved_.restore(*this);
 	  }
-	  while ((bufferEnd_ - current_) < length) {
-	    switch(fillBuffer_(initialState)) {
-	      case FillResult::AGAIN:
-		saved_.save(*this);
-		initialState.restore(*this);
-		return false;
-
-	      case FillResult::END_OF_STREAM:
-		throw IncorrectAlignment("Not aligned to word", origin,
-					 PISTIS_EX_HERE);
-	    }
-	  }
 
-	  while ((bufferEnd_ - current_) < (length + 1)) {
+	  // Need the word plus the character after it, to be sure the word
+	  // is not the start of a longer one
+	  while ((size_t)(bufferEnd_ - current_) < (length + 1)) {
 	    switch(fillBuffer_(initialState)) {
 	      case FillResult::AGAIN:
 		saved_.save(*this);
@@ -303,15 +604,21 @@ namespace pistis {
 		return false;
 
 	      case FillResult::END_OF_STREAM:
-		if (::memcmp(word, current_, length)) {
+		if (((size_t)(bufferEnd_ - current_) < length) ||
+		    ::memcmp(word, current_, length)) {
 		  throw IncorrectAlignment("Not aligned to word", origin,
 					   PISTIS_EX_HERE);
 		}
+		current_ += length;
 		return true;
+
+	      default:
+		break;
 	    }
 	  }
 
-	  if (::memcmp(word, current_, length) || std::isalnum(word[length])) {
+	  if (::memcmp(word, current_, length) ||
+	      std::isalnum(current_[length])) {
 	    throw IncorrectAlignment("Not aligned at word", origin,
 				     PISTIS_EX_HERE);
 	  }
@@ -319,6 +626,143 @@ namespace pistis {
 	  return true;
 	}
 	
+	/** @brief Result of skipValue() */
+	enum class SkipResult {
+	  SKIPPED,       ///< Skipped the entire value
+	  AGAIN,         ///< No data available, but more available later
+	  END_OF_STREAM  ///< The stream ended before the value did
+	};
+
+	/** @brief Skip over a value without parsing it.
+	 *
+	 *  If @c depth is zero, the reader must be positioned at the start
+	 *  of a value, and skips the whole value.  Otherwise, the reader is
+	 *  inside @c depth levels of objects or arrays, and skips to just
+	 *  past the bracket that closes the outermost one.
+	 *
+	 *  Objects and arrays are skipped with util::skipNested(), which
+	 *  only tracks quotes, escapes and brackets, 64 bytes at a time.
+	 *  Nothing is decoded or converted, and the text is not checked
+	 *  for errors beyond whether it ends too soon.
+	 *
+	 *  If this method returns AGAIN, call it again with @c restart set
+	 *  to true to continue where it left off.
+	 */
+	SkipResult skipValue(uint32_t depth, bool restart = false) {
+	  if (!restart) {
+	    skipNesting_ = util::NestingState(depth);
+	    skipState_ = depth ? SkipState_::NESTED : SkipState_::VALUE;
+	  }
+
+	  while (true) {
+	    if (current_ == bufferEnd_) {
+	      switch (fillBuffer_()) {
+	        case FillResult::AGAIN: return SkipResult::AGAIN;
+	        case FillResult::END_OF_STREAM:
+		  // Only a scalar can end at the end of the stream
+		  return (skipState_ == SkipState_::SCALAR)
+		             ? SkipResult::SKIPPED
+		             : SkipResult::END_OF_STREAM;
+	        default:
+		  break;
+	      }
+	    }
+
+	    switch (skipState_) {
+	      case SkipState_::VALUE:
+		if ((*current_ == '{') || (*current_ == '[')) {
+		  skipNesting_ = util::NestingState(1);
+		  skipState_ = SkipState_::NESTED;
+		  ++current_;
+		} else if (*current_ == '"') {
+		  skipState_ = SkipState_::STRING;
+		  ++current_;
+		} else {
+		  skipState_ = SkipState_::SCALAR;
+		}
+		break;
+
+	      case SkipState_::SCALAR:
+		while ((current_ != bufferEnd_) && !isScalarEnd_(*current_)) {
+		  ++current_;
+		}
+		if (current_ != bufferEnd_) {
+		  return SkipResult::SKIPPED;
+		}
+		break;
+
+	      case SkipState_::NESTED: {
+		util::NewlineCount newlines;
+		current_ = util::skipNested(current_, bufferEnd_, skipNesting_,
+					    newlines);
+		if (newlines.count) {
+		  lineNumber_ += newlines.count;
+		  lineStartOffset_ = offsetOf_(newlines.last) + 1;
+		}
+		if (!skipNesting_.depth) {
+		  return SkipResult::SKIPPED;
+		}
+		break;
+	      }
+
+	      case SkipState_::STRING:
+		current_ = util::findStringDelimiter(current_, bufferEnd_);
+		if (current_ != bufferEnd_) {
+		  const char c = *current_++;
+		  if (c == '"') {
+		    return SkipResult::SKIPPED;
+		  } else if (c == '\\') {
+		    skipState_ = SkipState_::ESCAPE;
+		  } else {
+		    lineStartOffset_ = offsetOf_(current_);
+		    ++lineNumber_;
+		  }
+		}
+		break;
+
+	      case SkipState_::ESCAPE:
+		// The escaped character can't end the string, and the hex
+		// digits of a Unicode escape are ordinary characters.
+		++current_;
+		skipState_ = SkipState_::STRING;
+		break;
+	    }
+	  }
+	}
+
+	/** @brief Skip everything up to and including the next newline.
+	 *
+	 *  Used to get past a malformed record of an NDJSON stream.  Returns
+	 *  SKIPPED once it has consumed the newline, AGAIN if the stream ran
+	 *  out of data first, in which case the caller calls skipLine()
+	 *  again later, or END_OF_STREAM if the stream ended first.
+	 */
+	SkipResult skipLine() {
+	  inStringPart_ = false;
+	  while (true) {
+	    if (current_ == bufferEnd_) {
+	      switch (fillBuffer_()) {
+	        case FillResult::AGAIN: return SkipResult::AGAIN;
+	        case FillResult::END_OF_STREAM:
+		  return SkipResult::END_OF_STREAM;
+	        default:
+		  break;
+	      }
+	    }
+
+	    const char* const newline = static_cast<const char*>(
+		::memchr(current_, '\n', bufferEnd_ - current_)
+	    );
+	    if (newline) {
+	      current_ = newline + 1;
+	      lineStartOffset_ = offsetOf_(newline) + 1;
+	      ++lineNumber_;
+	      return SkipResult::SKIPPED;
+	    }
+	    current_ = bufferEnd_;
+	  }
+	}
+
 	FlexibleStreamReader& operator=(const FlexibleStreamReader&) = delete;
 	FlexibleStreamReader& operator=(FlexibleStreamReader&&) = default;
 
@@ -336,31 +780,65 @@ namespace pistis {
 	  END_OF_STREAM ///< Reached the end of the stream
 	};
 
+	enum class DigitKind {
+	  INTEGER,   ///< Digits before the '.'
+	  FRACTION,  ///< Digits after the '.'
+	  EXPONENT   ///< Digits after the 'e' or 'E'
+	};
+
+	/** @brief Where skipValue() is in the value it is skipping */
+	enum class SkipState_ {
+	  VALUE,   ///< At the start of the value
+	  SCALAR,  ///< Inside a number or word
+	  NESTED,  ///< Inside an object or array
+	  STRING,  ///< Inside a string that is not in an object or array
+	  ESCAPE   ///< Just past a '\\' inside that string
+	};
+
 	enum class DecodeResult {
 	  AGAIN,    ///< No data available, but more available later
 	  DECODED   ///< Decoded escape sequence successfully
 	};
 
+	/** @brief Returns buffers to the allocator they came from */
+	class BufferDeleter_ {
+	public:
+	  BufferDeleter_(): allocator_(), size_(0) { }
+	  BufferDeleter_(const Allocator& allocator, size_t size):
+	      allocator_(allocator), size_(size) {
+	  }
+
+	  size_t size() const { return size_; }
+	  void operator()(char* p) { allocator_.deallocate(p, size_); }
+
+	private:
+	  Allocator allocator_;
+	  size_t size_;
+	};
+
+	typedef std::unique_ptr<char[], BufferDeleter_> BufferPtr_;
+
 	class SavedState {
 	public:
 	  SavedState():
-	      current_(nullptr), lineStart_(nullptr), lineNumber_(0) {
+	      current_(nullptr), lineStartOffset_(0), lineNumber_(0) {
 	  }
 	  SavedState(const FlexibleStreamReader& reader):
-	      current_(reader.current_), lineStart_(reader.lineStart_)
+	      current_(reader.current_),
+	      lineStartOffset_(reader.lineStartOffset_),
 	      lineNumber_(reader.lineNumber_) {
 	  }
 	  SavedState(const SavedState&) = default;
 
 	  void save(const FlexibleStreamReader& reader) {
 	    current_ = reader.current_;
-	    lineStart_ = reader.lineStart_;
+	    lineStartOffset_ = reader.lineStartOffset_;
 	    lineNumber_ = reader.lineNumber_;
 	  }
 
 	  void restore(FlexibleStreamReader& reader) {
 	    reader.current_ = current_;
-	    reader.lineStart_ = lineStart_;
+	    reader.lineStartOffset_ = lineStartOffset_;
 	    reader.lineNumber_ = lineNumber_;
 	  }
 
@@ -377,11 +855,12 @@ namespace pistis {
 
 	
       private:
-	std::unique_ptr<char[]> buffer_;
+	BufferPtr_ buffer_;
 	Stream stream_;
-	memory::StringBuffer stringBuffer_;
+	memory::StringBuffer<Allocator> stringBuffer_;
 	size_t chunkSize_;
 	size_t bufferExtensionLimit_;
+	const char* base_;
 	const char* bufferEos_;
 	const char* bufferEnd_;
 	const char* current_;
@@ -390,16 +869,59 @@ namespace pistis {
 	uint64_t lineNumber_;
 	SavedState saved_;
 	uint32_t numberParseState_;
+	JsonEventType numberEventType_;
+	JsonNumber number_;
+	uint32_t digitCount_;
+	int32_t exponentValue_;
+	bool exponentNegative_;
 	const char* lastBuffer_;
+	SkipState_ skipState_;
+	util::NestingState skipNesting_;
+
+	// Where nextStringPart() is in the string it is reading.
+	// partDecoded_ is true when the text of the current part is in
+	// stringBuffer_, partReturned_ when the last call returned a part,
+	// and partsEnded_ when the string ended with a part that was
+	// returned before the empty last one.
+	bool inStringPart_;
+	bool partsEnded_;
+	bool partDecoded_;
+	bool partReturned_;
+	uint64_t numParts_;
+
+	// Buffers kept for their payloads when pinBuffers_ is set, and the
+	// decoded strings of those payloads
+	bool pinBuffers_;
+	std::vector<BufferPtr_> pinned_;
+	memory::MonotonicArena<Allocator> pinnedText_;
+
+	BufferPtr_ allocateBuffer_(size_t size) {
+	  return BufferPtr_(this->allocate(size), BufferDeleter_(*this, size));
+	}
+
+	uint64_t offsetOf_(const char* p) const {
+	  return bufferOffset_ + (p - base_);
+	}
 
 	FillResult fillBuffer_() {
-	  ::assert(current_ == bufferEnd_);
+	  assert(current_ == bufferEnd_);
+	  if constexpr (IN_PLACE) {
+	    return FillResult::END_OF_STREAM;
+	  }
 
-	  bufferOffset_ += (bufferEnd_ - buffer_.get());
-	  bufferEnd_ = buffer_.get();
-	  current_ = bufferEnd_;
+	  if (!pinBuffers_) {
+	    bufferOffset_ += (bufferEnd_ - buffer_.get());
+	    bufferEnd_ = buffer_.get();
+	    current_ = bufferEnd_;
+	  } else if ((size_t)(bufferEos_ - bufferEnd_) <= chunkSize_) {
+	    // Only the space for a token that crosses the end is left
+	    startPinnedBuffer_(bufferEnd_, 2 * chunkSize_);
+	  }
 
-	  ssize_t n = buffer_.read(buffer_.get(), bufferEos_ - bufferEnd_);
+	  // When pinning, stop short of the space kept at the end
+	  const size_t numToRead =
+	      (bufferEos_ - bufferEnd_) - (pinBuffers_ ? chunkSize_ : 0);
+	  ssize_t n = stream_.read(const_cast<char*>(bufferEnd_), numToRead);
 	  if (n < 0) {
 	    return FillResult::AGAIN;
 	  } else if (!n) {
@@ -411,36 +933,44 @@ namespace pistis {
 	}
 	
 	FillResult fillBuffer_(SavedState& initialState) {
-	  ::assert(current_ == bufferEnd_);
+	  assert(current_ <= bufferEnd_);
+	  if constexpr (IN_PLACE) {
+	    return FillResult::END_OF_STREAM;
+	  }
+
+	  if (pinBuffers_) {
+	    return fillPinnedBuffer_(initialState);
+	  }
+
 	  const char* const preserve = initialState.current();
 	  const size_t numToKeep = bufferEnd_ - preserve;
 	  const size_t numToRemove = preserve - buffer_.get();
-	  size_t numToRead = bufferEos_ - numToKeep;
+	  const size_t currentOffset = current_ - preserve;
+	  size_t numToRead = (bufferEos_ - buffer_.get()) - numToKeep;
 	  
 	  if (numToRead >= bufferExtensionLimit_) {
 	    // Move stuff down and fill remaining space in the buffer
-	    ::memcpy(buffer_.get(), preserve, numToKeep);
-	    bufferEnd_ -= numToRemove;
-	    current_ = bufferEnd_;
-	    bufferOffset_ += numToRemove;
-	    initialState.setCurrent(buffer_.get());
+	    ::memmove(buffer_.get(), preserve, numToKeep);
 	  } else {
 	    // Move stuff down and extend the buffer enough so we can fit
-	    // chunkSize_ more bytes in it
-	    const size_t newBufferSize = chunkSize_ - numToRead_;
-	    std::unique_ptr<char[]> newBuffer(this->allocate(newBufferSize));
+	    // chunkSize_ more bytes in it.  The old buffer goes back to the
+	    // allocator, which may hand it out again if it is a pool.
+	    const size_t newBufferSize = numToKeep + chunkSize_;
+	    BufferPtr_ newBuffer(allocateBuffer_(newBufferSize));
 
-	    ::memcpy(newBuffer_.get(), preserve, numToKeep);
-	    bufferEos_ = newBuffer_.get() + newBufferSize;
-	    bufferEnd_ = newBuffer_.get() + numToKeep;
-	    current_ = bufferEnd_;
-	    bufferOffset_ += numToRemove;
-	    initialState.setCurrent(newBuffer_.get());
+	    ::memcpy(newBuffer.get(), preserve, numToKeep);
+	    bufferEos_ = newBuffer.get() + newBufferSize;
 	    buffer_ = std::move(newBuffer);
+	    base_ = buffer_.get();
 	    numToRead = chunkSize_;
 	  }
 
-	  ssize_t n = stream_.read(bufferEnd_, numToRead);
+	  bufferEnd_ = buffer_.get() + numToKeep;
+	  current_ = buffer_.get() + currentOffset;
+	  bufferOffset_ += numToRemove;
+	  initialState.setCurrent(buffer_.get());
+
+	  ssize_t n = stream_.read(buffer_.get() + numToKeep, numToRead);
 	  if (n < 0) {
 	    return FillResult::AGAIN;
 	  } else if (!n) {
@@ -451,30 +981,131 @@ namespace pistis {
 	  }
 	}
 
-	DigitScanResult scanDigits_(SavedState& initialState) {
-	  const char* start = current_;
+	/** @brief Finish the part of a string nextStringPart() has read,
+	 *         which ends at current_, and return @c result.
+	 */
+	StringPartResult returnPart_(JsonString& text, const char* start,
+				     StringPartResult result) {
+	  if (partDecoded_) {
+	    stringBuffer_.write(start, current_);
+	    text = pinBuffers_ ? pinnedText_.copy(stringBuffer_.str())
+	                       : stringBuffer_.str();
+	  } else {
+	    text = JsonString(start, current_);
+	  }
+	  if (result == StringPartResult::PART) {
+	    ++numParts_;
+	    partReturned_ = true;
+	  }
+	  return result;
+	}
+
+	/** @brief fillBuffer_(SavedState&) for pinned buffers.
+	 *
+	 *  The token being read goes on in the space at the end of the
+	 *  buffer if there is any left, so nothing moves.  Otherwise, the
+	 *  part read so far is copied to the start of a new buffer, and the
+	 *  old one is pinned with the payloads before the token.
+	 */
+	FillResult fillPinnedBuffer_(SavedState& initialState) {
+	  if (bufferEnd_ == bufferEos_) {
+	    const char* const preserve = initialState.current();
+	    const size_t currentOffset = current_ - preserve;
+	    startPinnedBuffer_(preserve,
+			       (bufferEnd_ - preserve) + 2 * chunkSize_);
+	    current_ = buffer_.get() + currentOffset;
+	    initialState.setCurrent(buffer_.get());
+	  }
+
+	  ssize_t n = stream_.read(const_cast<char*>(bufferEnd_),
+				   bufferEos_ - bufferEnd_);
+	  if (n < 0) {
+	    return FillResult::AGAIN;
+	  } else if (!n) {
+	    return FillResult::END_OF_STREAM;
+	  } else {
+	    bufferEnd_ += n;
+	    return FillResult::FILLED;
+	  }
+	}
+
+	/** @brief Pin the current buffer and carry on in a new one of
+	 *         @c size bytes, copying [keep, bufferEnd_) to its start.
+	 *
+	 *  A buffer that holds nothing anyone could point to is freed
+	 *  instead of being pinned.
+	 */
+	void startPinnedBuffer_(const char* keep, size_t size) {
+	  const size_t numToKeep = bufferEnd_ - keep;
+	  BufferPtr_ newBuffer(allocateBuffer_(size));
+
+	  ::memcpy(newBuffer.get(), keep, numToKeep);
+	  bufferOffset_ += keep - buffer_.get();
+	  if (keep != buffer_.get()) {
+	    pinned_.push_back(std::move(buffer_));
+	  }
+	  buffer_ = std::move(newBuffer);
+	  base_ = buffer_.get();
+	  bufferEos_ = buffer_.get() + size;
+	  bufferEnd_ = buffer_.get() + numToKeep;
+	  current_ = bufferEnd_;
+	}
+
+	/** @brief Scan a run of digits, adding them to number_.
+	 *
+	 *  digitCount_ counts the digits in the current part of the number,
+	 *  so a scan resumed after AGAIN knows whether it has already seen
+	 *  any.  Returns NONE for a zero followed by more integer digits,
+	 *  which is not a valid number either.
+	 */
+	DigitScanResult scanDigits_(SavedState& initialState, DigitKind kind) {
 	  while (true) {
 	    if (current_ == bufferEnd_) {
-	      uint64_t oldOffset = bufferOffset_;
 	      switch (fillBuffer_(initialState)) {
 	        case FillResult::AGAIN: return DigitScanResult::AGAIN;
 	        case FillResult::END_OF_STREAM:
-		  return (current_ > start) ? DigitScanResult::READ
-		                            : DigitScanResult::END_OF_STREAM;
+		  return digitCount_ ? DigitScanResult::READ
+		                     : DigitScanResult::END_OF_STREAM;
+	        default:
+		  break;
 	      }
-	      start -= bufferOffset_ - oldOffset;
 	    }
 
-	    if (std::isdigit(*current_)) {
-	      ++current_;
-	    } else if (current_ > start) {
-	      return DigitScanResult::READ;
-	    } else {
-	      return DigitScanResult::NONE;
+	    const uint32_t d = (uint32_t)(uint8_t)*current_ - '0';
+	    if (d > 9) {
+	      return digitCount_ ? DigitScanResult::READ
+		                 : DigitScanResult::NONE;
 	    }
+
+	    switch (kind) {
+	      case DigitKind::INTEGER:
+		if ((digitCount_ == 1) && !number_.significand()) {
+		  // JSON does not allow leading zeros
+		  return DigitScanResult::NONE;
+		}
+		number_.addIntegerDigit(d);
+		break;
+
+	      case DigitKind::FRACTION:
+		number_.addFractionDigit(d);
+		break;
+
+	      case DigitKind::EXPONENT:
+		// Anything this large overflows a double anyway
+		if (exponentValue_ < 100000000) {
+		  exponentValue_ = exponentValue_ * 10 + (int32_t)d;
+		}
+		break;
+	    }
+	    ++digitCount_;
+	    ++current_;
 	  }
 	}
 
+	/** @brief Decode the escape sequence at current_, leaving current_
+	 *         just past it.  If the sequence is incomplete and no more
+	 *         data is available yet, leaves current_ at the '\\'.
+	 */
 	DecodeResult decodeEscapeSequence_(SavedState& initialState) {
 	  ++current_; // Consume '\'
 	  if (current_ == bufferEnd_) {
@@ -486,6 +1117,9 @@ namespace pistis {
 	      case FillResult::END_OF_STREAM:
 		throw InvalidJsonStringError("Invalid escape sequence",
 					     position(), PISTIS_EX_HERE);
+
+	      default:
+		break;
 	    }
 	  }
 	  switch(*current_) {
@@ -523,6 +1157,7 @@ namespace pistis {
 					   position(), PISTIS_EX_HERE);
 		  
 	  }
+	  ++current_;
 	  return DecodeResult::DECODED;
 	}
 
@@ -538,21 +1173,45 @@ namespace pistis {
 		// Illegal escape sequence
 		throw InvalidJsonStringError("Invalid escape sequence \"\\u\"",
 					     position(), PISTIS_EX_HERE);
+
+	      default:
+		break;
 	    }
 	  }
-	  const uint32_t c = (((((decodeHexChar_(current_[0]) << 8) ||
-				 decodeHexChar_(current_[1])) << 8) ||
-			       decodeHexChar_(current_[2])) << 8) ||
-	                     decodeHexChar_(current_[3]);
-	  if (c > 0x001FFFFF) {
-	    throw InvalidJsonStringError("Not a legal unicode character",
+	  const int32_t c = (decodeHexChar_(current_[0]) * 0x1000) |
+	                    (decodeHexChar_(current_[1]) * 0x100) |
+	                    (decodeHexChar_(current_[2]) * 0x10) |
+	                    decodeHexChar_(current_[3]);
+	  if (c < 0) {
+	    throw InvalidJsonStringError("Invalid escape sequence \"\\u\"",
 					 position(), PISTIS_EX_HERE);
 	  }
-	  this->encodeChar(stringBuffer_, c);
+	  this->encodeChar(stringBuffer_, (uint32_t)c);
 	  current_ += 4;
 	  return DecodeResult::DECODED;
 	}
 
+	/** @brief Returns the value of a hex digit, or a negative number
+	 *         if @c c is not a hex digit.
+	 */
+	static int32_t decodeHexChar_(char c) {
+	  if ((c >= '0') && (c <= '9')) {
+	    return c - '0';
+	  } else if ((c >= 'A') && (c <= 'F')) {
+	    return c - 'A' + 10;
+	  } else if ((c >= 'a') && (c <= 'f')) {
+	    return c - 'a' + 10;
+	  } else {
+	    return -0x10000;
+	  }
+	}
+
+	/** @brief Returns true if @c c ends a number or word */
+	static bool isScalarEnd_(char c) {
+	  return util::isJsonWhitespace(c) || (c == ',') || (c == ']') ||
+	         (c == '}');
+	}
+
 	static bool isEscapedQuote_(const char* start, const char* buffer) {
 	  if ((start >= buffer) && (*start == '\\')) {
 	    const char* p = start - 1;
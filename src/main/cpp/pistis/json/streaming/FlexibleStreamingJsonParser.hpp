@@ -8,6 +8,12 @@
 #define __PISTIS__JSON__STREAMING__FLEXIBLESTREAMINGJSONPARSER_HPP__
 
 #include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/detail/FdStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/FileStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/InMemoryStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/MappedFileStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/ReadAheadStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/UringFdStreamAdapter.hpp>
 
 namespace pistis {
   namespace json {
@@ -20,13 +26,44 @@ namespace pistis {
 	        FileStreamType;
 	typedef FlexibleEventStream<detail::FdStreamAdapter, PayloadFactory>
 	        FdStreamType;
-	typedef FlexibleEventStream<detail::StringStreamAdapter, PayloadFactory>
-	        StringEventStream;
+	typedef FlexibleEventStream<detail::InMemoryStreamAdapter,
+				    PayloadFactory>
+	        StringStreamType;
+	typedef FlexibleEventStream<detail::MappedFileStreamAdapter,
+				    PayloadFactory>
+	        MappedFileStreamType;
+	typedef FlexibleEventStream<
+	            detail::ReadAheadStreamAdapter<detail::FileStreamAdapter>,
+	            PayloadFactory
+	        >
+	        ReadAheadFileStreamType;
+	typedef FlexibleEventStream<
+	            detail::ReadAheadStreamAdapter<detail::FdStreamAdapter>,
+	            PayloadFactory
+	        >
+	        ReadAheadFdStreamType;
+	typedef FlexibleEventStream<detail::UringFdStreamAdapter,
+				    PayloadFactory>
+	        UringFdStreamType;
 	
       public:
+	/** @brief Create a new parser.
+	 *
+	 *  @c readAheadDepth and @c readAheadChunkSize only affect the
+	 *  streams returned by the parseFileWithReadAhead() and
+	 *  parseFileWithIoUring() methods.  They are the number of chunks
+	 *  that may be read ahead of the parser and the size of each chunk.
+	 *  A chunk size of zero means the same size as the parser's buffer.
+	 */
 	FlexibleStreamingJsonParser(const PayloadFactory& payloadFactory,
-				    uint32_t bufferSize)
-	    : payloadFactory_(payloadFactory), bufferSize_(bufferSize) {
+				    uint32_t bufferSize,
+				    uint32_t readAheadDepth = 4,
+				    uint32_t readAheadChunkSize = 0)
+	    : payloadFactory_(payloadFactory), bufferSize_(bufferSize),
+	      readAheadDepth_(readAheadDepth),
+	      readAheadChunkSize_(readAheadChunkSize ? readAheadChunkSize
+				                     : bufferSize),
+	      projection_(), multipleValues_(false) {
 	}
 	FlexibleStreamingJsonParser(const FlexibleStreamingJsonParser&)
 	    = default;
@@ -36,9 +73,12 @@ namespace pistis {
 	FlexibleEventStream<Stream, PayloadFactory> parseStream(
 	    const std::string& streamName, Stream&& stream
         ) {
-	  return FlexibleEventStream<Stream, PayloadFactory>(
-	      streamName, std::move(stream), payloadFactory_, bufferSize_
+	  FlexibleEventStream<Stream, PayloadFactory> events(
+	      streamName, std::move(stream), payloadFactory_, bufferSize_,
+	      projection_
 	  );
+	  events.setMultipleValues(multipleValues_);
+	  return events;
 	}
 
 	FileStreamType parseFile(const std::string& filename) {
@@ -46,17 +86,93 @@ namespace pistis {
 	}
 
 	FdStreamType parseFile(const std::string& name, int fd) {
-	  return parseStream(name, detail::FdStreamAdapter(fd));
+	  return parseStream(name, detail::FdStreamAdapter(name, fd));
 	}
 
 	FdStreamType parseFile(int fd) {
 	  return parseFile("", fd);
 	}
 
+	/** @brief Parse a file while a background thread reads ahead.
+	 *
+	 *  The parser never waits on read() unless it has consumed every
+	 *  chunk the background thread has read, so parsing overlaps with
+	 *  I/O.  Most useful for files on network filesystems.
+	 */
+	ReadAheadFileStreamType parseFileWithReadAhead(
+	    const std::string& filename
+	) {
+	  return parseStream(
+	      filename,
+	      detail::ReadAheadStreamAdapter<detail::FileStreamAdapter>(
+		  detail::FileStreamAdapter(filename), readAheadDepth_,
+		  readAheadChunkSize_
+	      )
+	  );
+	}
+
+	ReadAheadFdStreamType parseFileWithReadAhead(const std::string& name,
+						     int fd) {
+	  return parseStream(
+	      name,
+	      detail::ReadAheadStreamAdapter<detail::FdStreamAdapter>(
+		  detail::FdStreamAdapter(name, fd), readAheadDepth_,
+		  readAheadChunkSize_
+	      )
+	  );
+	}
+
+	ReadAheadFdStreamType parseFileWithReadAhead(int fd) {
+	  return parseFileWithReadAhead("", fd);
+	}
+
+	/** @brief Parse a file, reading it through io_uring.
+	 *
+	 *  Keeps several reads in flight into buffers registered with the
+	 *  kernel, which cuts the number of system calls per byte when many
+	 *  files are parsed at once.  Falls back to read() if the kernel
+	 *  does not support io_uring or the file is not a regular file.
+	 */
+	UringFdStreamType parseFileWithIoUring(const std::string& filename) {
+	  return parseStream(
+	      filename,
+	      detail::UringFdStreamAdapter(filename, readAheadDepth_,
+					   readAheadChunkSize_)
+	  );
+	}
+
+	UringFdStreamType parseFileWithIoUring(const std::string& name,
+					       int fd) {
+	  return parseStream(
+	      name,
+	      detail::UringFdStreamAdapter(name, fd, readAheadDepth_,
+					   readAheadChunkSize_)
+	  );
+	}
+
+	UringFdStreamType parseFileWithIoUring(int fd) {
+	  return parseFileWithIoUring("", fd);
+	}
+
+	/** @brief Parse a file by mapping it into memory.
+	 *
+	 *  The file is parsed in place, so nothing is copied when the
+	 *  reader reaches the end of a chunk, and payloads that do not need
+	 *  decoding stay valid for the life of the returned stream.  Only
+	 *  works on regular files.
+	 */
+	MappedFileStreamType parseMappedFile(const std::string& filename) {
+	  return parseStream(filename,
+			     detail::MappedFileStreamAdapter(filename));
+	}
+
+	MappedFileStreamType parseMappedFile(const std::string& name, int fd) {
+	  return parseStream(name, detail::MappedFileStreamAdapter(name, fd));
+	}
 
 	StringStreamType parseString(const std::string& name,
 				     const std::string& text) {
-	  return parseStream(name, detail::StringStreamAdapter(text));
+	  return parseStream(name, detail::InMemoryStreamAdapter(text));
 	}
 
 	StringStreamType parseString(const std::string& text) {
@@ -71,9 +187,36 @@ namespace pistis {
 	    FlexibleStreamingJsonParser&&
         ) = default;
 
+	uint32_t readAheadDepth() const { return readAheadDepth_; }
+	void setReadAheadDepth(uint32_t depth) { readAheadDepth_ = depth; }
+	uint32_t readAheadChunkSize() const { return readAheadChunkSize_; }
+	void setReadAheadChunkSize(uint32_t size) {
+	  readAheadChunkSize_ = size ? size : bufferSize_;
+	}
+
+	/** @brief Paths the streams this parser creates are projected onto.
+	 *
+	 *  An empty projection, the default, reports the whole document.
+	 */
+	const PathProjection& projection() const { return projection_; }
+	void setProjection(const PathProjection& projection) {
+	  projection_ = projection;
+	}
+
+	/** @brief True if the streams this parser creates read sequences of
+	 *         top-level values, such as NDJSON files.  See
+	 *         FlexibleEventStream::setMultipleValues().
+	 */
+	bool multipleValues() const { return multipleValues_; }
+	void setMultipleValues(bool multiple) { multipleValues_ = multiple; }
+
       private:
 	PayloadFactory payloadFactory_;
-	size_t bufferFactory_;
+	size_t bufferSize_;
+	uint32_t readAheadDepth_;
+	uint32_t readAheadChunkSize_;
+	PathProjection projection_;
+	bool multipleValues_;
       };
       
     }
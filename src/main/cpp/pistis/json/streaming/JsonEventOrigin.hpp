@@ -1,13 +1,16 @@
 #ifndef __PISTIS__JSON__STREAMING__JSONEVENTORIGIN_HPP__
 #define __PISTIS__JSON__STREAMING__JSONEVENTORIGIN_HPP__
 
+#include <ostream>
+#include <stdint.h>
+
 namespace pistis {
   namespace json {
     namespace streaming {
 
       class JsonEventOrigin {
       public:
-	JsonEventOrigin() { }
+	JsonEventOrigin(): line_(0), column_(0), offset_(0) { }
 	JsonEventOrigin(uint32_t line, uint32_t column, uint64_t offset):
 	    line_(line), column_(column), offset_(offset) {
 	}
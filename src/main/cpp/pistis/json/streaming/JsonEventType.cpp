@@ -0,0 +1,26 @@
+#include "JsonEventType.hpp"
+
+using namespace pistis::json::streaming;
+
+std::ostream& pistis::json::streaming::operator<<(std::ostream& out,
+						  JsonEventType t) {
+  switch (t) {
+    case JsonEventType::END:          return out << "END";
+    case JsonEventType::AGAIN:        return out << "AGAIN";
+    case JsonEventType::BEGIN_OBJECT: return out << "BEGIN_OBJECT";
+    case JsonEventType::END_OBJECT:   return out << "END_OBJECT";
+    case JsonEventType::BEGIN_ARRAY:  return out << "BEGIN_ARRAY";
+    case JsonEventType::END_ARRAY:    return out << "END_ARRAY";
+    case JsonEventType::FIELD_NAME:   return out << "FIELD_NAME";
+    case JsonEventType::INT_VALUE:    return out << "INT_VALUE";
+    case JsonEventType::FLOAT_VALUE:  return out << "FLOAT_VALUE";
+    case JsonEventType::STRING_VALUE: return out << "STRING_VALUE";
+    case JsonEventType::TRUE_VALUE:   return out << "TRUE_VALUE";
+    case JsonEventType::FALSE_VALUE:  return out << "FALSE_VALUE";
+    case JsonEventType::NULL_VALUE:   return out << "NULL_VALUE";
+    case JsonEventType::END_RECORD:   return out << "END_RECORD";
+    case JsonEventType::STRING_CHUNK: return out << "STRING_CHUNK";
+    case JsonEventType::STRING_END:   return out << "STRING_END";
+    default:                          return out << "**UNKNOWN**";
+  }
+}
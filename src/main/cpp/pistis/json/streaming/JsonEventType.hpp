@@ -96,7 +96,33 @@ namespace pistis {
 	 *
 	 *  This event has no payload.
 	 */
-	NULL_VALUE
+	NULL_VALUE,
+
+	/** Reached the end of a top-level value of a stream with multiple
+	 *  values, such as an NDJSON file.
+	 *
+	 *  Returned after the last event of each value, and only if the
+	 *  stream was told to expect multiple values.  This event has no
+	 *  payload.
+	 */
+	END_RECORD,
+
+	/** Encountered part of a string value too long to return whole.
+	 *
+	 *  Only returned by streams told to split long strings.  This
+	 *  event has a string payload, holding the next part of the
+	 *  string's text.  The parts of a string follow each other with
+	 *  no other events in between, and a STRING_END event follows the
+	 *  last one.
+	 */
+	STRING_CHUNK,
+
+	/** Reached the end of a string value returned in STRING_CHUNK
+	 *  events.
+	 *
+	 *  This event has no payload.
+	 */
+	STRING_END
       };
 
       std::ostream& operator<<(std::ostream& out, JsonEventType t);
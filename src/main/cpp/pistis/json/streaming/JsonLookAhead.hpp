@@ -1,6 +1,8 @@
 #ifndef __PISTIS__JSON__STREAMING__JSONLOOKAHEAD_HPP__
 #define __PISTIS__JSON__STREAMING__JSONLOOKAHEAD_HPP__
 
+#include <stdint.h>
+
 namespace pistis {
   namespace json {
     namespace streaming {
@@ -31,10 +33,14 @@ namespace pistis {
 	constexpr JsonLookAhead(uint8_t c): again(0), ch(c) { }
 	constexpr JsonLookAhead(uint8_t a, uint8_t c): again(a), ch(c) { }
 
-	static constexpr const JsonLookAhead AGAIN = JsonLookAhead(1, 0);
-	static constexpr const JsonLookAhead END_OF_STREAM =
-	    JsonLookAhead(0, 0);
+	static const JsonLookAhead AGAIN;
+	static const JsonLookAhead END_OF_STREAM;
       };
+
+      constexpr const JsonLookAhead JsonLookAhead::AGAIN =
+	  JsonLookAhead(1, 0);
+      constexpr const JsonLookAhead JsonLookAhead::END_OF_STREAM =
+	  JsonLookAhead(0, 0);
       
     }
   }
@@ -0,0 +1,579 @@
+/** @file OnDemandDocument
+ *
+ *  Interface and implementation of
+ *  pistis::json::streaming::OnDemandDocument, which reads values out of
+ *  an event stream as they are asked for, without building a tree.
+ */
+#ifndef __PISTIS__JSON__STREAMING__ONDEMANDDOCUMENT_HPP__
+#define __PISTIS__JSON__STREAMING__ONDEMANDDOCUMENT_HPP__
+
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <pistis/json/streaming/JsonEventType.hpp>
+#include <pistis/json/util/NumberParser.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      template <typename EventStream> class OnDemandDocument;
+      template <typename EventStream> class OnDemandElements;
+      template <typename EventStream> class OnDemandFields;
+
+      /** @brief A value of an OnDemandDocument that has not been read
+       *         yet.
+       *
+       *  Values are cheap handles.  Reading one with getInt64(),
+       *  getString() and the like, or looking inside it with
+       *  operator[](), elements() or fields(), moves the document's
+       *  stream forward.  Each value can only be used while the stream
+       *  has not gone past it.  Using a value that has already been read
+       *  or skipped, such as a field that came before the one just looked
+       *  up, throws pistis::exceptions::IllegalStateError.
+       *
+       *  Asking for a value as the wrong type throws
+       *  pistis::exceptions::IllegalValueError, as does looking up a
+       *  field that isn't there.
+       */
+      template <typename EventStream>
+      class OnDemandValue {
+      public:
+	typedef OnDemandDocument<EventStream> DocumentType;
+
+      public:
+	OnDemandValue(): doc_(nullptr), id_(0), depth_(0) { }
+
+	/** @brief The event the value starts with, which tells what type
+	 *         it is.  Does not read the value.
+	 */
+	JsonEventType type() const { return doc_->peekValue_(*this); }
+	bool isNull() const { return type() == JsonEventType::NULL_VALUE; }
+
+	int64_t getInt64() const {
+	  int64_t value;
+	  const JsonNumber n =
+	      doc_->readNumber_(*this, JsonEventType::INT_VALUE);
+	  if (!n.toInt64(value)) {
+	    std::ostringstream msg;
+	    msg << "\"" << n.text() << "\" is not an integer in the range "
+		<< "of an int64_t";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return value;
+	}
+
+	/** @brief The value of a number, integer or not */
+	double getDouble() const {
+	  return util::toDouble(
+	      doc_->readNumber_(*this, JsonEventType::FLOAT_VALUE)
+	  );
+	}
+
+	bool getBool() const {
+	  return doc_->readScalar_(*this, JsonEventType::TRUE_VALUE) ==
+	             JsonEventType::TRUE_VALUE;
+	}
+
+	/** @brief The text of a string, which is only valid until the
+	 *         document's stream moves on
+	 */
+	JsonString getString() const {
+	  return doc_->readString_(*this);
+	}
+
+	/** @brief Skip the value, or the rest of it, without decoding it */
+	void skip() const { doc_->skip_(*this); }
+
+	/** @brief Look up the field @c name of an object.
+	 *
+	 *  Fields are searched forward from the last field read, and the
+	 *  fields passed on the way are skipped, so look fields up in the
+	 *  order they appear in the document.  Returns false if the
+	 *  object has no such field after the last field read, in which
+	 *  case the whole object has been read.
+	 */
+	bool findField(const JsonString& name, OnDemandValue& value) const {
+	  JsonString fieldName;
+	  while (doc_->nextField_(*this, fieldName, value)) {
+	    if ((fieldName.size() == name.size()) &&
+		!::memcmp(fieldName.begin(), name.begin(), name.size())) {
+	      return true;
+	    }
+	  }
+	  return false;
+	}
+
+	/** @brief findField(), throwing if the field isn't there */
+	OnDemandValue operator[](const JsonString& name) const {
+	  OnDemandValue value;
+	  if (!findField(name, value)) {
+	    std::ostringstream msg;
+	    msg << "No field named \"" << name << "\" after the last field "
+		<< "read";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return value;
+	}
+
+	OnDemandValue operator[](const char* name) const {
+	  return (*this)[JsonString(name, name + ::strlen(name))];
+	}
+
+	OnDemandValue operator[](const std::string& name) const {
+	  return (*this)[JsonString(name.data(), name.data() + name.size())];
+	}
+
+	/** @brief The elements of an array, for use in a range-based for
+	 *         loop
+	 */
+	OnDemandElements<EventStream> elements() const {
+	  return OnDemandElements<EventStream>(*this);
+	}
+
+	/** @brief The fields of an object, for use in a range-based for
+	 *         loop.  Each one is a (name, value) pair, and the name is
+	 *         only valid until the value is read.
+	 */
+	OnDemandFields<EventStream> fields() const {
+	  return OnDemandFields<EventStream>(*this);
+	}
+
+      private:
+	DocumentType* doc_;
+
+	// Number the document gave the value, in document order
+	uint64_t id_;
+
+	// Number of objects and arrays the value is in
+	uint32_t depth_;
+
+	OnDemandValue(DocumentType* doc, uint64_t id, uint32_t depth):
+	    doc_(doc), id_(id), depth_(depth) {
+	}
+
+	friend DocumentType;
+	friend class OnDemandElements<EventStream>;
+	friend class OnDemandFields<EventStream>;
+      };
+
+      /** @brief A field of an object, as returned by OnDemandFields */
+      template <typename EventStream>
+      struct OnDemandField {
+	JsonString name;
+	OnDemandValue<EventStream> value;
+      };
+
+      /** @brief Range over the elements of an array */
+      template <typename EventStream>
+      class OnDemandElements {
+      public:
+	class Iterator {
+	public:
+	  const OnDemandValue<EventStream>& operator*() const {
+	    return element_;
+	  }
+	  const OnDemandValue<EventStream>* operator->() const {
+	    return &element_;
+	  }
+
+	  Iterator& operator++() {
+	    more_ = array_.doc_->nextElement_(array_, element_);
+	    return *this;
+	  }
+
+	  bool operator==(const Iterator& other) const {
+	    return more_ == other.more_;
+	  }
+	  bool operator!=(const Iterator& other) const {
+	    return more_ != other.more_;
+	  }
+
+	private:
+	  OnDemandValue<EventStream> array_;
+	  OnDemandValue<EventStream> element_;
+	  bool more_;
+
+	  Iterator(const OnDemandValue<EventStream>& array, bool more):
+	      array_(array), element_(), more_(more) {
+	  }
+
+	  friend class OnDemandElements;
+	};
+
+      public:
+	OnDemandElements(const OnDemandValue<EventStream>& array):
+	    array_(array) {
+	}
+
+	Iterator begin() const { return ++Iterator(array_, true); }
+	Iterator end() const { return Iterator(array_, false); }
+
+      private:
+	OnDemandValue<EventStream> array_;
+      };
+
+      /** @brief Range over the fields of an object */
+      template <typename EventStream>
+      class OnDemandFields {
+      public:
+	class Iterator {
+	public:
+	  const OnDemandField<EventStream>& operator*() const {
+	    return field_;
+	  }
+	  const OnDemandField<EventStream>* operator->() const {
+	    return &field_;
+	  }
+
+	  Iterator& operator++() {
+	    more_ = object_.doc_->nextField_(object_, field_.name,
+					     field_.value);
+	    return *this;
+	  }
+
+	  bool operator==(const Iterator& other) const {
+	    return more_ == other.more_;
+	  }
+	  bool operator!=(const Iterator& other) const {
+	    return more_ != other.more_;
+	  }
+
+	private:
+	  OnDemandValue<EventStream> object_;
+	  OnDemandField<EventStream> field_;
+	  bool more_;
+
+	  Iterator(const OnDemandValue<EventStream>& object, bool more):
+	      object_(object), field_(), more_(more) {
+	  }
+
+	  friend class OnDemandFields;
+	};
+
+      public:
+	OnDemandFields(const OnDemandValue<EventStream>& object):
+	    object_(object) {
+	}
+
+	Iterator begin() const { return ++Iterator(object_, true); }
+	Iterator end() const { return Iterator(object_, false); }
+
+      private:
+	OnDemandValue<EventStream> object_;
+      };
+
+      /** @brief Reads values out of a FlexibleEventStream as they are
+       *         asked for.
+       *
+       *    OnDemandDocument<Stream> doc(stream);
+       *    const int64_t id = doc["user"]["id"].getInt64();
+       *
+       *  Nothing is built.  Looking up a field reads the field names of
+       *  the object until it finds the one asked for, and skips the
+       *  values of the others with FlexibleEventStream::skipValue(), so
+       *  they are never decoded.  Moving on from a value that was only
+       *  partly read skips the rest of it the same way.
+       *
+       *  The stream only moves forward, so values must be read in the
+       *  order they appear in the document.  See OnDemandValue.  The
+       *  document reads the first value of the stream.  With an NDJSON
+       *  stream, create a new document for each record.
+       *
+       *  The stream must be a blocking one, whose next() and skipValue()
+       *  never report that there is no data yet.  None of the document's
+       *  methods can stop part way and carry on later, so if the stream
+       *  does return AGAIN, or skipValue() returns false, the document
+       *  throws pistis::exceptions::IllegalStateError instead of spinning
+       *  until the data arrives.  The stream is then somewhere in the
+       *  middle of a value, so every later use of the document that
+       *  needs the stream throws too.  Read non-blocking streams with
+       *  DocumentBuilder, or with the stream itself, instead.
+       */
+      template <typename EventStream>
+      class OnDemandDocument {
+      public:
+	typedef OnDemandValue<EventStream> ValueType;
+
+      public:
+	explicit OnDemandDocument(EventStream& stream):
+	    stream_(&stream), nextId_(1), unread_(0), open_(),
+	    lastEvent_(JsonEventType::AGAIN),
+	    peekedEvent_(JsonEventType::AGAIN), peeked_(false),
+	    blocked_(false) {
+	}
+	OnDemandDocument(const OnDemandDocument&) = delete;
+
+	/** @brief The value the document consists of */
+	ValueType root() { return ValueType(this, 0, 0); }
+
+	/** @brief Look up a field of the root object */
+	ValueType operator[](const JsonString& name) { return root()[name]; }
+	ValueType operator[](const char* name) { return root()[name]; }
+	ValueType operator[](const std::string& name) {
+	  return root()[name];
+	}
+
+	OnDemandDocument& operator=(const OnDemandDocument&) = delete;
+
+      private:
+	static constexpr const uint64_t NO_VALUE_ = ~(uint64_t)0;
+
+	EventStream* stream_;
+	uint64_t nextId_;
+
+	// The value whose first event has not been read yet, if any
+	uint64_t unread_;
+
+	// The value each open object and array belongs to, or NO_VALUE_
+	// for those opened while skipping
+	std::vector<uint64_t> open_;
+
+	JsonEventType lastEvent_;
+	JsonEventType peekedEvent_;
+	bool peeked_;
+
+	// True once the stream has returned AGAIN
+	bool blocked_;
+
+	friend ValueType;
+	friend class OnDemandElements<EventStream>;
+	friend class OnDemandFields<EventStream>;
+
+	static bool isBegin_(JsonEventType e) {
+	  return (e == JsonEventType::BEGIN_OBJECT) ||
+	         (e == JsonEventType::BEGIN_ARRAY);
+	}
+
+	/** @brief Throw because the stream has no data yet, or did
+	 *         earlier
+	 */
+	[[noreturn]] void noData_() {
+	  blocked_ = true;
+	  throw pistis::exceptions::IllegalStateError(
+	      "The stream has no data yet.  OnDemandDocument needs a "
+	      "blocking stream.", PISTIS_EX_HERE
+	  );
+	}
+
+	JsonEventType read_() {
+	  while (true) {
+	    const JsonEventType e = blocked_ ? JsonEventType::AGAIN
+		                             : stream_->next();
+	    if (e == JsonEventType::END) {
+	      throw pistis::exceptions::IllegalStateError(
+		  "Stream ended before the value was read", PISTIS_EX_HERE
+	      );
+	    } else if (e == JsonEventType::AGAIN) {
+	      noData_();
+	    } else if (e != JsonEventType::END_RECORD) {
+	      return e;
+	    }
+	  }
+	}
+
+	/** @brief Skip the value or container the stream is at */
+	void skipValue_() {
+	  if (blocked_ || !stream_->skipValue()) {
+	    noData_();
+	  }
+	}
+
+	JsonEventType peek_() {
+	  if (!peeked_) {
+	    peekedEvent_ = read_();
+	    peeked_ = true;
+	  }
+	  return peekedEvent_;
+	}
+
+	JsonEventType next_() {
+	  const JsonEventType e = peeked_ ? peekedEvent_ : read_();
+	  peeked_ = false;
+	  if (isBegin_(e)) {
+	    open_.push_back(NO_VALUE_);
+	  } else if ((e == JsonEventType::END_OBJECT) ||
+		     (e == JsonEventType::END_ARRAY)) {
+	    open_.pop_back();
+	  }
+	  lastEvent_ = e;
+	  return e;
+	}
+
+	/** @brief Skip the rest of the innermost open object or array */
+	void skipContainer_() {
+	  skipValue_();
+	  open_.pop_back();
+	  lastEvent_ = JsonEventType::END_OBJECT;
+	}
+
+	/** @brief Skip the value of the field whose name was just read */
+	void skipFieldValue_() {
+	  skipValue_();
+	  lastEvent_ = JsonEventType::NULL_VALUE;
+	}
+
+	/** @brief Skip the value whose first event has not been read */
+	void skipUnread_() {
+	  unread_ = NO_VALUE_;
+	  if (!peeked_ && (lastEvent_ == JsonEventType::FIELD_NAME)) {
+	    skipFieldValue_();
+	  } else if (isBegin_(next_())) {
+	    skipContainer_();
+	  }
+	}
+
+	/** @brief Skip forward until only @c depth objects and arrays are
+	 *         open
+	 */
+	void returnTo_(uint32_t depth) {
+	  if (unread_ != NO_VALUE_) {
+	    skipUnread_();
+	  }
+	  while (open_.size() > depth) {
+	    if (isBegin_(lastEvent_)) {
+	      skipContainer_();
+	    } else if (lastEvent_ == JsonEventType::FIELD_NAME) {
+	      skipFieldValue_();
+	    } else {
+	      next_();
+	    }
+	  }
+	}
+
+	[[noreturn]] static void passed_() {
+	  throw pistis::exceptions::IllegalStateError(
+	      "The stream has already passed this value.  Values of an "
+	      "OnDemandDocument must be read in document order.",
+	      PISTIS_EX_HERE
+	  );
+	}
+
+	[[noreturn]] static void wrongType_(JsonEventType actual,
+					    const char* expected) {
+	  std::ostringstream msg;
+	  msg << "Value starts with " << actual << ", but " << expected
+	      << " was expected";
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+
+	JsonEventType peekValue_(const ValueType& value) {
+	  if (unread_ != value.id_) {
+	    passed_();
+	  }
+	  return peek_();
+	}
+
+	/** @brief Read a value that must not be an object or array */
+	JsonEventType readScalar_(const ValueType& value,
+				  JsonEventType expected) {
+	  if (unread_ != value.id_) {
+	    passed_();
+	  }
+	  unread_ = NO_VALUE_;
+	  const JsonEventType e = next_();
+	  if (isBegin_(e)) {
+	    skipContainer_();
+	  }
+
+	  if ((expected == JsonEventType::TRUE_VALUE) &&
+	      (e != JsonEventType::TRUE_VALUE) &&
+	      (e != JsonEventType::FALSE_VALUE)) {
+	    wrongType_(e, "a boolean");
+	  }
+	  return e;
+	}
+
+	JsonNumber readNumber_(const ValueType& value,
+			       JsonEventType expected) {
+	  const JsonEventType e = readScalar_(value, expected);
+	  if ((e == JsonEventType::INT_VALUE) ||
+	      ((e == JsonEventType::FLOAT_VALUE) &&
+	       (expected == JsonEventType::FLOAT_VALUE))) {
+	    return stream_->numberPayload();
+	  }
+	  wrongType_(e, (expected == JsonEventType::INT_VALUE)
+		            ? "an integer" : "a number");
+	}
+
+	JsonString readString_(const ValueType& value) {
+	  const JsonEventType e =
+	      readScalar_(value, JsonEventType::STRING_VALUE);
+	  if (e != JsonEventType::STRING_VALUE) {
+	    wrongType_(e, "a string");
+	  }
+	  return stream_->payloadText();
+	}
+
+	void skip_(const ValueType& value) {
+	  if (unread_ == value.id_) {
+	    skipUnread_();
+	  } else if ((value.depth_ < open_.size()) &&
+		     (open_[value.depth_] == value.id_)) {
+	    returnTo_(value.depth_);
+	  } else {
+	    passed_();
+	  }
+	}
+
+	/** @brief Get ready to read the next element of an array or field
+	 *         of an object, by opening it if it hasn't been opened yet,
+	 *         or by skipping the rest of the element or field before.
+	 */
+	void enter_(const ValueType& value, JsonEventType begin) {
+	  if (unread_ == value.id_) {
+	    unread_ = NO_VALUE_;
+	    const JsonEventType e = next_();
+	    if (e != begin) {
+	      if (isBegin_(e)) {
+		skipContainer_();
+	      }
+	      wrongType_(e, (begin == JsonEventType::BEGIN_OBJECT)
+			        ? "an object" : "an array");
+	    }
+	    open_.back() = value.id_;
+	  } else if ((value.depth_ < open_.size()) &&
+		     (open_[value.depth_] == value.id_)) {
+	    returnTo_(value.depth_ + 1);
+	  } else {
+	    passed_();
+	  }
+	}
+
+	bool nextElement_(const ValueType& array, ValueType& element) {
+	  enter_(array, JsonEventType::BEGIN_ARRAY);
+	  if (peek_() == JsonEventType::END_ARRAY) {
+	    next_();
+	    return false;
+	  }
+	  element = ValueType(this, nextId_++, array.depth_ + 1);
+	  unread_ = element.id_;
+	  return true;
+	}
+
+	bool nextField_(const ValueType& object, JsonString& name,
+			ValueType& value) {
+	  enter_(object, JsonEventType::BEGIN_OBJECT);
+	  if (next_() == JsonEventType::END_OBJECT) {
+	    return false;
+	  }
+	  name = stream_->payloadText();
+	  value = ValueType(this, nextId_++, object.depth_ + 1);
+	  unread_ = value.id_;
+	  return true;
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,190 @@
+/** @file ParallelArrayParser
+ *
+ *  Interface and implementation of
+ *  pistis::json::streaming::ParallelArrayParser, which parses the
+ *  elements of a document's top-level array on several threads at once.
+ */
+#ifndef __PISTIS__JSON__STREAMING__PARALLELARRAYPARSER_HPP__
+#define __PISTIS__JSON__STREAMING__PARALLELARRAYPARSER_HPP__
+
+#include <pistis/json/memory/BufferPoolAllocator.hpp>
+#include <pistis/json/streaming/ArrayElementSplitter.hpp>
+#include <pistis/json/streaming/ChunkResultOrder.hpp>
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/PathProjection.hpp>
+#include <pistis/json/streaming/detail/MappedFileStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/MemoryViewStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/ParallelChunks.hpp>
+#include <pistis/json/util/Utf8CharEncoder.hpp>
+#include <pistis/json/util/WorkStealingPool.hpp>
+#include <string>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief Parses the elements of a document that is one huge array
+       *         on several threads at once.
+       *
+       *  An ArrayElementSplitter cuts the array into chunks of about
+       *  chunkSize() bytes, each holding whole elements.  The chunks are
+       *  parsed on a WorkStealingPool, each by its own FlexibleEventStream
+       *  that starts inside the array (see
+       *  FlexibleEventStream::setArrayElements()), and the result of each
+       *  chunk is handed back to the thread that called parse(), in the
+       *  order the chunks appear in the array or as they finish.
+       *
+       *    ParallelArrayParser<DefaultPayloadFactory> parser(factory);
+       *    parser.parseMappedFile(
+       *        "export.json",
+       *        [](auto& events, const ArrayChunk& chunk) {
+       *          return loadRecords(events);
+       *        },
+       *        [&db](std::vector<Record> records, const ArrayChunk& chunk) {
+       *          db.insert(records);
+       *        }
+       *    );
+       *
+       *  The splitter runs on the calling thread while the pool parses
+       *  the chunks already cut.  It only counts brackets and quotes, 64
+       *  bytes at a time, so it stays well ahead of the pool.
+       *
+       *  The splitter only checks the brackets and commas of the array
+       *  itself.  Each element is checked by the stream that parses it,
+       *  but only as far as @c parseChunk reads the stream.  In strict
+       *  mode, the parser reads the rest of each chunk's stream after
+       *  @c parseChunk returns, and the splitter checks that the array is
+       *  closed by ']' and followed only by whitespace, so the whole
+       *  document is validated.  Values skipped by the projection are
+       *  only checked the way FlexibleEventStream::skipValue() checks
+       *  them.
+       *
+       *  As with ParallelNdjsonParser, the positions of events count from
+       *  the start of their chunk.  Use the chunk's @c offset to map them
+       *  back to the document.
+       */
+      template <typename PayloadFactory>
+      class ParallelArrayParser {
+      public:
+	/** @brief Type of the stream each chunk is parsed with.  Each one
+	 *         allocates from the BufferPool of the thread it runs on,
+	 *         so chunks reuse the buffers of the chunks before them.
+	 */
+	typedef FlexibleEventStream<detail::MemoryViewStreamAdapter,
+				    PayloadFactory, util::Utf8CharEncoder,
+				    memory::BufferPoolAllocator<> >
+	        EventStreamType;
+
+      public:
+	/** @brief Create a parser with @c numThreads threads, or one per
+	 *         core if @c numThreads is zero.
+	 */
+	ParallelArrayParser(const PayloadFactory& payloadFactory,
+			    uint32_t numThreads = 0,
+			    size_t chunkSize = 1024 * 1024,
+			    uint32_t bufferSize = 65536)
+	    : payloadFactory_(payloadFactory),
+	      chunkSize_(chunkSize ? chunkSize : 1),
+	      bufferSize_(bufferSize), projection_(), strict_(false),
+	      pool_(numThreads) {
+	}
+	ParallelArrayParser(const ParallelArrayParser&) = delete;
+
+	uint32_t numThreads() const { return pool_.numThreads(); }
+
+	/** @brief Size a chunk grows to before it is cut at the next comma
+	 *         between elements
+	 */
+	size_t chunkSize() const { return chunkSize_; }
+	void setChunkSize(size_t size) { chunkSize_ = size ? size : 1; }
+
+	/** @brief Most chunks that are queued, running or waiting to be
+	 *         consumed at any one time
+	 */
+	uint32_t maxChunksInFlight() const { return 4 * numThreads(); }
+
+	/** @brief Paths each chunk's stream is projected onto, relative to
+	 *         each element of the array.
+	 */
+	const PathProjection& projection() const { return projection_; }
+	void setProjection(const PathProjection& projection) {
+	  projection_ = projection;
+	}
+
+	/** @brief True if the parser validates the whole document */
+	bool strict() const { return strict_; }
+	void setStrict(bool strict) { strict_ = strict; }
+
+	/** @brief Parse the elements of the array in [begin, end).
+	 *
+	 *  Calls @c parseChunk(EventStreamType&, const ArrayChunk&) on the
+	 *  pool's threads, once for each chunk, with a stream that reads
+	 *  the elements of that chunk.  Each element ends with an
+	 *  END_RECORD event, and the stream returns END after the last
+	 *  one.  Then calls @c consume(result, const ArrayChunk&) with
+	 *  whatever @c parseChunk returned, on the calling thread, in the
+	 *  order given by @c order.
+	 *
+	 *  The document must stay in memory until parse() returns.
+	 */
+	template <typename ParseChunk, typename Consume>
+	void parse(const char* begin, const char* end, ParseChunk parseChunk,
+		   Consume consume,
+		   ChunkResultOrder order = ChunkResultOrder::IN_ORDER) {
+	  parse_(std::string(), begin, end, parseChunk, consume, order);
+	}
+
+	/** @brief Map a file into memory and parse it with parse() */
+	template <typename ParseChunk, typename Consume>
+	void parseMappedFile(
+	    const std::string& filename, ParseChunk parseChunk,
+	    Consume consume,
+	    ChunkResultOrder order = ChunkResultOrder::IN_ORDER
+	) {
+	  detail::MappedFileStreamAdapter file(filename);
+	  parse_(filename, file.begin(), file.end(), parseChunk, consume,
+		 order);
+	}
+
+	ParallelArrayParser& operator=(const ParallelArrayParser&) = delete;
+
+      private:
+	PayloadFactory payloadFactory_;
+	size_t chunkSize_;
+	uint32_t bufferSize_;
+	PathProjection projection_;
+	bool strict_;
+	util::WorkStealingPool pool_;
+
+	template <typename ParseChunk, typename Consume>
+	void parse_(const std::string& name, const char* begin,
+		    const char* end, ParseChunk& parseChunk,
+		    Consume& consume, ChunkResultOrder order) {
+	  ArrayElementSplitter splitter(name, begin, end, chunkSize_,
+					strict_);
+	  detail::processChunksInParallel<ArrayChunk>(
+	      pool_, maxChunksInFlight(),
+	      [&splitter](ArrayChunk& chunk) { return splitter.next(chunk); },
+	      [this, &name, &parseChunk](const ArrayChunk& chunk) {
+		EventStreamType events(
+		    name,
+		    detail::MemoryViewStreamAdapter(chunk.begin, chunk.end),
+		    payloadFactory_, bufferSize_, projection_
+		);
+		events.setArrayElements(true);
+		auto result = parseChunk(events, chunk);
+		if (strict_) {
+		  while (events.next() != JsonEventType::END) {
+		  }
+		}
+		return result;
+	      },
+	      consume, order
+	  );
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,217 @@
+/** @file ParallelNdjsonParser
+ *
+ *  Interface and implementation of
+ *  pistis::json::streaming::ParallelNdjsonParser, which parses the records
+ *  of an NDJSON document on several threads at once.
+ */
+#ifndef __PISTIS__JSON__STREAMING__PARALLELNDJSONPARSER_HPP__
+#define __PISTIS__JSON__STREAMING__PARALLELNDJSONPARSER_HPP__
+
+#include <pistis/json/memory/BufferPoolAllocator.hpp>
+#include <pistis/json/streaming/ChunkResultOrder.hpp>
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/PathProjection.hpp>
+#include <pistis/json/streaming/detail/MappedFileStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/MemoryViewStreamAdapter.hpp>
+#include <pistis/json/streaming/detail/ParallelChunks.hpp>
+#include <pistis/json/util/Utf8CharEncoder.hpp>
+#include <pistis/json/util/WorkStealingPool.hpp>
+#include <string>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief A run of whole records of an NDJSON document */
+      struct NdjsonChunk {
+	/** @brief Position of the chunk in the document, counting from
+	 *         zero
+	 */
+	uint64_t index;
+
+	/** @brief Offset of the chunk's first byte in the document */
+	uint64_t offset;
+
+	const char* begin;
+	const char* end;
+      };
+
+      /** @brief Parses an NDJSON document on several threads at once.
+       *
+       *  The document is cut into chunks of about chunkSize() bytes,
+       *  each ending at a newline, so every record lies entirely within
+       *  one chunk.  The chunks are parsed on a WorkStealingPool, each by
+       *  its own FlexibleEventStream, and the result of each chunk is
+       *  handed back to the thread that called parse().
+       *
+       *    ParallelNdjsonParser<DefaultPayloadFactory> parser(factory);
+       *    uint64_t total = 0;
+       *    parser.parseMappedFile(
+       *        "trades.ndjson",
+       *        [](auto& events, const NdjsonChunk& chunk) {
+       *          return sumTrades(events);
+       *        },
+       *        [&total](uint64_t n, const NdjsonChunk& chunk) {
+       *          total += n;
+       *        }
+       *    );
+       *
+       *  Only maxChunksInFlight() chunks are queued or waiting to be
+       *  consumed at once, so memory use does not grow with the size of
+       *  the document.  When results are wanted IN_ORDER, results that
+       *  finish early wait in a reorder buffer until the chunks before
+       *  them are done.
+       *
+       *  The positions of events in a chunk's stream count from the
+       *  start of the chunk, not the start of the document.  Use the
+       *  chunk's @c offset to map them back.  If parsing a chunk throws,
+       *  parse() stops handing out chunks, waits for the ones already
+       *  running, and rethrows the exception of the earliest failed chunk
+       *  it has seen.
+       */
+      template <typename PayloadFactory>
+      class ParallelNdjsonParser {
+      public:
+	/** @brief Type of the stream each chunk is parsed with.  Each one
+	 *         allocates from the BufferPool of the thread it runs on,
+	 *         so chunks reuse the buffers of the chunks before them.
+	 */
+	typedef FlexibleEventStream<detail::MemoryViewStreamAdapter,
+				    PayloadFactory, util::Utf8CharEncoder,
+				    memory::BufferPoolAllocator<> >
+	        EventStreamType;
+
+      public:
+	/** @brief Create a parser with @c numThreads threads, or one per
+	 *         core if @c numThreads is zero.
+	 */
+	ParallelNdjsonParser(const PayloadFactory& payloadFactory,
+			     uint32_t numThreads = 0,
+			     size_t chunkSize = 1024 * 1024,
+			     uint32_t bufferSize = 65536)
+	    : payloadFactory_(payloadFactory),
+	      chunkSize_(chunkSize ? chunkSize : 1),
+	      bufferSize_(bufferSize), projection_(), pool_(numThreads) {
+	}
+	ParallelNdjsonParser(const ParallelNdjsonParser&) = delete;
+
+	uint32_t numThreads() const { return pool_.numThreads(); }
+
+	/** @brief Size a chunk grows to before it is cut at the next
+	 *         newline
+	 */
+	size_t chunkSize() const { return chunkSize_; }
+	void setChunkSize(size_t size) { chunkSize_ = size ? size : 1; }
+
+	/** @brief Most chunks that are queued, running or waiting to be
+	 *         consumed at any one time
+	 */
+	uint32_t maxChunksInFlight() const { return 4 * numThreads(); }
+
+	/** @brief Paths each chunk's stream is projected onto.  See
+	 *         FlexibleStreamingJsonParser::setProjection().
+	 */
+	const PathProjection& projection() const { return projection_; }
+	void setProjection(const PathProjection& projection) {
+	  projection_ = projection;
+	}
+
+	/** @brief Parse the NDJSON document in [begin, end).
+	 *
+	 *  Calls @c parseChunk(EventStreamType&, const NdjsonChunk&) on
+	 *  the pool's threads, once for each chunk, with a stream that
+	 *  reads the records of that chunk.  Each record ends with an
+	 *  END_RECORD event, and the stream returns END after the last
+	 *  one.  Then calls @c consume(result, const NdjsonChunk&) with
+	 *  whatever @c parseChunk returned, on the calling thread, in the
+	 *  order given by @c order.
+	 *
+	 *  The document must stay in memory until parse() returns.
+	 */
+	template <typename ParseChunk, typename Consume>
+	void parse(const char* begin, const char* end, ParseChunk parseChunk,
+		   Consume consume,
+		   ChunkResultOrder order = ChunkResultOrder::IN_ORDER) {
+	  parseChunks(
+	      begin, end,
+	      [this, &parseChunk](const NdjsonChunk& chunk) {
+		EventStreamType events(
+		    std::string(),
+		    detail::MemoryViewStreamAdapter(chunk.begin, chunk.end),
+		    payloadFactory_, bufferSize_, projection_
+		);
+		events.setMultipleValues(true);
+		return parseChunk(events, chunk);
+	      },
+	      consume, order
+	  );
+	}
+
+	/** @brief Map a file into memory and parse it with parse() */
+	template <typename ParseChunk, typename Consume>
+	void parseMappedFile(
+	    const std::string& filename, ParseChunk parseChunk,
+	    Consume consume,
+	    ChunkResultOrder order = ChunkResultOrder::IN_ORDER
+	) {
+	  detail::MappedFileStreamAdapter file(filename);
+	  parse(file.begin(), file.end(), parseChunk, consume, order);
+	}
+
+	/** @brief Cut [begin, end) into chunks and process each one on the
+	 *         pool.
+	 *
+	 *  Like parse(), but @c processChunk(const NdjsonChunk&) gets the
+	 *  raw bytes of its chunk instead of an event stream, for callers
+	 *  that parse the records some other way.
+	 */
+	template <typename ProcessChunk, typename Consume>
+	void parseChunks(
+	    const char* begin, const char* end, ProcessChunk processChunk,
+	    Consume consume,
+	    ChunkResultOrder order = ChunkResultOrder::IN_ORDER
+	) {
+	  const char* p = begin;
+	  uint64_t index = 0;
+	  detail::processChunksInParallel<NdjsonChunk>(
+	      pool_, maxChunksInFlight(),
+	      [this, begin, end, &p, &index](NdjsonChunk& chunk) {
+		if (p == end) {
+		  return false;
+		}
+		chunk = nextChunk_(begin, p, end, index++);
+		p = chunk.end;
+		return true;
+	      },
+	      processChunk, consume, order
+	  );
+	}
+
+	ParallelNdjsonParser& operator=(const ParallelNdjsonParser&) = delete;
+
+      private:
+	PayloadFactory payloadFactory_;
+	size_t chunkSize_;
+	uint32_t bufferSize_;
+	PathProjection projection_;
+	util::WorkStealingPool pool_;
+
+	NdjsonChunk nextChunk_(const char* begin, const char* p,
+			       const char* end, uint64_t index) const {
+	  const char* chunkEnd = end;
+	  if ((size_t)(end - p) > chunkSize_) {
+	    const char* nl = (const char*)::memchr(p + chunkSize_, '\n',
+						   end - p - chunkSize_);
+	    if (nl) {
+	      chunkEnd = nl + 1;
+	    }
+	  }
+	  return NdjsonChunk{ index, (uint64_t)(p - begin), p, chunkEnd };
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,232 @@
+#include "PathProjection.hpp"
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+
+using namespace pistis::exceptions;
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+
+namespace {
+  [[noreturn]] void invalidPath(const std::string& path,
+				const std::string& details) {
+    std::ostringstream msg;
+    msg << "Invalid path \"" << path << "\": " << details;
+    throw IllegalValueError(msg.str(), PISTIS_EX_HERE);
+  }
+
+  /** @brief Parse an array index.  Returns false if @c text is not a
+   *         non-negative decimal integer without leading zeroes.
+   */
+  bool parseIndex(const std::string& text, uint64_t& index) {
+    if (text.empty() || (text.size() > 19) ||
+	((text[0] == '0') && (text.size() > 1))) {
+      return false;
+    }
+    index = 0;
+    for (char c : text) {
+      if ((c < '0') || (c > '9')) {
+	return false;
+      }
+      index = index * 10 + (c - '0');
+    }
+    return true;
+  }
+}
+
+PathProjection::PathProjection():
+    paths_(), nodes_(1), numSelections_(0), definite_(true) {
+}
+
+PathProjection::PathProjection(const std::vector<std::string>& paths):
+    paths_(paths), nodes_(1), numSelections_(0), definite_(true) {
+  for (const std::string& path : paths_) {
+    if (path.empty() || (path[0] == '/')) {
+      addJsonPointer_(path);
+    } else if (path[0] == '$') {
+      addJsonPath_(path);
+    } else {
+      invalidPath(path, "Must start with '/' or '$'");
+    }
+  }
+  finish_(root());
+}
+
+void PathProjection::matchField(uint32_t node, const JsonString& name,
+				std::vector<uint32_t>& children) const {
+  const Node_& n = nodes_[node];
+  for (const auto& field : n.fields) {
+    if ((field.first.size() == name.size()) &&
+	!::memcmp(field.first.data(), name.begin(), name.size())) {
+      children.push_back(field.second);
+      break;
+    }
+  }
+  if (n.any != NO_NODE) {
+    children.push_back(n.any);
+  }
+}
+
+void PathProjection::matchIndex(uint32_t node, uint64_t index,
+				std::vector<uint32_t>& children) const {
+  const Node_& n = nodes_[node];
+  for (const auto& element : n.indices) {
+    if (element.first == index) {
+      children.push_back(element.second);
+      break;
+    }
+  }
+  if (n.any != NO_NODE) {
+    children.push_back(n.any);
+  }
+}
+
+void PathProjection::addJsonPointer_(const std::string& path) {
+  // A numeric segment matches a field or an element, so the path forks
+  // at each one
+  std::vector<uint32_t> current(1, root());
+  std::vector<uint32_t> next;
+  size_t i = 0;
+
+  while (i < path.size()) {
+    std::string segment;
+    for (++i; (i < path.size()) && (path[i] != '/'); ++i) {
+      if (path[i] != '~') {
+	segment.push_back(path[i]);
+      } else if ((i + 1) < path.size() && (path[i + 1] == '0')) {
+	segment.push_back('~');
+	++i;
+      } else if ((i + 1) < path.size() && (path[i + 1] == '1')) {
+	segment.push_back('/');
+	++i;
+      } else {
+	invalidPath(path, "'~' must be followed by '0' or '1'");
+      }
+    }
+
+    uint64_t index;
+    const bool isIndex = parseIndex(segment, index);
+    next.clear();
+    for (uint32_t node : current) {
+      next.push_back(fieldChild_(node, segment));
+      if (isIndex) {
+	next.push_back(indexChild_(node, index));
+      }
+    }
+    current.swap(next);
+  }
+
+  for (uint32_t node : current) {
+    nodes_[node].selects = true;
+  }
+}
+
+void PathProjection::addJsonPath_(const std::string& path) {
+  uint32_t node = root();
+  size_t i = 1;
+
+  while (i < path.size()) {
+    if (path[i] == '.') {
+      const size_t start = ++i;
+      while ((i < path.size()) && (path[i] != '.') && (path[i] != '[')) {
+	++i;
+      }
+      if (i == start) {
+	invalidPath(path, "Field name missing after '.'");
+      }
+      const std::string name = path.substr(start, i - start);
+      node = (name == "*") ? anyChild_(node) : fieldChild_(node, name);
+    } else if (path[i] != '[') {
+      invalidPath(path, "'.' or '[' expected");
+    } else if ((i + 1) >= path.size()) {
+      invalidPath(path, "']' missing");
+    } else if ((path[i + 1] == '\'') || (path[i + 1] == '"')) {
+      const char quote = path[i + 1];
+      const size_t end = path.find(quote, i + 2);
+      if ((end == std::string::npos) || ((end + 1) >= path.size()) ||
+	  (path[end + 1] != ']')) {
+	invalidPath(path, "Field name not terminated");
+      }
+      node = fieldChild_(node, path.substr(i + 2, end - i - 2));
+      i = end + 2;
+    } else {
+      const size_t end = path.find(']', i + 1);
+      if (end == std::string::npos) {
+	invalidPath(path, "']' missing");
+      }
+      const std::string step = path.substr(i + 1, end - i - 1);
+      uint64_t index;
+      if (step == "*") {
+	node = anyChild_(node);
+      } else if (parseIndex(step, index)) {
+	node = indexChild_(node, index);
+      } else {
+	invalidPath(path, "Array index expected between '[' and ']'");
+      }
+      i = end + 1;
+    }
+  }
+
+  nodes_[node].selects = true;
+}
+
+uint32_t PathProjection::fieldChild_(uint32_t node,
+				     const std::string& name) {
+  for (const auto& field : nodes_[node].fields) {
+    if (field.first == name) {
+      return field.second;
+    }
+  }
+  const uint32_t child = addNode_();
+  nodes_[node].fields.emplace_back(name, child);
+  return child;
+}
+
+uint32_t PathProjection::indexChild_(uint32_t node, uint64_t index) {
+  for (const auto& element : nodes_[node].indices) {
+    if (element.first == index) {
+      return element.second;
+    }
+  }
+  const uint32_t child = addNode_();
+  nodes_[node].indices.emplace_back(index, child);
+  return child;
+}
+
+uint32_t PathProjection::anyChild_(uint32_t node) {
+  if (nodes_[node].any == NO_NODE) {
+    const uint32_t child = addNode_();
+    nodes_[node].any = child;
+  }
+  return nodes_[node].any;
+}
+
+uint32_t PathProjection::addNode_() {
+  nodes_.push_back(Node_());
+  return nodes_.size() - 1;
+}
+
+void PathProjection::finish_(uint32_t node) {
+  Node_& n = nodes_[node];
+  if (n.selects) {
+    // Nothing below a node that selects its value matters
+    n.selection = numSelections_++;
+    n.fields.clear();
+    n.indices.clear();
+    n.any = NO_NODE;
+    return;
+  }
+
+  if (n.any != NO_NODE) {
+    definite_ = false;
+    finish_(n.any);
+  }
+  // finish_() does not add nodes, so these references stay valid
+  for (const auto& field : n.fields) {
+    finish_(field.second);
+  }
+  for (const auto& element : n.indices) {
+    finish_(element.second);
+  }
+}
@@ -0,0 +1,126 @@
+#ifndef __PISTIS__JSON__STREAMING__PATHPROJECTION_HPP__
+#define __PISTIS__JSON__STREAMING__PATHPROJECTION_HPP__
+
+#include <pistis/json/JsonString.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief A set of paths into a JSON document, compiled into an
+       *         automaton that a FlexibleEventStream runs to report only
+       *         the parts of the document those paths select.
+       *
+       *  Each path is either a JSON Pointer (RFC 6901), such as
+       *  "/user/id" or "/items/0/price", or a simple JSONPath
+       *  expression, such as "$.user.id", "$.items[*].price",
+       *  "$['odd name']" or "$.items[2]".  A JSONPath wildcard ("*" or
+       *  "[*]") matches every field of an object and every element of
+       *  an array.  A JSON Pointer segment that is a number matches
+       *  either an array element or a field with that name.
+       *
+       *  The automaton is a trie of path steps.  Each node is a step,
+       *  and a node "selects" its value if a path ends there.  Paths that
+       *  continue past a node that selects add nothing, since the whole
+       *  value is already selected, so they are dropped when the paths
+       *  are compiled.
+       */
+      class PathProjection {
+      public:
+	/** @brief Node number meaning "no node" */
+	static constexpr const uint32_t NO_NODE = 0xFFFFFFFF;
+
+      public:
+	/** @brief A projection with no paths, which selects everything */
+	PathProjection();
+
+	/** @brief Compile @c paths.
+	 *
+	 *  Throws pistis::exceptions::IllegalValueError if any of them
+	 *  is not a valid path.
+	 */
+	explicit PathProjection(const std::vector<std::string>& paths);
+
+	PathProjection(const PathProjection&) = default;
+	PathProjection(PathProjection&&) = default;
+
+	/** @brief The paths the projection was compiled from */
+	const std::vector<std::string>& paths() const { return paths_; }
+
+	/** @brief True if the projection has no paths and selects the
+	 *         whole document.
+	 */
+	bool empty() const { return paths_.empty(); }
+
+	/** @brief True if no path contains a wildcard, so every path
+	 *         selects at most one value.
+	 *
+	 *  A FlexibleEventStream stops reading the document once it has
+	 *  seen every value selected by a definite projection.
+	 */
+	bool definite() const { return definite_; }
+
+	/** @brief Number of nodes that select their values */
+	uint32_t numSelections() const { return numSelections_; }
+
+	/** @brief The node for the document's value */
+	uint32_t root() const { return 0; }
+
+	/** @brief If @c node selects its value, returns a number from zero
+	 *         to numSelections() - 1 that identifies it.  Otherwise,
+	 *         returns NO_NODE.
+	 */
+	uint32_t selection(uint32_t node) const {
+	  return nodes_[node].selection;
+	}
+
+	/** @brief Append the nodes for the value of field @c name of the
+	 *         object at @c node to @c children.
+	 */
+	void matchField(uint32_t node, const JsonString& name,
+			std::vector<uint32_t>& children) const;
+
+	/** @brief Append the nodes for element @c index of the array at
+	 *         @c node to @c children.
+	 */
+	void matchIndex(uint32_t node, uint64_t index,
+			std::vector<uint32_t>& children) const;
+
+	PathProjection& operator=(const PathProjection&) = default;
+	PathProjection& operator=(PathProjection&&) = default;
+
+      private:
+	struct Node_ {
+	  std::vector<std::pair<std::string, uint32_t> > fields;
+	  std::vector<std::pair<uint64_t, uint32_t> > indices;
+	  uint32_t any;        ///< Child for a wildcard step
+	  uint32_t selection;  ///< See selection()
+	  bool selects;
+
+	  Node_(): fields(), indices(), any(NO_NODE), selection(NO_NODE),
+		   selects(false) {
+	  }
+	};
+
+	std::vector<std::string> paths_;
+	std::vector<Node_> nodes_;
+	uint32_t numSelections_;
+	bool definite_;
+
+	void addJsonPointer_(const std::string& path);
+	void addJsonPath_(const std::string& path);
+	uint32_t fieldChild_(uint32_t node, const std::string& name);
+	uint32_t indexChild_(uint32_t node, uint64_t index);
+	uint32_t anyChild_(uint32_t node);
+	uint32_t addNode_();
+	void finish_(uint32_t node);
+      };
+
+    }
+  }
+}
+#endif
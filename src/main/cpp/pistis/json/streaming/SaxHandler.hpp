@@ -0,0 +1,113 @@
+#ifndef __PISTIS__JSON__STREAMING__SAXHANDLER_HPP__
+#define __PISTIS__JSON__STREAMING__SAXHANDLER_HPP__
+
+#include <pistis/json/JsonString.hpp>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief What a SaxHandler callback tells
+       *         FlexibleEventStream::parse() to do next
+       */
+      enum class ParseAction {
+	/** @brief Go on to the next event */
+	CONTINUE,
+
+	/** @brief Skip the value that just started.
+	 *
+	 *  From onBeginObject() or onBeginArray(), skips the rest of the
+	 *  object or array, and its onEndObject() or onEndArray() is not
+	 *  called.  From onKey(), skips the field's value.  Anywhere else,
+	 *  the same as CONTINUE.
+	 */
+	SKIP,
+
+	/** @brief Return from parse() right away */
+	STOP
+      };
+
+      /** @brief Why FlexibleEventStream::parse() returned */
+      enum class ParseResult {
+	/** @brief Reached the end of the stream */
+	END,
+
+	/** @brief Ran out of data.  Call parse() again when more data is
+	 *         available.
+	 */
+	AGAIN,
+
+	/** @brief A callback returned ParseAction::STOP.  Calling parse()
+	 *         again carries on with the next event.
+	 */
+	STOPPED
+      };
+
+      /** @brief Base class for handlers passed to
+       *         FlexibleEventStream::parse().
+       *
+       *  Every callback does nothing and returns CONTINUE.  Handlers
+       *  define the ones they care about, which hide these, and leave out
+       *  the rest:
+       *
+       *    struct SumPrices : SaxHandler {
+       *      bool price = false;
+       *      double total = 0.0;
+       *
+       *      ParseAction onKey(const JsonString& name) {
+       *        price = (name == "price");
+       *        return price ? ParseAction::CONTINUE : ParseAction::SKIP;
+       *      }
+       *      ParseAction onFloat(double value) {
+       *        total += price ? value : 0.0;
+       *        return ParseAction::CONTINUE;
+       *      }
+       *    };
+       *
+       *  The handler is a template parameter of parse(), so the calls
+       *  are not virtual and the empty ones compile to nothing.
+       *  Payloads have the types the stream's PayloadFactory gives
+       *  them, and strings and field names are only valid until the
+       *  callback returns, unless the stream pins its buffers.
+       */
+      class SaxHandler {
+      public:
+	ParseAction onBeginObject() { return ParseAction::CONTINUE; }
+	ParseAction onEndObject() { return ParseAction::CONTINUE; }
+	ParseAction onBeginArray() { return ParseAction::CONTINUE; }
+	ParseAction onEndArray() { return ParseAction::CONTINUE; }
+
+	ParseAction onKey(const JsonString&) {
+	  return ParseAction::CONTINUE;
+	}
+
+	template <typename T>
+	ParseAction onInt(const T&) { return ParseAction::CONTINUE; }
+
+	template <typename T>
+	ParseAction onFloat(const T&) { return ParseAction::CONTINUE; }
+
+	template <typename T>
+	ParseAction onString(const T&) { return ParseAction::CONTINUE; }
+
+	/** @brief Part of a string value, when the stream splits long
+	 *         strings (see FlexibleEventStream::setStringChunkSize())
+	 */
+	ParseAction onStringChunk(const JsonString&) {
+	  return ParseAction::CONTINUE;
+	}
+
+	/** @brief End of a string value delivered with onStringChunk() */
+	ParseAction onStringEnd() { return ParseAction::CONTINUE; }
+
+	ParseAction onBool(bool) { return ParseAction::CONTINUE; }
+	ParseAction onNull() { return ParseAction::CONTINUE; }
+
+	/** @brief End of a record of a stream with multiple values */
+	ParseAction onEndRecord() { return ParseAction::CONTINUE; }
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,204 @@
+#ifndef __PISTIS__JSON__STREAMING__SHAPECACHE_HPP__
+#define __PISTIS__JSON__STREAMING__SHAPECACHE_HPP__
+
+#include <pistis/json/JsonString.hpp>
+#include <pistis/json/memory/SymbolTable.hpp>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+
+      /** @brief Hit and miss counts for FlexibleEventStream's shape
+       *         prediction
+       */
+      struct ShapeStatistics {
+	/** @brief Field names that matched the predicted name */
+	uint64_t hits;
+
+	/** @brief Field names that had to be read in full */
+	uint64_t misses;
+
+	ShapeStatistics(): hits(0), misses(0) { }
+
+	double hitRate() const {
+	  return (hits + misses) ? (double)hits / (double)(hits + misses)
+	                         : 0.0;
+	}
+      };
+
+      /** @brief Remembers the sequences of field names in the objects a
+       *         FlexibleEventStream has read, so it can predict the field
+       *         names of the objects that follow.
+       *
+       *  Works like the hidden classes of a JavaScript engine.  A shape is
+       *  a node in a tree, reached from the object's start by one
+       *  transition per field name.  Each node remembers the field name
+       *  that followed it last time, and the stream checks the next
+       *  field name against that one with a single memcmp().  Objects
+       *  start at a node that depends on where they are: the value of a
+       *  given field, an element of an array that is the value of a
+       *  given field, or a value at the top level.  So the objects of an
+       *  array of records, or the records of an NDJSON file, share their
+       *  shapes, and objects nested inside them get shapes of their own.
+       *
+       *  The tree stops growing at maxNodes() nodes.  After that, fields
+       *  with no node are not predicted.
+       */
+      template <typename Allocator = std::allocator<char> >
+      class ShapeCache {
+      public:
+	/** @brief Node number meaning "no node" */
+	static constexpr const uint32_t NO_NODE = 0xFFFFFFFF;
+
+      public:
+	ShapeCache(uint32_t maxNodes = 4096,
+		   const Allocator& allocator = Allocator()):
+	    maxNodes_(maxNodes), nodes_(1),
+	    keys_(0xFFFFFFFF, 4096, allocator) {
+	}
+	ShapeCache(const ShapeCache&) = delete;
+	ShapeCache(ShapeCache&&) = default;
+
+	uint32_t maxNodes() const { return maxNodes_; }
+	uint32_t size() const { return nodes_.size(); }
+
+	/** @brief Node for the context of top-level values */
+	uint32_t root() const { return 0; }
+
+	/** @brief Field name that leads to @c node */
+	const JsonString& key(uint32_t node) const {
+	  return nodes_[node].key;
+	}
+
+	/** @brief Position of the field that leads to @c node in its
+	 *         object, starting at one
+	 */
+	uint32_t index(uint32_t node) const { return nodes_[node].index; }
+
+	/** @brief Node for the field predicted to follow @c node, or
+	 *         NO_NODE if there is no prediction.
+	 */
+	uint32_t predicted(uint32_t node) const {
+	  const uint32_t next = nodes_[node].next;
+	  return ((next != NO_NODE) && nodes_[next].matchable) ? next
+	                                                       : NO_NODE;
+	}
+
+	/** @brief Symbol id cached for the field that leads to @c node.
+	 *
+	 *  The stream keeps the id from its symbol table here, so a
+	 *  predicted field name needs no symbol table lookup.
+	 */
+	uint32_t& symbol(uint32_t node) { return nodes_[node].symbol; }
+
+	/** @brief Forget all cached symbol ids */
+	void clearSymbols() {
+	  for (Node_& n : nodes_) {
+	    n.symbol = memory::SymbolTable<Allocator>::NO_SYMBOL;
+	  }
+	}
+
+	/** @brief Node an object starts at when it begins in @c context.
+	 *
+	 *  @c context is the node of the field whose value the object is,
+	 *  or whose value is the array the object is in, or root() for
+	 *  top-level objects.  Returns NO_NODE if @c context is NO_NODE
+	 *  or the tree is full.
+	 */
+	uint32_t objectShape(uint32_t context) {
+	  if (context == NO_NODE) {
+	    return NO_NODE;
+	  } else if (nodes_[context].nested == NO_NODE) {
+	    const uint32_t start = addNode_(JsonString(), 0, true);
+	    if (start != NO_NODE) {
+	      nodes_[context].nested = start;
+	    }
+	    return start;
+	  }
+	  return nodes_[context].nested;
+	}
+
+	/** @brief Follow the transition from @c node for field name
+	 *         @c key, creating it if needed, and make it the
+	 *         prediction for @c node.
+	 *
+	 *  @c matchable is false if @c key was decoded from escape
+	 *  sequences or contains a newline, so its raw text can't be
+	 *  compared with the stream's bytes.  Returns NO_NODE if @c node
+	 *  is NO_NODE, or if the tree is full.
+	 */
+	uint32_t addKey(uint32_t node, const JsonString& key,
+			bool matchable) {
+	  if (node == NO_NODE) {
+	    return NO_NODE;
+	  }
+
+	  uint32_t child = nodes_[node].firstChild;
+	  while ((child != NO_NODE) &&
+		 ((nodes_[child].key.size() != key.size()) ||
+		  ::memcmp(nodes_[child].key.begin(), key.begin(),
+			   key.size()))) {
+	    child = nodes_[child].sibling;
+	  }
+
+	  if (child == NO_NODE) {
+	    const uint32_t k = keys_.add(key);
+	    child = addNode_(keys_.name(k), nodes_[node].index + 1,
+			     matchable);
+	    if (child == NO_NODE) {
+	      return NO_NODE;
+	    }
+	    nodes_[child].sibling = nodes_[node].firstChild;
+	    nodes_[node].firstChild = child;
+	  }
+	  nodes_[node].next = child;
+	  return child;
+	}
+
+	ShapeCache& operator=(const ShapeCache&) = delete;
+	ShapeCache& operator=(ShapeCache&&) = default;
+
+      private:
+	struct Node_ {
+	  JsonString key;
+	  uint32_t index;
+	  uint32_t next;        ///< See predicted()
+	  uint32_t firstChild;  ///< First transition from this node
+	  uint32_t sibling;     ///< Next transition from the parent
+	  uint32_t nested;      ///< See objectShape()
+	  uint32_t symbol;      ///< See symbol()
+	  bool matchable;
+
+	  Node_(): Node_(JsonString(), 0, false) { }
+	  Node_(const JsonString& k, uint32_t i, bool m):
+	      key(k), index(i), next(NO_NODE), firstChild(NO_NODE),
+	      sibling(NO_NODE), nested(NO_NODE),
+	      symbol(memory::SymbolTable<Allocator>::NO_SYMBOL),
+	      matchable(m) {
+	  }
+	};
+
+	uint32_t maxNodes_;
+	std::vector<Node_> nodes_;
+
+	// Holds the text of the field names, which nodes point into
+	memory::SymbolTable<Allocator> keys_;
+
+	uint32_t addNode_(const JsonString& key, uint32_t index,
+			  bool matchable) {
+	  if (nodes_.size() >= maxNodes_) {
+	    return NO_NODE;
+	  }
+	  nodes_.push_back(Node_(key, index, matchable));
+	  return nodes_.size() - 1;
+	}
+      };
+
+    }
+  }
+}
+#endif
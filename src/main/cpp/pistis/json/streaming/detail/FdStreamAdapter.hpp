@@ -0,0 +1,109 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__FDSTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__FDSTREAMADAPTER_HPP__
+
+#include <pistis/exceptions/IOError.hpp>
+#include <sstream>
+#include <string>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream that calls read() on a file descriptor.
+	 *
+	 *  read() returns -1 if the descriptor is nonblocking and has no
+	 *  data, and the parser reports AGAIN.  The adapter leaves the
+	 *  descriptor open when it is destroyed; FileStreamAdapter is the
+	 *  one that opens and closes a file by name.  The name only
+	 *  appears in error messages.
+	 */
+	class FdStreamAdapter {
+	public:
+	  explicit FdStreamAdapter(int fd): FdStreamAdapter(std::string(), fd) {
+	  }
+
+	  FdStreamAdapter(const std::string& name, int fd):
+	      FdStreamAdapter(name, fd, false) {
+	  }
+
+	  FdStreamAdapter(const FdStreamAdapter&) = delete;
+	  FdStreamAdapter(FdStreamAdapter&& other):
+	      name_(std::move(other.name_)), fd_(other.fd_),
+	      ownsFd_(other.ownsFd_) {
+	    other.fd_ = -1;
+	    other.ownsFd_ = false;
+	  }
+	  ~FdStreamAdapter() { close_(); }
+
+	  /** @brief The descriptor the adapter reads.  Lets
+	   *         ReadAheadStreamAdapter poll() it (see HasFileDescriptor).
+	   */
+	  int fd() const { return fd_; }
+
+	  const std::string& name() const { return name_; }
+
+	  ssize_t read(char* buffer, size_t n) {
+	    while (true) {
+	      const ssize_t numRead = ::read(fd_, buffer, n);
+	      if (numRead >= 0) {
+		return numRead;
+	      } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+		return -1;
+	      } else if (errno != EINTR) {
+		error_("Could not read", name_, errno);
+	      }
+	    }
+	  }
+
+	  FdStreamAdapter& operator=(const FdStreamAdapter&) = delete;
+	  FdStreamAdapter& operator=(FdStreamAdapter&& other) {
+	    if (this != &other) {
+	      close_();
+	      name_ = std::move(other.name_);
+	      fd_ = other.fd_;
+	      ownsFd_ = other.ownsFd_;
+	      other.fd_ = -1;
+	      other.ownsFd_ = false;
+	    }
+	    return *this;
+	  }
+
+	protected:
+	  /** @brief Adopt @c fd, closing it on destruction if @c ownsFd is
+	   *         true
+	   */
+	  FdStreamAdapter(const std::string& name, int fd, bool ownsFd):
+	      name_(name), fd_(fd), ownsFd_(ownsFd) {
+	  }
+
+	  [[noreturn]] static void error_(const char* action,
+					  const std::string& name, int err) {
+	    std::ostringstream msg;
+	    msg << action << " " << (name.empty() ? "file" : name) << ": "
+		<< ::strerror(err);
+	    throw pistis::exceptions::IOError(msg.str(), PISTIS_EX_HERE);
+	  }
+
+	private:
+	  std::string name_;
+	  int fd_;
+	  bool ownsFd_;
+
+	  void close_() {
+	    if (ownsFd_ && (fd_ >= 0)) {
+	      ::close(fd_);
+	    }
+	    fd_ = -1;
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__FILESTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__FILESTREAMADAPTER_HPP__
+
+#include <pistis/json/streaming/detail/FdStreamAdapter.hpp>
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream that opens a file by name, reads it with read()
+	 *         and closes it when the adapter is destroyed.
+	 */
+	class FileStreamAdapter : public FdStreamAdapter {
+	public:
+	  explicit FileStreamAdapter(const std::string& filename):
+	      FdStreamAdapter(filename, open_(filename), true) {
+	  }
+
+	  FileStreamAdapter(FileStreamAdapter&&) = default;
+
+	  FileStreamAdapter& operator=(FileStreamAdapter&&) = default;
+
+	private:
+	  static int open_(const std::string& filename) {
+	    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	    if (fd < 0) {
+	      error_("Could not open", filename, errno);
+	    }
+	    return fd;
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,54 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__INMEMORYSTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__INMEMORYSTREAMADAPTER_HPP__
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string.h>
+#include <sys/types.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream over a copy of a string.
+	 *
+	 *  The text lives on the heap, so it stays put when the adapter is
+	 *  moved, which makes this a contiguous stream (see
+	 *  IsContiguousStream) that can be parsed in place.
+	 */
+	class InMemoryStreamAdapter {
+	public:
+	  InMemoryStreamAdapter(std::string text):
+	      text_(new std::string(std::move(text))), readPosition_(0) {
+	  }
+	  InMemoryStreamAdapter(const InMemoryStreamAdapter&) = delete;
+	  InMemoryStreamAdapter(InMemoryStreamAdapter&&) = default;
+
+	  const char* begin() const { return text_->data(); }
+	  const char* end() const { return text_->data() + text_->size(); }
+	  size_t size() const { return text_->size(); }
+
+	  ssize_t read(char* buffer, size_t n) {
+	    const size_t numToCopy =
+	        std::min(n, text_->size() - readPosition_);
+	    ::memcpy(buffer, text_->data() + readPosition_, numToCopy);
+	    readPosition_ += numToCopy;
+	    return numToCopy;
+	  }
+
+	  InMemoryStreamAdapter& operator=(const InMemoryStreamAdapter&)
+	      = delete;
+	  InMemoryStreamAdapter& operator=(InMemoryStreamAdapter&&) = default;
+
+	private:
+	  std::unique_ptr<std::string> text_;
+	  size_t readPosition_;
+	};
+
+      }
+    }
+  }
+}
+#endif
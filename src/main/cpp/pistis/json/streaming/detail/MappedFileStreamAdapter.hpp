@@ -0,0 +1,153 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__MAPPEDFILESTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__MAPPEDFILESTREAMADAPTER_HPP__
+
+#include <pistis/exceptions/IOError.hpp>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream that maps a file into memory.
+	 *
+	 *  Since the entire file is in memory, FlexibleStreamReader parses
+	 *  it in place: it never copies the file's content into a buffer,
+	 *  and the string and number payloads it returns point directly into
+	 *  the mapping, so they stay valid until the adapter is destroyed.
+	 *
+	 *  The adapter tells the kernel that the mapping will be read
+	 *  sequentially, so it reads ahead aggressively and drops pages
+	 *  behind the reader, and asks for transparent huge pages where the
+	 *  kernel and filesystem support them, which cuts TLB misses on
+	 *  large files.
+	 */
+	class MappedFileStreamAdapter {
+	public:
+	  MappedFileStreamAdapter(const std::string& filename):
+	      begin_(nullptr), end_(nullptr), readPosition_(nullptr),
+	      size_(0) {
+	    const int fd = ::open(filename.c_str(), O_RDONLY);
+	    if (fd < 0) {
+	      error_("Could not open", filename, errno);
+	    }
+	    try {
+	      map_(fd, filename);
+	    } catch(...) {
+	      ::close(fd);
+	      throw;
+	    }
+	    ::close(fd);
+	  }
+
+	  MappedFileStreamAdapter(const std::string& name, int fd):
+	      begin_(nullptr), end_(nullptr), readPosition_(nullptr),
+	      size_(0) {
+	    map_(fd, name);
+	  }
+	  
+	  MappedFileStreamAdapter(const MappedFileStreamAdapter&) = delete;
+	  MappedFileStreamAdapter(MappedFileStreamAdapter&& other):
+	      begin_(other.begin_), end_(other.end_),
+	      readPosition_(other.readPosition_), size_(other.size_) {
+	    other.begin_ = nullptr;
+	    other.end_ = nullptr;
+	    other.readPosition_ = nullptr;
+	    other.size_ = 0;
+	  }
+	  ~MappedFileStreamAdapter() { unmap_(); }
+
+	  const char* begin() const { return begin_; }
+	  const char* end() const { return end_; }
+	  size_t size() const { return size_; }
+
+	  /** @brief Copy the next @c n bytes of the file into @c buffer.
+	   *
+	   *  Only needed when the adapter is used with a reader that does
+	   *  not parse contiguous streams in place.
+	   */
+	  ssize_t read(char* buffer, size_t n) {
+	    const size_t numToCopy =
+	        std::min(n, (size_t)(end_ - readPosition_));
+	    ::memcpy(buffer, readPosition_, numToCopy);
+	    readPosition_ += numToCopy;
+	    return numToCopy;
+	  }
+
+	  MappedFileStreamAdapter& operator=(const MappedFileStreamAdapter&)
+	      = delete;
+	  MappedFileStreamAdapter& operator=(MappedFileStreamAdapter&& other) {
+	    if (this != &other) {
+	      unmap_();
+	      begin_ = other.begin_;
+	      end_ = other.end_;
+	      readPosition_ = other.readPosition_;
+	      size_ = other.size_;
+	      other.begin_ = nullptr;
+	      other.end_ = nullptr;
+	      other.readPosition_ = nullptr;
+	      other.size_ = 0;
+	    }
+	    return *this;
+	  }
+
+	private:
+	  const char* begin_;
+	  const char* end_;
+	  const char* readPosition_;
+	  size_t size_;
+
+	  void map_(int fd, const std::string& name) {
+	    struct stat info;
+	    if (::fstat(fd, &info) < 0) {
+	      error_("Could not stat", name, errno);
+	    }
+
+	    // mmap() rejects zero-length mappings
+	    if (info.st_size) {
+	      void* p = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+			       fd, 0);
+	      if (p == MAP_FAILED) {
+		error_("Could not map", name, errno);
+	      }
+	      ::madvise(p, info.st_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	      ::madvise(p, info.st_size, MADV_HUGEPAGE);
+#endif
+	      size_ = info.st_size;
+	      begin_ = (const char*)p;
+	    }
+	    end_ = begin_ + size_;
+	    readPosition_ = begin_;
+	  }
+
+	  void unmap_() {
+	    if (begin_) {
+	      ::munmap((void*)begin_, size_);
+	      begin_ = nullptr;
+	    }
+	  }
+
+	  [[noreturn]] static void error_(const char* action,
+					  const std::string& name, int err) {
+	    std::ostringstream msg;
+	    msg << action << " " << (name.empty() ? "file" : name) << ": "
+		<< ::strerror(err);
+	    throw pistis::exceptions::IOError(msg.str(), PISTIS_EX_HERE);
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
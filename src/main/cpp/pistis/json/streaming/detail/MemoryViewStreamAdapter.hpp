@@ -0,0 +1,47 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__MEMORYVIEWSTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__MEMORYVIEWSTREAMADAPTER_HPP__
+
+#include <algorithm>
+#include <string.h>
+#include <sys/types.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream over memory that someone else owns.
+	 *
+	 *  Like InMemoryStreamAdapter, but without the copy.  The memory
+	 *  must outlive the stream.  ParallelNdjsonParser uses it to give
+	 *  each worker a stream over its own chunk of a larger input.
+	 */
+	class MemoryViewStreamAdapter {
+	public:
+	  MemoryViewStreamAdapter(const char* begin, const char* end):
+	      begin_(begin), end_(end), readPosition_(begin) {
+	  }
+
+	  const char* begin() const { return begin_; }
+	  const char* end() const { return end_; }
+	  size_t size() const { return end_ - begin_; }
+
+	  ssize_t read(char* buffer, size_t n) {
+	    const size_t numToCopy =
+	        std::min(n, (size_t)(end_ - readPosition_));
+	    ::memcpy(buffer, readPosition_, numToCopy);
+	    readPosition_ += numToCopy;
+	    return numToCopy;
+	  }
+
+	private:
+	  const char* begin_;
+	  const char* end_;
+	  const char* readPosition_;
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,155 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__PARALLELCHUNKS_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__PARALLELCHUNKS_HPP__
+
+#include <pistis/json/streaming/ChunkResultOrder.hpp>
+#include <pistis/json/util/WorkStealingPool.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Process the chunks of a document on @c pool, and hand
+	 *         the results back on the calling thread.
+	 *
+	 *  @c nextChunk(Chunk&) cuts the next chunk off the document and
+	 *  returns false when there are none left.  It runs on the calling
+	 *  thread, in between handing out chunks and consuming results.
+	 *  Each chunk must have an @c index member that counts the chunks
+	 *  from zero.  @c processChunk(const Chunk&) runs on the pool, and
+	 *  @c consume(result, const Chunk&) runs on the calling thread, in
+	 *  the order given by @c order.  Results that finish early wait in
+	 *  a reorder buffer when they are wanted IN_ORDER.
+	 *
+	 *  At most @c maxInFlight chunks are queued, running or waiting to
+	 *  be consumed at once.  If processing a chunk throws, no more
+	 *  chunks are handed out, and the exception of the earliest failed
+	 *  chunk seen is rethrown once the running ones are done.  The same
+	 *  goes for exceptions from @c nextChunk and @c consume.
+	 */
+	template <typename Chunk, typename NextChunk, typename ProcessChunk,
+		  typename Consume>
+	void processChunksInParallel(util::WorkStealingPool& pool,
+				     uint32_t maxInFlight,
+				     NextChunk nextChunk,
+				     ProcessChunk processChunk,
+				     Consume consume,
+				     ChunkResultOrder order) {
+	  typedef decltype(processChunk(std::declval<const Chunk&>()))
+	          Result;
+
+	  struct Completed {
+	    Chunk chunk;
+	    std::optional<Result> result;
+	    std::exception_ptr error;
+	  };
+
+	  // Workers put finished chunks here, and this thread takes them
+	  std::mutex mutex;
+	  std::condition_variable finished;
+	  std::deque<Completed> completed;
+
+	  std::map<uint64_t, Completed> reorderBuffer;
+	  uint64_t nextToConsume = 0;
+	  uint32_t numInFlight = 0;
+	  bool moreChunks = true;
+	  std::exception_ptr error;
+	  uint64_t errorIndex = 0;
+
+	  auto deliver = [&](Completed& c) {
+	    if (c.error) {
+	      if (!error || (c.chunk.index < errorIndex)) {
+		error = c.error;
+		errorIndex = c.chunk.index;
+	      }
+	    } else if (!error) {
+	      consume(std::move(*c.result), c.chunk);
+	    }
+	  };
+
+	  try {
+	    while (true) {
+	      while (moreChunks && !error && (numInFlight < maxInFlight)) {
+		Chunk chunk;
+		moreChunks = nextChunk(chunk);
+		if (!moreChunks) {
+		  break;
+		}
+
+		++numInFlight;
+		pool.submit([&, chunk]() {
+		  Completed c{ chunk, std::nullopt, nullptr };
+		  try {
+		    c.result.emplace(processChunk(chunk));
+		  } catch(...) {
+		    c.error = std::current_exception();
+		  }
+
+		  std::unique_lock<std::mutex> lock(mutex);
+		  completed.push_back(std::move(c));
+		  finished.notify_one();
+		});
+	      }
+
+	      if (!numInFlight) {
+		break;
+	      }
+
+	      std::deque<Completed> batch;
+	      {
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [&completed]() {
+		  return !completed.empty();
+		});
+		batch.swap(completed);
+	      }
+	      numInFlight -= batch.size();
+
+	      for (Completed& c : batch) {
+		if (order == ChunkResultOrder::AS_COMPLETED) {
+		  deliver(c);
+		} else {
+		  const uint64_t index = c.chunk.index;
+		  reorderBuffer.emplace(index, std::move(c));
+		}
+	      }
+
+	      while (!reorderBuffer.empty() &&
+		     (reorderBuffer.begin()->first == nextToConsume)) {
+		deliver(reorderBuffer.begin()->second);
+		reorderBuffer.erase(reorderBuffer.begin());
+		++nextToConsume;
+	      }
+	    }
+	  } catch(...) {
+	    // The chunks still running refer to this frame, so wait for
+	    // them before letting the exception go.
+	    std::unique_lock<std::mutex> lock(mutex);
+	    while (numInFlight) {
+	      finished.wait(lock, [&completed]() {
+		return !completed.empty();
+	      });
+	      numInFlight -= completed.size();
+	      completed.clear();
+	    }
+	    throw;
+	  }
+
+	  if (error) {
+	    std::rethrow_exception(error);
+	  }
+	}
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,88 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__PAYLOADCONVERSION_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__PAYLOADCONVERSION_HPP__
+
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Convert a number with the factory's
+	 *         intValue(const JsonNumber&), which uses the significand and
+	 *         exponent the reader has already computed.
+	 */
+	template <typename PayloadFactory>
+	inline auto intValue(const PayloadFactory& factory,
+			     const JsonNumber& n, int)
+	    -> decltype(factory.intValue(n)) {
+	  return factory.intValue(n);
+	}
+
+	/** @brief Convert a number with the factory's
+	 *         intValue(const JsonString&), for factories that only
+	 *         accept the text of the number.
+	 */
+	template <typename PayloadFactory>
+	inline auto intValue(const PayloadFactory& factory,
+			     const JsonNumber& n, long)
+	    -> decltype(factory.intValue(n.text())) {
+	  return factory.intValue(n.text());
+	}
+
+	/** @brief Float counterpart of intValue() */
+	template <typename PayloadFactory>
+	inline auto floatValue(const PayloadFactory& factory,
+			       const JsonNumber& n, int)
+	    -> decltype(factory.floatValue(n)) {
+	  return factory.floatValue(n);
+	}
+
+	/** @brief Float counterpart of intValue() */
+	template <typename PayloadFactory>
+	inline auto floatValue(const PayloadFactory& factory,
+			       const JsonNumber& n, long)
+	    -> decltype(factory.floatValue(n.text())) {
+	  return factory.floatValue(n.text());
+	}
+
+	/** @brief Types of the payloads a factory creates */
+	template <typename PayloadFactory>
+	struct PayloadTypes {
+	  typedef typename std::remove_cv<
+	              typename std::remove_reference<
+		          decltype(intValue(
+			      std::declval<const PayloadFactory&>(),
+			      std::declval<const JsonNumber&>(), 0
+			  ))
+	              >::type
+	          >::type
+	          IntPayloadType;
+	  typedef typename std::remove_cv<
+	              typename std::remove_reference<
+		          decltype(floatValue(
+			      std::declval<const PayloadFactory&>(),
+			      std::declval<const JsonNumber&>(), 0
+			  ))
+	              >::type
+	          >::type
+	          FloatPayloadType;
+	  typedef typename std::remove_cv<
+	              typename std::remove_reference<
+		          decltype(std::declval<const PayloadFactory&>().
+				       stringValue(
+					   std::declval<const JsonString&>()
+				       ))
+	              >::type
+	          >::type
+	          StringPayloadType;
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,345 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__READAHEADSTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__READAHEADSTREAMADAPTER_HPP__
+
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <pistis/json/streaming/detail/StreamTraits.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream that reads ahead of its consumer on a background
+	 *         thread.
+	 *
+	 *  A producer thread reads chunks from the wrapped stream into a
+	 *  ring of @c queueDepth buffers while the parser consumes the
+	 *  chunk in front of it, so parsing overlaps with I/O instead of
+	 *  stalling on every read.  The producer and consumer hand buffers
+	 *  to each other by advancing two atomic counters; they only touch
+	 *  the mutex when one of them has to sleep because the ring is full
+	 *  or empty.
+	 *
+	 *  When @c blocking is false, read() returns -1 instead of waiting
+	 *  when the producer has not filled the next chunk yet, and the
+	 *  parser reports AGAIN.  Exceptions thrown by the wrapped stream
+	 *  are rethrown by read() once the data read before them has been
+	 *  consumed.
+	 *
+	 *  The destructor stops the producer and waits for it to exit, so
+	 *  it has to wait for a read() of the wrapped stream that is in
+	 *  progress.  If the wrapped stream has an fd() method (see
+	 *  HasFileDescriptor), the producer poll()s the descriptor before
+	 *  reading and only reads once there is data, so it never blocks
+	 *  in read() on a pipe or socket, and the destructor interrupts the
+	 *  poll().  This also covers non-blocking descriptors, whose read()
+	 *  returns -1 until data arrives.  Other streams that can block
+	 *  forever must be unblocked before the adapter is destroyed, for
+	 *  example by closing the other end of the connection.  If one of
+	 *  them returns -1 instead, the producer tries again after
+	 *  @c retryInterval, or sooner if the adapter is destroyed.
+	 */
+	template <typename Stream>
+	class ReadAheadStreamAdapter {
+	public:
+	  /** @brief Default time the producer waits before reading again
+	   *         from a stream without fd() that returned -1
+	   */
+	  static constexpr const std::chrono::microseconds
+	      DEFAULT_RETRY_INTERVAL = std::chrono::microseconds(100);
+
+	  ReadAheadStreamAdapter(
+	      Stream&& stream, size_t queueDepth, size_t chunkSize,
+	      bool blocking = true,
+	      std::chrono::microseconds retryInterval = DEFAULT_RETRY_INTERVAL
+	  ):
+	      state_(new State_(std::move(stream), queueDepth, chunkSize,
+				blocking, retryInterval)) {
+	    state_->start();
+	  }
+	  ReadAheadStreamAdapter(const ReadAheadStreamAdapter&) = delete;
+	  ReadAheadStreamAdapter(ReadAheadStreamAdapter&&) = default;
+	  ~ReadAheadStreamAdapter() {
+	    if (state_) {
+	      state_->stop();
+	    }
+	  }
+
+	  size_t queueDepth() const { return state_->slots.size(); }
+	  size_t chunkSize() const { return state_->chunkSize; }
+	  std::chrono::microseconds retryInterval() const {
+	    return state_->retryInterval;
+	  }
+
+	  ssize_t read(char* buffer, size_t n) {
+	    return state_->read(buffer, n);
+	  }
+
+	  ReadAheadStreamAdapter& operator=(const ReadAheadStreamAdapter&)
+	      = delete;
+	  ReadAheadStreamAdapter& operator=(ReadAheadStreamAdapter&& other) {
+	    if (this != &other) {
+	      if (state_) {
+		state_->stop();
+	      }
+	      state_ = std::move(other.state_);
+	    }
+	    return *this;
+	  }
+
+	private:
+	  struct Slot_ {
+	    std::unique_ptr<char[]> data;
+	    size_t size;
+	    bool endOfStream;
+	    std::exception_ptr error;
+
+	    Slot_(size_t chunkSize):
+	        data(new char[chunkSize]), size(0), endOfStream(false),
+	        error() {
+	    }
+	  };
+
+	  /** @brief State shared by the producer and consumer.  Lives on the
+	   *         heap so the adapter can be moved while the producer is
+	   *         running.
+	   */
+	  struct State_ {
+	    static constexpr const bool POLL = HasFileDescriptor<Stream>::value;
+
+	    Stream stream;
+	    std::vector<Slot_> slots;
+	    const size_t chunkSize;
+	    const bool blocking;
+	    const std::chrono::microseconds retryInterval;
+
+	    // Number of chunks the producer has filled and the consumer has
+	    // finished with.  Slot (n % slots.size()) holds chunk n.
+	    std::atomic<uint64_t> produced;
+	    std::atomic<uint64_t> consumed;
+	    std::atomic<bool> producerWaiting;
+	    std::atomic<bool> consumerWaiting;
+	    std::atomic<bool> stopping;
+	    std::mutex mutex;
+	    std::condition_variable wakeup;
+	    std::thread producer;
+
+	    // Consumer's position in the chunk at the front of the ring
+	    size_t readOffset;
+	    bool finished;
+
+	    // Pipe stop() writes to, to interrupt the producer's poll()
+	    int stopPipe[2];
+
+	    State_(Stream&& s, size_t queueDepth, size_t size, bool block,
+		   std::chrono::microseconds retry):
+	        stream(std::move(s)), slots(), chunkSize(size),
+	        blocking(block), retryInterval(retry), produced(0),
+	        consumed(0), producerWaiting(false), consumerWaiting(false),
+	        stopping(false), mutex(), wakeup(), producer(),
+	        readOffset(0), finished(false), stopPipe{ -1, -1 } {
+	      if (!queueDepth || !chunkSize) {
+		throw pistis::exceptions::IllegalValueError(
+		    "Read-ahead queue depth and chunk size must be nonzero",
+		    PISTIS_EX_HERE
+		);
+	      }
+	      slots.reserve(queueDepth);
+	      for (size_t i = 0; i < queueDepth; ++i) {
+		slots.emplace_back(chunkSize);
+	      }
+	      if (POLL && ::pipe2(stopPipe, O_CLOEXEC | O_NONBLOCK)) {
+		throw pistis::exceptions::IOError(
+		    std::string("Cannot create pipe: ") + ::strerror(errno),
+		    PISTIS_EX_HERE
+		);
+	      }
+	    }
+
+	    ~State_() {
+	      if (stopPipe[0] >= 0) {
+		::close(stopPipe[0]);
+		::close(stopPipe[1]);
+	      }
+	    }
+
+	    void start() {
+	      producer = std::thread([this]() { this->produce(); });
+	    }
+
+	    void stop() {
+	      stopping.store(true);
+	      {
+		std::lock_guard<std::mutex> lock(mutex);
+		wakeup.notify_all();
+	      }
+	      if (POLL) {
+		const char c = 0;
+		while ((::write(stopPipe[1], &c, 1) < 0) && (errno == EINTR)) {
+		}
+	      }
+	      if (producer.joinable()) {
+		producer.join();
+	      }
+	    }
+
+	    ssize_t read(char* buffer, size_t n) {
+	      if (finished) {
+		return 0;
+	      }
+
+	      const uint64_t front = consumed.load(std::memory_order_relaxed);
+	      if (produced.load(std::memory_order_acquire) == front) {
+		if (!blocking) {
+		  return -1;
+		}
+		waitUntil_(consumerWaiting, [this, front]() {
+		  return produced.load(std::memory_order_acquire) != front;
+		});
+	      }
+
+	      Slot_& slot = slots[front % slots.size()];
+	      if (slot.error) {
+		finished = true;
+		std::rethrow_exception(slot.error);
+	      } else if (slot.endOfStream) {
+		finished = true;
+		return 0;
+	      }
+
+	      const size_t numToCopy = std::min(n, slot.size - readOffset);
+	      ::memcpy(buffer, slot.data.get() + readOffset, numToCopy);
+	      readOffset += numToCopy;
+	      if (readOffset == slot.size) {
+		readOffset = 0;
+		consumed.store(front + 1);
+		if (producerWaiting.load()) {
+		  std::lock_guard<std::mutex> lock(mutex);
+		  wakeup.notify_all();
+		}
+	      }
+	      return numToCopy;
+	    }
+
+	    void produce() {
+	      uint64_t next = 0;
+	      while (!stopping.load(std::memory_order_relaxed)) {
+		if ((next - consumed.load(std::memory_order_acquire)) ==
+		        slots.size()) {
+		  waitUntil_(producerWaiting, [this, next]() {
+		    return stopping.load() ||
+		           ((next - consumed.load(std::memory_order_acquire)) <
+			    slots.size());
+		  });
+		  continue;
+		}
+
+		Slot_& slot = slots[next % slots.size()];
+		if (!fill_(slot)) {
+		  continue;
+		}
+		produced.store(++next);
+		if (consumerWaiting.load()) {
+		  std::lock_guard<std::mutex> lock(mutex);
+		  wakeup.notify_all();
+		}
+		if (slot.endOfStream || slot.error) {
+		  return;
+		}
+	      }
+	    }
+
+	  private:
+	    /** @brief Read the next chunk into @c slot.  Returns false if
+	     *         the wrapped stream had no data yet, or the adapter is
+	     *         stopping.
+	     */
+	    bool fill_(Slot_& slot) {
+	      slot.size = 0;
+	      slot.endOfStream = false;
+	      try {
+		if (POLL && !waitForData_()) {
+		  return false;
+		}
+		const ssize_t n = stream.read(slot.data.get(), chunkSize);
+		if (n < 0) {
+		  if (!POLL) {
+		    std::unique_lock<std::mutex> lock(mutex);
+		    wakeup.wait_for(lock, retryInterval,
+				    [this]() { return stopping.load(); });
+		  }
+		  return false;
+		}
+		slot.size = n;
+		slot.endOfStream = !n;
+	      } catch(...) {
+		slot.error = std::current_exception();
+	      }
+	      return true;
+	    }
+
+	    /** @brief Wait until the wrapped stream's descriptor is
+	     *         readable.  Returns false if stop() interrupted the
+	     *         wait.
+	     */
+	    bool waitForData_() {
+	      if constexpr (POLL) {
+		pollfd fds[2] = {
+		  { stream.fd(), POLLIN, 0 }, { stopPipe[0], POLLIN, 0 }
+		};
+		while (::poll(fds, 2, -1) < 0) {
+		  if (errno != EINTR) {
+		    throw pistis::exceptions::IOError(
+			std::string("poll() failed: ") + ::strerror(errno),
+			PISTIS_EX_HERE
+		    );
+		  }
+		}
+		// Errors and hangups are left for read() to report
+		return !fds[1].revents;
+	      }
+	      return true;
+	    }
+
+	    /** @brief Sleep until @c ready returns true.
+	     *
+	     *  @c waiting is set before @c ready is checked again, and the
+	     *  other thread checks it after publishing its progress, so
+	     *  either this thread sees the progress or the other thread sees
+	     *  the flag and wakes it.
+	     */
+	    template <typename Predicate>
+	    void waitUntil_(std::atomic<bool>& waiting, Predicate ready) {
+	      std::unique_lock<std::mutex> lock(mutex);
+	      waiting.store(true);
+	      wakeup.wait(lock, [this, &ready]() {
+		return ready() || stopping.load();
+	      });
+	      waiting.store(false);
+	    }
+	  };
+
+	  std::unique_ptr<State_> state_;
+	};
+
+      }
+    }
+  }
+}
+#endif
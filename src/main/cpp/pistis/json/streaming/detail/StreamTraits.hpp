@@ -0,0 +1,62 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__STREAMTRAITS_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__STREAMTRAITS_HPP__
+
+#include <type_traits>
+#include <utility>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief True if @c Stream holds its entire content in memory that
+	 *         stays put for as long as the stream exists.
+	 *
+	 *  Such a stream has begin() and end() methods that return
+	 *  const char*, in addition to the read() method all streams have.
+	 *  FlexibleStreamReader parses these streams in place,
+	 *  without copying their content into a buffer, and the payloads it
+	 *  returns for them stay valid for the life of the stream (except
+	 *  for strings with escape sequences, which are decoded into a
+	 *  separate buffer).
+	 */
+	template <typename Stream, typename = void>
+	struct IsContiguousStream : std::false_type { };
+
+	template <typename Stream>
+	struct IsContiguousStream<
+	    Stream,
+	    typename std::enable_if<
+	        std::is_same<decltype(std::declval<const Stream&>().begin()),
+			     const char*>::value &&
+	        std::is_same<decltype(std::declval<const Stream&>().end()),
+			     const char*>::value
+	    >::type
+	> : std::true_type {
+	};
+
+	/** @brief True if @c Stream reads from a file descriptor, which
+	 *         its fd() method returns.
+	 *
+	 *  ReadAheadStreamAdapter waits for such a stream with poll()
+	 *  instead of calling read() blindly, so it can stop without
+	 *  waiting for data that may never come.
+	 */
+	template <typename Stream, typename = void>
+	struct HasFileDescriptor : std::false_type { };
+
+	template <typename Stream>
+	struct HasFileDescriptor<
+	    Stream,
+	    typename std::enable_if<
+	        std::is_same<decltype(std::declval<const Stream&>().fd()),
+			     int>::value
+	    >::type
+	> : std::true_type {
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,505 @@
+#ifndef __PISTIS__JSON__STREAMING__DETAIL__URINGFDSTREAMADAPTER_HPP__
+#define __PISTIS__JSON__STREAMING__DETAIL__URINGFDSTREAMADAPTER_HPP__
+
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+// IORING_FEAT_RW_CUR_POS arrived with the same release (5.6) as the
+// IORING_REGISTER_PROBE enumerator, which the preprocessor cannot see
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define PISTIS_JSON_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace detail {
+
+	/** @brief Stream that reads a file descriptor through io_uring.
+	 *
+	 *  The adapter keeps @c queueDepth reads of @c chunkSize bytes in
+	 *  flight at consecutive offsets of the file, so the kernel is
+	 *  already reading the next chunks while the parser works on the
+	 *  current one.  The chunk buffers are registered with the ring,
+	 *  which saves the kernel from pinning and unpinning the pages of
+	 *  the buffer on every read.  Once the ring is running, read()
+	 *  makes one system call per chunk to queue the next read, and a
+	 *  second one only when the parser catches up with the disk.
+	 *
+	 *  Reads are issued at explicit offsets, starting at the current
+	 *  offset of the file descriptor, and do not move that offset.  If
+	 *  the descriptor is not a regular file, or the kernel does not
+	 *  support io_uring or forbids it (as seccomp profiles often do), or
+	 *  setting up the ring fails for any other reason, the adapter
+	 *  quietly falls back to calling read() on the descriptor, just like
+	 *  FdStreamAdapter.  In that case read() returns -1 if the
+	 *  descriptor is nonblocking and has no data, and the parser reports
+	 *  AGAIN.  usingIoUring() reports which path the adapter took.
+	 *
+	 *  The constructors that take a file name open the file and close
+	 *  it when the adapter is destroyed.  The ones that take a
+	 *  descriptor leave it open.
+	 */
+	class UringFdStreamAdapter {
+	public:
+	  static constexpr const uint32_t DEFAULT_QUEUE_DEPTH = 4;
+	  static constexpr const size_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+	public:
+	  UringFdStreamAdapter(const std::string& filename):
+	      UringFdStreamAdapter(filename, DEFAULT_QUEUE_DEPTH,
+				   DEFAULT_CHUNK_SIZE) {
+	  }
+
+	  UringFdStreamAdapter(const std::string& filename,
+			       uint32_t queueDepth, size_t chunkSize):
+	      name_(filename), fd_(::open(filename.c_str(), O_RDONLY)),
+	      ownsFd_(true), ring_() {
+	    if (fd_ < 0) {
+	      error_("Could not open", name_, errno);
+	    }
+	    try {
+	      start_(queueDepth, chunkSize);
+	    } catch(...) {
+	      ::close(fd_);
+	      throw;
+	    }
+	  }
+
+	  UringFdStreamAdapter(const std::string& name, int fd):
+	      UringFdStreamAdapter(name, fd, DEFAULT_QUEUE_DEPTH,
+				   DEFAULT_CHUNK_SIZE) {
+	  }
+
+	  UringFdStreamAdapter(const std::string& name, int fd,
+			       uint32_t queueDepth, size_t chunkSize):
+	      name_(name), fd_(fd), ownsFd_(false), ring_() {
+	    start_(queueDepth, chunkSize);
+	  }
+
+	  UringFdStreamAdapter(const UringFdStreamAdapter&) = delete;
+	  UringFdStreamAdapter(UringFdStreamAdapter&& other):
+	      name_(std::move(other.name_)), fd_(other.fd_),
+	      ownsFd_(other.ownsFd_), ring_(std::move(other.ring_)) {
+	    other.fd_ = -1;
+	    other.ownsFd_ = false;
+	  }
+	  ~UringFdStreamAdapter() { close_(); }
+
+	  /** @brief True if reads go through io_uring, false if the
+	   *         adapter fell back to read().
+	   */
+	  bool usingIoUring() const { return (bool)ring_; }
+
+	  ssize_t read(char* buffer, size_t n) {
+#ifdef PISTIS_JSON_HAVE_IO_URING
+	    if (ring_) {
+	      return ring_->read(buffer, n, name_);
+	    }
+#endif
+	    while (true) {
+	      const ssize_t numRead = ::read(fd_, buffer, n);
+	      if (numRead >= 0) {
+		return numRead;
+	      } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+		return -1;
+	      } else if (errno != EINTR) {
+		error_("Could not read", name_, errno);
+	      }
+	    }
+	  }
+
+	  UringFdStreamAdapter& operator=(const UringFdStreamAdapter&)
+	      = delete;
+	  UringFdStreamAdapter& operator=(UringFdStreamAdapter&& other) {
+	    if (this != &other) {
+	      close_();
+	      name_ = std::move(other.name_);
+	      fd_ = other.fd_;
+	      ownsFd_ = other.ownsFd_;
+	      ring_ = std::move(other.ring_);
+	      other.fd_ = -1;
+	      other.ownsFd_ = false;
+	    }
+	    return *this;
+	  }
+
+	private:
+#ifdef PISTIS_JSON_HAVE_IO_URING
+	  /** @brief A chunk buffer and the read that fills it */
+	  struct Slot_ {
+	    char* data;
+	    uint64_t offset;
+	    uint32_t requested;
+	    int32_t result;
+	    bool complete;
+	  };
+
+	  /** @brief The io_uring instance, its shared rings and the chunk
+	   *         buffers.
+	   *
+	   *  Each slot has at most one read in flight, so the submission
+	   *  queue, which has one entry per slot, never fills up.  Slots are
+	   *  consumed in order; completions that arrive out of order wait in
+	   *  their slots until the parser reaches them.
+	   */
+	  class Ring_ {
+	  public:
+	    Ring_(): ringFd_(-1), fd_(-1), sqRing_(MAP_FAILED),
+		     sqRingSize_(0), cqRing_(MAP_FAILED), cqRingSize_(0),
+		     sqes_(nullptr),
+		     sqesSize_(0), sqTail_(nullptr), sqMask_(nullptr),
+		     sqArray_(nullptr), cqHead_(nullptr), cqTail_(nullptr),
+		     cqMask_(nullptr), cqes_(nullptr), buffers_(nullptr),
+		     fixedBuffers_(false), slots_(), nextOffset_(0), front_(0),
+		     readOffset_(0), inFlight_(0), finished_(false) {
+	    }
+	    Ring_(const Ring_&) = delete;
+	    ~Ring_() {
+	      if (ringFd_ >= 0) {
+		// The kernel may still be writing into the buffers
+		try {
+		  while (inFlight_) {
+		    waitForCompletion_();
+		  }
+		} catch(...) {
+		}
+		::close(ringFd_);
+	      }
+	      if (sqes_) {
+		::munmap(sqes_, sqesSize_);
+	      }
+	      if ((cqRing_ != MAP_FAILED) && (cqRing_ != sqRing_)) {
+		::munmap(cqRing_, cqRingSize_);
+	      }
+	      if (sqRing_ != MAP_FAILED) {
+		::munmap(sqRing_, sqRingSize_);
+	      }
+	      ::free(buffers_);
+	    }
+
+	    /** @brief Set up the ring and queue the first reads.  Returns
+	     *         false if io_uring cannot be used.
+	     */
+	    bool start(int fd, uint64_t offset, uint32_t queueDepth,
+		       size_t chunkSize) {
+	      if (!setUp_(queueDepth) || !probe_() ||
+		  !allocateBuffers_(queueDepth, chunkSize)) {
+		return false;
+	      }
+	      fd_ = fd;
+	      nextOffset_ = offset;
+	      try {
+		for (uint32_t i = 0; i < slots_.size(); ++i) {
+		  submit_(i, nextOffset_, chunkSize);
+		  nextOffset_ += chunkSize;
+		}
+	      } catch(...) {
+		return false;
+	      }
+	      return true;
+	    }
+
+	    ssize_t read(char* buffer, size_t n, const std::string& name) {
+	      if (finished_) {
+		return 0;
+	      }
+
+	      Slot_& slot = slots_[front_];
+	      while (!slot.complete) {
+		waitForCompletion_();
+	      }
+	      if (slot.result < 0) {
+		if ((slot.result != -EAGAIN) && (slot.result != -EINTR)) {
+		  finished_ = true;
+		  error_("Could not read", name, -slot.result);
+		}
+		submit_(front_, slot.offset, slot.requested);
+		return read(buffer, n, name);
+	      } else if (!slot.result) {
+		finished_ = true;
+		return 0;
+	      }
+
+	      const size_t numToCopy =
+		  std::min(n, (size_t)slot.result - readOffset_);
+	      ::memcpy(buffer, slot.data + readOffset_, numToCopy);
+	      readOffset_ += numToCopy;
+	      if (readOffset_ == (size_t)slot.result) {
+		readOffset_ = 0;
+		if ((uint32_t)slot.result < slot.requested) {
+		  // Short read.  The next slot's read starts after the end
+		  // of this one, so read the rest of this chunk first.
+		  submit_(front_, slot.offset + slot.result,
+			  slot.requested - slot.result);
+		} else {
+		  submit_(front_, nextOffset_, slot.requested);
+		  nextOffset_ += slot.requested;
+		  front_ = (front_ + 1) % slots_.size();
+		}
+	      }
+	      return numToCopy;
+	    }
+
+	  private:
+	    int ringFd_;
+	    int fd_;
+	    void* sqRing_;
+	    size_t sqRingSize_;
+	    void* cqRing_;
+	    size_t cqRingSize_;
+	    io_uring_sqe* sqes_;
+	    size_t sqesSize_;
+	    unsigned* sqTail_;
+	    unsigned* sqMask_;
+	    unsigned* sqArray_;
+	    unsigned* cqHead_;
+	    unsigned* cqTail_;
+	    unsigned* cqMask_;
+	    io_uring_cqe* cqes_;
+	    char* buffers_;
+	    bool fixedBuffers_;
+	    std::vector<Slot_> slots_;
+	    uint64_t nextOffset_;
+	    size_t front_;
+	    size_t readOffset_;
+	    uint32_t inFlight_;
+	    bool finished_;
+
+	    bool setUp_(uint32_t queueDepth) {
+	      io_uring_params params;
+	      ::memset(&params, 0, sizeof(params));
+	      ringFd_ = (int)::syscall(__NR_io_uring_setup, queueDepth,
+				       &params);
+	      if (ringFd_ < 0) {
+		return false;
+	      }
+
+	      sqRingSize_ = params.sq_off.array +
+		            params.sq_entries * sizeof(unsigned);
+	      cqRingSize_ = params.cq_off.cqes +
+		            params.cq_entries * sizeof(io_uring_cqe);
+	      const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+	      if (singleMap) {
+		sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+	      }
+
+	      sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+			       MAP_SHARED | MAP_POPULATE, ringFd_,
+			       IORING_OFF_SQ_RING);
+	      if (sqRing_ == MAP_FAILED) {
+		return false;
+	      }
+	      cqRing_ = singleMap ? sqRing_
+		                  : ::mmap(nullptr, cqRingSize_,
+					   PROT_READ | PROT_WRITE,
+					   MAP_SHARED | MAP_POPULATE, ringFd_,
+					   IORING_OFF_CQ_RING);
+	      if (cqRing_ == MAP_FAILED) {
+		return false;
+	      }
+	      sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+	      void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+				  MAP_SHARED | MAP_POPULATE, ringFd_,
+				  IORING_OFF_SQES);
+	      if (sqes == MAP_FAILED) {
+		return false;
+	      }
+	      sqes_ = (io_uring_sqe*)sqes;
+
+	      char* const sq = (char*)sqRing_;
+	      char* const cq = (char*)cqRing_;
+	      sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+	      sqMask_ = (unsigned*)(sq + params.sq_off.ring_mask);
+	      sqArray_ = (unsigned*)(sq + params.sq_off.array);
+	      cqHead_ = (unsigned*)(cq + params.cq_off.head);
+	      cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+	      cqMask_ = (unsigned*)(cq + params.cq_off.ring_mask);
+	      cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+	      return true;
+	    }
+
+	    /** @brief Check that the kernel supports the reads the adapter
+	     *         issues.
+	     */
+	    bool probe_() {
+	      const size_t size =
+		  sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+	      std::unique_ptr<char[]> storage(new char[size]);
+	      ::memset(storage.get(), 0, size);
+	      io_uring_probe* probe = (io_uring_probe*)storage.get();
+	      if (::syscall(__NR_io_uring_register, ringFd_,
+			    IORING_REGISTER_PROBE, probe, 256) < 0) {
+		return false;
+	      }
+	      return (probe->last_op >= IORING_OP_READ) &&
+		     (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+		     && (probe->ops[IORING_OP_READ_FIXED].flags &
+			 IO_URING_OP_SUPPORTED);
+	    }
+
+	    bool allocateBuffers_(uint32_t queueDepth, size_t chunkSize) {
+	      const size_t pageSize = ::sysconf(_SC_PAGESIZE);
+	      const size_t slotSize =
+		  (chunkSize + pageSize - 1) / pageSize * pageSize;
+	      if (::posix_memalign((void**)&buffers_, pageSize,
+				   slotSize * queueDepth)) {
+		buffers_ = nullptr;
+		return false;
+	      }
+
+	      std::vector<iovec> iovecs(queueDepth);
+	      slots_.resize(queueDepth);
+	      for (uint32_t i = 0; i < queueDepth; ++i) {
+		slots_[i].data = buffers_ + i * slotSize;
+		slots_[i].offset = 0;
+		slots_[i].requested = 0;
+		slots_[i].result = 0;
+		slots_[i].complete = false;
+		iovecs[i].iov_base = slots_[i].data;
+		iovecs[i].iov_len = chunkSize;
+	      }
+
+	      // Registration can fail if the buffers exceed RLIMIT_MEMLOCK.
+	      // Ordinary reads into the same buffers still work.
+	      fixedBuffers_ =
+		  ::syscall(__NR_io_uring_register, ringFd_,
+			    IORING_REGISTER_BUFFERS, iovecs.data(),
+			    queueDepth) >= 0;
+	      return true;
+	    }
+
+	    void submit_(uint32_t index, uint64_t offset, uint32_t size) {
+	      Slot_& slot = slots_[index];
+	      slot.offset = offset;
+	      slot.requested = size;
+	      slot.result = 0;
+	      slot.complete = false;
+
+	      const unsigned tail = *sqTail_;
+	      const unsigned i = tail & *sqMask_;
+	      io_uring_sqe* sqe = sqes_ + i;
+	      ::memset(sqe, 0, sizeof(io_uring_sqe));
+	      sqe->opcode = fixedBuffers_ ? IORING_OP_READ_FIXED
+		                          : IORING_OP_READ;
+	      sqe->fd = fd_;
+	      sqe->off = offset;
+	      sqe->addr = (uint64_t)(uintptr_t)slot.data;
+	      sqe->len = size;
+	      sqe->buf_index = fixedBuffers_ ? index : 0;
+	      sqe->user_data = index;
+	      sqArray_[i] = i;
+	      __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+	      while (::syscall(__NR_io_uring_enter, ringFd_, 1, 0, 0,
+			       nullptr, 0) < 0) {
+		if ((errno != EINTR) && (errno != EAGAIN)) {
+		  error_("Could not submit read for", "file", errno);
+		}
+	      }
+	      ++inFlight_;
+	    }
+
+	    /** @brief Record every completion in the completion queue,
+	     *         waiting for one if the queue is empty.
+	     */
+	    void waitForCompletion_() {
+	      unsigned head = *cqHead_;
+	      while (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+		if ((::syscall(__NR_io_uring_enter, ringFd_, 0, 1,
+			       IORING_ENTER_GETEVENTS, nullptr, 0) < 0) &&
+		    (errno != EINTR) && (errno != EAGAIN)) {
+		  error_("Could not wait for read from", "file", errno);
+		}
+	      }
+	      do {
+		const io_uring_cqe& cqe = cqes_[head & *cqMask_];
+		Slot_& slot = slots_[cqe.user_data];
+		slot.result = cqe.res;
+		slot.complete = true;
+		--inFlight_;
+		++head;
+	      } while (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE));
+	      __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+	    }
+	  };
+#else
+	  class Ring_ {
+	  public:
+	    bool start(int, uint64_t, uint32_t, size_t) { return false; }
+	  };
+#endif
+
+	  std::string name_;
+	  int fd_;
+	  bool ownsFd_;
+	  std::unique_ptr<Ring_> ring_;
+
+	  void start_(uint32_t queueDepth, size_t chunkSize) {
+	    if (!queueDepth || !chunkSize || (chunkSize > 0x7FFFFFFF)) {
+	      throw pistis::exceptions::IllegalValueError(
+		  "io_uring queue depth and chunk size must be nonzero and "
+		  "the chunk size must be less than 2GB",
+		  PISTIS_EX_HERE
+	      );
+	    }
+
+	    struct stat info;
+	    if (::fstat(fd_, &info) < 0) {
+	      error_("Could not stat", name_, errno);
+	    }
+	    if (!S_ISREG(info.st_mode)) {
+	      return;
+	    }
+	    const off_t offset = ::lseek(fd_, 0, SEEK_CUR);
+	    if (offset < 0) {
+	      return;
+	    }
+
+	    ring_.reset(new Ring_());
+	    if (!ring_->start(fd_, offset, queueDepth, chunkSize)) {
+	      ring_.reset();
+	    }
+	  }
+
+	  void close_() {
+	    ring_.reset();
+	    if (ownsFd_ && (fd_ >= 0)) {
+	      ::close(fd_);
+	    }
+	    fd_ = -1;
+	  }
+
+	  [[noreturn]] static void error_(const char* action,
+					  const std::string& name, int err) {
+	    std::ostringstream msg;
+	    msg << action << " " << (name.empty() ? "file" : name) << ": "
+		<< ::strerror(err);
+	    throw pistis::exceptions::IOError(msg.str(), PISTIS_EX_HERE);
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
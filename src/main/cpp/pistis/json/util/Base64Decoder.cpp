@@ -0,0 +1,249 @@
+#include "Base64Decoder.hpp"
+#include "CpuFeatures.hpp"
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <atomic>
+#include <sstream>
+
+#ifdef PISTIS_JSON_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace pistis::exceptions;
+using namespace pistis::json::util;
+
+namespace {
+  typedef const char* (*DecodeBase64Fn)(const char*, const char*,
+					uint8_t*);
+
+  static const uint8_t INVALID = 0xFF;
+
+  /** @brief Six-bit value of each character of the base64 alphabet, and
+   *         INVALID for every other character.
+   */
+  struct Base64Table {
+    uint8_t values[256];
+
+    Base64Table() {
+      static const char ALPHABET[] =
+	  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      for (int i = 0; i < 256; ++i) {
+	values[i] = INVALID;
+      }
+      for (int i = 0; i < 64; ++i) {
+	values[(uint8_t)ALPHABET[i]] = i;
+      }
+    }
+
+    uint8_t operator[](char c) const { return values[(uint8_t)c]; }
+  };
+
+  const Base64Table BASE64;
+
+  const char* decodeBase64Scalar(const char* p, const char* end,
+				 uint8_t* out) {
+    while ((end - p) >= 4) {
+      const uint32_t a = BASE64[p[0]];
+      const uint32_t b = BASE64[p[1]];
+      const uint32_t c = BASE64[p[2]];
+      const uint32_t d = BASE64[p[3]];
+      if ((a | b | c | d) == INVALID) {
+	break;
+      }
+      const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+      out[0] = (uint8_t)(v >> 16);
+      out[1] = (uint8_t)(v >> 8);
+      out[2] = (uint8_t)v;
+      p += 4;
+      out += 3;
+    }
+    return p;
+  }
+
+#ifdef PISTIS_JSON_X86_SIMD
+  /** @brief Decode 32 characters at a time.
+   *
+   *  Each character is validated and translated to its six-bit value
+   *  with three 16-entry tables indexed by the character's high and low
+   *  nibbles.  A character is valid when the entries for its two
+   *  nibbles have no bit in common.  Adjacent values are then merged
+   *  into 24-bit groups with two multiply-adds and packed together with
+   *  shuffles.  The block that contains the first invalid character is
+   *  left to the scalar kernel.
+   */
+  __attribute__((target("avx2")))
+  const char* decodeBase64Avx2(const char* p, const char* end,
+			       uint8_t* out) {
+    const __m256i lutLo = _mm256_setr_epi8(
+	0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+	0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+    );
+    const __m256i lutHi = _mm256_setr_epi8(
+	0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+	0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+    );
+    const __m256i lutRoll = _mm256_setr_epi8(
+	0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+    );
+    const __m256i slash = _mm256_set1_epi8(0x2F);
+    const __m256i mergePairs = _mm256_set1_epi32(0x01400140);
+    const __m256i mergeGroups = _mm256_set1_epi32(0x00011000);
+    const __m256i pack = _mm256_setr_epi8(
+	2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+    );
+    const __m256i packLanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    while ((end - p) >= 32) {
+      const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+
+      // Masking with 0x2F rather than 0x0F lets the same constant find
+      // the '/' characters.  The shuffles ignore bit 5.
+      const __m256i hiNibbles =
+	  _mm256_and_si256(_mm256_srli_epi32(v, 4), slash);
+      const __m256i loNibbles = _mm256_and_si256(v, slash);
+      const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+      const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+      if (!_mm256_testz_si256(lo, hi)) {
+	break;
+      }
+
+      const __m256i roll = _mm256_shuffle_epi8(
+	  lutRoll, _mm256_add_epi8(_mm256_cmpeq_epi8(v, slash), hiNibbles)
+      );
+      const __m256i values = _mm256_add_epi8(v, roll);
+      const __m256i merged = _mm256_madd_epi16(
+	  _mm256_maddubs_epi16(values, mergePairs), mergeGroups
+      );
+      const __m256i packed = _mm256_permutevar8x32_epi32(
+	  _mm256_shuffle_epi8(merged, pack), packLanes
+      );
+
+      _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(packed));
+      _mm_storel_epi64((__m128i*)(out + 16),
+		       _mm256_extracti128_si256(packed, 1));
+      p += 32;
+      out += 24;
+    }
+    return decodeBase64Scalar(p, end, out);
+  }
+#endif
+
+  const char* resolveDecodeBase64(const char* p, const char* end,
+				  uint8_t* out);
+
+  /** @brief Kernel used by decodeBase64Run().  Resolved on first use.
+   *
+   *  The translation needs byte shuffles, which SSE2 lacks, so CPUs
+   *  without AVX2 use the scalar kernel.
+   */
+  std::atomic<DecodeBase64Fn> decodeBase64Impl(&resolveDecodeBase64);
+
+  const char* resolveDecodeBase64(const char* p, const char* end,
+				  uint8_t* out) {
+    DecodeBase64Fn f = &decodeBase64Scalar;
+    switch (simdLevel()) {
+#ifdef PISTIS_JSON_X86_SIMD
+      case SimdLevel::AVX512:
+      case SimdLevel::AVX2:
+	f = &decodeBase64Avx2;
+	break;
+#endif
+
+      default:
+	break;
+    }
+    decodeBase64Impl.store(f, std::memory_order_relaxed);
+    return f(p, end, out);
+  }
+
+  [[noreturn]] void invalidBase64(const char* what, uint64_t offset) {
+    std::ostringstream msg;
+    msg << what << " at offset " << offset << " of base64 text";
+    throw IllegalValueError(msg.str(), PISTIS_EX_HERE);
+  }
+}
+
+const char* pistis::json::util::decodeBase64Run(const char* p,
+						const char* end,
+						uint8_t* out) {
+  return decodeBase64Impl.load(std::memory_order_relaxed)(p, end, out);
+}
+
+size_t Base64Decoder::decode(const char* p, const char* end,
+			     uint8_t* out) {
+  uint8_t* const start = out;
+
+  while (p != end) {
+    if (!numPending_ && !numPadding_) {
+      // At the start of a group, so decode as many whole groups as
+      // possible at once
+      const char* next = decodeBase64Run(p, end, out);
+      out += (next - p) / 4 * 3;
+      numDecoded_ += next - p;
+      p = next;
+      if (p == end) {
+	break;
+      }
+    }
+    out += decodeChar_(*p++, out);
+  }
+  return out - start;
+}
+
+size_t Base64Decoder::finish(uint8_t* out) {
+  if (numPending_ == 1) {
+    invalidBase64("Text ends in the middle of a group", numDecoded_);
+  }
+  const size_t n = flush_(out, numPending_);
+  reset();
+  return n;
+}
+
+size_t Base64Decoder::decodeChar_(char c, uint8_t* out) {
+  const uint64_t offset = numDecoded_++;
+
+  if (numPadding_ && !numPending_) {
+    invalidBase64("Text follows the padding", offset);
+  } else if (c == '=') {
+    if (numPending_ < 2) {
+      invalidBase64("Misplaced padding", offset);
+    }
+    if ((numPending_ + ++numPadding_) < 4) {
+      return 0;
+    }
+    const size_t n = flush_(out, numPending_);
+    numPending_ = 0;
+    return n;
+  }
+
+  const uint8_t value = BASE64[c];
+  if (value == INVALID) {
+    invalidBase64("Invalid character", offset);
+  } else if (numPadding_) {
+    invalidBase64("Text follows the padding", offset);
+  }
+
+  pending_[numPending_++] = value;
+  if (numPending_ < 4) {
+    return 0;
+  }
+  numPending_ = 0;
+  return flush_(out, 4);
+}
+
+size_t Base64Decoder::flush_(uint8_t* out, uint32_t numChars) {
+  // A group of n characters holds n - 1 whole bytes
+  uint32_t v = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    v = (v << 6) | ((i < numChars) ? pending_[i] : 0);
+  }
+  for (uint32_t i = 1; i < numChars; ++i) {
+    *out++ = (uint8_t)(v >> (24 - 8 * i));
+  }
+  return numChars ? numChars - 1 : 0;
+}
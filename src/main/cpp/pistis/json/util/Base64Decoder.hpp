@@ -0,0 +1,97 @@
+#ifndef __PISTIS__JSON__UTIL__BASE64DECODER_HPP__
+#define __PISTIS__JSON__UTIL__BASE64DECODER_HPP__
+
+#include <pistis/json/JsonString.hpp>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace util {
+
+      /** @brief Decode the base64 text starting at @c p, four characters
+       *         at a time, using the widest instruction set the CPU
+       *         supports.
+       *
+       *  Decodes whole groups of four characters from the standard
+       *  base64 alphabet and writes three bytes to @c out for each.
+       *  Stops at the first group that contains any other character,
+       *  including the '=' that pads the last group, or when fewer than
+       *  four characters are left.  Returns the location just past the
+       *  last group decoded, so (result - p) / 4 * 3 bytes were written.
+       */
+      const char* decodeBase64Run(const char* p, const char* end,
+				  uint8_t* out);
+
+      /** @brief Decodes base64 text that arrives in pieces.
+       *
+       *  Each call to decode() decodes as much of its text as it can
+       *  and keeps the one to three characters of an unfinished group
+       *  for the next call, so the pieces may be split anywhere.  Long
+       *  runs are decoded with decodeBase64Run().  Call finish() after
+       *  the last piece to decode the last group when it isn't padded.
+       *
+       *  Used with FlexibleEventStream::base64Payload(), this decodes
+       *  the STRING_CHUNK events of a long string straight from the
+       *  reader's buffers, so the string's text is never held in
+       *  memory all at once.
+       *
+       *  Characters outside the base64 alphabet, misplaced padding and
+       *  text that follows the padding throw
+       *  pistis::exceptions::IllegalValueError.
+       */
+      class Base64Decoder {
+      public:
+	Base64Decoder() { reset(); }
+
+	/** @brief Most bytes a call to decode() writes for @c n characters
+	 *         of text
+	 */
+	static size_t maxDecodedSize(size_t n) { return (n + 3) / 4 * 3; }
+
+	/** @brief Number of characters decoded so far */
+	uint64_t numDecoded() const { return numDecoded_; }
+
+	/** @brief Decode [p, end) and write the result to @c out.
+	 *
+	 *  @c out must have room for maxDecodedSize(end - p) bytes.
+	 *  Returns the number of bytes written.
+	 */
+	size_t decode(const char* p, const char* end, uint8_t* out);
+
+	size_t decode(const JsonString& text, uint8_t* out) {
+	  return decode(text.begin(), text.end(), out);
+	}
+
+	/** @brief Decode the last group of the text, if decode() has
+	 *         kept one, and get ready for new text.
+	 *
+	 *  Writes at most two bytes to @c out and returns the number
+	 *  written.
+	 */
+	size_t finish(uint8_t* out);
+
+	/** @brief Forget any text decode() has seen */
+	void reset() {
+	  numPending_ = 0;
+	  numPadding_ = 0;
+	  numDecoded_ = 0;
+	}
+
+      private:
+	// Six-bit values of the characters of an unfinished group
+	uint8_t pending_[4];
+	uint32_t numPending_;
+
+	// Number of '=' seen at the end of the last group
+	uint32_t numPadding_;
+	uint64_t numDecoded_;
+
+	size_t decodeChar_(char c, uint8_t* out);
+	size_t flush_(uint8_t* out, uint32_t numChars);
+      };
+
+    }
+  }
+}
+#endif
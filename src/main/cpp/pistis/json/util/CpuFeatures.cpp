@@ -0,0 +1,41 @@
+#include "CpuFeatures.hpp"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace pistis::json::util;
+
+namespace {
+  SimdLevel detectCpuSimdLevel() {
+#ifdef PISTIS_JSON_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+      return SimdLevel::AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+      return SimdLevel::AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+      return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+  }
+
+  SimdLevel detectSimdLevel() {
+    static const char* const NAMES[] = { "scalar", "sse2", "avx2", "avx512" };
+    const SimdLevel level = detectCpuSimdLevel();
+    const char* limit = ::getenv("PISTIS_JSON_SIMD_LEVEL");
+    if (limit) {
+      for (int i = 0; i < 4; ++i) {
+	if (!::strcmp(limit, NAMES[i])) {
+	  return std::min(level, (SimdLevel)i);
+	}
+      }
+    }
+    return level;
+  }
+}
+
+SimdLevel pistis::json::util::simdLevel() {
+  static const SimdLevel level = detectSimdLevel();
+  return level;
+}
@@ -0,0 +1,40 @@
+#ifndef __PISTIS__JSON__UTIL__CPUFEATURES_HPP__
+#define __PISTIS__JSON__UTIL__CPUFEATURES_HPP__
+
+/** @brief Defined when the x86 SIMD kernels can be compiled.
+ *
+ *  The kernels use the GCC/Clang "target" attribute, so the library can be
+ *  compiled for a baseline CPU and still use AVX2 or AVX-512 instructions
+ *  when the CPU it runs on supports them.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PISTIS_JSON_X86_SIMD 1
+#endif
+
+namespace pistis {
+  namespace json {
+    namespace util {
+
+      /** @brief Widest instruction set the SIMD scanners can use */
+      enum class SimdLevel {
+	SCALAR,  ///< No SIMD support; process one byte at a time
+	SSE2,    ///< 16 bytes at a time
+	AVX2,    ///< 32 bytes at a time
+	AVX512   ///< 64 bytes at a time (requires AVX-512BW)
+      };
+
+      /** @brief Returns the widest instruction set supported by the CPU
+       *         the library is running on.
+       *
+       *  The result is computed on the first call and cached.  Setting
+       *  the environment variable PISTIS_JSON_SIMD_LEVEL to "scalar",
+       *  "sse2", "avx2" or "avx512" caps the result at that level, so
+       *  the narrower kernels can be tested and compared on a CPU that
+       *  supports the wider ones.
+       */
+      SimdLevel simdLevel();
+
+    }
+  }
+}
+#endif
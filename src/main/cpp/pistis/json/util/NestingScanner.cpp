@@ -0,0 +1,291 @@
+#include "NestingScanner.hpp"
+#include "CpuFeatures.hpp"
+#include <atomic>
+
+#ifdef PISTIS_JSON_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace pistis::json::util;
+
+namespace {
+  typedef const char* (*SkipNestedFn)(const char*, const char*,
+				      NestingState&, NewlineCount&);
+
+  /** @brief Returns a mask of the characters escaped by a backslash.
+   *
+   *  A backslash escapes the next character unless it is escaped
+   *  itself, so in a run of backslashes only the character after an
+   *  odd-length run is escaped.  Adding the starts of the runs that
+   *  begin on odd bits to the backslash mask carries through each run
+   *  and flips the parity of the bit after it, which finds the
+   *  odd-length runs for all 64 bytes at once.  @c escaped carries the
+   *  state from one block to the next.
+   */
+  inline uint64_t findEscaped(uint64_t backslash, uint64_t& escaped) {
+    static constexpr const uint64_t EVEN_BITS = 0x5555555555555555ull;
+
+    backslash &= ~escaped;
+    const uint64_t followsEscape = (backslash << 1) | escaped;
+    const uint64_t oddSequenceStarts =
+	backslash & ~EVEN_BITS & ~followsEscape;
+    uint64_t sequencesStartingOnEvenBits;
+    escaped = __builtin_add_overflow(oddSequenceStarts, backslash,
+				     &sequencesStartingOnEvenBits);
+    const uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+    return (EVEN_BITS ^ invertMask) & followsEscape;
+  }
+
+  /** @brief Bit i of the result is the XOR of bits 0 through i of
+   *         @c x.  Turns a mask of quotes into a mask of the string
+   *         regions they enclose.
+   */
+  inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+  }
+
+  /** @brief Bitmaps of the characters skipNested() cares about in a
+   *         64-byte block
+   */
+  struct NestingBlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t open;     ///< '{' and '['
+    uint64_t close;    ///< '}' and ']'
+    uint64_t newline;
+  };
+
+  inline void countNewlines(const char* p, uint64_t mask,
+			    NewlineCount& newlines) {
+    if (mask) {
+      newlines.count += __builtin_popcountll(mask);
+      newlines.last = p + (63 - __builtin_clzll(mask));
+    }
+  }
+
+  /** @brief Skip the 64-byte block at @c p, given its masks.
+   *
+   *  Returns the offset of the bracket that closes the outermost open
+   *  object or array, or 64 if the block does not contain it.
+   */
+  inline uint32_t skipNestedBlock(const char* p, const NestingBlockMasks& m,
+				  NestingState& state,
+				  NewlineCount& newlines) {
+    const uint64_t escaped = findEscaped(m.backslash, state.escaped);
+    const uint64_t quote = m.quote & ~escaped;
+    const uint64_t inString = prefixXor(quote) ^ state.inString;
+    state.inString = (uint64_t)((int64_t)inString >> 63);
+
+    // A backslash outside a string is an error skipNested() doesn't
+    // report, but it escapes the next bracket, as in skipNestedScalar()
+    const uint64_t open = m.open & ~inString & ~escaped;
+    const uint64_t close = m.close & ~inString & ~escaped;
+    if ((uint32_t)__builtin_popcountll(close) < state.depth) {
+      // The depth can't reach zero in this block
+      state.depth += __builtin_popcountll(open);
+      state.depth -= __builtin_popcountll(close);
+      countNewlines(p, m.newline, newlines);
+      return 64;
+    }
+
+    for (uint64_t brackets = open | close; brackets;
+	 brackets &= brackets - 1) {
+      const uint32_t i = __builtin_ctzll(brackets);
+      if ((open >> i) & 1) {
+	++state.depth;
+      } else if (!--state.depth) {
+	// ~0ull >> (63 - i) is bits 0 through i
+	countNewlines(p, m.newline & (~0ull >> (63 - i)), newlines);
+	return i;
+      }
+    }
+    countNewlines(p, m.newline, newlines);
+    return 64;
+  }
+
+  /** @brief Same as skipNestedBlock(), one character at a time.  Treats
+   *         backslashes the same way findEscaped() does.
+   */
+  const char* skipNestedScalar(const char* p, const char* end,
+			       NestingState& state,
+			       NewlineCount& newlines) {
+    while (p != end) {
+      const char c = *p++;
+      if (c == '\n') {
+	++newlines.count;
+	newlines.last = p - 1;
+      }
+      if (state.escaped) {
+	state.escaped = 0;
+      } else if (c == '\\') {
+	state.escaped = 1;
+      } else if (c == '"') {
+	state.inString = ~state.inString;
+      } else if (!state.inString) {
+	if ((c == '{') || (c == '[')) {
+	  ++state.depth;
+	} else if (((c == '}') || (c == ']')) && !--state.depth) {
+	  return p;
+	}
+      }
+    }
+    return p;
+  }
+
+#ifdef PISTIS_JSON_X86_SIMD
+  __attribute__((target("sse2")))
+  const char* skipNestedSse2(const char* p, const char* end,
+			     NestingState& state, NewlineCount& newlines) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+
+    while ((end - p) >= 64) {
+      NestingBlockMasks m = { 0, 0, 0, 0, 0 };
+      for (uint32_t i = 0; i < 64; i += 16) {
+	const __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+	const __m128i folded = _mm_or_si128(v, caseBit);
+	m.quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+	    _mm_cmpeq_epi8(v, quote)
+	) << i;
+	m.backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+	    _mm_cmpeq_epi8(v, backslash)
+	) << i;
+	m.open |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+	    _mm_cmpeq_epi8(folded, openBrace)
+	) << i;
+	m.close |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+	    _mm_cmpeq_epi8(folded, closeBrace)
+	) << i;
+	m.newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+	    _mm_cmpeq_epi8(v, lf)
+	) << i;
+      }
+      const uint32_t n = skipNestedBlock(p, m, state, newlines);
+      if (n < 64) {
+	return p + n + 1;
+      }
+      p += 64;
+    }
+    return skipNestedScalar(p, end, state, newlines);
+  }
+
+  __attribute__((target("avx2")))
+  const char* skipNestedAvx2(const char* p, const char* end,
+			     NestingState& state, NewlineCount& newlines) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i openBrace = _mm256_set1_epi8('{');
+    const __m256i closeBrace = _mm256_set1_epi8('}');
+
+    while ((end - p) >= 64) {
+      NestingBlockMasks m = { 0, 0, 0, 0, 0 };
+      for (uint32_t i = 0; i < 64; i += 32) {
+	const __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+	const __m256i folded = _mm256_or_si256(v, caseBit);
+	m.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(v, quote)
+	) << i;
+	m.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(v, backslash)
+	) << i;
+	m.open |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(folded, openBrace)
+	) << i;
+	m.close |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(folded, closeBrace)
+	) << i;
+	m.newline |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+	    _mm256_cmpeq_epi8(v, lf)
+	) << i;
+      }
+      const uint32_t n = skipNestedBlock(p, m, state, newlines);
+      if (n < 64) {
+	return p + n + 1;
+      }
+      p += 64;
+    }
+    return skipNestedScalar(p, end, state, newlines);
+  }
+
+  __attribute__((target("avx512bw")))
+  const char* skipNestedAvx512(const char* p, const char* end,
+			       NestingState& state, NewlineCount& newlines) {
+    const __m512i quote = _mm512_set1_epi8('"');
+    const __m512i backslash = _mm512_set1_epi8('\\');
+    const __m512i lf = _mm512_set1_epi8('\n');
+    const __m512i caseBit = _mm512_set1_epi8(0x20);
+    const __m512i openBrace = _mm512_set1_epi8('{');
+    const __m512i closeBrace = _mm512_set1_epi8('}');
+
+    while ((end - p) >= 64) {
+      const __m512i v = _mm512_loadu_si512((const void*)p);
+      const __m512i folded = _mm512_or_si512(v, caseBit);
+      NestingBlockMasks m;
+      m.quote = _mm512_cmpeq_epi8_mask(v, quote);
+      m.backslash = _mm512_cmpeq_epi8_mask(v, backslash);
+      m.open = _mm512_cmpeq_epi8_mask(folded, openBrace);
+      m.close = _mm512_cmpeq_epi8_mask(folded, closeBrace);
+      m.newline = _mm512_cmpeq_epi8_mask(v, lf);
+
+      const uint32_t n = skipNestedBlock(p, m, state, newlines);
+      if (n < 64) {
+	return p + n + 1;
+      }
+      p += 64;
+    }
+    return skipNestedScalar(p, end, state, newlines);
+  }
+#endif
+
+  const char* resolveSkipNested(const char* p, const char* end,
+				NestingState& state, NewlineCount& newlines);
+
+  /** @brief Kernel used by skipNested().  Resolved on first use, like
+   *         the kernels in SimdScanner.cpp.
+   */
+  std::atomic<SkipNestedFn> skipNestedImpl(&resolveSkipNested);
+
+  const char* resolveSkipNested(const char* p, const char* end,
+				NestingState& state, NewlineCount& newlines) {
+    SkipNestedFn f = &skipNestedScalar;
+    switch (simdLevel()) {
+#ifdef PISTIS_JSON_X86_SIMD
+      case SimdLevel::AVX512:
+	f = &skipNestedAvx512;
+	break;
+
+      case SimdLevel::AVX2:
+	f = &skipNestedAvx2;
+	break;
+
+      case SimdLevel::SSE2:
+	f = &skipNestedSse2;
+	break;
+#endif
+
+      default:
+	break;
+    }
+    skipNestedImpl.store(f, std::memory_order_relaxed);
+    return f(p, end, state, newlines);
+  }
+}
+
+const char* pistis::json::util::skipNested(const char* p, const char* end,
+					   NestingState& state,
+					   NewlineCount& newlines) {
+  return skipNestedImpl.load(std::memory_order_relaxed)(p, end, state,
+						       newlines);
+}
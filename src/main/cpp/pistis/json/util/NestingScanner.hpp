@@ -0,0 +1,49 @@
+#ifndef __PISTIS__JSON__UTIL__NESTINGSCANNER_HPP__
+#define __PISTIS__JSON__UTIL__NESTINGSCANNER_HPP__
+
+#include <pistis/json/util/SimdScanner.hpp>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace util {
+
+      /** @brief State carried from one call to skipNested() to the next */
+      struct NestingState {
+	/** @brief Number of objects and arrays open */
+	uint32_t depth;
+
+	/** @brief All ones if inside a string, else zero */
+	uint64_t inString;
+
+	/** @brief 1 if the next character is escaped, else zero */
+	uint64_t escaped;
+
+	NestingState(uint32_t d = 0): depth(d), inString(0), escaped(0) { }
+      };
+
+      /** @brief Skip to the end of the objects and arrays that are open
+       *         at @c p, using the widest instruction set the CPU
+       *         supports.
+       *
+       *  Returns the location just past the bracket that closes the
+       *  outermost open object or array, or @c end if [p, end) does not
+       *  contain it.  In the latter case, @c state holds everything
+       *  needed to continue with the text that follows @c end.  The
+       *  number of newlines passed over is added to @c newlines.count
+       *  and @c newlines.last is set to the last one.
+       *
+       *  Works 64 bytes at a time.  The strings in a block are found
+       *  with the escape-carry and prefix-XOR tricks described in
+       *  NestingScanner.cpp, and a block in which fewer brackets close
+       *  than are open is passed over without looking at its brackets
+       *  one by one.  The text is not checked for errors.
+       *  @c state.depth must be at least one.
+       */
+      const char* skipNested(const char* p, const char* end,
+			     NestingState& state, NewlineCount& newlines);
+
+    }
+  }
+}
+#endif
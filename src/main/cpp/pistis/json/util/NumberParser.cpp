@@ -0,0 +1,494 @@
+#include "NumberParser.hpp"
+#include "PowersOfFive.hpp"
+#include <cfloat>
+#include <limits>
+#include <string.h>
+
+using namespace pistis::json;
+using namespace pistis::json::util;
+
+namespace {
+  /** @brief A binary significand and biased exponent, as computed by
+   *         the Eisel-Lemire algorithm.
+   */
+  struct AdjustedMantissa {
+    uint64_t mantissa;
+    int32_t power2;
+
+    bool operator==(const AdjustedMantissa& other) const {
+      return (mantissa == other.mantissa) && (power2 == other.power2);
+    }
+  };
+
+  static constexpr const int32_t MANTISSA_EXPLICIT_BITS = 52;
+  static constexpr const int32_t MINIMUM_EXPONENT = -1023;
+  static constexpr const int32_t INFINITE_POWER = 0x7FF;
+  static constexpr const int32_t MIN_EXPONENT_ROUND_TO_EVEN = -4;
+  static constexpr const int32_t MAX_EXPONENT_ROUND_TO_EVEN = 23;
+
+  static const double EXACT_POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  struct UInt128 {
+    uint64_t low;
+    uint64_t high;
+  };
+
+  inline UInt128 multiply(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    const unsigned __int128 p = (unsigned __int128)a * b;
+    return UInt128{ (uint64_t)p, (uint64_t)(p >> 64) };
+#else
+    const uint64_t aLow = (uint32_t)a, aHigh = a >> 32;
+    const uint64_t bLow = (uint32_t)b, bHigh = b >> 32;
+    const uint64_t ll = aLow * bLow, lh = aLow * bHigh;
+    const uint64_t hl = aHigh * bLow, hh = aHigh * bHigh;
+    const uint64_t middle = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    return UInt128{ (middle << 32) | (uint32_t)ll,
+		    hh + (lh >> 32) + (hl >> 32) + (middle >> 32) };
+#endif
+  }
+
+  /** @brief Returns floor(log2(10^q)) + 63 */
+  inline int32_t binaryExponent(int32_t q) {
+    return (((152170 + 65536) * q) >> 16) + 63;
+  }
+
+  /** @brief Multiply @c w by 5^q, keeping enough of the product to
+   *         round it correctly to a double.
+   */
+  UInt128 approximateProduct(int32_t q, uint64_t w) {
+    const int32_t index = 2 * (q - detail::SMALLEST_POWER_OF_FIVE);
+    const uint64_t precisionMask =
+	0xFFFFFFFFFFFFFFFFull >> (MANTISSA_EXPLICIT_BITS + 3);
+    UInt128 first = multiply(w, detail::POWERS_OF_FIVE_128[index]);
+    if ((first.high & precisionMask) == precisionMask) {
+      const UInt128 second =
+	  multiply(w, detail::POWERS_OF_FIVE_128[index + 1]);
+      first.low += second.high;
+      if (second.high > first.low) {
+	++first.high;
+      }
+    }
+    return first;
+  }
+
+  /** @brief Compute the double nearest to w * 10^q with the Eisel-Lemire
+   *         algorithm.
+   *
+   *  This follows the version of the algorithm used by the fast_float
+   *  library, which Mushtak and Lemire have shown never needs a
+   *  fallback when @c w holds every digit of the number.
+   */
+  AdjustedMantissa computeFloat(int32_t q, uint64_t w) {
+    AdjustedMantissa answer;
+    if (!w || (q < detail::SMALLEST_POWER_OF_FIVE)) {
+      answer.power2 = 0;
+      answer.mantissa = 0;
+      return answer;
+    }
+    if (q > detail::LARGEST_POWER_OF_FIVE) {
+      answer.power2 = INFINITE_POWER;
+      answer.mantissa = 0;
+      return answer;
+    }
+
+    const int32_t lz = __builtin_clzll(w);
+    w <<= lz;
+
+    const UInt128 product = approximateProduct(q, w);
+    const int32_t upperBit = (int32_t)(product.high >> 63);
+    const int32_t shift = upperBit + 64 - MANTISSA_EXPLICIT_BITS - 3;
+
+    answer.mantissa = product.high >> shift;
+    answer.power2 =
+	binaryExponent(q) + upperBit - lz - MINIMUM_EXPONENT;
+
+    if (answer.power2 <= 0) {
+      // Subnormal
+      if ((-answer.power2 + 1) >= 64) {
+	answer.power2 = 0;
+	answer.mantissa = 0;
+	return answer;
+      }
+      answer.mantissa >>= -answer.power2 + 1;
+      answer.mantissa += (answer.mantissa & 1);
+      answer.mantissa >>= 1;
+      answer.power2 =
+	  (answer.mantissa < (1ull << MANTISSA_EXPLICIT_BITS)) ? 0 : 1;
+      return answer;
+    }
+
+    // If the product is exactly halfway between two doubles, round to even
+    if ((product.low <= 1) && (q >= MIN_EXPONENT_ROUND_TO_EVEN) &&
+	(q <= MAX_EXPONENT_ROUND_TO_EVEN) && ((answer.mantissa & 3) == 1) &&
+	((answer.mantissa << shift) == product.high)) {
+      answer.mantissa &= ~1ull;
+    }
+
+    answer.mantissa += (answer.mantissa & 1);
+    answer.mantissa >>= 1;
+    if (answer.mantissa >= (2ull << MANTISSA_EXPLICIT_BITS)) {
+      answer.mantissa = (1ull << MANTISSA_EXPLICIT_BITS);
+      ++answer.power2;
+    }
+    answer.mantissa &= ~(1ull << MANTISSA_EXPLICIT_BITS);
+    if (answer.power2 >= INFINITE_POWER) {
+      answer.power2 = INFINITE_POWER;
+      answer.mantissa = 0;
+    }
+    return answer;
+  }
+
+  inline double assemble(bool negative, const AdjustedMantissa& am) {
+    const uint64_t bits = am.mantissa |
+			  ((uint64_t)am.power2 << MANTISSA_EXPLICIT_BITS) |
+			  ((uint64_t)negative << 63);
+    double value;
+    ::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  /** @brief Convert w * 10^q exactly with ordinary floating-point
+   *         arithmetic, if w and 10^q are both exactly representable.
+   */
+  inline bool clingerFastPath(uint64_t w, int32_t q, bool negative,
+			      double& value) {
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+    if ((q >= -22) && (q <= 22) && (w <= (1ull << 53))) {
+      double v = (double)w;
+      if (q < 0) {
+	v /= EXACT_POWERS_OF_TEN[-q];
+      } else {
+	v *= EXACT_POWERS_OF_TEN[q];
+      }
+      value = negative ? -v : v;
+      return true;
+    }
+#endif
+    return false;
+  }
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  inline bool isEightDigits(const char* p) {
+    uint64_t v;
+    ::memcpy(&v, p, sizeof(v));
+    return (((v & 0xF0F0F0F0F0F0F0F0ull) |
+	     (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+	    0x3333333333333333ull);
+  }
+
+  /** @brief Convert eight ASCII digits to their value with three
+   *         multiplications instead of eight.
+   */
+  inline uint32_t parseEightDigits(const char* p) {
+    uint64_t v;
+    ::memcpy(&v, p, sizeof(v));
+    v = ((v & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+    v = ((v & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+    return (uint32_t)(((v & 0x0000FFFF0000FFFFull) * 42949672960001ull)
+		      >> 32);
+  }
+#else
+  inline bool isEightDigits(const char*) { return false; }
+  inline uint32_t parseEightDigits(const char*) { return 0; }
+#endif
+
+  inline bool isDigit(char c) { return (uint32_t)(uint8_t)c - '0' < 10; }
+
+  /** @brief Just enough of an unsigned big integer to compare a long
+   *         decimal number with the point halfway between two doubles.
+   *
+   *  The largest value it has to hold is 2^54 * 10^(MAX_DIGITS + 342),
+   *  a little over 3700 bits.
+   */
+  class BigInteger {
+  public:
+    explicit BigInteger(uint64_t v): size_(0) {
+      while (v) {
+	limbs_[size_++] = (uint32_t)v;
+	v >>= 32;
+      }
+    }
+
+    /** @brief this = this * m + a */
+    void multiplyAdd(uint32_t m, uint32_t a) {
+      uint64_t carry = a;
+      for (uint32_t i = 0; i < size_; ++i) {
+	carry += (uint64_t)limbs_[i] * m;
+	limbs_[i] = (uint32_t)carry;
+	carry >>= 32;
+      }
+      if (carry) {
+	limbs_[size_++] = (uint32_t)carry;
+      }
+    }
+
+    void multiplyByPowerOfTen(uint32_t n) {
+      static const uint32_t POWERS_OF_TEN[] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+	1000000000
+      };
+      for (; n >= 9; n -= 9) {
+	multiplyAdd(POWERS_OF_TEN[9], 0);
+      }
+      multiplyAdd(POWERS_OF_TEN[n], 0);
+    }
+
+    void shiftLeft(uint32_t n) {
+      if (!size_) {
+	return;
+      }
+      const uint32_t limbShift = n / 32;
+      const uint32_t bitShift = n % 32;
+      limbs_[size_] = 0;
+      for (uint32_t i = size_; i > 0; --i) {
+	limbs_[i + limbShift] =
+	    bitShift ? ((limbs_[i] << bitShift) |
+			(limbs_[i - 1] >> (32 - bitShift)))
+	             : limbs_[i];
+      }
+      limbs_[limbShift] = limbs_[0] << bitShift;
+      ::memset(limbs_, 0, limbShift * sizeof(uint32_t));
+      size_ += limbShift + 1;
+      while (size_ && !limbs_[size_ - 1]) {
+	--size_;
+      }
+    }
+
+    int compare(const BigInteger& other) const {
+      if (size_ != other.size_) {
+	return (size_ < other.size_) ? -1 : 1;
+      }
+      for (uint32_t i = size_; i > 0; --i) {
+	if (limbs_[i - 1] != other.limbs_[i - 1]) {
+	  return (limbs_[i - 1] < other.limbs_[i - 1]) ? -1 : 1;
+	}
+      }
+      return 0;
+    }
+
+  private:
+    static constexpr const uint32_t MAX_LIMBS = 128;
+
+    uint32_t limbs_[MAX_LIMBS + 1];
+    uint32_t size_;
+  };
+
+  /** @brief Digits past this many cannot change how a double rounds,
+   *         except to break an exact tie, so only whether any of them
+   *         is nonzero matters.
+   */
+  static constexpr const uint32_t MAX_DIGITS = 768;
+
+  /** @brief Round the number in @c text, whose value lies between the
+   *         adjacent doubles @c lower and @c upper, by comparing it
+   *         exactly with the point halfway between them.
+   */
+  AdjustedMantissa roundBetween(const JsonString& text,
+				const AdjustedMantissa& lower,
+				const AdjustedMantissa& upper) {
+    // The number is digits * 10^exponent
+    BigInteger digits(0);
+    int32_t exponent = 0;
+    uint32_t numDigits = 0;
+    uint32_t group = 0;
+    uint32_t groupSize = 0;
+    bool inFraction = false;
+    bool dropped = false;
+    const char* p = text.begin();
+
+    for (; (p != text.end()) && (*p != 'e') && (*p != 'E'); ++p) {
+      if (*p == '.') {
+	inFraction = true;
+      } else if (isDigit(*p) && (numDigits || (*p != '0'))) {
+	if (numDigits < MAX_DIGITS) {
+	  group = group * 10 + (*p - '0');
+	  if (++groupSize == 9) {
+	    digits.multiplyAdd(1000000000, group);
+	    group = groupSize = 0;
+	  }
+	  ++numDigits;
+	  exponent -= inFraction;
+	} else {
+	  dropped |= (*p != '0');
+	  exponent += !inFraction;
+	}
+      } else if (isDigit(*p)) {
+	exponent -= inFraction;  // A leading zero
+      }
+    }
+    if (groupSize) {
+      digits.multiplyByPowerOfTen(groupSize);
+      digits.multiplyAdd(1, group);
+    }
+    if (p != text.end()) {
+      // scanNumber() has already checked the exponent's syntax, and it
+      // is small, since the number is within the range of a double
+      const bool negative = (*++p == '-');
+      p += (*p == '+') || negative;
+      int32_t e = 0;
+      for (; (p != text.end()) && (e < 100000000); ++p) {
+	e = e * 10 + (*p - '0');
+      }
+      exponent += negative ? -e : e;
+    }
+
+    // The halfway point is (2m + 1) * 2^(power - 1)
+    const bool subnormal = !lower.power2;
+    const uint64_t m = lower.mantissa |
+		       (subnormal ? 0 : (1ull << MANTISSA_EXPLICIT_BITS));
+    const int32_t power =
+	(subnormal ? 1 : lower.power2) + MINIMUM_EXPONENT -
+	MANTISSA_EXPLICIT_BITS - 1;
+    BigInteger halfway(2 * m + 1);
+
+    if (exponent >= 0) {
+      digits.multiplyByPowerOfTen(exponent);
+    } else {
+      halfway.multiplyByPowerOfTen(-exponent);
+    }
+    if (power >= 0) {
+      halfway.shiftLeft(power);
+    } else {
+      digits.shiftLeft(-power);
+    }
+
+    const int cmp = digits.compare(halfway);
+    if ((cmp < 0) || (!cmp && !dropped && !(lower.mantissa & 1))) {
+      return lower;
+    }
+    return upper;
+  }
+}
+
+bool pistis::json::util::scanNumber(const JsonString& text,
+				    JsonNumber& number) {
+  const char* p = text.begin();
+  const char* const end = text.end();
+
+  number.reset();
+  number.setText(text);
+  if ((p != end) && (*p == '-')) {
+    number.setNegative(true);
+    ++p;
+  }
+
+  if ((p == end) || !isDigit(*p)) {
+    return false;
+  } else if ((*p == '0') && ((p + 1) != end) && isDigit(p[1])) {
+    return false;  // JSON does not allow leading zeros
+  }
+  while ((p != end) && isDigit(*p)) {
+    number.addIntegerDigit(*p++ - '0');
+  }
+
+  if ((p != end) && (*p == '.')) {
+    ++p;
+    if ((p == end) || !isDigit(*p)) {
+      return false;
+    }
+    while ((p != end) && isDigit(*p)) {
+      number.addFractionDigit(*p++ - '0');
+    }
+  }
+
+  if ((p != end) && ((*p == 'e') || (*p == 'E'))) {
+    bool negativeExponent = false;
+    int32_t exponent = 0;
+
+    ++p;
+    if ((p != end) && ((*p == '+') || (*p == '-'))) {
+      negativeExponent = (*p == '-');
+      ++p;
+    }
+    if ((p == end) || !isDigit(*p)) {
+      return false;
+    }
+    while ((p != end) && isDigit(*p)) {
+      // Anything this large overflows a double anyway
+      if (exponent < 100000000) {
+	exponent = exponent * 10 + (*p - '0');
+      }
+      ++p;
+    }
+    number.addExponent(negativeExponent ? -exponent : exponent);
+  }
+
+  return p == end;
+}
+
+bool pistis::json::util::parseInt64(const JsonString& text, int64_t& value) {
+  const char* p = text.begin();
+  const char* const end = text.end();
+  const bool negative = (p != end) && (*p == '-');
+
+  if (negative) {
+    ++p;
+  }
+  // 19 digits always fit in a uint64_t; more never fit in an int64_t
+  if ((p == end) || ((end - p) > 19)) {
+    return false;
+  } else if ((*p == '0') && ((end - p) > 1)) {
+    return false;  // JSON does not allow leading zeros
+  }
+
+  uint64_t v = 0;
+  while ((end - p) >= 8) {
+    if (!isEightDigits(p)) {
+      break;
+    }
+    v = v * 100000000 + parseEightDigits(p);
+    p += 8;
+  }
+  while (p != end) {
+    if (!isDigit(*p)) {
+      return false;
+    }
+    v = v * 10 + (*p++ - '0');
+  }
+
+  if (v > (uint64_t)std::numeric_limits<int64_t>::max() + negative) {
+    return false;
+  }
+  value = negative ? (int64_t)(0 - v) : (int64_t)v;
+  return true;
+}
+
+double pistis::json::util::toDouble(const JsonNumber& number) {
+  const uint64_t w = number.significand();
+  const int32_t q = number.exponent();
+  double value;
+
+  if (!number.truncated()) {
+    if (clingerFastPath(w, q, number.negative(), value)) {
+      return value;
+    }
+    return assemble(number.negative(), computeFloat(q, w));
+  }
+
+  // Digits past the 19th were dropped, so the number lies between
+  // w * 10^q and (w + 1) * 10^q.  If both round to the same double,
+  // so does the number.  Otherwise they round to adjacent doubles,
+  // and the dropped digits decide which side of the halfway point
+  // between them the number is on.
+  const AdjustedMantissa lower = computeFloat(q, w);
+  const AdjustedMantissa upper = computeFloat(q, w + 1);
+  if ((lower == upper) || !number.text().size()) {
+    return assemble(number.negative(), lower);
+  }
+  return assemble(number.negative(),
+		  roundBetween(number.text(), lower, upper));
+}
+
+bool pistis::json::util::parseDouble(const JsonString& text,
+				     double& value) {
+  JsonNumber number;
+  if (!scanNumber(text, number)) {
+    return false;
+  }
+  value = toDouble(number);
+  return true;
+}
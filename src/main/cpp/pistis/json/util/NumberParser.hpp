@@ -0,0 +1,50 @@
+#ifndef __PISTIS__JSON__UTIL__NUMBERPARSER_HPP__
+#define __PISTIS__JSON__UTIL__NUMBERPARSER_HPP__
+
+#include <pistis/json/JsonNumber.hpp>
+#include <pistis/json/JsonString.hpp>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace util {
+
+      /** @brief Split the text of a JSON number into its significand and
+       *         exponent.
+       *
+       *  Returns false if @c text is not a valid JSON number.
+       */
+      bool scanNumber(const JsonString& text, JsonNumber& number);
+
+      /** @brief Convert a JSON integer to an int64_t.
+       *
+       *  Returns false if @c text is not a valid JSON integer or if its
+       *  value does not fit in an int64_t.  Does not allocate memory and
+       *  does not depend on the current locale.
+       */
+      bool parseInt64(const JsonString& text, int64_t& value);
+
+      /** @brief Convert a JSON number to the nearest double.
+       *
+       *  Uses the Clinger fast path when the significand and exponent are
+       *  small enough for the conversion to be exact with ordinary
+       *  floating-point arithmetic, and the Eisel-Lemire algorithm
+       *  otherwise.  The result is correctly rounded.  Numbers with more
+       *  than 19 significant digits that lie too close to a halfway point
+       *  for the first 19 digits to decide the rounding are compared
+       *  with the halfway point digit by digit, using the first 768
+       *  digits and whether any of the rest is nonzero.  Does not
+       *  allocate memory and does not depend on the current locale.
+       */
+      double toDouble(const JsonNumber& number);
+
+      /** @brief Convert the text of a JSON number to the nearest double.
+       *
+       *  Returns false if @c text is not a valid JSON number.
+       */
+      bool parseDouble(const JsonString& text, double& value);
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,30 @@
+#ifndef __PISTIS__JSON__UTIL__POWERSOFFIVE_HPP__
+#define __PISTIS__JSON__UTIL__POWERSOFFIVE_HPP__
+
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace util {
+      namespace detail {
+
+	/** @brief Smallest power of five in POWERS_OF_FIVE_128 */
+	static constexpr const int32_t SMALLEST_POWER_OF_FIVE = -342;
+
+	/** @brief Largest power of five in POWERS_OF_FIVE_128 */
+	static constexpr const int32_t LARGEST_POWER_OF_FIVE = 308;
+
+	/** @brief 128-bit approximations of 5^q for
+	 *         SMALLEST_POWER_OF_FIVE <= q <= LARGEST_POWER_OF_FIVE.
+	 *
+	 *  Each power is normalized so its most significant bit is set,
+	 *  and stored as two 64-bit words, most significant word first.
+	 *  Used by the Eisel-Lemire algorithm in NumberParser.cpp.
+	 */
+	extern const uint64_t POWERS_OF_FIVE_128[];
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,273 @@
+#include "SimdScanner.hpp"
+#include "CpuFeatures.hpp"
+#include <atomic>
+
+#ifdef PISTIS_JSON_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace pistis::json::util;
+
+namespace {
+  typedef const char* (*SkipWhitespaceFn)(const char*, const char*,
+					  NewlineCount&);
+  typedef const char* (*FindStringDelimiterFn)(const char*, const char*);
+
+  const char* skipWhitespaceScalar(const char* p, const char* end,
+				   NewlineCount& newlines) {
+    while ((p != end) && isJsonWhitespace(*p)) {
+      if (*p == '\n') {
+	++newlines.count;
+	newlines.last = p;
+      }
+      ++p;
+    }
+    return p;
+  }
+
+  const char* findStringDelimiterScalar(const char* p, const char* end) {
+    while ((p != end) && !isStringDelimiter(*p)) {
+      ++p;
+    }
+    return p;
+  }
+
+  /** @brief Record the newlines in the block starting at @c p, given
+   *         a bitmask with one bit set for each newline in the block.
+   */
+  inline void countNewlines(const char* p, uint64_t mask,
+			    NewlineCount& newlines) {
+    if (mask) {
+      newlines.count += __builtin_popcountll(mask);
+      newlines.last = p + (63 - __builtin_clzll(mask));
+    }
+  }
+
+#ifdef PISTIS_JSON_X86_SIMD
+  __attribute__((target("sse2")))
+  const char* skipWhitespaceSse2(const char* p, const char* end,
+				 NewlineCount& newlines) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    while ((end - p) >= 16) {
+      const __m128i v = _mm_loadu_si128((const __m128i*)p);
+      const __m128i nl = _mm_cmpeq_epi8(v, lf);
+      const __m128i ws = _mm_or_si128(
+	  _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+	  _mm_or_si128(_mm_cmpeq_epi8(v, cr), nl)
+      );
+      const uint32_t wsMask = (uint32_t)_mm_movemask_epi8(ws);
+      const uint32_t nlMask = (uint32_t)_mm_movemask_epi8(nl);
+
+      if (wsMask != 0xFFFF) {
+	const uint32_t stop = __builtin_ctz(~wsMask);
+	countNewlines(p, nlMask & ((1u << stop) - 1), newlines);
+	return p + stop;
+      }
+      countNewlines(p, nlMask, newlines);
+      p += 16;
+    }
+    return skipWhitespaceScalar(p, end, newlines);
+  }
+
+  __attribute__((target("avx2")))
+  const char* skipWhitespaceAvx2(const char* p, const char* end,
+				 NewlineCount& newlines) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    while ((end - p) >= 32) {
+      const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+      const __m256i nl = _mm256_cmpeq_epi8(v, lf);
+      const __m256i ws = _mm256_or_si256(
+	  _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+			  _mm256_cmpeq_epi8(v, tab)),
+	  _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), nl)
+      );
+      const uint32_t wsMask = (uint32_t)_mm256_movemask_epi8(ws);
+      const uint32_t nlMask = (uint32_t)_mm256_movemask_epi8(nl);
+
+      if (wsMask != 0xFFFFFFFF) {
+	const uint32_t stop = __builtin_ctz(~wsMask);
+	countNewlines(p, nlMask & ((1ull << stop) - 1), newlines);
+	return p + stop;
+      }
+      countNewlines(p, nlMask, newlines);
+      p += 32;
+    }
+    return skipWhitespaceSse2(p, end, newlines);
+  }
+
+  __attribute__((target("avx512bw")))
+  const char* skipWhitespaceAvx512(const char* p, const char* end,
+				   NewlineCount& newlines) {
+    const __m512i space = _mm512_set1_epi8(' ');
+    const __m512i tab = _mm512_set1_epi8('\t');
+    const __m512i cr = _mm512_set1_epi8('\r');
+    const __m512i lf = _mm512_set1_epi8('\n');
+
+    while ((end - p) >= 64) {
+      const __m512i v = _mm512_loadu_si512((const void*)p);
+      const uint64_t nlMask = _mm512_cmpeq_epi8_mask(v, lf);
+      const uint64_t wsMask = _mm512_cmpeq_epi8_mask(v, space) |
+	                      _mm512_cmpeq_epi8_mask(v, tab) |
+	                      _mm512_cmpeq_epi8_mask(v, cr) | nlMask;
+
+      if (~wsMask) {
+	const uint32_t stop = __builtin_ctzll(~wsMask);
+	countNewlines(p, nlMask & ((1ull << stop) - 1), newlines);
+	return p + stop;
+      }
+      countNewlines(p, nlMask, newlines);
+      p += 64;
+    }
+    return skipWhitespaceAvx2(p, end, newlines);
+  }
+
+  __attribute__((target("sse2")))
+  const char* findStringDelimiterSse2(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    while ((end - p) >= 16) {
+      const __m128i v = _mm_loadu_si128((const __m128i*)p);
+      const __m128i found = _mm_or_si128(
+	  _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+	  _mm_cmpeq_epi8(v, lf)
+      );
+      const uint32_t mask = (uint32_t)_mm_movemask_epi8(found);
+      if (mask) {
+	return p + __builtin_ctz(mask);
+      }
+      p += 16;
+    }
+    return findStringDelimiterScalar(p, end);
+  }
+
+  __attribute__((target("avx2")))
+  const char* findStringDelimiterAvx2(const char* p, const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    while ((end - p) >= 32) {
+      const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+      const __m256i found = _mm256_or_si256(
+	  _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+			  _mm256_cmpeq_epi8(v, backslash)),
+	  _mm256_cmpeq_epi8(v, lf)
+      );
+      const uint32_t mask = (uint32_t)_mm256_movemask_epi8(found);
+      if (mask) {
+	return p + __builtin_ctz(mask);
+      }
+      p += 32;
+    }
+    return findStringDelimiterSse2(p, end);
+  }
+
+  __attribute__((target("avx512bw")))
+  const char* findStringDelimiterAvx512(const char* p, const char* end) {
+    const __m512i quote = _mm512_set1_epi8('"');
+    const __m512i backslash = _mm512_set1_epi8('\\');
+    const __m512i lf = _mm512_set1_epi8('\n');
+
+    while ((end - p) >= 64) {
+      const __m512i v = _mm512_loadu_si512((const void*)p);
+      const uint64_t mask = _mm512_cmpeq_epi8_mask(v, quote) |
+	                    _mm512_cmpeq_epi8_mask(v, backslash) |
+	                    _mm512_cmpeq_epi8_mask(v, lf);
+      if (mask) {
+	return p + __builtin_ctzll(mask);
+      }
+      p += 64;
+    }
+    return findStringDelimiterAvx2(p, end);
+  }
+#endif
+
+  const char* resolveSkipWhitespace(const char* p, const char* end,
+				    NewlineCount& newlines);
+
+  /** @brief Kernel used by skipWhitespaceRun().  Starts out pointing
+   *         to a function that picks the best kernel for this CPU,
+   *         replaces itself with it, and calls it.
+   */
+  std::atomic<SkipWhitespaceFn> skipWhitespaceImpl(&resolveSkipWhitespace);
+
+  const char* resolveSkipWhitespace(const char* p, const char* end,
+				    NewlineCount& newlines) {
+    SkipWhitespaceFn f = &skipWhitespaceScalar;
+    switch (simdLevel()) {
+#ifdef PISTIS_JSON_X86_SIMD
+      case SimdLevel::AVX512:
+	f = &skipWhitespaceAvx512;
+	break;
+
+      case SimdLevel::AVX2:
+	f = &skipWhitespaceAvx2;
+	break;
+
+      case SimdLevel::SSE2:
+	f = &skipWhitespaceSse2;
+	break;
+#endif
+
+      default:
+	break;
+    }
+    skipWhitespaceImpl.store(f, std::memory_order_relaxed);
+    return f(p, end, newlines);
+  }
+
+  const char* resolveFindStringDelimiter(const char* p, const char* end);
+
+  /** @brief Kernel used by findStringDelimiterRun().  Resolved on first
+   *         use, like skipWhitespaceImpl.
+   */
+  std::atomic<FindStringDelimiterFn> findStringDelimiterImpl(
+      &resolveFindStringDelimiter
+  );
+
+  const char* resolveFindStringDelimiter(const char* p, const char* end) {
+    FindStringDelimiterFn f = &findStringDelimiterScalar;
+    switch (simdLevel()) {
+#ifdef PISTIS_JSON_X86_SIMD
+      case SimdLevel::AVX512:
+	f = &findStringDelimiterAvx512;
+	break;
+
+      case SimdLevel::AVX2:
+	f = &findStringDelimiterAvx2;
+	break;
+
+      case SimdLevel::SSE2:
+	f = &findStringDelimiterSse2;
+	break;
+#endif
+
+      default:
+	break;
+    }
+    findStringDelimiterImpl.store(f, std::memory_order_relaxed);
+    return f(p, end);
+  }
+}
+
+const char* pistis::json::util::skipWhitespaceRun(const char* p,
+						  const char* end,
+						  NewlineCount& newlines) {
+  return skipWhitespaceImpl.load(std::memory_order_relaxed)(p, end,
+							   newlines);
+}
+
+const char* pistis::json::util::findStringDelimiterRun(const char* p,
+						       const char* end) {
+  return findStringDelimiterImpl.load(std::memory_order_relaxed)(p, end);
+}
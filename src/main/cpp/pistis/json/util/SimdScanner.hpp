@@ -0,0 +1,96 @@
+#ifndef __PISTIS__JSON__UTIL__SIMDSCANNER_HPP__
+#define __PISTIS__JSON__UTIL__SIMDSCANNER_HPP__
+
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace util {
+
+      /** @brief Newlines passed over by skipWhitespace() */
+      struct NewlineCount {
+	/** @brief Number of newlines found */
+	uint64_t count;
+
+	/** @brief Location of the last newline found.  Only valid if
+	 *         count is nonzero.
+	 */
+	const char* last;
+
+	NewlineCount(): count(0), last(nullptr) { }
+      };
+
+      /** @brief Returns true if @c c is one of the four whitespace
+       *         characters JSON allows between tokens.
+       */
+      inline bool isJsonWhitespace(char c) {
+	return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t');
+      }
+
+      /** @brief Skip the run of whitespace starting at @c p using the
+       *         widest instruction set the CPU supports.
+       *
+       *  Returns the location of the first non-whitespace character in
+       *  [p, end), or @c end if every character in that range is
+       *  whitespace.  Adds the number of newlines skipped to
+       *  @c newlines.count and sets @c newlines.last to the last one.
+       */
+      const char* skipWhitespaceRun(const char* p, const char* end,
+				    NewlineCount& newlines);
+
+      /** @brief Skip the run of whitespace starting at @c p.
+       *
+       *  Same as skipWhitespaceRun(), but handles short runs inline.
+       *  Compact JSON has no whitespace at all and most whitespace in
+       *  pretty-printed JSON is a single space after a ':', so the vector
+       *  scanner is only called when the run continues past the first few
+       *  characters.
+       */
+      inline const char* skipWhitespace(const char* p, const char* end,
+					NewlineCount& newlines) {
+	for (int i = 0; i < 4; ++i, ++p) {
+	  if (p == end) {
+	    return p;
+	  } else if (*p == '\n') {
+	    ++newlines.count;
+	    newlines.last = p;
+	  } else if (!isJsonWhitespace(*p)) {
+	    return p;
+	  }
+	}
+	return skipWhitespaceRun(p, end, newlines);
+      }
+
+      /** @brief Returns true if @c c ends a run of ordinary characters
+       *         inside a JSON string.
+       */
+      inline bool isStringDelimiter(char c) {
+	return (c == '"') || (c == '\\') || (c == '\n');
+      }
+
+      /** @brief Find the first '"', '\\' or newline in [p, end) using the
+       *         widest instruction set the CPU supports.
+       *
+       *  Returns @c end if none of those characters occur in the range.
+       */
+      const char* findStringDelimiterRun(const char* p, const char* end);
+
+      /** @brief Find the first '"', '\\' or newline in [p, end).
+       *
+       *  Same as findStringDelimiterRun(), but checks the first few
+       *  characters inline, since most field names are short.
+       */
+      inline const char* findStringDelimiter(const char* p,
+					     const char* end) {
+	for (int i = 0; i < 8; ++i, ++p) {
+	  if ((p == end) || isStringDelimiter(*p)) {
+	    return p;
+	  }
+	}
+	return findStringDelimiterRun(p, end);
+      }
+
+    }
+  }
+}
+#endif
@@ -30,8 +30,8 @@ namespace pistis {
 	    buffer.write((char)(0x80 | (c & 0x3F)));
 	  } else {
 	    std::ostringstream msg;
-	    msg << "Cannot encode character 0x" << std::width(4)
-		<< std::fill('0') << std::hex << c
+	    msg << "Cannot encode character 0x" << std::setw(4)
+		<< std::setfill('0') << std::hex << c
 		<< ", which has more than 21 bits";
 	    throw pistis::exceptions::IllegalValueError(msg.str(),
 							PISTIS_EX_HERE);
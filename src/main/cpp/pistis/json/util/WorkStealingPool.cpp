@@ -0,0 +1,105 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+
+using namespace pistis::json::util;
+
+namespace {
+  // Index of the pool worker running on this thread, if any
+  thread_local const WorkStealingPool* currentPool = nullptr;
+  thread_local uint32_t currentWorker = 0;
+}
+
+WorkStealingPool::WorkStealingPool(uint32_t numThreads):
+    queues_(), threads_(), numQueued_(0), nextQueue_(0), idleMutex_(),
+    idle_(), stopping_(false) {
+  if (!numThreads) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (uint32_t i = 0; i < numThreads; ++i) {
+    queues_.emplace_back(new Queue_());
+  }
+  for (uint32_t i = 0; i < numThreads; ++i) {
+    threads_.emplace_back([this, i]() { run_(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    stopping_ = true;
+  }
+  idle_.notify_all();
+  for (std::thread& t : threads_) {
+    t.join();
+  }
+}
+
+void WorkStealingPool::submit(Task task) {
+  const uint32_t q =
+      (currentPool == this)
+	  ? currentWorker
+	  : nextQueue_.fetch_add(1, std::memory_order_relaxed) %
+	        queues_.size();
+
+  // Count the task before queueing it, so numQueued_ never goes below
+  // zero when a worker takes the task at once.  Taking idleMutex_ orders
+  // the increment with a worker that is about to go to sleep, so the
+  // wakeup can't be lost.
+  {
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    numQueued_.fetch_add(1, std::memory_order_release);
+  }
+  {
+    std::unique_lock<std::mutex> lock(queues_[q]->mutex);
+    queues_[q]->tasks.push_back(std::move(task));
+  }
+  idle_.notify_one();
+}
+
+void WorkStealingPool::run_(uint32_t worker) {
+  currentPool = this;
+  currentWorker = worker;
+
+  Task task;
+  while (true) {
+    if (take_(worker, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    idle_.wait(lock, [this]() {
+	return stopping_ || numQueued_.load(std::memory_order_acquire);
+    });
+    if (stopping_ && !numQueued_.load(std::memory_order_acquire)) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingPool::take_(uint32_t worker, Task& task) {
+  if (!numQueued_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  // Newest task from our own queue first, then the oldest task of the
+  // other queues
+  const uint32_t n = queues_.size();
+  for (uint32_t i = 0; i < n; ++i) {
+    Queue_& q = *queues_[(worker + i) % n];
+    std::unique_lock<std::mutex> lock(q.mutex);
+    if (!q.tasks.empty()) {
+      if (!i) {
+	task = std::move(q.tasks.back());
+	q.tasks.pop_back();
+      } else {
+	task = std::move(q.tasks.front());
+	q.tasks.pop_front();
+      }
+      numQueued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,77 @@
+#ifndef __PISTIS__JSON__UTIL__WORKSTEALINGPOOL_HPP__
+#define __PISTIS__JSON__UTIL__WORKSTEALINGPOOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace pistis {
+  namespace json {
+    namespace util {
+
+      /** @brief A fixed set of threads that run tasks, each with its own
+       *         queue, stealing from each other when their queues run dry.
+       *
+       *  Tasks submitted from outside the pool are dealt to the queues in
+       *  turn, and tasks submitted by a worker go on that worker's own
+       *  queue.  A worker takes its newest task first, which keeps the
+       *  data it just touched in its cache, and steals the oldest task of
+       *  another worker when it has none.  Each queue has its own mutex,
+       *  so workers only contend when one of them steals.  Idle workers
+       *  sleep until a task arrives.
+       *
+       *  The destructor runs the tasks still queued, then joins the
+       *  threads.  Tasks must not throw.
+       */
+      class WorkStealingPool {
+      public:
+	typedef std::function<void ()> Task;
+
+      public:
+	/** @brief Start @c numThreads threads, or one per core if
+	 *         @c numThreads is zero
+	 */
+	explicit WorkStealingPool(uint32_t numThreads = 0);
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	~WorkStealingPool();
+
+	uint32_t numThreads() const { return queues_.size(); }
+
+	/** @brief Queue @c task to run on one of the pool's threads */
+	void submit(Task task);
+
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+      private:
+	struct Queue_ {
+	  std::mutex mutex;
+	  std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue_> > queues_;
+	std::vector<std::thread> threads_;
+
+	// Number of tasks in all queues, and where the next task from
+	// outside the pool goes
+	std::atomic<uint64_t> numQueued_;
+	std::atomic<uint32_t> nextQueue_;
+
+	// Idle workers sleep on this
+	std::mutex idleMutex_;
+	std::condition_variable idle_;
+	bool stopping_;
+
+	void run_(uint32_t worker);
+	bool take_(uint32_t worker, Task& task);
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,245 @@
+#include "../streaming/EventTraces.hpp"
+#include <pistis/json/binding/ValueReader.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Item {
+  int32_t x;
+  std::optional<std::string> tag;
+
+  bool operator==(const Item& other) const {
+    return (x == other.x) && (tag == other.tag);
+  }
+};
+
+struct Record {
+  int64_t id;
+  double price;
+  std::string symbol;
+  bool active;
+  uint8_t small;
+  std::optional<int64_t> parent;
+  std::vector<Item> items;
+  Item main;
+
+  bool operator==(const Record& other) const {
+    return (id == other.id) && (price == other.price) &&
+	   (symbol == other.symbol) && (active == other.active) &&
+	   (small == other.small) && (parent == other.parent) &&
+	   (items == other.items) && (main == other.main);
+  }
+};
+
+PISTIS_JSON_BIND(Item, x, tag)
+PISTIS_JSON_BIND(Record, id, price, symbol, active, small, parent, items,
+		 main)
+
+using namespace pistis::exceptions;
+using namespace pistis::json;
+using namespace pistis::json::binding;
+using namespace pistis::json::streaming;
+
+namespace {
+  typedef streaming::testing::TrickleEventStream TrickleEventStream;
+  typedef streaming::testing::InPlaceEventStream InPlaceEventStream;
+
+  /** @brief Stream that hands out @c text 1 to 7 bytes at a time and
+   *         says it has no data yet a third of the time
+   */
+  streaming::testing::TrickleStream trickle(const std::string& text,
+					    uint32_t seed) {
+    return streaming::testing::TrickleStream(text, 7, 33, seed);
+  }
+
+  InPlaceEventStream streamOf(const std::string& text) {
+    return streaming::testing::streamOf(text);
+  }
+
+  template <typename T>
+  T readText(const std::string& text) {
+    InPlaceEventStream events = streamOf(text);
+    return readValue<T>(events);
+  }
+
+  std::string randomString(std::mt19937& rng) {
+    static const char* const PIECES[] = {
+      "a", "bc", " ", "]", "}", "\\\"", "\\n", "\\u00e9"
+    };
+    std::string s = "\"";
+    for (uint32_t n = rng() % 5; n; --n) {
+      s += PIECES[rng() % 8];
+    }
+    return s + "\"";
+  }
+
+  /** @brief The decoded text of a string randomString() made */
+  std::string decoded(const std::string& s) {
+    InPlaceEventStream events = streamOf(s);
+    events.next();
+    return std::string(events.payloadText().begin(),
+		       events.payloadText().end());
+  }
+
+  /** @brief A field the bindings don't know about */
+  std::string unknownField(std::mt19937& rng) {
+    static const char* const VALUES[] = {
+      "1", "\"x\"", "[1, {\"id\": 2}]", "{\"items\": [{}], \"x\": null}",
+      "null"
+    };
+    return "\"extra" + std::to_string(rng() % 3) + "\": " +
+	   VALUES[rng() % 5];
+  }
+
+  /** @brief Write the fields in @c fields as an object, in a random
+   *         order and with unknown fields mixed in
+   */
+  std::string object(std::mt19937& rng, std::vector<std::string> fields) {
+    for (uint32_t n = rng() % 3; n; --n) {
+      fields.push_back(unknownField(rng));
+    }
+    std::shuffle(fields.begin(), fields.end(), rng);
+    std::string text = "{";
+    for (size_t i = 0; i < fields.size(); ++i) {
+      text += (i ? ", " : "") + fields[i];
+    }
+    return text + "}";
+  }
+
+  Item randomItem(std::mt19937& rng, std::string& text) {
+    Item item{ (int32_t)rng(), std::nullopt };
+    std::vector<std::string> fields = {
+      "\"x\": " + std::to_string(item.x)
+    };
+    if (rng() % 2) {
+      const std::string s = randomString(rng);
+      item.tag = decoded(s);
+      fields.push_back("\"tag\": " + s);
+    } else if (rng() % 2) {
+      fields.push_back("\"tag\": null");
+    }
+    text = object(rng, fields);
+    return item;
+  }
+
+  Record randomRecord(std::mt19937& rng, std::string& text) {
+    Record record;
+    record.id = (int64_t)(((uint64_t)rng() << 32) | rng());
+    record.price = (double)(rng() % 1000000) / 100;
+    const std::string symbol = randomString(rng);
+    record.symbol = decoded(symbol);
+    record.active = rng() % 2;
+    record.small = rng() % 256;
+    std::ostringstream price;
+    price.precision(17);
+    price << record.price;
+
+    std::vector<std::string> fields = {
+      "\"id\": " + std::to_string(record.id),
+      "\"price\": " + price.str(),
+      "\"symbol\": " + symbol,
+      std::string("\"active\": ") + (record.active ? "true" : "false"),
+      "\"small\": " + std::to_string(record.small)
+    };
+    if (rng() % 2) {
+      record.parent = rng() % 1000;
+      fields.push_back("\"parent\": " + std::to_string(*record.parent));
+    } else {
+      fields.push_back("\"parent\": null");
+    }
+
+    std::string items = "\"items\": [";
+    for (uint32_t n = rng() % 4; n; --n) {
+      std::string itemText;
+      record.items.push_back(randomItem(rng, itemText));
+      items += itemText + ((n > 1) ? ", " : "");
+    }
+    fields.push_back(items + "]");
+
+    std::string mainText;
+    record.main = randomItem(rng, mainText);
+    fields.push_back("\"main\": " + mainText);
+
+    text = object(rng, fields);
+    return record;
+  }
+}
+
+TEST(ValueReaderTests, ReadsBoundFields) {
+  const Record record = readText<Record>(
+      "{\"id\": -12, \"extra\": {\"id\": 7, \"items\": [1]}, "
+      "\"price\": 2.5, \"symbol\": \"a\\u00e9\", \"active\": true, "
+      "\"small\": 255, \"parent\": null, "
+      "\"items\": [{\"x\": 1, \"tag\": \"t\"}, {\"x\": -2}], "
+      "\"main\": {\"tag\": null, \"x\": 3}}"
+  );
+  EXPECT_EQ(-12, record.id);
+  EXPECT_EQ(2.5, record.price);
+  EXPECT_EQ("a\xc3\xa9", record.symbol);
+  EXPECT_TRUE(record.active);
+  EXPECT_EQ(255, record.small);
+  EXPECT_FALSE(record.parent.has_value());
+  ASSERT_EQ(2u, record.items.size());
+  EXPECT_EQ((Item{ 1, std::string("t") }), record.items[0]);
+  EXPECT_EQ((Item{ -2, std::nullopt }), record.items[1]);
+  EXPECT_EQ((Item{ 3, std::nullopt }), record.main);
+}
+
+TEST(ValueReaderTests, MatchesTheDocument) {
+  // Random records, with their fields in random order and unknown
+  // fields mixed in, read in place and a few bytes at a time
+  std::mt19937 rng(14);
+  for (int trial = 0; trial < 500; ++trial) {
+    std::string text;
+    const Record expected = randomRecord(rng, text);
+    EXPECT_EQ(expected, readText<Record>(text)) << text;
+
+    TrickleEventStream events("test", trickle(text, rng()),
+			      DefaultPayloadFactory(), 16);
+    Record record{};
+    ValueReader<Record> reader(record);
+    while (!reader.read(events)) {
+    }
+    EXPECT_EQ(expected, record) << text;
+  }
+}
+
+TEST(ValueReaderTests, ReadsRecords) {
+  std::mt19937 rng(15);
+  std::vector<Record> expected;
+  std::string text;
+  for (int i = 0; i < 50; ++i) {
+    std::string recordText;
+    expected.push_back(randomRecord(rng, recordText));
+    text += recordText + "\n";
+  }
+
+  TrickleEventStream events("test", trickle(text, 16),
+			    DefaultPayloadFactory(), 16);
+  events.setMultipleValues(true);
+  std::vector<Record> records(expected.size());
+  ValueReader<Record> reader(records[0]);
+  for (size_t i = 0; i < records.size(); ++i) {
+    reader.reset(records[i]);
+    while (!reader.read(events)) {
+    }
+  }
+  EXPECT_EQ(expected, records);
+}
+
+TEST(ValueReaderTests, MismatchedTypesThrow) {
+  static const char* const CASES[] = {
+    "{\"id\": \"1\"}", "{\"id\": 1.5}", "{\"id\": 1e30}",
+    "{\"small\": 256}", "{\"small\": -1}", "{\"price\": true}",
+    "{\"symbol\": 1}", "{\"items\": {}}", "{\"items\": [1]}",
+    "{\"main\": []}", "{\"active\": null}", "[]"
+  };
+  for (const char* text : CASES) {
+    EXPECT_THROW(readText<Record>(text), IllegalValueError) << text;
+  }
+}
@@ -0,0 +1,398 @@
+#include "../streaming/EventTraces.hpp"
+#include <pistis/json/dom/DocumentBuilder.hpp>
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <pistis/json/exceptions/JsonStringNotTerminated.hpp>
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace pistis::exceptions;
+using namespace pistis::json;
+using namespace pistis::json::dom;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief Blocks a RecordingAllocator has handed out and not taken
+   *         back
+   */
+  struct Blocks {
+    std::vector<std::pair<const char*, size_t> > live;
+
+    bool contain(const JsonString& s) const {
+      for (const auto& block : live) {
+	if ((s.begin() >= block.first) &&
+	    (s.end() <= (block.first + block.second))) {
+	  return true;
+	}
+      }
+      return false;
+    }
+  };
+
+  /** @brief Allocator that keeps track of its blocks in a Blocks */
+  template <typename T>
+  class RecordingAllocator {
+  public:
+    typedef T value_type;
+
+    explicit RecordingAllocator(Blocks& blocks): blocks_(&blocks) { }
+
+    template <typename U>
+    RecordingAllocator(const RecordingAllocator<U>& other):
+	blocks_(&other.blocks()) {
+    }
+
+    Blocks& blocks() const { return *blocks_; }
+
+    T* allocate(size_t n) {
+      T* p = std::allocator<T>().allocate(n);
+      blocks_->live.emplace_back((const char*)p, n * sizeof(T));
+      return p;
+    }
+
+    void deallocate(T* p, size_t n) {
+      auto& live = blocks_->live;
+      for (auto i = live.begin(); i != live.end(); ++i) {
+	if (i->first == (const char*)p) {
+	  live.erase(i);
+	  break;
+	}
+      }
+      std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const RecordingAllocator<U>& other) const {
+      return blocks_ == &other.blocks();
+    }
+
+    template <typename U>
+    bool operator!=(const RecordingAllocator<U>& other) const {
+      return blocks_ != &other.blocks();
+    }
+
+  private:
+    Blocks* blocks_;
+  };
+
+  typedef RecordingAllocator<char> TestAllocator;
+
+  /** @brief Write @c v out as JSON, with its members in the order the
+   *         document keeps them and its numbers tagged with their types
+   */
+  void dump(std::ostream& out, const JsonValue& v) {
+    switch (v.type()) {
+      case JsonValueType::NULL_VALUE:
+	out << "null";
+	break;
+
+      case JsonValueType::BOOL:
+	out << (v.boolValue() ? "true" : "false");
+	break;
+
+      case JsonValueType::INT:
+	out << "i" << v.intValue();
+	break;
+
+      case JsonValueType::FLOAT:
+	out << "f" << floatText(v.floatValue());
+	break;
+
+      case JsonValueType::STRING:
+	out << "\"" << v.stringValue() << "\"";
+	break;
+
+      case JsonValueType::ARRAY:
+	out << "[";
+	for (const JsonValue* e = v.beginElements(); e != v.endElements();
+	     ++e) {
+	  out << ((e == v.beginElements()) ? "" : ",");
+	  dump(out, *e);
+	}
+	out << "]";
+	break;
+
+      case JsonValueType::OBJECT:
+	out << "{";
+	for (const JsonMember* m = v.beginMembers(); m != v.endMembers();
+	     ++m) {
+	  out << ((m == v.beginMembers()) ? "\"" : ",\"") << m->name()
+	      << "\":";
+	  dump(out, m->value());
+	}
+	out << "}";
+	break;
+    }
+  }
+
+  std::string dump(const JsonValue& v) {
+    std::ostringstream out;
+    dump(out, v);
+    return out.str();
+  }
+
+  /** @brief The events of @c v, as trace() writes them */
+  void traceOf(std::ostream& out, const JsonValue& v) {
+    switch (v.type()) {
+      case JsonValueType::NULL_VALUE:
+	out << "NULL_VALUE ";
+	break;
+
+      case JsonValueType::BOOL:
+	out << (v.boolValue() ? "TRUE_VALUE " : "FALSE_VALUE ");
+	break;
+
+      case JsonValueType::INT:
+	out << "INT_VALUE:" << v.intValue() << " ";
+	break;
+
+      case JsonValueType::FLOAT:
+	out << "FLOAT_VALUE:" << floatText(v.floatValue()) << " ";
+	break;
+
+      case JsonValueType::STRING:
+	out << "STRING_VALUE:" << v.stringValue() << " ";
+	break;
+
+      case JsonValueType::ARRAY:
+	out << "BEGIN_ARRAY ";
+	for (const JsonValue* e = v.beginElements(); e != v.endElements();
+	     ++e) {
+	  traceOf(out, *e);
+	}
+	out << "END_ARRAY ";
+	break;
+
+      case JsonValueType::OBJECT:
+	out << "BEGIN_OBJECT ";
+	for (const JsonMember* m = v.beginMembers(); m != v.endMembers();
+	     ++m) {
+	  out << "FIELD_NAME:" << m->name() << " ";
+	  traceOf(out, m->value());
+	}
+	out << "END_OBJECT ";
+	break;
+    }
+  }
+
+  /** @brief Read @c text into a document that copies every string,
+   *         so it outlives the stream
+   */
+  JsonDocument<> documentOf(const std::string& text) {
+    InPlaceEventStream events = streamOf(text);
+    return readDocument(events, false);
+  }
+
+  /** @brief The traceOf() the document read from @c events, traced
+   *         while the stream it may point into is still there
+   */
+  template <typename EventStream>
+  std::string traceDocument(EventStream& events, bool referenceInput) {
+    DocumentBuilder<> builder(referenceInput, 64, 256);
+    while (!builder.read(events)) {
+    }
+    std::ostringstream out;
+    traceOf(out, builder.document().root());
+    return out.str();
+  }
+
+  std::string nested(size_t depth) {
+    std::string text;
+    for (size_t i = 0; i < depth; ++i) {
+      text += (i % 2) ? "{\"a\": " : "[";
+    }
+    text += "1";
+    for (size_t i = depth; i > 0; --i) {
+      text += ((i - 1) % 2) ? "}" : "]";
+    }
+    return text;
+  }
+}
+
+TEST(DocumentBuilderTests, Scalars) {
+  EXPECT_EQ("null", dump(documentOf("null").root()));
+  EXPECT_EQ("true", dump(documentOf(" true ").root()));
+  EXPECT_EQ("i-42", dump(documentOf("-42").root()));
+  EXPECT_EQ("f2.5", dump(documentOf("2.5").root()));
+  EXPECT_EQ("\"a\\b\"", dump(documentOf("\"a\\\\b\"").root()));
+}
+
+TEST(DocumentBuilderTests, ObjectsKeepTheirKeyOrder) {
+  const auto doc = documentOf(
+      "{\"z\": 1, \"a\": {\"y\": [], \"b\": {}}, \"m\": [3, 2, 1]}"
+  );
+  EXPECT_EQ("{\"z\":i1,\"a\":{\"y\":[],\"b\":{}},\"m\":[i3,i2,i1]}",
+	    dump(doc.root()));
+  EXPECT_EQ(3u, doc.root().size());
+  EXPECT_EQ(1, doc.root().find("z")->intValue());
+  EXPECT_EQ(2, (*doc.root().find("m"))[1].intValue());
+  EXPECT_EQ(nullptr, doc.root().find("y"));
+}
+
+TEST(DocumentBuilderTests, DuplicateKeys) {
+  // Every member is kept, and find() returns the first one
+  const auto doc =
+      documentOf("{\"b\": 1, \"a\": 2, \"b\": [3], \"a\": null}");
+  EXPECT_EQ("{\"b\":i1,\"a\":i2,\"b\":[i3],\"a\":null}", dump(doc.root()));
+  EXPECT_EQ(4u, doc.root().size());
+  EXPECT_EQ(1, doc.root().find("b")->intValue());
+  EXPECT_EQ(2, doc.root().find("a")->intValue());
+}
+
+TEST(DocumentBuilderTests, DeepNesting) {
+  const size_t DEPTH = 1000;
+  const auto doc = documentOf(nested(DEPTH));
+  const JsonValue* v = &doc.root();
+  for (size_t i = 0; i < DEPTH; ++i) {
+    ASSERT_EQ(1u, v->size()) << "depth " << i;
+    if (i % 2) {
+      ASSERT_TRUE(v->isObject()) << "depth " << i;
+      EXPECT_EQ("a", v->beginMembers()->name().toString());
+      v = &v->beginMembers()->value();
+    } else {
+      ASSERT_TRUE(v->isArray()) << "depth " << i;
+      v = v->beginElements();
+    }
+  }
+  EXPECT_EQ(1, v->intValue());
+}
+
+TEST(DocumentBuilderTests, Numbers) {
+  const auto doc = documentOf(
+      "[0, -1, 9223372036854775807, -9223372036854775808, "
+      "9223372036854775808, 1e2, -0.5, 1.7976931348623157e308]"
+  );
+  EXPECT_EQ("[i0,i-1,i9223372036854775807,i-9223372036854775808,"
+	    "f9.2233720368547758e+18,f100,f-0.5,"
+	    "f1.7976931348623157e+308]",
+	    dump(doc.root()));
+}
+
+TEST(DocumentBuilderTests, StringsAndNodesLiveInTheArena) {
+  const std::string text =
+      "{\"plain\": \"abc\", \"esc\\u0041ped\": [\"x\\ny\", 12, 2.5], "
+      "\"long\": \"" + std::string(5000, 'z') + "\"}";
+
+  for (int referenceInput = 0; referenceInput < 2; ++referenceInput) {
+    Blocks blocks;
+    InPlaceEventStream events = streamOf(text);
+    DocumentBuilder<TestAllocator> builder(referenceInput, 64, 1024,
+					   TestAllocator(blocks));
+    while (!builder.read(events)) {
+    }
+    const auto doc = builder.document();
+    const JsonValue& root = doc.root();
+    ASSERT_TRUE(root.isObject());
+    ASSERT_EQ(3u, root.size());
+
+    // The nodes, numbers included, are in the arena
+    const JsonMember* members = root.beginMembers();
+    EXPECT_TRUE(blocks.contain(JsonString((const char*)&root,
+					  (const char*)(&root + 1))));
+    EXPECT_TRUE(blocks.contain(JsonString((const char*)members,
+					  (const char*)(members + 3))));
+    const JsonValue& array = members[1].value();
+    EXPECT_TRUE(blocks.contain(JsonString(
+	(const char*)array.beginElements(),
+	(const char*)array.endElements()
+    )));
+    EXPECT_EQ(12, array[1].intValue());
+    EXPECT_EQ(2.5, array[2].floatValue());
+
+    // Strings with escapes are always copied.  The rest point into the
+    // input when referenceInput is true.
+    EXPECT_EQ("escAped", members[1].name().toString());
+    EXPECT_TRUE(blocks.contain(members[1].name()));
+    EXPECT_EQ("x\ny", array[0].stringValue().toString());
+    EXPECT_TRUE(blocks.contain(array[0].stringValue()));
+    for (const JsonString& s : { members[0].name(),
+				 members[0].value().stringValue(),
+				 members[2].value().stringValue() }) {
+      EXPECT_EQ(!referenceInput, blocks.contain(s)) << s;
+    }
+    EXPECT_EQ(5000u, members[2].value().stringValue().size());
+    EXPECT_LT(0u, doc.bytesAllocated());
+  }
+}
+
+TEST(DocumentBuilderTests, MatchesTheEvents) {
+  // Random documents, read in place and a few bytes at a time, with and
+  // without referencing the input
+  std::mt19937 rng(18);
+  for (int trial = 0; trial < 300; ++trial) {
+    const std::string text = randomValue(rng, 5);
+    std::string expected = traceInPlace(text);
+    expected.erase(expected.size() - 3);
+
+    for (int referenceInput = 0; referenceInput < 2; ++referenceInput) {
+      InPlaceEventStream inPlace = streamOf(text);
+      EXPECT_EQ(expected, traceDocument(inPlace, referenceInput)) << text;
+
+      TrickleEventStream trickle("test",
+				 TrickleStream(text, 1 + rng() % 7, 40),
+				 DefaultPayloadFactory(), 16);
+      EXPECT_EQ(expected, traceDocument(trickle, referenceInput)) << text;
+    }
+  }
+}
+
+TEST(DocumentBuilderTests, ErrorsPropagate) {
+  // Syntax errors, a document nested deeper than the stream allows and
+  // a stream that ends first all reach the caller.  The builder can be
+  // reset and used again afterwards.
+  static const char* const BAD[] = {
+    "[1, 2", "{\"a\": 1,}", "[1 2]", "{\"a\" 1}", "[tru]"
+  };
+  DocumentBuilder<> builder;
+  for (const char* text : BAD) {
+    InPlaceEventStream events = streamOf(text);
+    EXPECT_THROW(builder.read(events), exceptions::JsonParseError) << text;
+    EXPECT_FALSE(builder.done()) << text;
+    builder.reset();
+  }
+
+  InPlaceEventStream unterminated = streamOf("[\"abc");
+  EXPECT_THROW(builder.read(unterminated),
+	       exceptions::JsonStringNotTerminated);
+  builder.reset();
+
+  InPlaceEventStream deep =
+      streamOf(nested(InPlaceEventStream::DEFAULT_MAX_DEPTH + 1));
+  EXPECT_THROW(builder.read(deep), exceptions::JsonParseError);
+  builder.reset();
+
+  InPlaceEventStream empty = streamOf("");
+  EXPECT_THROW(builder.read(empty), exceptions::JsonParseError);
+  builder.reset();
+
+  EXPECT_THROW(builder.document(), IllegalStateError);
+
+  InPlaceEventStream records = streamOf("[1]\n");
+  records.setMultipleValues(true);
+  ASSERT_TRUE(builder.read(records));
+  EXPECT_EQ("[i1]", dump(builder.document().root()));
+  EXPECT_THROW(builder.read(records), IllegalStateError);  // At END
+  builder.reset();
+
+  InPlaceEventStream good = streamOf("{\"a\": [true]}");
+  ASSERT_TRUE(builder.read(good));
+  EXPECT_EQ("{\"a\":[true]}", dump(builder.document().root()));
+}
+
+TEST(JsonValueTests, WrongTypesThrow) {
+  const auto doc = documentOf("[1, \"a\", {}]");
+  const JsonValue& root = doc.root();
+  EXPECT_THROW(root.intValue(), IllegalStateError);
+  EXPECT_THROW(root.beginMembers(), IllegalStateError);
+  EXPECT_THROW(root[0].stringValue(), IllegalStateError);
+  EXPECT_THROW(root[1].floatValue(), IllegalStateError);
+  EXPECT_THROW(root[2].beginElements(), IllegalStateError);
+  EXPECT_EQ(1.0, root[0].floatValue());
+  EXPECT_EQ(0u, root[0].size());
+}
@@ -0,0 +1,158 @@
+#include <pistis/json/memory/BufferPool.hpp>
+#include <pistis/json/memory/BufferPoolAllocator.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pistis::json::memory;
+
+TEST(BufferPoolTests, RoundedSize) {
+  EXPECT_EQ(64u, BufferPool::roundedSize(0));
+  EXPECT_EQ(64u, BufferPool::roundedSize(1));
+  EXPECT_EQ(64u, BufferPool::roundedSize(64));
+  EXPECT_EQ(128u, BufferPool::roundedSize(65));
+  EXPECT_EQ(4096u, BufferPool::roundedSize(4096));
+  EXPECT_EQ(8192u, BufferPool::roundedSize(4097));
+}
+
+TEST(BufferPoolTests, RecyclesBuffers) {
+  BufferPool pool;
+  void* p = pool.allocate(100);
+  void* q = pool.allocate(1000);
+  pool.deallocate(p, 100);
+  pool.deallocate(q, 1000);
+
+  // Requests of the same size class get the same buffers back, most
+  // recently returned first
+  void* r = pool.allocate(120);
+  EXPECT_EQ(p, r);
+  void* s = pool.allocate(100);
+  EXPECT_NE(p, s);
+  EXPECT_EQ(q, pool.allocate(600));
+  pool.deallocate(r, 120);
+  pool.deallocate(s, 100);
+  pool.deallocate(q, 600);
+}
+
+TEST(BufferPoolTests, Statistics) {
+  BufferPool pool(256);
+  EXPECT_EQ(256u, pool.maxBytesCached());
+
+  void* p = pool.allocate(100);   // 128 bytes
+  void* q = pool.allocate(200);   // 256 bytes
+  const BufferPoolStatistics& stats = pool.statistics();
+  EXPECT_EQ(2u, stats.numAllocated);
+  EXPECT_EQ(0u, stats.numReused);
+  EXPECT_EQ(384u, stats.bytesInUse);
+  EXPECT_EQ(384u, stats.peakBytesInUse);
+  EXPECT_EQ(0u, stats.bytesCached);
+
+  // The first buffer fits in the cache and the second does not
+  pool.deallocate(p, 100);
+  pool.deallocate(q, 200);
+  EXPECT_EQ(0u, stats.bytesInUse);
+  EXPECT_EQ(384u, stats.peakBytesInUse);
+  EXPECT_EQ(128u, stats.bytesCached);
+  EXPECT_EQ(1u, stats.numFreed);
+
+  p = pool.allocate(128);
+  EXPECT_EQ(3u, stats.numAllocated);
+  EXPECT_EQ(1u, stats.numReused);
+  EXPECT_EQ(0u, stats.bytesCached);
+  EXPECT_EQ(128u, stats.bytesInUse);
+
+  pool.resetStatistics();
+  EXPECT_EQ(0u, stats.numAllocated);
+  EXPECT_EQ(0u, stats.numReused);
+  EXPECT_EQ(0u, stats.numFreed);
+  EXPECT_EQ(128u, stats.peakBytesInUse);
+  EXPECT_EQ(128u, stats.bytesInUse);
+
+  pool.deallocate(p, 128);
+  EXPECT_EQ(128u, stats.bytesCached);
+  pool.trim();
+  EXPECT_EQ(0u, stats.bytesCached);
+  EXPECT_EQ(1u, stats.numFreed);
+}
+
+TEST(BufferPoolTests, LocalPoolIsPerThread) {
+  BufferPool* main = &BufferPool::local();
+  EXPECT_EQ(main, &BufferPool::local());
+
+  BufferPool* other = nullptr;
+  std::thread([&other]() { other = &BufferPool::local(); }).join();
+  EXPECT_NE(main, other);
+}
+
+TEST(BufferPoolAllocatorTests, Equality) {
+  BufferPool pool1;
+  BufferPool pool2;
+  BufferPoolAllocator<char> a(pool1);
+  BufferPoolAllocator<char> b(pool1);
+  BufferPoolAllocator<char> c(pool2);
+  BufferPoolAllocator<uint64_t> d(a);   // Rebound, same pool
+  BufferPoolAllocator<char> e(d);
+  BufferPoolAllocator<char> local;
+
+  EXPECT_TRUE(a == b);
+  EXPECT_FALSE(a != b);
+  EXPECT_TRUE(a != c);
+  EXPECT_FALSE(a == c);
+  EXPECT_TRUE(a == d);
+  EXPECT_TRUE(c != d);
+  EXPECT_TRUE(a == e);
+  EXPECT_TRUE(local == BufferPoolAllocator<int>());
+  EXPECT_TRUE(local == BufferPoolAllocator<char>(BufferPool::local()));
+  EXPECT_TRUE(local != a);
+}
+
+TEST(BufferPoolAllocatorTests, ContainersRecycleThroughThePool) {
+  typedef std::basic_string<char, std::char_traits<char>,
+			    BufferPoolAllocator<char> > PooledString;
+  BufferPool pool;
+  const BufferPoolAllocator<char> allocator(pool);
+  {
+    std::vector<PooledString, BufferPoolAllocator<PooledString> >
+	strings(allocator);
+    for (int i = 0; i < 100; ++i) {
+      strings.emplace_back(std::string(100 + i, 'x').c_str(), allocator);
+    }
+    EXPECT_LT(0u, pool.statistics().bytesInUse);
+  }
+  EXPECT_EQ(0u, pool.statistics().bytesInUse);
+
+  const uint64_t reused = pool.statistics().numReused;
+  PooledString s(std::string(150, 'y').c_str(), allocator);
+  EXPECT_EQ(reused + 1, pool.statistics().numReused);
+}
+
+TEST(BufferPoolAllocatorTests, BuffersReturnedAfterThePoolIsDestroyed) {
+  // Each buffer goes back to the heap, which ASan and valgrind check
+  typedef std::vector<char, BufferPoolAllocator<char> > PooledVector;
+  std::unique_ptr<PooledVector> v;
+  std::unique_ptr<BufferPool> pool(new BufferPool());
+  {
+    BufferPoolAllocator<char> allocator(*pool);
+    v.reset(new PooledVector(1000, 'x', allocator));
+    PooledVector cached(500, 'y', allocator);
+  }
+  pool.reset();
+
+  // Containers still allocate from the heap, too
+  v->resize(5000, 'z');
+  EXPECT_EQ('x', (*v)[999]);
+  EXPECT_EQ('z', (*v)[4999]);
+  v.reset();
+}
+
+TEST(BufferPoolAllocatorTests, BuffersOutliveTheirThreadsPool) {
+  std::unique_ptr<std::vector<char, BufferPoolAllocator<char> > > v;
+  std::thread([&v]() {
+    v.reset(new std::vector<char, BufferPoolAllocator<char> >(100, 'x'));
+  }).join();
+  EXPECT_TRUE(v->get_allocator() != BufferPoolAllocator<char>());
+  EXPECT_EQ(100u, v->size());
+  v.reset();
+}
@@ -0,0 +1,85 @@
+#include "../streaming/EventTraces.hpp"
+#include <pistis/json/memory/SymbolTable.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  typedef InPlaceEventStream::SymbolTableType SymbolTableType;
+
+  /** @brief A document whose field names go into @c symbols, which
+   *         every stream that reads it shares
+   */
+  struct SymbolsCase : TraceCase {
+    std::shared_ptr<SymbolTableType> symbols;
+    bool predict;
+  };
+
+  /** @brief The trace() of @c events, with the name of each field
+   *         looked up by the id fieldSymbol() gives it, and checks that
+   *         names without ids are new names that did not fit in the
+   *         table
+   */
+  template <typename EventStream>
+  std::string traceSymbols(EventStream& events) {
+    const SymbolTableType& symbols = *events.symbolTable();
+    std::ostringstream out;
+    while (true) {
+      const JsonEventType t = events.next();
+      if (t == JsonEventType::AGAIN) {
+	continue;
+      }
+      out << t;
+      if (t == JsonEventType::END) {
+	return out.str();
+      } else if (t != JsonEventType::FIELD_NAME) {
+	recordPayload(out, events, t);
+      } else if (events.fieldSymbol() != SymbolTableType::NO_SYMBOL) {
+	out << ":" << symbols.name(events.fieldSymbol());
+      } else {
+	EXPECT_EQ(symbols.maxSymbols(), symbols.size());
+	EXPECT_EQ(SymbolTableType::NO_SYMBOL,
+		  symbols.find(events.payloadText()));
+	out << ":" << events.payloadText();
+      }
+      out << " ";
+    }
+  }
+}
+
+TEST(SymbolTableTests, FieldSymbolsNameFieldNames) {
+  // Three copies of a value, so shape prediction finds field names
+  // whose ids it has cached.  The names are random strings with
+  // escapes, and every third table is too small to hold them all.
+  // Names added before parsing keep their ids.
+  checkTraces(
+      12, 600,
+      [](std::mt19937& rng, int trial) {
+	SymbolsCase c;
+	const std::string value = randomValue(rng, 3);
+	c.text = "[" + value + ", " + value + ", " + value + "]";
+	c.expected = traceInPlace(c.text);
+	c.symbols.reset(new SymbolTableType((trial % 3) ? 65536 : 4));
+	EXPECT_EQ(0, c.symbols->add(std::string("bc")));
+	EXPECT_EQ(1, c.symbols->add(std::string("\"")));
+	c.predict = trial % 2;
+	return c;
+      },
+      [](auto& events, const SymbolsCase& c) {
+	events.setSymbolTable(c.symbols.get());
+	events.setShapePrediction(c.predict);
+      },
+      [](auto& events, const SymbolsCase& c) {
+	const std::string t = traceSymbols(events);
+	EXPECT_EQ(0, c.symbols->find(std::string("bc")));
+	EXPECT_EQ(1, c.symbols->find(std::string("\"")));
+	return t;
+      }
+  );
+}
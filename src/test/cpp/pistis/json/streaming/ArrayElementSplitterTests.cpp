@@ -0,0 +1,143 @@
+#include <pistis/json/streaming/ArrayElementSplitter.hpp>
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pistis::json::exceptions;
+using namespace pistis::json::streaming;
+
+namespace {
+  std::string randomString(std::mt19937& rng) {
+    static const char* const PIECES[] = {
+      "a", ",", "[", "]", "{", "}", "\\\"", "\\\\", " ", ":", "\\n"
+    };
+    std::string s = "\"";
+    for (uint32_t n = rng() % 8; n; --n) {
+      s += PIECES[rng() % 11];
+    }
+    return s + "\"";
+  }
+
+  std::string randomValue(std::mt19937& rng, int depth) {
+    switch (depth ? rng() % 6 : rng() % 3) {
+      case 0: return std::to_string(rng() % 1000);
+      case 1: return randomString(rng);
+      case 2: return "true";
+      case 3:
+      case 4: {
+	std::string s = "[";
+	for (uint32_t n = rng() % 4; n; --n) {
+	  s += randomValue(rng, depth - 1) + ((n > 1) ? ", " : "");
+	}
+	return s + "]";
+      }
+      default: {
+	std::string s = "{\n";
+	for (uint32_t n = rng() % 4; n; --n) {
+	  s += randomString(rng) + ": " + randomValue(rng, depth - 1);
+	  s += (n > 1) ? ",\n" : "\n";
+	}
+	return s + "}";
+      }
+    }
+  }
+
+  std::vector<ArrayChunk> split(const std::string& text, size_t chunkSize,
+				bool strict) {
+    ArrayElementSplitter splitter("test", text.data(),
+				  text.data() + text.size(), chunkSize,
+				  strict);
+    std::vector<ArrayChunk> chunks;
+    ArrayChunk chunk;
+    while (splitter.next(chunk)) {
+      chunks.push_back(chunk);
+    }
+    return chunks;
+  }
+
+  std::string errorOf(const std::string& text, bool strict,
+		      size_t chunkSize = 16) {
+    try {
+      split(text, chunkSize, strict);
+    } catch(const JsonParseError& e) {
+      return e.details();
+    }
+    return "";
+  }
+}
+
+TEST(ArrayElementSplitterTests, ChunksHoldWholeElements) {
+  std::mt19937 rng(17);
+  for (int trial = 0; trial < 2000; ++trial) {
+    std::string elements;
+    for (uint32_t n = rng() % 40; n; --n) {
+      elements += randomValue(rng, 3) + ((n > 1) ? "," : "");
+    }
+    const std::string text = " [" + elements + "]\n";
+
+    const size_t chunkSize = 1 + rng() % 200;
+    const std::vector<ArrayChunk> chunks = split(text, chunkSize, true);
+
+    // Chunks are cut at the commas between elements, so putting them
+    // back together with commas gives back the elements
+    std::string actual;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      ASSERT_EQ(i, chunks[i].index);
+      ASSERT_EQ((uint64_t)(chunks[i].begin - text.data()),
+		chunks[i].offset);
+      actual += (i ? "," : "") + std::string(chunks[i].begin,
+					       chunks[i].end);
+    }
+    ASSERT_EQ(elements, actual) << "chunk size = " << chunkSize;
+    ASSERT_EQ(elements.empty(), chunks.empty());
+  }
+}
+
+TEST(ArrayElementSplitterTests, SmallChunksHoldOneElement) {
+  const std::string text = "[1, \"a,]\\\"\", [2, 3], {\"b\": [4]}]";
+  const std::vector<ArrayChunk> chunks = split(text, 1, true);
+
+  ASSERT_EQ(4u, chunks.size());
+  EXPECT_EQ("1", std::string(chunks[0].begin, chunks[0].end));
+  EXPECT_EQ(" \"a,]\\\"\"", std::string(chunks[1].begin, chunks[1].end));
+  EXPECT_EQ(" [2, 3]", std::string(chunks[2].begin, chunks[2].end));
+  EXPECT_EQ(" {\"b\": [4]}", std::string(chunks[3].begin, chunks[3].end));
+}
+
+TEST(ArrayElementSplitterTests, EmptyArray) {
+  EXPECT_TRUE(split("[]", 16, true).empty());
+  EXPECT_TRUE(split(" [ \n ] ", 16, true).empty());
+}
+
+TEST(ArrayElementSplitterTests, Errors) {
+  EXPECT_NE(std::string::npos, errorOf("{}", false).find("\"[\" expected"));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, 2", false).find("Array not terminated"));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, \"]", false).find("Array not terminated"));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, 2, ]", false, 1).find("Value expected"));
+}
+
+TEST(ArrayElementSplitterTests, StrictModeChecksTheEnd) {
+  EXPECT_EQ("", errorOf("[1, 2} x", false));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, 2}", true).find("\"]\" expected"));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, 2] x", true).find("Text after the end"));
+  EXPECT_EQ("", errorOf("[1, 2]\n", true));
+}
+
+TEST(ArrayElementSplitterTests, ErrorsSayWhere) {
+  try {
+    split("[1,\n 2,\n ]", 1, false);
+    FAIL() << "Expected a JsonParseError";
+  } catch(const JsonParseError& e) {
+    EXPECT_EQ(3u, e.origin().line());
+    EXPECT_EQ(2u, e.origin().column());
+    EXPECT_EQ(9u, e.origin().offset());
+    EXPECT_NE(std::string::npos, e.details().find("of test"));
+  }
+}
@@ -0,0 +1,110 @@
+#include "EventTraces.hpp"
+#include <pistis/json/streaming/CompactJsonEvent.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::exceptions;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief A document to read with nextBatch() */
+  struct BatchCase : TraceCase {
+    size_t batchSize;
+    bool withOffsets;
+
+    /** @brief True if the document has an error.  The batch that finds
+     *         it loses the events before it, so only the errors are
+     *         compared.
+     */
+    bool bad;
+
+    std::string compared(const std::string& t) const {
+      return bad ? t.substr(std::min(t.size(), t.find("ERROR"))) : t;
+    }
+  };
+
+  /** @brief The trace() of @c events, read with nextBatch() in batches
+   *         of up to @c batchSize events
+   */
+  template <typename EventStream>
+  std::string traceBatches(EventStream& events, size_t batchSize,
+			   bool withOffsets) {
+    std::vector<CompactJsonEvent> batch(batchSize);
+    std::ostringstream out;
+    try {
+      while (true) {
+	const size_t n =
+	    events.nextBatch(batch.data(), batchSize, withOffsets);
+	for (size_t i = 0; i < n; ++i) {
+	  const CompactJsonEvent& evt = batch[i];
+	  if (evt.type == JsonEventType::AGAIN) {
+	    continue;
+	  }
+	  out << evt.type;
+	  if (withOffsets) {
+	    out << "@" << evt.origin.offset();
+	  }
+	  switch (evt.type) {
+	    case JsonEventType::FIELD_NAME:
+	    case JsonEventType::STRING_VALUE:
+	    case JsonEventType::STRING_CHUNK:
+	      out << ":" << events.payloadText(evt);
+	      break;
+
+	    case JsonEventType::INT_VALUE:
+	      out << ":" << events.intPayload(evt);
+	      break;
+
+	    case JsonEventType::FLOAT_VALUE:
+	      out << ":" << floatText(events.floatPayload(evt));
+	      break;
+
+	    case JsonEventType::END:
+	      return out.str();
+
+	    default:
+	      break;
+	  }
+	  out << " ";
+	}
+      }
+    } catch(const JsonParseError& e) {
+      out << "ERROR(" << e.origin().offset() << ")";
+    }
+    return out.str();
+  }
+}
+
+TEST(CompactJsonEventTests, NextBatchMatchesNext) {
+  checkTraces(
+      9, 300,
+      [](std::mt19937& rng, int trial) {
+	// Every fifth document has an error
+	BatchCase c;
+	c.bad = !(trial % 5);
+	c.text = randomValue(rng, 4);
+	if (c.bad) {
+	  c.text = "[" + c.text + ((trial % 2) ? ", ]" : " 1]");
+	}
+	c.batchSize = 1 + rng() % 20;
+	c.withOffsets = rng() % 2;
+	c.context = ", batch size " + std::to_string(c.batchSize);
+
+	InPlaceEventStream events = streamOf(c.text);
+	c.expected = c.compared(
+	    trace(events, []() { return false; }, c.withOffsets)
+	);
+	EXPECT_NE("", c.expected) << c.text;
+	return c;
+      },
+      [](auto& events, const BatchCase& c) {
+	return c.compared(traceBatches(events, c.batchSize, c.withOffsets));
+      }
+  );
+}
@@ -0,0 +1,315 @@
+/** @file EventTraces.hpp
+ *
+ *  Helpers the event stream tests share: a stream that hands out its
+ *  text a few bytes at a time, trace(), which writes down the events a
+ *  stream returns, random documents, and checkTraces(), which reads
+ *  random documents in place and a few bytes at a time and compares
+ *  their traces against what a test expects.
+ */
+#ifndef __PISTIS__JSON__STREAMING__EVENTTRACES_HPP__
+#define __PISTIS__JSON__STREAMING__EVENTTRACES_HPP__
+
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/streaming/PathProjection.hpp>
+#include <pistis/json/streaming/detail/InMemoryStreamAdapter.hpp>
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace testing {
+
+	/** @brief Stream that hands out its text a few bytes at a time
+	 *         and, if asked to, says it has no data yet (returns -1)
+	 *         at random.
+	 *
+	 *  It has no begin() or end(), so the reader copies its text into
+	 *  a buffer instead of parsing it in place.
+	 */
+	class TrickleStream {
+	public:
+	  TrickleStream(const std::string& text, size_t maxRead,
+			uint32_t againPercent, uint32_t seed = 1):
+	      text_(text), position_(0), maxRead_(maxRead),
+	      againPercent_(againPercent), rng_(seed) {
+	  }
+
+	  ssize_t read(char* buffer, size_t n) {
+	    if ((rng_() % 100) < againPercent_) {
+	      return -1;
+	    }
+	    n = std::min(std::min(n, 1 + rng_() % maxRead_),
+			 text_.size() - position_);
+	    ::memcpy(buffer, text_.data() + position_, n);
+	    position_ += n;
+	    return n;
+	  }
+
+	private:
+	  std::string text_;
+	  size_t position_;
+	  size_t maxRead_;
+	  uint32_t againPercent_;
+	  std::mt19937 rng_;
+	};
+
+	typedef FlexibleEventStream<detail::InMemoryStreamAdapter,
+				    DefaultPayloadFactory> InPlaceEventStream;
+	typedef FlexibleEventStream<TrickleStream, DefaultPayloadFactory>
+	        TrickleEventStream;
+
+	inline InPlaceEventStream streamOf(
+	    const std::string& text, size_t bufferSize = 16,
+	    const PathProjection& projection = PathProjection()
+	) {
+	  return InPlaceEventStream("test", detail::InMemoryStreamAdapter(text),
+				    DefaultPayloadFactory(), bufferSize,
+				    projection);
+	}
+
+	inline std::string floatText(double v) {
+	  std::ostringstream out;
+	  out.precision(17);
+	  out << v;
+	  return out.str();
+	}
+
+	/** @brief Write the payload of an event of type @c t, if it has
+	 *         one trace() records
+	 */
+	template <typename EventStream>
+	void recordPayload(std::ostream& out, EventStream& events,
+			   JsonEventType t) {
+	  switch (t) {
+	    case JsonEventType::FIELD_NAME:
+	    case JsonEventType::STRING_VALUE:
+	    case JsonEventType::STRING_CHUNK:
+	      out << ":" << events.payloadText();
+	      break;
+
+	    case JsonEventType::INT_VALUE:
+	      out << ":" << events.intPayload();
+	      break;
+
+	    case JsonEventType::FLOAT_VALUE:
+	      out << ":" << floatText(events.floatPayload());
+	      break;
+
+	    default:
+	      break;
+	  }
+	}
+
+	/** @brief Says to skip about @c percent of the values trace() asks
+	 *         about, the same ones every time for the same @c seed
+	 */
+	class RandomSkips {
+	public:
+	  RandomSkips(uint32_t seed, uint32_t percent):
+	      rng_(seed), percent_(percent) {
+	  }
+
+	  bool operator()() { return percent_ && ((rng_() % 100) < percent_); }
+
+	private:
+	  std::mt19937 rng_;
+	  uint32_t percent_;
+	};
+
+	/** @brief Records the events a stream returns, with their
+	 *         payloads, as one line of text, skipping every value
+	 *         @c skip says to.
+	 *
+	 *  Skipped values show up as "SKIPPED".  AGAIN is not recorded, so
+	 *  the trace is the same no matter how the stream's data arrives.
+	 *  The offset of each event follows it if @c withOffsets is true.
+	 */
+	template <typename EventStream, typename SkipPredicate>
+	std::string trace(EventStream& events, SkipPredicate skip,
+			  bool withOffsets = false) {
+	  std::ostringstream out;
+	  try {
+	    while (true) {
+	      const JsonEventType t = events.next();
+	      if (t == JsonEventType::AGAIN) {
+		continue;
+	      }
+	      out << t;
+	      if (withOffsets) {
+		out << "@" << events.origin().offset();
+	      }
+	      if (t == JsonEventType::END) {
+		return out.str();
+	      }
+	      recordPayload(out, events, t);
+	      out << " ";
+
+	      if (((t == JsonEventType::FIELD_NAME) ||
+		   (t == JsonEventType::BEGIN_OBJECT) ||
+		   (t == JsonEventType::BEGIN_ARRAY)) && skip()) {
+		while (!events.skipValue()) {
+		}
+		out << "SKIPPED ";
+	      }
+	    }
+	  } catch(const exceptions::JsonParseError& e) {
+	    out << "ERROR(" << e.origin().offset() << ")";
+	  }
+	  return out.str();
+	}
+
+	template <typename EventStream>
+	std::string trace(EventStream& events) {
+	  return trace(events, []() { return false; });
+	}
+
+	inline std::string traceInPlace(const std::string& text) {
+	  InPlaceEventStream events = streamOf(text);
+	  return trace(events);
+	}
+
+	inline std::string traceTrickle(const std::string& text,
+					size_t maxRead,
+					uint32_t againPercent) {
+	  TrickleEventStream events("test",
+				    TrickleStream(text, maxRead, againPercent),
+				    DefaultPayloadFactory(), 16);
+	  return trace(events);
+	}
+
+	inline std::string randomString(std::mt19937& rng) {
+	  static const char* const PIECES[] = {
+	    "a", "bc", " ", "[", "}", ",", "\\\"", "\\\\", "\\n", "\\u0041"
+	  };
+	  std::string s = "\"";
+	  for (uint32_t n = rng() % 6; n; --n) {
+	    s += PIECES[rng() % 10];
+	  }
+	  return s + "\"";
+	}
+
+	/** @brief A random value nested at most @c depth deep.  Objects
+	 *         put each field on a line of its own.
+	 */
+	inline std::string randomValue(std::mt19937& rng, int depth) {
+	  switch (depth ? rng() % 9 : rng() % 6) {
+	    case 0: return std::to_string((int32_t)rng() % 100000);
+	    case 1: return std::to_string(rng() % 1000) + ".25e-1";
+	    case 2: return randomString(rng);
+	    case 3: return "true";
+	    case 4: return "false";
+	    case 5: return "null";
+	    case 6:
+	    case 7: {
+	      std::string s = "[";
+	      for (uint32_t n = rng() % 4; n; --n) {
+		s += randomValue(rng, depth - 1) + ((n > 1) ? ", " : "");
+	      }
+	      return s + "]";
+	    }
+	    default: {
+	      std::string s = "{\n";
+	      for (uint32_t n = rng() % 4; n; --n) {
+		s += randomString(rng) + ": " + randomValue(rng, depth - 1);
+		s += (n > 1) ? ",\n" : "\n";
+	      }
+	      return s + "}";
+	    }
+	  }
+	}
+
+	/** @brief A document for checkTrace() to read, and the trace it
+	 *         expects.  Tests that need more put it in a subclass.
+	 */
+	struct TraceCase {
+	  /** @brief The document */
+	  std::string text;
+
+	  /** @brief The trace every stream must give */
+	  std::string expected;
+
+	  /** @brief Seeds the random choices made while tracing, such as
+	   *         RandomSkips, so every stream makes the same ones
+	   */
+	  uint32_t seed;
+
+	  /** @brief Size of the streams' buffers */
+	  size_t bufferSize;
+
+	  /** @brief Projection the streams are created with */
+	  PathProjection projection;
+
+	  /** @brief Printed after the text when a trace differs */
+	  std::string context;
+
+	  TraceCase(): text(), expected(), seed(0), bufferSize(16),
+		       projection(), context() {
+	  }
+	};
+
+	/** @brief For checkTrace() callers that leave the streams as they
+	 *         are created
+	 */
+	struct NoConfiguration {
+	  template <typename EventStream, typename Case>
+	  void operator()(EventStream&, const Case&) const { }
+	};
+
+	/** @brief Read @c c.text in place, then a few bytes at a time,
+	 *         through a TrickleStream that hands out 1 to @c maxRead
+	 *         bytes per read and returns AGAIN @c againPercent of the
+	 *         time, and check that both streams give @c c.expected.
+	 *
+	 *  configure(events, c) sets each stream up before it is read, and
+	 *  traceOf(events, c) reads it and returns its trace.
+	 */
+	template <typename Case, typename Configure, typename Trace>
+	void checkTrace(const Case& c, size_t maxRead, uint32_t againPercent,
+			Configure configure, Trace traceOf) {
+	  InPlaceEventStream inPlace = streamOf(c.text, c.bufferSize,
+						c.projection);
+	  configure(inPlace, c);
+	  EXPECT_EQ(c.expected, traceOf(inPlace, c))
+	      << "in place: " << c.text << c.context;
+
+	  TrickleEventStream trickle(
+	      "test", TrickleStream(c.text, maxRead, againPercent, c.seed),
+	      DefaultPayloadFactory(), c.bufferSize, c.projection
+	  );
+	  configure(trickle, c);
+	  EXPECT_EQ(c.expected, traceOf(trickle, c))
+	      << "a few bytes at a time: " << c.text << c.context;
+	}
+
+	/** @brief Run checkTrace() on @c numTrials documents made by
+	 *         makeCase(rng, trial), reading each out of place 1 to 7
+	 *         bytes at a time with AGAIN 40% of the time
+	 */
+	template <typename MakeCase, typename Configure, typename Trace>
+	void checkTraces(uint32_t seed, int numTrials, MakeCase makeCase,
+			 Configure configure, Trace traceOf) {
+	  std::mt19937 rng(seed);
+	  for (int trial = 0; trial < numTrials; ++trial) {
+	    const auto c = makeCase(rng, trial);
+	    checkTrace(c, 1 + rng() % 7, 40, configure, traceOf);
+	  }
+	}
+
+	template <typename MakeCase, typename Trace>
+	void checkTraces(uint32_t seed, int numTrials, MakeCase makeCase,
+			 Trace traceOf) {
+	  checkTraces(seed, numTrials, makeCase, NoConfiguration(), traceOf);
+	}
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,108 @@
+#include "EventTraces.hpp"
+#include <pistis/json/util/Base64Decoder.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  std::string encodeBase64(const std::string& data) {
+    static const char ALPHABET[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    for (size_t i = 0; i < data.size(); i += 3) {
+      uint32_t v = 0;
+      for (size_t j = 0; j < 3; ++j) {
+	v = (v << 8) | (((i + j) < data.size()) ? (uint8_t)data[i + j] : 0);
+      }
+      for (size_t j = 0; j < 4; ++j) {
+	text += ((i + j) <= data.size()) ? ALPHABET[(v >> (18 - 6 * j)) & 0x3F]
+	                                 : '=';
+      }
+    }
+    return text;
+  }
+
+  /** @brief Each blob in hex, one after the other */
+  std::string hexOf(const std::vector<std::string>& blobs) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string text;
+    for (const std::string& blob : blobs) {
+      for (char c : blob) {
+	text += DIGITS[(uint8_t)c >> 4];
+	text += DIGITS[(uint8_t)c & 0xF];
+      }
+      text += " ";
+    }
+    return text;
+  }
+
+  /** @brief Decode every string @c events returns as base64 with
+   *         base64Payload(), whether it arrives whole or in parts
+   */
+  template <typename EventStream>
+  std::vector<std::string> decodeBase64Strings(EventStream& events) {
+    util::Base64Decoder decoder;
+    std::vector<std::string> decoded;
+    std::string blob;
+    std::vector<uint8_t> out;
+    JsonEventType t;
+    while ((t = events.next()) != JsonEventType::END) {
+      if ((t == JsonEventType::STRING_VALUE) ||
+	  (t == JsonEventType::STRING_CHUNK)) {
+	out.resize(util::Base64Decoder::maxDecodedSize(
+	    events.payloadText().size()
+	));
+	blob.append((const char*)out.data(),
+		    events.base64Payload(decoder, out.data()));
+      }
+      if ((t == JsonEventType::STRING_VALUE) ||
+	  (t == JsonEventType::STRING_END)) {
+	out.resize(2);
+	blob.append((const char*)out.data(), decoder.finish(out.data()));
+	decoded.push_back(blob);
+	blob.clear();
+      }
+    }
+    return decoded;
+  }
+
+  struct Base64Case : TraceCase {
+    size_t chunkSize;
+  };
+}
+
+TEST(FlexibleEventStreamBase64Tests, Base64PayloadOfSplitStrings) {
+  // Blobs of every length around the chunk size, read whole and in
+  // parts, decode to the same bytes
+  checkTraces(
+      23, 300,
+      [](std::mt19937& rng, int) {
+	Base64Case c;
+	std::vector<std::string> blobs;
+	c.text = "[";
+	for (uint32_t n = 1 + rng() % 4; n; --n) {
+	  std::string blob;
+	  for (uint32_t i = rng() % 300; i; --i) {
+	    blob += (char)rng();
+	  }
+	  blobs.push_back(blob);
+	  c.text += "\"" + encodeBase64(blob) + "\"" + ((n > 1) ? ", " : "]");
+	}
+	c.expected = hexOf(blobs);
+	c.chunkSize = rng() % 64;
+	c.context = ", chunk size " + std::to_string(c.chunkSize);
+	return c;
+      },
+      [](auto& events, const Base64Case& c) {
+	events.setStringChunkSize(c.chunkSize);
+      },
+      [](auto& events, const Base64Case&) {
+	return hexOf(decodeBase64Strings(events));
+      }
+  );
+}
@@ -0,0 +1,89 @@
+#include "EventTraces.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace pistis::json;
+using namespace pistis::json::exceptions;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+
+  /** @brief The trace() of a stream that splits strings, with the
+   *         STRING_CHUNK parts of each string and its STRING_END joined
+   *         into one STRING_VALUE.  Checks that strings that arrive
+   *         whole are no longer than the stream's chunk size.
+   */
+  template <typename EventStream, typename SkipPredicate>
+  std::string traceJoined(EventStream& events, SkipPredicate skip) {
+    std::ostringstream out;
+    std::string joined;
+    try {
+      while (true) {
+	const JsonEventType t = events.next();
+	if (t == JsonEventType::AGAIN) {
+	  continue;
+	} else if (t == JsonEventType::STRING_CHUNK) {
+	  joined.append(events.payloadText().begin(),
+			events.payloadText().end());
+	  continue;
+	} else if (t == JsonEventType::STRING_END) {
+	  out << JsonEventType::STRING_VALUE << ":" << joined << " ";
+	  joined.clear();
+	  continue;
+	} else if (t == JsonEventType::STRING_VALUE) {
+	  EXPECT_GE(events.stringChunkSize(), events.payloadText().size());
+	}
+
+	out << t;
+	if (t == JsonEventType::END) {
+	  return out.str();
+	}
+	recordPayload(out, events, t);
+	out << " ";
+
+	if (((t == JsonEventType::FIELD_NAME) ||
+	     (t == JsonEventType::BEGIN_OBJECT) ||
+	     (t == JsonEventType::BEGIN_ARRAY)) && skip()) {
+	  while (!events.skipValue()) {
+	  }
+	  out << "SKIPPED ";
+	}
+      }
+    } catch(const JsonParseError& e) {
+      out << "ERROR(" << e.origin().offset() << ")";
+    }
+    return out.str();
+  }
+
+  struct ChunkCase : TraceCase {
+    size_t chunkSize;
+    uint32_t skipPercent;
+  };
+}
+
+TEST(FlexibleEventStreamChunkTests, StringChunksJoinToStrings) {
+  // Every other document skips some of its values
+  checkTraces(
+      22, 500,
+      [](std::mt19937& rng, int trial) {
+	ChunkCase c;
+	c.text = randomValue(rng, 4);
+	c.chunkSize = 1 + rng() % 12;
+	c.seed = rng();
+	c.skipPercent = (trial % 2) ? 0 : 20;
+	c.context = ", chunk size " + std::to_string(c.chunkSize);
+	InPlaceEventStream events = streamOf(c.text);
+	c.expected = trace(events, RandomSkips(c.seed, c.skipPercent));
+	return c;
+      },
+      [](auto& events, const ChunkCase& c) {
+	events.setStringChunkSize(c.chunkSize);
+      },
+      [](auto& events, const ChunkCase& c) {
+	return traceJoined(events, RandomSkips(c.seed, c.skipPercent));
+      }
+  );
+}
@@ -0,0 +1,79 @@
+#include "EventTraces.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief The events of a stream of records and the text of their
+   *         payloads, written out at the end of each record from the
+   *         payloads the stream returned, which must still be valid
+   *         if @c events pins its buffers.  Releases the buffers after
+   *         each record.
+   */
+  template <typename EventStream>
+  std::string tracePinned(EventStream& events) {
+    std::vector<std::pair<JsonEventType, JsonString> > record;
+    std::ostringstream out;
+    while (true) {
+      const JsonEventType t = events.next();
+      if (t == JsonEventType::AGAIN) {
+	continue;
+      }
+      record.emplace_back(t, events.payloadText());
+      if (events.pinBuffers() && (t != JsonEventType::END_RECORD) &&
+	  (t != JsonEventType::END)) {
+	continue;
+      }
+      for (const auto& evt : record) {
+	out << evt.first;
+	if ((evt.first == JsonEventType::FIELD_NAME) ||
+	    (evt.first == JsonEventType::STRING_VALUE) ||
+	    (evt.first == JsonEventType::INT_VALUE) ||
+	    (evt.first == JsonEventType::FLOAT_VALUE)) {
+	  out << ":" << evt.second;
+	}
+	out << " ";
+      }
+      record.clear();
+      events.releaseBuffers();
+      if (t == JsonEventType::END) {
+	return out.str();
+      }
+    }
+  }
+}
+
+TEST(FlexibleEventStreamPinningTests, PinnedPayloadsLastUntilReleased) {
+  // Records long enough to span several buffers, read a few bytes at a
+  // time, so payloads are split across refills
+  checkTraces(
+      21, 200,
+      [](std::mt19937& rng, int) {
+	TraceCase c;
+	for (uint32_t n = 1 + rng() % 6; n; --n) {
+	  std::string record = randomValue(rng, 4);
+	  std::replace(record.begin(), record.end(), '\n', ' ');
+	  c.text += record + "\n";
+	}
+	c.bufferSize = 16 << (rng() % 3);
+	c.seed = rng();
+	InPlaceEventStream events = streamOf(c.text);
+	events.setMultipleValues(true);
+	c.expected = tracePinned(events);
+	return c;
+      },
+      [](auto& events, const TraceCase&) {
+	events.setMultipleValues(true);
+	events.setPinBuffers(true);
+      },
+      [](auto& events, const TraceCase&) { return tracePinned(events); }
+  );
+}
@@ -0,0 +1,116 @@
+#include "EventTraces.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::exceptions;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+
+  /** @brief The trace() of a stream of records, which skips each
+   *         record @c skip says to after its first event, and skips
+   *         the rest of each record that has an error
+   */
+  template <typename EventStream>
+  std::string traceRecords(EventStream& events,
+			   const std::vector<bool>& skip) {
+    std::ostringstream out;
+    size_t record = 0;
+    bool first = true;
+    while (true) {
+      try {
+	const JsonEventType t = events.next();
+	if (t == JsonEventType::AGAIN) {
+	  continue;
+	}
+	out << t;
+	if (t == JsonEventType::END) {
+	  return out.str();
+	}
+	recordPayload(out, events, t);
+	out << " ";
+	if (t == JsonEventType::END_RECORD) {
+	  ++record;
+	  first = true;
+	} else if (first && skip[record]) {
+	  while (!events.skipRecord()) {
+	  }
+	  out << "SKIPPED ";
+	  ++record;
+	} else {
+	  first = false;
+	}
+      } catch(const JsonParseError& e) {
+	out << "ERROR(" << e.origin().offset() << ") ";
+	while (!events.skipRecord()) {
+	}
+	++record;
+	first = true;
+      }
+    }
+  }
+
+  struct RecordCase : TraceCase {
+    std::vector<bool> skip;
+  };
+
+  /** @brief Records, one per line, some of them malformed and some
+   *         skipped after their first event, and the events each gives
+   *         on its own, with its offsets moved to where its line starts
+   */
+  RecordCase randomRecordCase(std::mt19937& rng) {
+    static const char* const BAD_RECORDS[] = {
+      "[1 2]", "{\"a\" 1}", "[1, ]", "{\"a\": tru}", "[\"x\", }"
+    };
+    static const char* const SEPARATORS[] = { "\n", "\r\n", "\n\n  " };
+    RecordCase c;
+    for (uint32_t n = rng() % 8; n; --n) {
+      std::string record = randomValue(rng, 3);
+      std::replace(record.begin(), record.end(), '\n', ' ');
+      if (!(rng() % 6)) {
+	record = BAD_RECORDS[rng() % 5];
+      }
+      c.skip.push_back(!(rng() % 5));
+
+      std::string events = traceInPlace(record);
+      const size_t error = events.find("ERROR(");
+      if (error != std::string::npos) {
+	const uint64_t offset = std::stoull(events.substr(error + 6));
+	events = events.substr(0, error) + "ERROR(" +
+		 std::to_string(offset + c.text.size()) + ") ";
+	c.skip.back() = false;
+      } else if (c.skip.back()) {
+	InPlaceEventStream first = streamOf(record);
+	const JsonEventType t = first.next();
+	std::ostringstream out;
+	out << t;
+	recordPayload(out, first, t);
+	events = out.str() + " SKIPPED ";
+      } else {
+	events.replace(events.size() - 3, 3, "END_RECORD ");
+      }
+      c.expected += events;
+      c.text += record + SEPARATORS[rng() % 3];
+    }
+    c.expected += "END";
+    c.skip.push_back(false);
+    return c;
+  }
+}
+
+TEST(FlexibleEventStreamRecordTests, RecordsMatchSeparateDocuments) {
+  checkTraces(
+      15, 300,
+      [](std::mt19937& rng, int) { return randomRecordCase(rng); },
+      [](auto& events, const RecordCase&) { events.setMultipleValues(true); },
+      [](auto& events, const RecordCase& c) {
+	return traceRecords(events, c.skip);
+      }
+  );
+}
@@ -0,0 +1,74 @@
+#include "EventTraces.hpp"
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief Skips the values whose numbers, counting from one in the
+   *         order trace() asks about them, are in @c skipped
+   */
+  auto skipNumbers(std::initializer_list<uint32_t> skipped) {
+    return [n = 0u, skipped = std::vector<uint32_t>(skipped)]() mutable {
+      ++n;
+      return std::find(skipped.begin(), skipped.end(), n) != skipped.end();
+    };
+  }
+}
+
+TEST(FlexibleEventStreamSkipTests, SkipValue) {
+  const std::string text =
+      "{\"a\": {\"x\": \"]}\\\"\"}, \"b\": [1, [2]], \"c\": 3}";
+  InPlaceEventStream events = streamOf(text);
+  EXPECT_EQ("BEGIN_OBJECT FIELD_NAME:a SKIPPED FIELD_NAME:b BEGIN_ARRAY "
+	    "SKIPPED FIELD_NAME:c INT_VALUE:3 END_OBJECT END",
+	    trace(events, skipNumbers({ 2, 4 })));
+}
+
+TEST(FlexibleEventStreamSkipTests, SkipValueWithAgain) {
+  checkTraces(
+      26, 500,
+      [](std::mt19937& rng, int) {
+	TraceCase c;
+	c.text = randomValue(rng, 4);
+	c.seed = rng();
+	InPlaceEventStream events = streamOf(c.text);
+	c.expected = trace(events, RandomSkips(c.seed, 33));
+	return c;
+      },
+      [](auto& events, const TraceCase& c) {
+	return trace(events, RandomSkips(c.seed, 33));
+      }
+  );
+}
+
+TEST(FlexibleEventStreamSkipTests, SkipValueRejectsMissingValue) {
+  // skipValue() must fail where next() would, not skip an empty value
+  static const char* const CASES[] = {
+    "{\"a\": }", "{\"a\": ]}", "{\"a\": , \"b\": 1}", "{\"a\"::1}",
+    "{\"a\": "
+  };
+  for (const char* text : CASES) {
+    TraceCase c;
+    c.text = text;
+    c.expected = traceInPlace(text);
+    ASSERT_EQ("ERROR(", c.expected.substr(26, 6)) << text;
+    checkTrace(c, 2, 50, NoConfiguration(),
+	       [](auto& events, const TraceCase&) {
+		 return trace(events, skipNumbers({ 2 }));
+	       });
+  }
+}
+
+TEST(FlexibleEventStreamSkipTests, SkipValueOutOfPlace) {
+  InPlaceEventStream events = streamOf("[1]");
+  EXPECT_EQ(JsonEventType::BEGIN_ARRAY, events.next());
+  EXPECT_EQ(JsonEventType::INT_VALUE, events.next());
+  EXPECT_THROW(events.skipValue(), pistis::exceptions::IllegalStateError);
+}
@@ -0,0 +1,88 @@
+#include "EventTraces.hpp"
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+TEST(FlexibleEventStreamTests, EventSequence) {
+  const std::string text =
+      "{\"a\": [1, -2.5, \"x\\ty\", true, false, null],\n"
+      " \"b\": {}, \"c\": [], \"d\": {\"e\": [[]]}}";
+  const std::string expected =
+      "BEGIN_OBJECT FIELD_NAME:a BEGIN_ARRAY INT_VALUE:1 "
+      "FLOAT_VALUE:-2.5 STRING_VALUE:x\ty TRUE_VALUE FALSE_VALUE "
+      "NULL_VALUE END_ARRAY FIELD_NAME:b BEGIN_OBJECT END_OBJECT "
+      "FIELD_NAME:c BEGIN_ARRAY END_ARRAY FIELD_NAME:d BEGIN_OBJECT "
+      "FIELD_NAME:e BEGIN_ARRAY BEGIN_ARRAY END_ARRAY END_ARRAY "
+      "END_OBJECT END_OBJECT END";
+
+  EXPECT_EQ(expected, traceInPlace(text));
+  EXPECT_EQ(expected, traceTrickle(text, 1, 0));
+  EXPECT_EQ(expected, traceTrickle(text, 5, 50));
+}
+
+TEST(FlexibleEventStreamTests, ScalarDocuments) {
+  EXPECT_EQ("INT_VALUE:42 END", traceInPlace(" 42 "));
+  EXPECT_EQ("STRING_VALUE:A END", traceInPlace("\"\\u0041\""));
+  EXPECT_EQ("NULL_VALUE END", traceTrickle("null", 1, 50));
+  EXPECT_EQ("ERROR(0)", traceInPlace(""));  // No value at all
+}
+
+TEST(FlexibleEventStreamTests, Errors) {
+  EXPECT_EQ("BEGIN_ARRAY INT_VALUE:1 ERROR(3)", traceInPlace("[1 2]"));
+  EXPECT_EQ("BEGIN_OBJECT ERROR(1)", traceInPlace("{1: 2}"));
+  EXPECT_EQ("BEGIN_ARRAY INT_VALUE:1 ERROR(3)",
+	    traceTrickle("[1 2]", 1, 50));
+}
+
+TEST(FlexibleEventStreamTests, AgainDoesNotChangeEvents) {
+  checkTraces(
+      25, 500,
+      [](std::mt19937& rng, int) {
+	TraceCase c;
+	c.text = randomValue(rng, 4);
+	c.expected = traceInPlace(c.text);
+	EXPECT_EQ("END", c.expected.substr(c.expected.size() - 3)) << c.text;
+	return c;
+      },
+      [](auto& events, const TraceCase&) { return trace(events); }
+  );
+}
+
+TEST(FlexibleEventStreamTests, MaxDepth) {
+  // Nested exactly as deeply as allowed, then one level more
+  static const char* const DOCUMENTS[][2] = {
+    { "[[[1]]]", "[[[[1]]]]" },
+    { "{\"a\": [{}]}", "{\"a\": [{\"b\": {}}]}" }
+  };
+  for (const auto& documents : DOCUMENTS) {
+    InPlaceEventStream events = streamOf(documents[0]);
+    events.setMaxDepth(3);
+    EXPECT_EQ(3u, events.maxDepth());
+    const std::string expected = trace(events);
+    EXPECT_EQ("END", expected.substr(expected.size() - 3)) << expected;
+
+    InPlaceEventStream deeper = streamOf(documents[1]);
+    deeper.setMaxDepth(3);
+    try {
+      while (deeper.next() != JsonEventType::END) {
+      }
+      ADD_FAILURE() << documents[1] << " did not throw";
+    } catch(const exceptions::JsonParseError& e) {
+      EXPECT_NE(std::string::npos, e.details().find("3 deep"))
+	  << e.details();
+    }
+  }
+
+  // The limit can't go below the objects and arrays open now
+  InPlaceEventStream events = streamOf("[[1]]");
+  events.next();
+  events.next();
+  EXPECT_THROW(events.setMaxDepth(1), pistis::exceptions::IllegalValueError);
+  events.setMaxDepth(2);
+  EXPECT_EQ(JsonEventType::INT_VALUE, events.next());
+}
@@ -0,0 +1,267 @@
+#include "EventTraces.hpp"
+#include "TemporaryFile.hpp"
+#include <pistis/json/streaming/FlexibleStreamingJsonParser.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace pistis::exceptions;
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  typedef FlexibleStreamingJsonParser<DefaultPayloadFactory> Parser;
+
+  const std::string DOCUMENT =
+      "{\"a\": [1, -2.5, \"x\\ty\", true, false, null],\n"
+      " \"b\": {\"c\": \"a string longer than the buffer\"}, \"d\": []}";
+
+  /** @brief A document a few times the size of the parsers' buffers */
+  std::string randomDocument(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::string text = "[";
+    for (int i = 0; i < 20; ++i) {
+      text += randomValue(rng, 3) + ", ";
+    }
+    return text + "null]";
+  }
+
+  /** @brief Descriptor opened on @c filename, closed when the object is
+   *         destroyed
+   */
+  class OpenFile {
+  public:
+    explicit OpenFile(const std::string& filename):
+	fd_(::open(filename.c_str(), O_RDONLY)) {
+      EXPECT_LE(0, fd_) << "Could not open " << filename;
+    }
+    OpenFile(const OpenFile&) = delete;
+    ~OpenFile() { ::close(fd_); }
+
+    int fd() const { return fd_; }
+
+    OpenFile& operator=(const OpenFile&) = delete;
+
+  private:
+    int fd_;
+  };
+}
+
+TEST(FlexibleStreamingJsonParserTests, ParseString) {
+  Parser parser(DefaultPayloadFactory(), 16);
+  auto events = parser.parseString("test", DOCUMENT);
+  EXPECT_EQ(traceInPlace(DOCUMENT), trace(events));
+
+  auto unnamed = parser.parseString("[1]");
+  EXPECT_EQ("BEGIN_ARRAY INT_VALUE:1 END_ARRAY END", trace(unnamed));
+}
+
+TEST(FlexibleStreamingJsonParserTests, ParseFile) {
+  const std::string text = randomDocument(5);
+  const std::string expected = traceInPlace(text);
+  TemporaryFile file(text);
+  Parser parser(DefaultPayloadFactory(), 16);
+
+  auto byName = parser.parseFile(file.name());
+  EXPECT_EQ(expected, trace(byName));
+
+  OpenFile open(file.name());
+  auto byFd = parser.parseFile("test", open.fd());
+  EXPECT_EQ(expected, trace(byFd));
+
+  // The parser leaves descriptors it did not open open
+  EXPECT_EQ(0, ::lseek(open.fd(), 0, SEEK_SET));
+  auto unnamed = parser.parseFile(open.fd());
+  EXPECT_EQ(expected, trace(unnamed));
+}
+
+TEST(FlexibleStreamingJsonParserTests, ParseMappedFile) {
+  const std::string text = randomDocument(6);
+  const std::string expected = traceInPlace(text);
+  TemporaryFile file(text);
+  Parser parser(DefaultPayloadFactory(), 16);
+
+  auto byName = parser.parseMappedFile(file.name());
+  EXPECT_EQ(expected, trace(byName));
+
+  OpenFile open(file.name());
+  auto byFd = parser.parseMappedFile("test", open.fd());
+  EXPECT_EQ(expected, trace(byFd));
+}
+
+TEST(FlexibleStreamingJsonParserTests, ParseMappedFileParsesInPlace) {
+  TemporaryFile file(DOCUMENT);
+  Parser parser(DefaultPayloadFactory(), 16);
+  auto events = parser.parseMappedFile(file.name());
+  std::vector<JsonString> names;
+  JsonEventType t;
+  while ((t = events.next()) != JsonEventType::END) {
+    if (t == JsonEventType::FIELD_NAME) {
+      names.push_back(events.payloadText());
+    }
+  }
+
+  // Names that need no decoding point into the mapping, so they are
+  // all still valid at the end of the document
+  ASSERT_EQ(4u, names.size());
+  EXPECT_EQ("a", names[0].toString());
+  EXPECT_EQ("b", names[1].toString());
+  EXPECT_EQ("c", names[2].toString());
+  EXPECT_EQ("d", names[3].toString());
+}
+
+TEST(FlexibleStreamingJsonParserTests, ReadAheadSettings) {
+  Parser parser(DefaultPayloadFactory(), 16);
+  EXPECT_EQ(4u, parser.readAheadDepth());
+  EXPECT_EQ(16u, parser.readAheadChunkSize());
+
+  parser.setReadAheadDepth(2);
+  parser.setReadAheadChunkSize(5);
+  EXPECT_EQ(2u, parser.readAheadDepth());
+  EXPECT_EQ(5u, parser.readAheadChunkSize());
+
+  // Zero means the size of the parser's buffer
+  parser.setReadAheadChunkSize(0);
+  EXPECT_EQ(16u, parser.readAheadChunkSize());
+
+  Parser configured(DefaultPayloadFactory(), 32, 3, 7);
+  EXPECT_EQ(3u, configured.readAheadDepth());
+  EXPECT_EQ(7u, configured.readAheadChunkSize());
+}
+
+TEST(FlexibleStreamingJsonParserTests, ParseFileWithReadAhead) {
+  // Chunks smaller and larger than the parser's buffer, and queues
+  // from one chunk deep up
+  static const uint32_t SETTINGS[][2] = {
+    { 1, 1 }, { 1, 64 }, { 2, 3 }, { 4, 0 }, { 8, 1000 }
+  };
+  const std::string text = randomDocument(7);
+  const std::string expected = traceInPlace(text);
+  TemporaryFile file(text);
+  for (const auto& settings : SETTINGS) {
+    Parser parser(DefaultPayloadFactory(), 16, settings[0], settings[1]);
+    auto byName = parser.parseFileWithReadAhead(file.name());
+    EXPECT_EQ(expected, trace(byName))
+	<< "depth " << settings[0] << ", chunk size " << settings[1];
+
+    OpenFile open(file.name());
+    auto byFd = parser.parseFileWithReadAhead("test", open.fd());
+    EXPECT_EQ(expected, trace(byFd))
+	<< "depth " << settings[0] << ", chunk size " << settings[1];
+  }
+
+  OpenFile open(file.name());
+  Parser parser(DefaultPayloadFactory(), 16);
+  auto unnamed = parser.parseFileWithReadAhead(open.fd());
+  EXPECT_EQ(expected, trace(unnamed));
+}
+
+TEST(FlexibleStreamingJsonParserTests, ReadAheadDepthReachesTheStream) {
+  TemporaryFile file("[]");
+  Parser parser(DefaultPayloadFactory(), 16);
+  parser.setReadAheadDepth(0);
+  EXPECT_THROW(parser.parseFileWithReadAhead(file.name()),
+	       IllegalValueError);
+}
+
+TEST(FlexibleStreamingJsonParserTests, ParseFileWithIoUring) {
+  static const uint32_t SETTINGS[][2] = {
+    { 1, 1 }, { 2, 3 }, { 4, 0 }, { 8, 64 }, { 4, 1000 }
+  };
+  const std::string text = randomDocument(8);
+  const std::string expected = traceInPlace(text);
+  TemporaryFile file(text);
+  for (const auto& settings : SETTINGS) {
+    Parser parser(DefaultPayloadFactory(), 16, settings[0], settings[1]);
+    auto byName = parser.parseFileWithIoUring(file.name());
+    EXPECT_EQ(expected, trace(byName))
+	<< "depth " << settings[0] << ", chunk size " << settings[1];
+
+    OpenFile open(file.name());
+    auto byFd = parser.parseFileWithIoUring("test", open.fd());
+    EXPECT_EQ(expected, trace(byFd))
+	<< "depth " << settings[0] << ", chunk size " << settings[1];
+  }
+
+  OpenFile open(file.name());
+  Parser parser(DefaultPayloadFactory(), 16);
+  auto unnamed = parser.parseFileWithIoUring(open.fd());
+  EXPECT_EQ(expected, trace(unnamed));
+
+  parser.setReadAheadDepth(0);
+  EXPECT_THROW(parser.parseFileWithIoUring(file.name()), IllegalValueError);
+}
+
+TEST(FlexibleStreamingJsonParserTests, Projection) {
+  const std::string text = randomDocument(9);
+  const PathProjection projection(
+      std::vector<std::string>{ "/1", "$[3].*", "/5/a" }
+  );
+  InPlaceEventStream reference = streamOf(text, 16, projection);
+  const std::string expected = trace(reference);
+  TemporaryFile file(text);
+
+  Parser parser(DefaultPayloadFactory(), 16);
+  EXPECT_TRUE(parser.projection().empty());
+  parser.setProjection(projection);
+  EXPECT_EQ(projection.paths(), parser.projection().paths());
+
+  auto fromString = parser.parseString(text);
+  EXPECT_EQ(expected, trace(fromString));
+  auto fromFile = parser.parseFile(file.name());
+  EXPECT_EQ(expected, trace(fromFile));
+  auto mapped = parser.parseMappedFile(file.name());
+  EXPECT_EQ(expected, trace(mapped));
+
+  // Streams keep the projection they were created with
+  auto projected = parser.parseString("[1, 2]");
+  parser.setProjection(PathProjection());
+  auto whole = parser.parseString("[1, 2]");
+  EXPECT_EQ("BEGIN_ARRAY INT_VALUE:2 END_ARRAY END", trace(projected));
+  EXPECT_EQ("BEGIN_ARRAY INT_VALUE:1 INT_VALUE:2 END_ARRAY END",
+	    trace(whole));
+}
+
+TEST(FlexibleStreamingJsonParserTests, MultipleValues) {
+  const std::string text = "{\"a\": 1}\n[true]\n\n\"x\"\n";
+  const std::string expected =
+      "BEGIN_OBJECT FIELD_NAME:a INT_VALUE:1 END_OBJECT END_RECORD "
+      "BEGIN_ARRAY TRUE_VALUE END_ARRAY END_RECORD "
+      "STRING_VALUE:x END_RECORD END";
+  TemporaryFile file(text);
+
+  Parser parser(DefaultPayloadFactory(), 16);
+  EXPECT_FALSE(parser.multipleValues());
+  auto single = parser.parseString(text);
+  EXPECT_EQ("BEGIN_OBJECT FIELD_NAME:a INT_VALUE:1 END_OBJECT END",
+	    trace(single));  // Stops after the first value
+
+  parser.setMultipleValues(true);
+  EXPECT_TRUE(parser.multipleValues());
+  auto fromString = parser.parseString(text);
+  EXPECT_EQ(expected, trace(fromString));
+  auto fromFile = parser.parseFile(file.name());
+  EXPECT_EQ(expected, trace(fromFile));
+  auto mapped = parser.parseMappedFile(file.name());
+  EXPECT_EQ(expected, trace(mapped));
+  auto readAhead = parser.parseFileWithReadAhead(file.name());
+  EXPECT_EQ(expected, trace(readAhead));
+  auto uring = parser.parseFileWithIoUring(file.name());
+  EXPECT_EQ(expected, trace(uring));
+}
+
+TEST(FlexibleStreamingJsonParserTests, MissingFilesThrow) {
+  TemporaryFile file;
+  const std::string missing = file.name() + ".missing";
+  Parser parser(DefaultPayloadFactory(), 16);
+  EXPECT_THROW(parser.parseFile(missing), IOError);
+  EXPECT_THROW(parser.parseMappedFile(missing), IOError);
+  EXPECT_THROW(parser.parseFileWithReadAhead(missing), IOError);
+  EXPECT_THROW(parser.parseFileWithIoUring(missing), IOError);
+}
@@ -0,0 +1,119 @@
+#include <pistis/json/streaming/OnDemandDocument.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/detail/InMemoryStreamAdapter.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <string.h>
+
+using namespace pistis::exceptions;
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+
+namespace {
+  /** @brief Stream that hands out its text, then says it has no data
+   *         yet (returns -1) forever, as a socket that stalls would
+   */
+  class StalledStream {
+  public:
+    explicit StalledStream(const std::string& text):
+	text_(text), position_(0) {
+    }
+
+    ssize_t read(char* buffer, size_t n) {
+      if (position_ == text_.size()) {
+	return -1;
+      }
+      n = std::min(n, text_.size() - position_);
+      ::memcpy(buffer, text_.data() + position_, n);
+      position_ += n;
+      return n;
+    }
+
+  private:
+    std::string text_;
+    size_t position_;
+  };
+
+  typedef FlexibleEventStream<detail::InMemoryStreamAdapter,
+			      DefaultPayloadFactory> InPlaceEventStream;
+  typedef FlexibleEventStream<StalledStream, DefaultPayloadFactory>
+	  StalledEventStream;
+
+  const std::string TEXT =
+      "{\"user\": {\"id\": 7, \"name\": \"Ann\", \"tags\": [1, 2, 3],\n"
+      "          \"extra\": {\"deep\": [[{}], \"]\"]}},\n"
+      " \"skipped\": [1, {\"x\": 2}], \"n\": 2.5, \"ok\": true}";
+
+  InPlaceEventStream streamOf(const std::string& text) {
+    return InPlaceEventStream("test", detail::InMemoryStreamAdapter(text),
+			      DefaultPayloadFactory(), 16);
+  }
+}
+
+TEST(OnDemandDocumentTests, ReadsValuesInOrder) {
+  InPlaceEventStream events = streamOf(TEXT);
+  OnDemandDocument<InPlaceEventStream> doc(events);
+
+  auto user = doc["user"];
+  EXPECT_EQ(7, user["id"].getInt64());
+  const JsonString name = user["name"].getString();
+  EXPECT_EQ("Ann", std::string(name.begin(), name.end()));
+  int64_t sum = 0;
+  for (const auto& tag : user["tags"].elements()) {
+    sum += tag.getInt64();
+  }
+  EXPECT_EQ(6, sum);
+
+  // "extra" and "skipped" are skipped on the way to "n"
+  EXPECT_EQ(2.5, doc["n"].getDouble());
+  EXPECT_TRUE(doc["ok"].getBool());
+}
+
+TEST(OnDemandDocumentTests, PassedValuesThrow) {
+  InPlaceEventStream events = streamOf(TEXT);
+  OnDemandDocument<InPlaceEventStream> doc(events);
+
+  auto user = doc["user"];
+  auto name = user["name"];
+  EXPECT_EQ(2.5, doc["n"].getDouble());
+  EXPECT_THROW(name.getString(), IllegalStateError);
+  EXPECT_THROW(user["id"], IllegalStateError);
+}
+
+TEST(OnDemandDocumentTests, WrongTypesThrow) {
+  InPlaceEventStream events = streamOf(TEXT);
+  OnDemandDocument<InPlaceEventStream> doc(events);
+
+  auto user = doc["user"];
+  EXPECT_THROW(user["id"].getString(), IllegalValueError);
+  EXPECT_THROW(user["tags"].getInt64(), IllegalValueError);
+  EXPECT_THROW(user["missing"], IllegalValueError);
+}
+
+TEST(OnDemandDocumentTests, ThrowsInsteadOfSpinningOnAgain) {
+  // Runs out of data in the middle of "user", which skipValue() is
+  // asked to skip, and in the middle of "tags", which next() reads
+  const std::string text = TEXT.substr(0, TEXT.find("3]"));
+  {
+    StalledEventStream events("test", StalledStream(text),
+			      DefaultPayloadFactory(), 16);
+    OnDemandDocument<StalledEventStream> doc(events);
+    EXPECT_THROW(doc["n"], IllegalStateError);
+    EXPECT_THROW(doc["ok"], IllegalStateError);
+  }
+  {
+    StalledEventStream events("test", StalledStream(text),
+			      DefaultPayloadFactory(), 16);
+    OnDemandDocument<StalledEventStream> doc(events);
+    auto user = doc["user"];
+    EXPECT_EQ(7, user["id"].getInt64());
+    auto tags = user["tags"];
+    auto i = tags.elements().begin();
+    EXPECT_EQ(1, i->getInt64());
+    EXPECT_EQ(2, (++i)->getInt64());
+    EXPECT_THROW(++i, IllegalStateError);
+    EXPECT_THROW(doc["n"], IllegalStateError);
+  }
+}
@@ -0,0 +1,167 @@
+#include <pistis/json/streaming/ParallelArrayParser.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/streaming/detail/MemoryViewStreamAdapter.hpp>
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace pistis::json;
+using namespace pistis::json::exceptions;
+using namespace pistis::json::streaming;
+
+namespace {
+  typedef ParallelArrayParser<DefaultPayloadFactory> Parser;
+
+  std::string randomValue(std::mt19937& rng, int depth) {
+    switch (depth ? rng() % 6 : rng() % 3) {
+      case 0: return std::to_string(rng() % 1000);
+      case 1: return (rng() % 2) ? "\"a,]\\\"\"" : "\"{\"";
+      case 2: return "null";
+      case 3:
+      case 4: {
+	std::string s = "[";
+	for (uint32_t n = rng() % 4; n; --n) {
+	  s += randomValue(rng, depth - 1) + ((n > 1) ? ", " : "");
+	}
+	return s + "]";
+      }
+      default: {
+	std::string s = "{\n";
+	for (uint32_t n = rng() % 4; n; --n) {
+	  s += "\"k" + std::to_string(n) + "\": " +
+	       randomValue(rng, depth - 1) + ((n > 1) ? ",\n" : "\n");
+	}
+	return s + "}";
+      }
+    }
+  }
+
+  /** @brief The events of @c events up to END, with their payloads */
+  template <typename EventStream>
+  std::string trace(EventStream& events) {
+    std::ostringstream out;
+    for (JsonEventType t = events.next(); t != JsonEventType::END;
+	 t = events.next()) {
+      out << t;
+      if ((t == JsonEventType::FIELD_NAME) ||
+	  (t == JsonEventType::STRING_VALUE) ||
+	  (t == JsonEventType::INT_VALUE)) {
+	out << ":" << events.payloadText();
+      }
+      out << " ";
+    }
+    return out.str();
+  }
+
+  /** @brief The events of the whole document, with END_RECORD after
+   *         each element of the array, the way the parser's streams
+   *         report them
+   */
+  std::string expectedTrace(const std::string& text) {
+    FlexibleEventStream<detail::MemoryViewStreamAdapter,
+			DefaultPayloadFactory> events(
+	"test",
+	detail::MemoryViewStreamAdapter(text.data(),
+					text.data() + text.size()),
+	DefaultPayloadFactory(), 64
+    );
+    std::ostringstream out;
+    uint32_t depth = 0;
+    std::string t = trace(events);
+    std::istringstream in(t);
+    std::string token;
+    while (in >> token) {
+      const bool end = (token == "END_OBJECT") || (token == "END_ARRAY");
+      if (end) {
+	--depth;
+      }
+      if (depth) {
+	out << token << " ";
+      }
+      if ((token == "BEGIN_OBJECT") || (token == "BEGIN_ARRAY")) {
+	++depth;
+      } else if (depth == 1) {
+	out << "END_RECORD ";
+      }
+    }
+    return out.str();
+  }
+
+  /** @brief Parse @c text, reading only the first event of each chunk
+   *         unless @c readAll is true, and return the error the parser
+   *         reports, or "" if there is none
+   */
+  std::string errorOf(const std::string& text, bool strict,
+		      bool readAll = false) {
+    Parser parser(DefaultPayloadFactory(), 2, 1, 64);
+    parser.setStrict(strict);
+    try {
+      parser.parse(
+	  text.data(), text.data() + text.size(),
+	  [readAll](Parser::EventStreamType& events, const ArrayChunk&) {
+	    return readAll ? trace(events) : std::string();
+	  },
+	  [](std::string, const ArrayChunk&) { },
+	  ChunkResultOrder::IN_ORDER
+      );
+    } catch(const JsonParseError& e) {
+      return e.details();
+    }
+    return "";
+  }
+}
+
+TEST(ParallelArrayParserTests, EventsMatchOneStream) {
+  std::mt19937 rng(17);
+  for (int trial = 0; trial < 300; ++trial) {
+    std::string text = "[";
+    for (uint32_t n = rng() % 30; n; --n) {
+      text += randomValue(rng, 3) + ((n > 1) ? ", " : "");
+    }
+    text += "]\n";
+
+    for (bool strict : { false, true }) {
+      Parser parser(DefaultPayloadFactory(), 2, 1 + rng() % 100, 64);
+      parser.setStrict(strict);
+      std::string actual;
+      parser.parse(
+	  text.data(), text.data() + text.size(),
+	  [](Parser::EventStreamType& events, const ArrayChunk&) {
+	    return trace(events);
+	  },
+	  [&actual](std::string chunkTrace, const ArrayChunk&) {
+	    actual += chunkTrace;
+	  }
+      );
+      ASSERT_EQ(expectedTrace(text), actual) << text;
+    }
+  }
+}
+
+TEST(ParallelArrayParserTests, StrictModeChecksUnreadElements) {
+  // parseChunk reads only the first event of each element, so the
+  // error is only found when the parser reads the rest itself
+  static const char* const CASES[] = {
+    "[{\"a\": 1}, {\"a\": 1 2}, {\"a\": 3}]",
+    "[[1], [2,, 3]]",
+    "[{\"a\": [1}, 2]",
+    "[1, \"abc]"
+  };
+  for (const char* text : CASES) {
+    EXPECT_NE("", errorOf(text, true)) << text;
+    EXPECT_NE("", errorOf(text, false, true)) << text;
+  }
+  EXPECT_EQ("", errorOf(CASES[0], false));
+  EXPECT_EQ("", errorOf(CASES[1], false));
+}
+
+TEST(ParallelArrayParserTests, StrictModeChecksTheEnd) {
+  EXPECT_EQ("", errorOf("[1, 2] x", false, true));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, 2] x", true).find("Text after the end"));
+  EXPECT_NE(std::string::npos,
+	    errorOf("[1, 2}", true).find("\"]\" expected"));
+  EXPECT_EQ("", errorOf("[1, {\"b\": [2]}]\n", true));
+}
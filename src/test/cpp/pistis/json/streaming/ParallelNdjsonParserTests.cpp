@@ -0,0 +1,184 @@
+#include <pistis/json/streaming/ParallelNdjsonParser.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/exceptions/JsonParseError.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::exceptions;
+using namespace pistis::json::streaming;
+
+namespace {
+  typedef ParallelNdjsonParser<DefaultPayloadFactory> Parser;
+
+  /** @brief @c numRecords records of different lengths, whose "id"
+   *         fields count up from zero
+   */
+  std::string makeDocument(uint32_t numRecords) {
+    std::mt19937 rng(16);
+    std::string text;
+    for (uint32_t i = 0; i < numRecords; ++i) {
+      text += "{\"id\": " + std::to_string(i) + ", \"tags\": [";
+      for (uint32_t n = rng() % 5; n; --n) {
+	text += "\"" + std::string(1 + rng() % 20, 'a' + rng() % 26) + "\"";
+	text += (n > 1) ? ", " : "";
+      }
+      text += "]}\n";
+    }
+    return text;
+  }
+
+  /** @brief The ids of the records in a chunk, in the order they
+   *         appear.  Checks that every record ends with END_RECORD.
+   */
+  std::vector<int64_t> recordIds(Parser::EventStreamType& events) {
+    std::vector<int64_t> ids;
+    bool inRecord = false;
+    while (true) {
+      const JsonEventType t = events.next();
+      if (t == JsonEventType::END) {
+	EXPECT_FALSE(inRecord);
+	return ids;
+      } else if (t == JsonEventType::END_RECORD) {
+	EXPECT_TRUE(inRecord);
+	inRecord = false;
+      } else if (t == JsonEventType::INT_VALUE) {
+	ids.push_back(events.intPayload());
+	inRecord = true;
+      }
+    }
+  }
+
+  struct Delivery {
+    uint64_t chunkIndex;
+    std::vector<int64_t> ids;
+  };
+
+  /** @brief Parse @c text with @c parser and return what was delivered,
+   *         in the order it was delivered.  The chunk given by @c slowChunk
+   *         takes a while, so the chunks after it finish first.
+   */
+  std::vector<Delivery> parseAll(Parser& parser, const std::string& text,
+				 ChunkResultOrder order,
+				 uint64_t slowChunk = ~0ull) {
+    std::vector<Delivery> deliveries;
+    parser.parse(
+	text.data(), text.data() + text.size(),
+	[slowChunk, &text](Parser::EventStreamType& events,
+			   const NdjsonChunk& chunk) {
+	  EXPECT_EQ(text.data() + chunk.offset, chunk.begin);
+	  if (chunk.index == slowChunk) {
+	    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	  }
+	  return recordIds(events);
+	},
+	[&deliveries](std::vector<int64_t> ids, const NdjsonChunk& chunk) {
+	  deliveries.push_back(Delivery{ chunk.index, std::move(ids) });
+	},
+	order
+    );
+    return deliveries;
+  }
+}
+
+TEST(ParallelNdjsonParserTests, InOrder) {
+  const std::string text = makeDocument(5000);
+  Parser parser(DefaultPayloadFactory(), 4, 1000, 256);
+  ASSERT_EQ(4, parser.numThreads());
+
+  const std::vector<Delivery> deliveries =
+      parseAll(parser, text, ChunkResultOrder::IN_ORDER, 0);
+  ASSERT_LT(20, deliveries.size());
+
+  int64_t nextId = 0;
+  for (size_t i = 0; i < deliveries.size(); ++i) {
+    ASSERT_EQ(i, deliveries[i].chunkIndex);
+    ASSERT_FALSE(deliveries[i].ids.empty());
+    for (int64_t id : deliveries[i].ids) {
+      ASSERT_EQ(nextId++, id);
+    }
+  }
+  EXPECT_EQ(5000, nextId);
+}
+
+TEST(ParallelNdjsonParserTests, AsCompleted) {
+  const std::string text = makeDocument(5000);
+  Parser parser(DefaultPayloadFactory(), 4, 1000, 256);
+  std::vector<Delivery> deliveries =
+      parseAll(parser, text, ChunkResultOrder::AS_COMPLETED, 0);
+  ASSERT_LT(20, deliveries.size());
+
+  // The first chunk is slow, so the chunks parsed alongside it are
+  // handed over before it is
+  EXPECT_NE(0, deliveries.front().chunkIndex);
+
+  // Every chunk exactly once, and every record in the right chunk
+  std::sort(deliveries.begin(), deliveries.end(),
+	    [](const Delivery& x, const Delivery& y) {
+	      return x.chunkIndex < y.chunkIndex;
+	    });
+  int64_t nextId = 0;
+  for (size_t i = 0; i < deliveries.size(); ++i) {
+    ASSERT_EQ(i, deliveries[i].chunkIndex);
+    for (int64_t id : deliveries[i].ids) {
+      ASSERT_EQ(nextId++, id);
+    }
+  }
+  EXPECT_EQ(5000, nextId);
+}
+
+TEST(ParallelNdjsonParserTests, ChunkBoundaries) {
+  // A chunk size of 1 puts every record in a chunk of its own, and a
+  // chunk size larger than the document puts them all in one
+  const std::string text = makeDocument(300);
+  for (size_t chunkSize : { 1, 37, 4096, 1 << 20 }) {
+    Parser parser(DefaultPayloadFactory(), 2, chunkSize, 64);
+    const std::vector<Delivery> deliveries =
+	parseAll(parser, text, ChunkResultOrder::IN_ORDER);
+    int64_t nextId = 0;
+    for (const Delivery& d : deliveries) {
+      for (int64_t id : d.ids) {
+	ASSERT_EQ(nextId++, id) << "chunkSize = " << chunkSize;
+      }
+    }
+    EXPECT_EQ(300, nextId) << "chunkSize = " << chunkSize;
+    if (chunkSize == 1) {
+      EXPECT_EQ(300, deliveries.size());
+    } else if (chunkSize == (1 << 20)) {
+      EXPECT_EQ(1, deliveries.size());
+    }
+  }
+}
+
+TEST(ParallelNdjsonParserTests, RethrowsParseErrors) {
+  std::string text = makeDocument(2000);
+  text.replace(text.find("{\"id\": 1500,"), 1, "[");
+  for (ChunkResultOrder order : { ChunkResultOrder::IN_ORDER,
+				  ChunkResultOrder::AS_COMPLETED }) {
+    Parser parser(DefaultPayloadFactory(), 4, 500, 256);
+    int64_t lastId = -1;
+    try {
+      parser.parse(
+	  text.data(), text.data() + text.size(),
+	  [](Parser::EventStreamType& events, const NdjsonChunk&) {
+	    return recordIds(events);
+	  },
+	  [&lastId](std::vector<int64_t> ids, const NdjsonChunk&) {
+	    lastId = std::max(lastId, ids.back());
+	  },
+	  order
+      );
+      ADD_FAILURE() << "parse() did not throw";
+    } catch(const JsonParseError&) {
+    }
+    if (order == ChunkResultOrder::IN_ORDER) {
+      // Nothing from the failed chunk or after it
+      EXPECT_LT(lastId, 1500);
+    }
+  }
+}
@@ -0,0 +1,357 @@
+#include "EventTraces.hpp"
+#include <pistis/json/streaming/PathProjection.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief A step of a path the way ReferenceProjection sees it:
+   *         a field name, an array index or a wildcard
+   */
+  struct PathStep {
+    enum Kind { FIELD, INDEX, ANY } kind;
+    std::string name;
+    uint64_t index;
+
+    bool matches(bool isIndex, const std::string& key, uint64_t i) const {
+      return (kind == ANY) || ((kind == FIELD) && !isIndex && (key == name))
+	         || ((kind == INDEX) && isIndex && (index == i));
+    }
+  };
+
+  typedef std::vector<PathStep> StepPath;
+
+  /** @brief Projects the events of a stream read without a projection
+   *         onto @c paths, one value at a time, the way PathProjection
+   *         is documented to, and records them the way trace() does.
+   */
+  class ReferenceProjection {
+  public:
+    ReferenceProjection(InPlaceEventStream& events,
+			const std::vector<StepPath>& paths, bool definite):
+	events_(events), paths_(paths), definite_(definite),
+	seen_(paths.size(), false), numToSee_(0), location_(), out_() {
+      // Paths that continue past a path that selects are dropped
+      for (size_t i = 0; i < paths_.size(); ++i) {
+	if (!selectedByPrefix_(i)) {
+	  ++numToSee_;
+	} else {
+	  seen_[i] = true;
+	}
+      }
+    }
+
+    std::string run() {
+      value_(events_.next());
+      out_ << "END";
+      return out_.str();
+    }
+
+  private:
+    struct Location {
+      bool isIndex;
+      std::string name;
+      uint64_t index;
+    };
+
+    InPlaceEventStream& events_;
+    std::vector<StepPath> paths_;
+    bool definite_;
+    std::vector<bool> seen_;
+    size_t numToSee_;
+    std::vector<Location> location_;
+    std::ostringstream out_;
+
+    bool selectedByPrefix_(size_t i) const {
+      for (size_t j = 0; j < paths_.size(); ++j) {
+	if ((paths_[j].size() < paths_[i].size()) &&
+	    std::equal(paths_[j].begin(), paths_[j].end(),
+		       paths_[i].begin(),
+		       [](const PathStep& a, const PathStep& b) {
+			 return (a.kind == b.kind) && (a.name == b.name) &&
+			        (a.index == b.index);
+		       })) {
+	  return true;
+	}
+      }
+      return false;
+    }
+
+    /** @brief 2 if a path selects the current location, 1 if a path
+     *         goes through it, 0 if none do
+     */
+    int relevance_() {
+      int result = 0;
+      for (size_t i = 0; i < paths_.size(); ++i) {
+	const StepPath& path = paths_[i];
+	if (path.size() < location_.size()) {
+	  continue;
+	}
+	size_t n = 0;
+	while ((n < location_.size()) &&
+	       path[n].matches(location_[n].isIndex, location_[n].name,
+			       location_[n].index)) {
+	  ++n;
+	}
+	if (n < location_.size()) {
+	  continue;
+	} else if (path.size() > n) {
+	  result = std::max(result, 1);
+	} else {
+	  result = 2;
+	}
+      }
+      return result;
+    }
+
+    /** @brief Count the paths the value at the current location
+     *         selects as seen
+     */
+    void see_() {
+      for (size_t i = 0; i < paths_.size(); ++i) {
+	if (!seen_[i] && (paths_[i].size() == location_.size()) &&
+	    std::equal(paths_[i].begin(), paths_[i].end(), location_.begin(),
+		       [](const PathStep& s, const Location& l) {
+			 return s.matches(l.isIndex, l.name, l.index);
+		       })) {
+	  seen_[i] = true;
+	  --numToSee_;
+	}
+      }
+    }
+
+    bool done_() const { return definite_ && !numToSee_; }
+
+    void record_(JsonEventType t) {
+      out_ << t;
+      switch (t) {
+	case JsonEventType::FIELD_NAME:
+	case JsonEventType::STRING_VALUE:
+	  out_ << ":" << events_.payloadText();
+	  break;
+
+	case JsonEventType::INT_VALUE:
+	  out_ << ":" << events_.intPayload();
+	  break;
+
+	case JsonEventType::FLOAT_VALUE:
+	  out_ << ":" << floatText(events_.floatPayload());
+	  break;
+
+	default:
+	  break;
+      }
+      out_ << " ";
+    }
+
+    /** @brief Copy the rest of a value that starts with @c t, or skip
+     *         it if @c report is false
+     */
+    void copy_(JsonEventType t, bool report) {
+      uint32_t depth = 0;
+      while (true) {
+	if (report) {
+	  record_(t);
+	}
+	if ((t == JsonEventType::BEGIN_OBJECT) ||
+	    (t == JsonEventType::BEGIN_ARRAY)) {
+	  ++depth;
+	} else if ((t == JsonEventType::END_OBJECT) ||
+		   (t == JsonEventType::END_ARRAY)) {
+	  --depth;
+	}
+	if (!depth) {
+	  return;
+	}
+	t = events_.next();
+      }
+    }
+
+    /** @brief Project a value that starts with @c t at the current
+     *         location, which a path selects or goes through
+     */
+    void value_(JsonEventType t) {
+      if (relevance_() == 2) {
+	copy_(t, true);
+	see_();
+	return;
+      }
+      record_(t);
+      if ((t != JsonEventType::BEGIN_OBJECT) &&
+	  (t != JsonEventType::BEGIN_ARRAY)) {
+	return;
+      }
+
+      const bool array = (t == JsonEventType::BEGIN_ARRAY);
+      uint64_t index = 0;
+      while (!done_()) {
+	t = events_.next();
+	if ((t == JsonEventType::END_OBJECT) ||
+	    (t == JsonEventType::END_ARRAY)) {
+	  break;
+	}
+	if (array) {
+	  location_.push_back(Location{ true, "", index++ });
+	} else {
+	  location_.push_back(Location{
+	    false, std::string(events_.payloadText().begin(),
+			       events_.payloadText().end()), 0
+	  });
+	}
+	const bool relevant = relevance_() > 0;
+	if (!array) {
+	  if (relevant) {
+	    record_(t);
+	  }
+	  t = events_.next();
+	}
+	if (relevant) {
+	  value_(t);
+	} else {
+	  copy_(t, false);
+	}
+	location_.pop_back();
+      }
+      record_(array ? JsonEventType::END_ARRAY : JsonEventType::END_OBJECT);
+    }
+  };
+
+  /** @brief A random path, as a JSON Pointer if it can be written as
+   *         one and @c rng says to, or else as a JSONPath expression,
+   *         with the steps it matches in @c steps.  A JSON Pointer
+   *         segment that is a number matches a field or an element, so
+   *         such a path has one set of steps for each combination.
+   */
+  std::string randomPath(std::mt19937& rng,
+			 std::vector<StepPath>& steps) {
+    std::vector<PathStep> path;
+    bool definite = true;
+    for (uint32_t n = 1 + rng() % 3; n; --n) {
+      switch (rng() % 6) {
+	case 0:
+	case 1:
+	case 2:
+	  path.push_back(PathStep{ PathStep::FIELD,
+				   std::string(1, "abc"[rng() % 3]), 0 });
+	  break;
+
+	case 3:
+	case 4:
+	  path.push_back(PathStep{ PathStep::INDEX, "", rng() % 2 });
+	  break;
+
+	default:
+	  path.push_back(PathStep{ PathStep::ANY, "", 0 });
+	  definite = false;
+	  break;
+      }
+    }
+
+    std::string text;
+    if (definite && (rng() % 2)) {
+      std::vector<StepPath> alternatives(1);
+      for (const PathStep& step : path) {
+	const std::string name = (step.kind == PathStep::FIELD)
+	                             ? step.name : std::to_string(step.index);
+	text += "/" + name;
+	std::vector<StepPath> forks;
+	for (const StepPath& a : alternatives) {
+	  forks.push_back(a);
+	  forks.back().push_back(PathStep{ PathStep::FIELD, name, 0 });
+	  if (step.kind == PathStep::INDEX) {
+	    forks.push_back(a);
+	    forks.back().push_back(step);
+	  }
+	}
+	alternatives.swap(forks);
+      }
+      steps.insert(steps.end(), alternatives.begin(), alternatives.end());
+      return text;
+    }
+
+    text = "$";
+    for (const PathStep& step : path) {
+      switch (step.kind) {
+	case PathStep::FIELD:
+	  text += (rng() % 2) ? "." + step.name : "['" + step.name + "']";
+	  break;
+
+	case PathStep::INDEX:
+	  text += "[" + std::to_string(step.index) + "]";
+	  break;
+
+	default:
+	  text += (rng() % 2) ? ".*" : "[*]";
+	  break;
+      }
+    }
+    steps.push_back(path);
+    return text;
+  }
+
+  /** @brief A random value whose objects have fields named "a", "b"
+   *         and "c" for paths to find.  A name is sometimes repeated,
+   *         so a definite projection that stops reading once it has
+   *         seen every value it selects reports fewer events than one
+   *         that reads on.
+   */
+  std::string randomProjectable(std::mt19937& rng, int depth) {
+    switch (depth ? rng() % 7 : rng() % 4) {
+      case 0: return std::to_string(rng() % 100);
+      case 1: return "\"s" + std::to_string(rng() % 10) + "\"";
+      case 2: return "[]";
+      case 3: return "null";
+      case 4:
+      case 5: {
+	std::string s = "[";
+	for (uint32_t n = rng() % 4; n; --n) {
+	  s += randomProjectable(rng, depth - 1) + ((n > 1) ? ", " : "");
+	}
+	return s + "]";
+      }
+      default: {
+	std::string s = "{";
+	const char* sep = "";
+	for (uint32_t n = rng() % 4; n; --n) {
+	  s += sep + std::string("\"") + "abc"[rng() % 3] + "\": " +
+	       randomProjectable(rng, depth - 1);
+	  sep = ", ";
+	}
+	return s + "}";
+      }
+    }
+  }
+}
+
+TEST(PathProjectionTests, ProjectionMatchesReference) {
+  checkTraces(
+      11, 2000,
+      [](std::mt19937& rng, int) {
+	TraceCase c;
+	c.text = randomProjectable(rng, 4);
+	std::vector<std::string> paths;
+	std::vector<StepPath> steps;
+	for (uint32_t n = 1 + rng() % 3; n; --n) {
+	  paths.push_back(randomPath(rng, steps));
+	}
+	c.projection = PathProjection(paths);
+	c.context = "\n  paths:";
+	for (const std::string& path : paths) {
+	  c.context += " " + path;
+	}
+
+	InPlaceEventStream all = streamOf(c.text);
+	c.expected =
+	    ReferenceProjection(all, steps, c.projection.definite()).run();
+	return c;
+      },
+      [](auto& events, const TraceCase&) { return trace(events); }
+  );
+}
@@ -0,0 +1,133 @@
+#include "EventTraces.hpp"
+#include <pistis/json/streaming/SaxHandler.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief SaxHandler that records its callbacks the way trace()
+   *         records events, and skips or stops where it is told to.
+   */
+  struct TraceHandler : SaxHandler {
+    std::ostringstream out;
+    std::mt19937 rng;
+    uint32_t skipPercent;
+    uint32_t stopPercent;
+
+    TraceHandler(uint32_t seed, uint32_t skip = 0, uint32_t stop = 0):
+	rng(seed), skipPercent(skip), stopPercent(stop) {
+    }
+
+    ParseAction record(const char* name, ParseAction action) {
+      out << name << " ";
+      if (action == ParseAction::SKIP) {
+	out << "SKIPPED ";
+      }
+      return action;
+    }
+
+    ParseAction maybeSkip(const char* name) {
+      return record(name, ((rng() % 100) < skipPercent) ? ParseAction::SKIP
+		                                          : maybeStop());
+    }
+
+    ParseAction maybeStop() {
+      return (stopPercent && ((rng() % 100) < stopPercent))
+	         ? ParseAction::STOP : ParseAction::CONTINUE;
+    }
+
+    ParseAction onBeginObject() { return maybeSkip("BEGIN_OBJECT"); }
+    ParseAction onEndObject() { return record("END_OBJECT", maybeStop()); }
+    ParseAction onBeginArray() { return maybeSkip("BEGIN_ARRAY"); }
+    ParseAction onEndArray() { return record("END_ARRAY", maybeStop()); }
+
+    ParseAction onKey(const JsonString& name) {
+      out << "FIELD_NAME:" << name;
+      return maybeSkip("");
+    }
+
+    ParseAction onInt(int64_t v) {
+      out << "INT_VALUE:" << v;
+      return record("", maybeStop());
+    }
+
+    ParseAction onFloat(double v) {
+      out << "FLOAT_VALUE:" << floatText(v);
+      return record("", maybeStop());
+    }
+
+    ParseAction onString(const JsonString& s) {
+      out << "STRING_VALUE:" << s;
+      return record("", maybeStop());
+    }
+
+    ParseAction onBool(bool v) {
+      return record(v ? "TRUE_VALUE" : "FALSE_VALUE", maybeStop());
+    }
+
+    ParseAction onNull() { return record("NULL_VALUE", maybeStop()); }
+  };
+
+
+  /** @brief A random document and its trace() without its final END,
+   *         which parse() reports by returning instead of calling the
+   *         handler
+   */
+  TraceCase randomCase(std::mt19937& rng, uint32_t skipPercent) {
+    TraceCase c;
+    c.text = randomValue(rng, 4);
+    c.seed = rng();
+    InPlaceEventStream events = streamOf(c.text);
+    c.expected = trace(events, RandomSkips(c.seed, skipPercent));
+    c.expected.erase(c.expected.size() - 3);
+    return c;
+  }
+}
+
+TEST(SaxHandlerTests, ParseMatchesNext) {
+  checkTraces(
+      27, 500,
+      [](std::mt19937& rng, int) { return randomCase(rng, 0); },
+      [](auto& events, const TraceCase& c) {
+	TraceHandler handler(c.seed);
+	ParseResult result;
+	while ((result = events.parse(handler)) == ParseResult::AGAIN) {
+	}
+	EXPECT_EQ(ParseResult::END, result);
+	return handler.out.str();
+      }
+  );
+}
+
+TEST(SaxHandlerTests, ParseSkipsLikeSkipValue) {
+  // With the same seed, the handler decides to skip the same values as
+  // RandomSkips
+  checkTraces(
+      28, 500,
+      [](std::mt19937& rng, int) { return randomCase(rng, 30); },
+      [](auto& events, const TraceCase& c) {
+	TraceHandler handler(c.seed, 30);
+	while (events.parse(handler) == ParseResult::AGAIN) {
+	}
+	return handler.out.str();
+      }
+  );
+}
+
+TEST(SaxHandlerTests, ParseStopsAndResumes) {
+  checkTraces(
+      29, 200,
+      [](std::mt19937& rng, int) { return randomCase(rng, 0); },
+      [](auto& events, const TraceCase& c) {
+	TraceHandler handler(c.seed, 0, 20);
+	while (events.parse(handler) != ParseResult::END) {
+	}
+	return handler.out.str();
+      }
+  );
+}
@@ -0,0 +1,121 @@
+#include "EventTraces.hpp"
+#include <pistis/json/streaming/ShapeCache.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pistis::json;
+using namespace pistis::json::streaming;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief An array of records with a few shapes in common, whose
+   *         field names are sometimes prefixes of each other or spelled
+   *         with escapes, so that predicted names sometimes don't match
+   */
+  std::string randomRecords(std::mt19937& rng, int depth = 2) {
+    static const char* const NAMES[] = {
+      "\"id\"", "\"idx\"", "\"name\"", "\"na\\u006de\"", "\"tags\"",
+      "\"\"", "\"a\\\"b\""
+    };
+    static const uint32_t SHAPES[][4] = {
+      { 0, 2, 4, 7 }, { 0, 2, 7, 7 }, { 1, 3, 4, 7 }, { 5, 6, 0, 2 }
+    };
+    std::string text = "[";
+    for (uint32_t n = rng() % 12; n; --n) {
+      const uint32_t* const shape = SHAPES[(rng() % 5) ? 0 : rng() % 4];
+      std::string record = "{";
+      for (uint32_t i = 0; (i < 4) && (shape[i] < 7); ++i) {
+	record += std::string(i ? ", " : "") + NAMES[shape[i]] + ": " +
+		  ((depth && !(rng() % 4)) ? randomRecords(rng, depth - 1)
+		                           : std::to_string(rng() % 100));
+      }
+      text += record + ((n > 1) ? "}, " : "}");
+    }
+    return text + "]";
+  }
+
+  struct ShapeCase : TraceCase {
+    uint32_t skipPercent;
+  };
+}
+
+TEST(ShapeCacheTests, ShapePredictionDoesNotChangeEvents) {
+  // Every other document skips some of its values
+  checkTraces(
+      13, 500,
+      [](std::mt19937& rng, int trial) {
+	ShapeCase c;
+	c.text = randomRecords(rng);
+	c.seed = rng();
+	c.skipPercent = (trial % 2) ? 0 : 20;
+	InPlaceEventStream events = streamOf(c.text);
+	c.expected = trace(events, RandomSkips(c.seed, c.skipPercent), true);
+	return c;
+      },
+      [](auto& events, const ShapeCase&) { events.setShapePrediction(true); },
+      [](auto& events, const ShapeCase& c) {
+	return trace(events, RandomSkips(c.seed, c.skipPercent), true);
+      }
+  );
+}
+
+TEST(ShapeCacheTests, PredictedKeysCountFields) {
+  std::mt19937 rng(14);
+  uint64_t totalHits = 0;
+  for (int trial = 0; trial < 300; ++trial) {
+    const std::string text = randomRecords(rng);
+    TrickleEventStream events("test",
+			      TrickleStream(text, 1 + rng() % 7, 40),
+			      DefaultPayloadFactory(), 16);
+    events.setShapePrediction(true);
+
+    // Number of fields read so far in each open object
+    std::vector<uint32_t> fields;
+    uint64_t numFields = 0;
+    JsonEventType t;
+    while ((t = events.next()) != JsonEventType::END) {
+      if (t == JsonEventType::BEGIN_OBJECT) {
+	fields.push_back(0);
+      } else if (t == JsonEventType::END_OBJECT) {
+	fields.pop_back();
+      } else if (t == JsonEventType::FIELD_NAME) {
+	++numFields;
+	++fields.back();
+	if (events.predictedKey() != TrickleEventStream::NOT_PREDICTED) {
+	  EXPECT_EQ(fields.back(), events.predictedKey()) << text;
+	}
+      }
+    }
+    const ShapeStatistics& statistics = events.shapeStatistics();
+    EXPECT_EQ(numFields, statistics.hits + statistics.misses) << text;
+    totalHits += statistics.hits;
+  }
+  EXPECT_LT(0u, totalHits);
+}
+
+TEST(ShapeCacheTests, PredictionCanChangeInsideADocument) {
+  // Turned on and off at random field names and objects and arrays,
+  // so objects open and close with prediction in either state
+  checkTraces(
+      15, 300,
+      [](std::mt19937& rng, int) {
+	TraceCase c;
+	c.text = randomRecords(rng);
+	c.seed = rng();
+	InPlaceEventStream events = streamOf(c.text);
+	c.expected = trace(events);
+	return c;
+      },
+      [](auto& events, const TraceCase& c) {
+	std::mt19937 rng(c.seed);
+	return trace(events, [&events, &rng]() {
+	  if (!(rng() % 3)) {
+	    events.setShapePrediction(!events.shapePrediction());
+	  }
+	  return false;
+	});
+      }
+  );
+}
@@ -0,0 +1,54 @@
+/** @file TemporaryFile.hpp
+ *
+ *  A file the stream and parser tests write a document to and read back.
+ */
+#ifndef __PISTIS__JSON__STREAMING__TEMPORARYFILE_HPP__
+#define __PISTIS__JSON__STREAMING__TEMPORARYFILE_HPP__
+
+#include <gtest/gtest.h>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace pistis {
+  namespace json {
+    namespace streaming {
+      namespace testing {
+
+	/** @brief A file in $TMPDIR (or /tmp) holding @c text, deleted
+	 *         when the object is destroyed
+	 */
+	class TemporaryFile {
+	public:
+	  explicit TemporaryFile(const std::string& text = std::string()):
+	      name_(directory_() + "/pistis-json-testXXXXXX") {
+	    const int fd = ::mkstemp(&name_[0]);
+	    EXPECT_LE(0, fd) << "Could not create " << name_;
+	    if (fd >= 0) {
+	      EXPECT_EQ((ssize_t)text.size(),
+			::write(fd, text.data(), text.size()));
+	      ::close(fd);
+	    }
+	  }
+
+	  TemporaryFile(const TemporaryFile&) = delete;
+	  ~TemporaryFile() { ::unlink(name_.c_str()); }
+
+	  const std::string& name() const { return name_; }
+
+	  TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+	private:
+	  std::string name_;
+
+	  static std::string directory_() {
+	    const char* dir = ::getenv("TMPDIR");
+	    return (dir && *dir) ? dir : "/tmp";
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,125 @@
+#include "../TemporaryFile.hpp"
+#include <pistis/json/streaming/detail/MappedFileStreamAdapter.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace pistis::exceptions;
+using namespace pistis::json::streaming::detail;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  /** @brief True if the pages holding [p, p + n) are still mapped.
+   *         msync() fails with ENOMEM on addresses that are not.
+   */
+  bool isMapped(const char* p, size_t n) {
+    const int result = ::msync((void*)p, n, MS_ASYNC);
+    EXPECT_TRUE(!result || (errno == ENOMEM));
+    return !result;
+  }
+
+  std::string contentOf(const MappedFileStreamAdapter& stream) {
+    return std::string(stream.begin(), stream.end());
+  }
+}
+
+TEST(MappedFileStreamAdapterTests, MapsTheFile) {
+  const std::string text = "{\"a\": [1, 2, 3]}";
+  TemporaryFile file(text);
+  MappedFileStreamAdapter stream(file.name());
+  EXPECT_EQ(text.size(), stream.size());
+  EXPECT_EQ(text, contentOf(stream));
+
+  // read() copies the same bytes
+  char buffer[8];
+  std::string copied;
+  ssize_t n;
+  while ((n = stream.read(buffer, sizeof(buffer))) > 0) {
+    copied.append(buffer, n);
+  }
+  EXPECT_EQ(0, n);
+  EXPECT_EQ(text, copied);
+}
+
+TEST(MappedFileStreamAdapterTests, MapsAnOpenDescriptor) {
+  const std::string text = "[true, false]";
+  TemporaryFile file(text);
+  const int fd = ::open(file.name().c_str(), O_RDONLY);
+  ASSERT_LE(0, fd);
+  {
+    MappedFileStreamAdapter stream("test", fd);
+    EXPECT_EQ(text, contentOf(stream));
+  }
+
+  // The descriptor belongs to the caller
+  EXPECT_EQ(0, ::close(fd));
+}
+
+TEST(MappedFileStreamAdapterTests, EmptyFile) {
+  TemporaryFile file;
+  MappedFileStreamAdapter stream(file.name());
+  EXPECT_EQ(0u, stream.size());
+  EXPECT_EQ(stream.begin(), stream.end());
+
+  char buffer[4];
+  EXPECT_EQ(0, stream.read(buffer, sizeof(buffer)));
+}
+
+TEST(MappedFileStreamAdapterTests, MissingFileThrows) {
+  TemporaryFile file;
+  EXPECT_THROW(MappedFileStreamAdapter(file.name() + ".missing"), IOError);
+  EXPECT_THROW(MappedFileStreamAdapter("test", -1), IOError);
+}
+
+TEST(MappedFileStreamAdapterTests, UnmapsOnDestruction) {
+  const std::string text(10000, 'x');
+  TemporaryFile file(text);
+  const char* begin;
+  {
+    MappedFileStreamAdapter stream(file.name());
+    begin = stream.begin();
+    EXPECT_TRUE(isMapped(begin, text.size()));
+  }
+  EXPECT_FALSE(isMapped(begin, text.size()));
+}
+
+TEST(MappedFileStreamAdapterTests, MoveTransfersTheMapping) {
+  const std::string text(10000, 'y');
+  TemporaryFile file(text);
+  std::unique_ptr<MappedFileStreamAdapter> source(
+      new MappedFileStreamAdapter(file.name())
+  );
+  const char* begin = source->begin();
+
+  // Destroying the moved-from adapter leaves the mapping alone
+  MappedFileStreamAdapter stream(std::move(*source));
+  EXPECT_EQ(nullptr, source->begin());
+  EXPECT_EQ(0u, source->size());
+  source.reset();
+  EXPECT_EQ(begin, stream.begin());
+  EXPECT_TRUE(isMapped(begin, text.size()));
+  EXPECT_EQ(text, contentOf(stream));
+}
+
+TEST(MappedFileStreamAdapterTests, MoveAssignmentUnmapsTheTarget) {
+  const std::string text1(10000, 'a');
+  const std::string text2(20000, 'b');
+  TemporaryFile file1(text1);
+  TemporaryFile file2(text2);
+  MappedFileStreamAdapter stream(file1.name());
+  MappedFileStreamAdapter other(file2.name());
+  const char* begin1 = stream.begin();
+  const char* begin2 = other.begin();
+
+  stream = std::move(other);
+  EXPECT_FALSE(isMapped(begin1, text1.size()));
+  EXPECT_EQ(begin2, stream.begin());
+  EXPECT_EQ(nullptr, other.begin());
+  EXPECT_EQ(text2, contentOf(stream));
+}
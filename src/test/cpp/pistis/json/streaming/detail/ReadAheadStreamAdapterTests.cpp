@@ -0,0 +1,188 @@
+#include <pistis/json/streaming/detail/ReadAheadStreamAdapter.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace pistis::json::streaming::detail;
+using namespace std::chrono;
+
+namespace {
+  /** @brief Stream that returns its text a few bytes at a time, says it
+   *         has no data yet (-1) at random, and can throw part way
+   */
+  class TrickleStream {
+  public:
+    TrickleStream(const std::string& text, size_t throwAt = (size_t)-1):
+	text_(text), position_(0), throwAt_(throwAt), rng_(3) {
+    }
+
+    ssize_t read(char* buffer, size_t n) {
+      if (position_ >= throwAt_) {
+	throw pistis::exceptions::IOError("Read failed", PISTIS_EX_HERE);
+      } else if (!(rng_() % 4)) {
+	return -1;
+      }
+      n = std::min(std::min(n, (size_t)(1 + rng_() % 100)),
+		   std::min(text_.size(), throwAt_) - position_);
+      ::memcpy(buffer, text_.data() + position_, n);
+      position_ += n;
+      return n;
+    }
+
+  private:
+    std::string text_;
+    size_t position_;
+    size_t throwAt_;
+    std::mt19937 rng_;
+  };
+
+  /** @brief Stream that never has any data */
+  struct NeverReadyStream {
+    ssize_t read(char*, size_t) { return -1; }
+  };
+
+  /** @brief Stream over the read end of a pipe, which it owns */
+  class PipeStream {
+  public:
+    explicit PipeStream(int fd): fd_(fd) { }
+    PipeStream(PipeStream&& other): fd_(other.fd_) { other.fd_ = -1; }
+    ~PipeStream() {
+      if (fd_ >= 0) {
+	::close(fd_);
+      }
+    }
+
+    int fd() const { return fd_; }
+
+    ssize_t read(char* buffer, size_t n) {
+      const ssize_t result = ::read(fd_, buffer, n);
+      if ((result < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+	throw pistis::exceptions::IOError("Read failed", PISTIS_EX_HERE);
+      }
+      return result;
+    }
+
+  private:
+    int fd_;
+  };
+
+  std::string randomText(size_t size) {
+    std::mt19937 rng(1);
+    std::string text;
+    for (size_t i = 0; i < size; ++i) {
+      text += (char)('a' + rng() % 26);
+    }
+    return text;
+  }
+
+  /** @brief Read @c stream to its end, retrying when it returns -1 */
+  template <typename Stream>
+  std::string readAll(Stream& stream) {
+    std::mt19937 rng(2);
+    std::string result;
+    char buffer[256];
+    ssize_t n;
+    while ((n = stream.read(buffer, 1 + rng() % sizeof(buffer)))) {
+      if (n > 0) {
+	result.append(buffer, n);
+      }
+    }
+    return result;
+  }
+
+  template <typename Function>
+  milliseconds timeOf(Function f) {
+    const auto start = steady_clock::now();
+    f();
+    return duration_cast<milliseconds>(steady_clock::now() - start);
+  }
+}
+
+TEST(ReadAheadStreamAdapterTests, Blocking) {
+  const std::string text = randomText(100000);
+  ReadAheadStreamAdapter<TrickleStream> stream(TrickleStream(text), 3, 64);
+  char buffer[16];
+  EXPECT_EQ(text, readAll(stream));
+  EXPECT_EQ(0, stream.read(buffer, sizeof(buffer)));
+}
+
+TEST(ReadAheadStreamAdapterTests, NonBlocking) {
+  const std::string text = randomText(100000);
+  ReadAheadStreamAdapter<TrickleStream> stream(TrickleStream(text), 3, 64,
+					       false);
+  EXPECT_EQ(text, readAll(stream));
+}
+
+TEST(ReadAheadStreamAdapterTests, RethrowsAfterEarlierData) {
+  const std::string text = randomText(10000);
+  ReadAheadStreamAdapter<TrickleStream> stream(TrickleStream(text, 5000),
+					       4, 100);
+  std::string result;
+  char buffer[100];
+  try {
+    ssize_t n;
+    while ((n = stream.read(buffer, sizeof(buffer)))) {
+      result.append(buffer, n);
+    }
+    ADD_FAILURE() << "read() did not throw";
+  } catch(const pistis::exceptions::IOError&) {
+  }
+  EXPECT_EQ(text.substr(0, 5000), result);
+}
+
+TEST(ReadAheadStreamAdapterTests, ReadsFromPipe) {
+  const std::string text = randomText(200000);
+  for (bool nonBlockingFd : { false, true }) {
+    int fds[2];
+    ASSERT_EQ(0, ::pipe(fds));
+    if (nonBlockingFd) {
+      ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    }
+
+    std::thread writer([&text, fd = fds[1]]() {
+      for (size_t i = 0; i < text.size(); i += 10000) {
+	std::this_thread::sleep_for(milliseconds(1));
+	EXPECT_EQ(10000, ::write(fd, text.data() + i, 10000));
+      }
+      ::close(fd);
+    });
+    ReadAheadStreamAdapter<PipeStream> stream(PipeStream(fds[0]), 4, 4096);
+    EXPECT_EQ(text, readAll(stream));
+    writer.join();
+  }
+}
+
+TEST(ReadAheadStreamAdapterTests, DestructorInterruptsPipeRead) {
+  // Nothing is ever written to the pipe, so a producer stuck in read()
+  // would keep the destructor waiting until the write end is closed
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+  const milliseconds elapsed = timeOf([&fds]() {
+    ReadAheadStreamAdapter<PipeStream> stream(PipeStream(fds[0]), 2, 64,
+					      false);
+    char buffer[16];
+    std::this_thread::sleep_for(milliseconds(20));
+    EXPECT_EQ(-1, stream.read(buffer, sizeof(buffer)));
+  });
+  ::close(fds[1]);
+  EXPECT_LT(elapsed.count(), 1000);
+}
+
+TEST(ReadAheadStreamAdapterTests, DestructorInterruptsRetryWait) {
+  const milliseconds elapsed = timeOf([]() {
+    ReadAheadStreamAdapter<NeverReadyStream> stream(
+	NeverReadyStream(), 2, 64, false, hours(1)
+    );
+    EXPECT_EQ(hours(1), stream.retryInterval());
+    char buffer[16];
+    std::this_thread::sleep_for(milliseconds(20));
+    EXPECT_EQ(-1, stream.read(buffer, sizeof(buffer)));
+  });
+  EXPECT_LT(elapsed.count(), 1000);
+}
@@ -0,0 +1,183 @@
+#include "../TemporaryFile.hpp"
+#include <pistis/json/streaming/detail/UringFdStreamAdapter.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace pistis::exceptions;
+using namespace pistis::json::streaming::detail;
+using namespace pistis::json::streaming::testing;
+
+namespace {
+  std::string randomText(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::string text;
+    for (size_t i = 0; i < size; ++i) {
+      text += (char)('a' + rng() % 26);
+    }
+    return text;
+  }
+
+  /** @brief Read @c stream to the end, at most @c n bytes at a time */
+  std::string readAll(UringFdStreamAdapter& stream, size_t n) {
+    std::string text;
+    std::unique_ptr<char[]> buffer(new char[n]);
+    ssize_t numRead;
+    while ((numRead = stream.read(buffer.get(), n)) != 0) {
+      if (numRead > 0) {
+	text.append(buffer.get(), numRead);
+      }
+    }
+    return text;
+  }
+
+  /** @brief Descriptor opened on @c filename, closed when the object is
+   *         destroyed
+   */
+  class OpenFile {
+  public:
+    OpenFile(const std::string& filename, int flags = O_RDONLY):
+	fd_(::open(filename.c_str(), flags)) {
+      EXPECT_LE(0, fd_) << "Could not open " << filename;
+    }
+    OpenFile(const OpenFile&) = delete;
+    ~OpenFile() { ::close(fd_); }
+
+    int fd() const { return fd_; }
+
+    OpenFile& operator=(const OpenFile&) = delete;
+
+  private:
+    int fd_;
+  };
+}
+
+TEST(UringFdStreamAdapterTests, ReadsWithReadsInFlight) {
+  // Reads the parser asks for smaller than, equal to and larger than
+  // the chunks, with up to eight chunks in flight at once
+  static const size_t SETTINGS[][3] = {
+    { 1, 64, 64 }, { 2, 100, 7 }, { 4, 4096, 1000 }, { 8, 10, 3 },
+    { 8, 333, 10000 }, { 4, 256 * 1024, 65536 }
+  };
+  const std::string text = randomText(50000, 1);
+  TemporaryFile file(text);
+  for (const auto& settings : SETTINGS) {
+    UringFdStreamAdapter stream(file.name(), settings[0], settings[1]);
+    EXPECT_EQ(text, readAll(stream, settings[2]))
+	<< "depth " << settings[0] << ", chunk size " << settings[1]
+	<< ", read size " << settings[2];
+  }
+}
+
+TEST(UringFdStreamAdapterTests, UsesIoUringOnRegularFiles) {
+  TemporaryFile file("[1, 2, 3]");
+  UringFdStreamAdapter stream(file.name(), 2, 4);
+  if (!stream.usingIoUring()) {
+    GTEST_SKIP() << "io_uring is not available here";
+  }
+  EXPECT_EQ("[1, 2, 3]", readAll(stream, 3));
+}
+
+TEST(UringFdStreamAdapterTests, StartsAtTheDescriptorsOffset) {
+  const std::string text = randomText(1000, 2);
+  TemporaryFile file(text);
+  OpenFile open(file.name());
+  ASSERT_EQ(100, ::lseek(open.fd(), 100, SEEK_SET));
+  {
+    UringFdStreamAdapter stream("test", open.fd(), 3, 64);
+    EXPECT_EQ(text.substr(100), readAll(stream, 50));
+  }
+
+  // The descriptor belongs to the caller
+  EXPECT_EQ(0, ::lseek(open.fd(), 0, SEEK_SET));
+}
+
+TEST(UringFdStreamAdapterTests, ShortReadsAreCompleted) {
+  // The second chunk's read, queued before the file grows, comes back
+  // short.  The rest of its chunk is read before the third chunk.
+  const std::string text = randomText(250, 3);
+  TemporaryFile file(text.substr(0, 150));
+  UringFdStreamAdapter stream(file.name(), 2, 100);
+
+  OpenFile append(file.name(), O_WRONLY | O_APPEND);
+  ASSERT_EQ(100, ::write(append.fd(), text.data() + 150, 100));
+  EXPECT_EQ(text, readAll(stream, 30));
+}
+
+TEST(UringFdStreamAdapterTests, EndOfFileDuringARead) {
+  // Files that end partway through a chunk, at its end and before the
+  // reads already in flight for the chunks after it
+  static const size_t SIZES[] = { 0, 1, 99, 100, 101, 400, 401, 1234 };
+  for (size_t size : SIZES) {
+    const std::string text = randomText(size, 4);
+    TemporaryFile file(text);
+    UringFdStreamAdapter stream(file.name(), 4, 100);
+    EXPECT_EQ(text, readAll(stream, 64)) << "size " << size;
+
+    // End of file stays the end
+    char c;
+    EXPECT_EQ(0, stream.read(&c, 1));
+    EXPECT_EQ(0, stream.read(&c, 1));
+  }
+}
+
+TEST(UringFdStreamAdapterTests, DestroyWithReadsInFlight) {
+  const std::string text = randomText(100000, 5);
+  TemporaryFile file(text);
+  for (int i = 0; i < 10; ++i) {
+    UringFdStreamAdapter stream(file.name(), 8, 4096);
+    char buffer[10];
+    EXPECT_EQ(10, stream.read(buffer, sizeof(buffer)));
+  }
+}
+
+TEST(UringFdStreamAdapterTests, MoveWithReadsInFlight) {
+  const std::string text = randomText(10000, 6);
+  TemporaryFile file(text);
+  UringFdStreamAdapter source(file.name(), 4, 512);
+  char buffer[100];
+  ASSERT_EQ(100, source.read(buffer, sizeof(buffer)));
+
+  UringFdStreamAdapter stream(std::move(source));
+  UringFdStreamAdapter assigned(file.name(), 2, 64);
+  assigned = std::move(stream);
+  EXPECT_EQ(text.substr(100), readAll(assigned, 300));
+}
+
+TEST(UringFdStreamAdapterTests, FallsBackWhenSetupFails) {
+  // io_uring_setup() refuses queues this deep
+  const std::string text = randomText(3000, 7);
+  TemporaryFile file(text);
+  UringFdStreamAdapter stream(file.name(), 100000, 16);
+  EXPECT_FALSE(stream.usingIoUring());
+  EXPECT_EQ(text, readAll(stream, 100));
+}
+
+TEST(UringFdStreamAdapterTests, FallsBackOnPipes) {
+  int fds[2];
+  ASSERT_EQ(0, ::pipe2(fds, O_NONBLOCK));
+  UringFdStreamAdapter stream("pipe", fds[0], 4, 64);
+  EXPECT_FALSE(stream.usingIoUring());
+
+  // Nonblocking descriptors with no data report AGAIN
+  char buffer[16];
+  EXPECT_EQ(-1, stream.read(buffer, sizeof(buffer)));
+  ASSERT_EQ(5, ::write(fds[1], "hello", 5));
+  ::close(fds[1]);
+  EXPECT_EQ("hello", readAll(stream, 2));
+  ::close(fds[0]);
+}
+
+TEST(UringFdStreamAdapterTests, BadArgumentsThrow) {
+  TemporaryFile file("[]");
+  EXPECT_THROW(UringFdStreamAdapter(file.name(), 0, 64), IllegalValueError);
+  EXPECT_THROW(UringFdStreamAdapter(file.name(), 4, 0), IllegalValueError);
+  EXPECT_THROW(UringFdStreamAdapter(file.name() + ".missing"), IOError);
+  EXPECT_THROW(UringFdStreamAdapter("test", -1), IOError);
+}
@@ -0,0 +1,122 @@
+#include <pistis/json/util/Base64Decoder.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pistis::exceptions;
+using namespace pistis::json::util;
+
+namespace {
+  /** @brief Encode @c data the obvious way, with or without padding */
+  std::string encode(const std::vector<uint8_t>& data, bool pad) {
+    static const char ALPHABET[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    for (size_t i = 0; i < data.size(); i += 3) {
+      const size_t n = std::min((size_t)3, data.size() - i);
+      uint32_t v = (uint32_t)data[i] << 16;
+      if (n > 1) {
+	v |= (uint32_t)data[i + 1] << 8;
+      }
+      if (n > 2) {
+	v |= data[i + 2];
+      }
+      for (size_t j = 0; j < 4; ++j) {
+	if (j <= n) {
+	  text += ALPHABET[(v >> (18 - 6 * j)) & 0x3F];
+	} else if (pad) {
+	  text += '=';
+	}
+      }
+    }
+    return text;
+  }
+
+  std::vector<uint8_t> randomBytes(std::mt19937& rng, size_t size) {
+    std::vector<uint8_t> data(size);
+    for (auto& b : data) {
+      b = (uint8_t)rng();
+    }
+    return data;
+  }
+
+  /** @brief Decode @c text in pieces cut at the offsets in @c splits */
+  std::vector<uint8_t> decode(const std::string& text,
+			      const std::vector<size_t>& splits) {
+    Base64Decoder decoder;
+    std::vector<uint8_t> data(Base64Decoder::maxDecodedSize(text.size())
+			      + 2);
+    size_t n = 0;
+    size_t start = 0;
+    for (size_t split : splits) {
+      n += decoder.decode(text.data() + start, text.data() + split,
+			  data.data() + n);
+      start = split;
+    }
+    n += decoder.decode(text.data() + start, text.data() + text.size(),
+			data.data() + n);
+    n += decoder.finish(data.data() + n);
+    data.resize(n);
+    return data;
+  }
+
+  std::vector<uint8_t> decode(const std::string& text) {
+    return decode(text, std::vector<size_t>());
+  }
+}
+
+TEST(Base64DecoderTests, RoundTrip) {
+  // Long enough that every kernel decodes most of the text, and in
+  // random pieces so the groups kept between calls are tested too
+  std::mt19937 rng(23);
+  for (int trial = 0; trial < 5000; ++trial) {
+    const std::vector<uint8_t> data =
+	randomBytes(rng, (trial % 4) ? rng() % 40 : rng() % 1000);
+    const std::string text = encode(data, trial % 2);
+
+    std::vector<size_t> splits;
+    for (uint32_t n = rng() % 4; n; --n) {
+      splits.push_back(text.empty() ? 0 : rng() % text.size());
+    }
+    std::sort(splits.begin(), splits.end());
+
+    ASSERT_EQ(data, decode(text)) << text;
+    ASSERT_EQ(data, decode(text, splits)) << text;
+  }
+}
+
+TEST(Base64DecoderTests, DecodeRunStopsAtTheFirstBadGroup) {
+  std::mt19937 rng(24);
+  for (size_t bad = 0; bad < 200; ++bad) {
+    std::string text = encode(randomBytes(rng, 150), false);
+    text[bad] = "=.\n-"[rng() % 4];
+    std::vector<uint8_t> out(Base64Decoder::maxDecodedSize(text.size()));
+    const char* const end =
+	decodeBase64Run(text.data(), text.data() + text.size(), out.data());
+    EXPECT_EQ(bad / 4 * 4, (size_t)(end - text.data())) << text;
+  }
+}
+
+TEST(Base64DecoderTests, RejectsBadText) {
+  static const char* const CASES[] = {
+    "QUJD-EVG", "QUJDREVGSElK\"", "QQ=A", "QQ==QUJD", "Q===", "QUJ=R",
+    "QUJDRA==="
+  };
+  for (const char* text : CASES) {
+    EXPECT_THROW(decode(text), IllegalValueError) << text;
+  }
+  // One character can't make a byte
+  EXPECT_THROW(decode("QUJDR"), IllegalValueError);
+}
+
+TEST(Base64DecoderTests, PaddingIsOptional) {
+  const std::vector<uint8_t> ab = { 'A', 'B' };
+  EXPECT_EQ(ab, decode("QUI="));
+  EXPECT_EQ(ab, decode("QUI"));
+  EXPECT_EQ(ab, decode("QUI=", { 1 }));
+  EXPECT_EQ(ab, decode("QUI=", { 3 }));
+  EXPECT_EQ(std::vector<uint8_t>(), decode(""));
+}
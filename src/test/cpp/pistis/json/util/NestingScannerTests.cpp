@@ -0,0 +1,139 @@
+#include <pistis/json/util/NestingScanner.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using namespace pistis::json::util;
+
+namespace {
+  /** @brief One character at a time, with the rules skipNested()
+   *         documents: a backslash escapes the next character whether or
+   *         not it is in a string, and brackets in strings don't count.
+   */
+  const char* referenceSkipNested(const char* p, const char* end,
+				  NestingState& state,
+				  NewlineCount& newlines) {
+    for (; p != end; ++p) {
+      if (*p == '\n') {
+	++newlines.count;
+	newlines.last = p;
+      }
+      if (state.escaped) {
+	state.escaped = 0;
+      } else if (*p == '\\') {
+	state.escaped = 1;
+      } else if (*p == '"') {
+	state.inString = ~state.inString;
+      } else if (state.inString) {
+	// Brackets in strings don't count
+      } else if ((*p == '{') || (*p == '[')) {
+	++state.depth;
+      } else if (((*p == '}') || (*p == ']')) && !--state.depth) {
+	return p + 1;
+      }
+    }
+    return p;
+  }
+
+  /** @brief Random text with more opening brackets than closing ones,
+   *         so some of it nests deep enough to span several blocks,
+   *         and runs of backslashes both in and out of strings
+   */
+  std::string randomText(std::mt19937& rng, size_t size) {
+    static const char ALPHABET[] = "{{[[}]\"\"\\\\\\ab \n,:";
+    std::string text(size, ' ');
+    for (auto& c : text) {
+      c = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+    }
+    return text;
+  }
+
+  ::testing::AssertionResult sameState(const NestingState& expected,
+				       const NestingState& actual) {
+    if ((expected.depth == actual.depth) &&
+	(!expected.inString == !actual.inString) &&
+	(expected.escaped == actual.escaped)) {
+      return ::testing::AssertionSuccess();
+    }
+    return ::testing::AssertionFailure()
+	<< "expected depth " << expected.depth << ", inString "
+	<< !!expected.inString << ", escaped " << expected.escaped
+	<< " but got " << actual.depth << ", " << !!actual.inString
+	<< ", " << actual.escaped;
+  }
+}
+
+TEST(NestingScannerTests, SkipNestedMatchesReference) {
+  std::mt19937 rng(10);
+  for (int trial = 0; trial < 50000; ++trial) {
+    const std::string text = randomText(rng, rng() % 400);
+    const char* const end = text.data() + text.size();
+    const uint32_t depth = 1 + ((trial % 2) ? rng() % 3 : rng() % 40);
+
+    NestingState expectedState(depth);
+    NestingState state(depth);
+    NewlineCount expectedNewlines;
+    NewlineCount newlines;
+    const char* const expectedEnd =
+	referenceSkipNested(text.data(), end, expectedState,
+			    expectedNewlines);
+
+    ASSERT_EQ(expectedEnd - text.data(),
+	      skipNested(text.data(), end, state, newlines) - text.data())
+	<< "text = \"" << text << "\", depth = " << depth;
+    ASSERT_EQ(expectedNewlines.count, newlines.count) << text;
+    if (newlines.count) {
+      ASSERT_EQ(expectedNewlines.last, newlines.last) << text;
+    }
+    if (expectedEnd == end) {
+      ASSERT_TRUE(sameState(expectedState, state)) << text;
+    } else {
+      ASSERT_EQ(0, state.depth) << text;
+    }
+  }
+}
+
+TEST(NestingScannerTests, SkipNestedResumes) {
+  // Splitting the text anywhere, including inside a string, between a
+  // backslash and the character it escapes, or in the middle of a
+  // block, must not change where the skip ends
+  std::mt19937 rng(11);
+  for (int trial = 0; trial < 20000; ++trial) {
+    const std::string text = randomText(rng, 64 + rng() % 300);
+    const char* const end = text.data() + text.size();
+    const uint32_t depth = 1 + rng() % 40;
+
+    NestingState expectedState(depth);
+    NewlineCount expectedNewlines;
+    const char* const expectedEnd =
+	referenceSkipNested(text.data(), end, expectedState,
+			    expectedNewlines);
+
+    NestingState state(depth);
+    NewlineCount newlines;
+    const char* const split = text.data() + rng() % text.size();
+    const char* p = skipNested(text.data(), split, state, newlines);
+    if ((p == split) && state.depth) {
+      p = skipNested(split, end, state, newlines);
+    }
+    ASSERT_EQ(expectedEnd - text.data(), p - text.data())
+	<< "text = \"" << text << "\", depth = " << depth
+	<< ", split = " << (split - text.data());
+    ASSERT_EQ(expectedNewlines.count, newlines.count) << text;
+  }
+}
+
+TEST(NestingScannerTests, EscapedBracketsOutsideStrings) {
+  // Not valid JSON, but every kernel must agree on where it ends
+  for (size_t padding : { 0, 61, 62, 63, 64, 200 }) {
+    const std::string text =
+	std::string(padding, ' ') + "\\]\\\\]\\\\\\}" + "]" +
+	std::string(100, ' ');
+    NestingState state(2);
+    NewlineCount newlines;
+    EXPECT_EQ(text.find("]", padding + 8) + 1,
+	      skipNested(text.data(), text.data() + text.size(), state,
+			 newlines) - text.data())
+	<< "padding = " << padding;
+  }
+}
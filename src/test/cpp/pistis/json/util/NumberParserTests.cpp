@@ -0,0 +1,284 @@
+#include <pistis/json/util/NumberParser.hpp>
+#include <pistis/json/exceptions/InvalidJsonNumberError.hpp>
+#include <pistis/json/streaming/FlexibleEventStream.hpp>
+#include <pistis/json/streaming/DefaultPayloadFactory.hpp>
+#include <pistis/json/streaming/detail/InMemoryStreamAdapter.hpp>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace pistis::json;
+using namespace pistis::json::util;
+
+namespace {
+  JsonString textOf(const std::string& s) {
+    return JsonString(s.data(), s.data() + s.size());
+  }
+
+  /** @brief Compare doubles bit for bit, so 0.0 and -0.0 differ */
+  ::testing::AssertionResult sameBits(const std::string& text,
+				      double expected, double actual) {
+    if (!::memcmp(&expected, &actual, sizeof(double))) {
+      return ::testing::AssertionSuccess();
+    }
+    char buffer[128];
+    ::snprintf(buffer, sizeof(buffer), "%.17g (%a) but got %.17g (%a)",
+	       expected, expected, actual, actual);
+    return ::testing::AssertionFailure()
+	<< "\"" << text << "\" should be " << buffer;
+  }
+
+  ::testing::AssertionResult matchesStrtod(const std::string& text) {
+    double value;
+    if (!parseDouble(textOf(text), value)) {
+      return ::testing::AssertionFailure()
+	  << "\"" << text << "\" was rejected";
+    }
+    return sameBits(text, ::strtod(text.c_str(), nullptr), value);
+  }
+
+  std::string randomDigits(std::mt19937_64& rng, uint32_t n) {
+    std::string digits;
+    for (uint32_t i = 0; i < n; ++i) {
+      digits += (char)('0' + rng() % 10);
+    }
+    return digits;
+  }
+
+  /** @brief A random JSON number with up to @c maxDigits digits and
+   *         an exponent anywhere a double can reach
+   */
+  std::string randomNumber(std::mt19937_64& rng, uint32_t maxDigits) {
+    std::string text = (rng() % 2) ? "-" : "";
+    const uint32_t numDigits = 1 + rng() % maxDigits;
+    const uint32_t numIntDigits = rng() % (numDigits + 1);
+    if (!numIntDigits) {
+      text += "0";
+    } else {
+      text += (char)('1' + rng() % 9) + randomDigits(rng, numIntDigits - 1);
+    }
+    if (numIntDigits < numDigits) {
+      text += "." + randomDigits(rng, numDigits - numIntDigits);
+    }
+    if (rng() % 4) {
+      text += ((rng() % 2) ? "e" : "E");
+      text += std::to_string((int32_t)(rng() % 700) - 350);
+    }
+    return text;
+  }
+}
+
+TEST(NumberParserTests, EdgeCases) {
+  static const char* const CASES[] = {
+    "0", "-0", "0.0", "-0.0e10", "1", "-1", "0.1", "0.3", "1e23",
+    "8.98846567431158e307", "1.7976931348623157e308",
+    "1.7976931348623158e308",           // Rounds down to DBL_MAX
+    "2.2250738585072011e-308",          // Largest subnormal, almost
+    "2.2250738585072014e-308",          // DBL_MIN
+    "4.9406564584124654e-324",          // Smallest subnormal
+    "2.4703282292062327e-324",          // Just under half of it
+    "2.4703282292062328e-324",          // Just over half of it
+    "1e-400", "-1e-400", "1e-324",
+    "9007199254740993",                 // 2^53 + 1, a halfway case
+    "9007199254740993.0000000000000000001",
+    "9007199254740992.9999999999999999999",
+    "123456789012345678901234567890",
+    "0.000000000000000000000000000000000000001234567890123456789012",
+    "7.2057594037927933e16", "4.35679149e-10",
+    "2.22507385850720113605740979670913197593481954635164564e-308",
+    "1.00000000000000011102230246251565404236316680908203125",
+    "1.00000000000000011102230246251565404236316680908203124",
+    "1.00000000000000011102230246251565404236316680908203126",
+    "0.500000000000000166533453693773481063544750213623046875",
+    "3.518437208883201171875e13", "62.5364939768271845828",
+    "8.10109172351e-10", "1.5e-5", "1E5", "1e+5"
+  };
+  for (const char* text : CASES) {
+    EXPECT_TRUE(matchesStrtod(text));
+  }
+}
+
+TEST(NumberParserTests, ShortestRoundTrip) {
+  std::mt19937_64 rng(4);
+  char buffer[64];
+  for (int i = 0; i < 200000; ++i) {
+    uint64_t bits = rng();
+    double d;
+    ::memcpy(&d, &bits, sizeof(d));
+    if (!std::isfinite(d)) {
+      continue;
+    }
+    ::snprintf(buffer, sizeof(buffer), "%.*e", (int)(rng() % 18), d);
+    ASSERT_TRUE(matchesStrtod(buffer));
+  }
+}
+
+TEST(NumberParserTests, RandomDecimals) {
+  std::mt19937_64 rng(5);
+  for (int i = 0; i < 200000; ++i) {
+    ASSERT_TRUE(matchesStrtod(randomNumber(rng, 19)));
+  }
+}
+
+TEST(NumberParserTests, LongSignificands) {
+  // More than 19 digits, so some land close enough to a halfway point
+  // that the digits past the 19th decide the rounding
+  std::mt19937_64 rng(6);
+  for (int i = 0; i < 50000; ++i) {
+    ASSERT_TRUE(matchesStrtod(randomNumber(rng, 60)));
+  }
+}
+
+TEST(NumberParserTests, NearHalfwayPoints) {
+  // Print the exact value of the midpoint between two adjacent doubles,
+  // then nudge its last digit up or down
+  std::mt19937_64 rng(7);
+  char buffer[1100];
+  for (int i = 0; i < 20000; ++i) {
+    uint64_t bits = rng() & 0x7fefffffffffffffull;
+    double d, next;
+    ::memcpy(&d, &bits, sizeof(d));
+    next = std::nextafter(d, std::numeric_limits<double>::infinity());
+    const long double mid = ((long double)d + (long double)next) / 2;
+    ::snprintf(buffer, sizeof(buffer), "%.40Le", mid);
+
+    std::string text(buffer);
+    const size_t e = text.find('e');
+    ASSERT_TRUE(matchesStrtod(text));
+    text[e - 1] = (text[e - 1] == '9') ? '8' : text[e - 1] + 1;
+    ASSERT_TRUE(matchesStrtod(text));
+  }
+}
+
+TEST(NumberParserTests, ExactHalfwayPoints) {
+  // A long double holds the midpoint exactly, and 1000 digits are
+  // enough to print it exactly, so these are ties that round to even.
+  // A 1 in the last place, past the 768th digit, breaks the tie.
+  std::mt19937_64 rng(10);
+  char buffer[1100];
+  for (int i = 0; i < 5000; ++i) {
+    uint64_t bits = rng() & 0x7fefffffffffffffull;
+    if (i % 2) {
+      bits &= 0x000fffffffffffffull;  // Subnormal
+    }
+    double d, next;
+    ::memcpy(&d, &bits, sizeof(d));
+    next = std::nextafter(d, std::numeric_limits<double>::infinity());
+    const long double mid = ((long double)d + (long double)next) / 2;
+    ::snprintf(buffer, sizeof(buffer), "%.1000Le", mid);
+
+    std::string text(buffer);
+    ASSERT_TRUE(matchesStrtod(text));
+    text[text.find('e') - 1] = '1';
+    ASSERT_TRUE(matchesStrtod(text));
+  }
+}
+
+TEST(NumberParserTests, RejectsInvalidNumbers) {
+  static const char* const CASES[] = {
+    "", "-", "+1", "01", "1.", ".5", "1e", "1e+", "0x10", "1.5.2",
+    "inf", "NaN", "1 "
+  };
+  double value;
+  for (const char* text : CASES) {
+    EXPECT_FALSE(parseDouble(textOf(text), value)) << "[" << text << "]";
+  }
+}
+
+TEST(NumberParserTests, ParseInt64) {
+  std::mt19937_64 rng(8);
+  int64_t value;
+  for (int i = 0; i < 100000; ++i) {
+    const int64_t expected = (int64_t)rng() >> (rng() % 64);
+    ASSERT_TRUE(parseInt64(textOf(std::to_string(expected)), value));
+    ASSERT_EQ(expected, value);
+  }
+
+  EXPECT_TRUE(parseInt64(textOf("9223372036854775807"), value));
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), value);
+  EXPECT_TRUE(parseInt64(textOf("-9223372036854775808"), value));
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(), value);
+  EXPECT_FALSE(parseInt64(textOf("9223372036854775808"), value));
+  EXPECT_FALSE(parseInt64(textOf("-9223372036854775809"), value));
+  EXPECT_FALSE(parseInt64(textOf("1.0"), value));
+  EXPECT_FALSE(parseInt64(textOf("-"), value));
+}
+
+TEST(NumberParserTests, EventStreamMatchesStrtod) {
+  // The reader splits numbers into significand and exponent itself,
+  // so check the whole path from text to floatPayload() too
+  typedef streaming::FlexibleEventStream<
+      streaming::detail::InMemoryStreamAdapter,
+      streaming::DefaultPayloadFactory
+  > EventStream;
+
+  std::mt19937_64 rng(9);
+  std::vector<std::string> numbers;
+  std::string text = "[";
+  for (int i = 0; i < 20000; ++i) {
+    std::string n = randomNumber(rng, 30);
+    if ((n.find_first_of(".eE") == std::string::npos)) {
+      n += ".0";  // Keep it a FLOAT_VALUE
+    }
+    text += (i ? "," : "") + n;
+    numbers.push_back(n);
+  }
+  text += "]";
+
+  EventStream events("test",
+		     streaming::detail::InMemoryStreamAdapter(text),
+		     streaming::DefaultPayloadFactory(), 4096);
+  ASSERT_EQ(streaming::JsonEventType::BEGIN_ARRAY, events.next());
+  for (const std::string& n : numbers) {
+    ASSERT_EQ(streaming::JsonEventType::FLOAT_VALUE, events.next()) << n;
+    ASSERT_TRUE(sameBits(n, ::strtod(n.c_str(), nullptr),
+			 events.floatPayload()));
+  }
+  EXPECT_EQ(streaming::JsonEventType::END_ARRAY, events.next());
+}
+
+TEST(NumberParserTests, EventStreamRejectsLeadingZeros) {
+  typedef streaming::FlexibleEventStream<
+      streaming::detail::InMemoryStreamAdapter,
+      streaming::DefaultPayloadFactory
+  > EventStream;
+  static const char* const INVALID[] = {
+    "01", "00", "-01", "-00.5", "00e1", "0123456789"
+  };
+  static const char* const VALID[] = {
+    "0", "-0", "0.5", "-0.05", "0e1", "-0E-1", "10", "100.001"
+  };
+
+  // A one-byte buffer splits each number across several reads
+  for (size_t bufferSize : { 4096, 1 }) {
+    for (const char* n : INVALID) {
+      EventStream events("test",
+			 streaming::detail::InMemoryStreamAdapter(
+			     "[" + std::string(n) + "]"
+			 ),
+			 streaming::DefaultPayloadFactory(), bufferSize);
+      ASSERT_EQ(streaming::JsonEventType::BEGIN_ARRAY, events.next());
+      EXPECT_THROW(events.next(), exceptions::InvalidJsonNumberError)
+	  << n << ", buffer size " << bufferSize;
+    }
+    for (const char* n : VALID) {
+      EventStream events("test",
+			 streaming::detail::InMemoryStreamAdapter(
+			     "[" + std::string(n) + "]"
+			 ),
+			 streaming::DefaultPayloadFactory(), bufferSize);
+      ASSERT_EQ(streaming::JsonEventType::BEGIN_ARRAY, events.next());
+      EXPECT_NE(streaming::JsonEventType::AGAIN, events.next())
+	  << n << ", buffer size " << bufferSize;
+      EXPECT_EQ(n, std::string(events.payloadText().begin(),
+			       events.payloadText().end()))
+	  << n << ", buffer size " << bufferSize;
+      EXPECT_EQ(streaming::JsonEventType::END_ARRAY, events.next());
+    }
+  }
+}
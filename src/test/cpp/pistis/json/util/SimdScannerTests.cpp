@@ -0,0 +1,122 @@
+#include <pistis/json/util/SimdScanner.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using namespace pistis::json::util;
+
+namespace {
+  const char* referenceSkipWhitespace(const char* p, const char* end,
+				      NewlineCount& newlines) {
+    for (; (p != end) && isJsonWhitespace(*p); ++p) {
+      if (*p == '\n') {
+	++newlines.count;
+	newlines.last = p;
+      }
+    }
+    return p;
+  }
+
+  const char* referenceFindStringDelimiter(const char* p,
+					   const char* end) {
+    while ((p != end) && !isStringDelimiter(*p)) {
+      ++p;
+    }
+    return p;
+  }
+
+  /** @brief Random text drawn from @c alphabet, long enough for every
+   *         kernel to use its vector loop and its tail loop
+   */
+  std::string randomText(std::mt19937& rng, const std::string& alphabet,
+			 size_t size) {
+    std::string text(size, ' ');
+    for (auto& c : text) {
+      c = alphabet[rng() % alphabet.size()];
+    }
+    return text;
+  }
+}
+
+TEST(SimdScannerTests, SkipWhitespaceMatchesReference) {
+  // Mostly whitespace, so runs are long enough to reach the vector
+  // kernels, with a few bytes that compare equal to whitespace when
+  // treated as signed or when the wrong bits are masked
+  const std::string alphabet =
+      std::string("    \t\t\r\n\n") + "x{\x80\xA0\x8A\x0B\x0C";
+  std::mt19937 rng(1);
+
+  for (int trial = 0; trial < 20000; ++trial) {
+    const std::string text =
+	randomText(rng, (trial % 4) ? alphabet : " \t\r\n", rng() % 300);
+    const char* const end = text.data() + text.size();
+    for (size_t start = 0; start < std::min<size_t>(text.size(), 3);
+	 ++start) {
+      NewlineCount expected;
+      NewlineCount actual;
+      const char* p = text.data() + start;
+      const char* const expectedEnd =
+	  referenceSkipWhitespace(p, end, expected);
+
+      ASSERT_EQ(expectedEnd, skipWhitespaceRun(p, end, actual))
+	  << "text = \"" << text << "\", start = " << start;
+      ASSERT_EQ(expected.count, actual.count);
+      if (expected.count) {
+	ASSERT_EQ(expected.last, actual.last);
+      }
+
+      NewlineCount inlined;
+      ASSERT_EQ(expectedEnd, skipWhitespace(p, end, inlined));
+      ASSERT_EQ(expected.count, inlined.count);
+      if (expected.count) {
+	ASSERT_EQ(expected.last, inlined.last);
+      }
+    }
+  }
+}
+
+TEST(SimdScannerTests, SkipWhitespaceAddsToNewlineCount) {
+  const std::string text = "\n  \n\n   x";
+  NewlineCount newlines;
+  newlines.count = 5;
+
+  const char* p = skipWhitespaceRun(text.data(),
+				    text.data() + text.size(), newlines);
+  EXPECT_EQ(text.data() + text.size() - 1, p);
+  EXPECT_EQ(8u, newlines.count);
+  EXPECT_EQ(text.data() + 4, newlines.last);
+}
+
+TEST(SimdScannerTests, SkipWhitespaceOnEmptyRange) {
+  const char text[] = "";
+  NewlineCount newlines;
+  EXPECT_EQ(text, skipWhitespaceRun(text, text, newlines));
+  EXPECT_EQ(0u, newlines.count);
+}
+
+TEST(SimdScannerTests, FindStringDelimiterMatchesReference) {
+  // Mostly ordinary characters, including UTF-8 bytes and characters
+  // one bit away from '"', '\\' and '\n'
+  const std::string alphabet =
+      std::string("abcdefghijklmnopqrstuvwxyz0123456789 #$\x0A") +
+      "\"\\\x80\xC3\xA9\xDC\x22\x5C\x0B\x02\x12\x7C\x1C";
+  const std::string rare = alphabet.substr(0, 39);
+  std::mt19937 rng(2);
+
+  for (int trial = 0; trial < 20000; ++trial) {
+    std::string text = randomText(rng, rare, rng() % 300);
+    if (!text.empty() && (trial % 3)) {
+      // Plant one delimiter somewhere in the text
+      text[rng() % text.size()] = alphabet[39 + rng() % 3];
+    }
+    const char* const end = text.data() + text.size();
+    for (size_t start = 0; start < std::min<size_t>(text.size(), 3);
+	 ++start) {
+      const char* p = text.data() + start;
+      const char* const expected = referenceFindStringDelimiter(p, end);
+      ASSERT_EQ(expected, findStringDelimiterRun(p, end))
+	  << "text = \"" << text << "\", start = " << start;
+      ASSERT_EQ(expected, findStringDelimiter(p, end));
+    }
+  }
+}
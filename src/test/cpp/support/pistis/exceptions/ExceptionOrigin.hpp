@@ -0,0 +1,46 @@
+/** @file ExceptionOrigin.hpp
+ *
+ *  Stand-in for the header of the same name from pistis-exceptions, so
+ *  the library and its tests build when pistis-exceptions is not
+ *  installed.  Only declares what pistis-json uses.
+ */
+#ifndef __PISTIS__EXCEPTIONS__EXCEPTIONORIGIN_HPP__
+#define __PISTIS__EXCEPTIONS__EXCEPTIONORIGIN_HPP__
+
+#include <ostream>
+#include <string>
+
+namespace pistis {
+  namespace exceptions {
+
+    class ExceptionOrigin {
+    public:
+      ExceptionOrigin(const char* fileName, int lineNumber,
+		      const char* functionName):
+	  fileName_(fileName), lineNumber_(lineNumber),
+	  functionName_(functionName) {
+      }
+
+      const std::string& fileName() const { return fileName_; }
+      int lineNumber() const { return lineNumber_; }
+      const std::string& functionName() const { return functionName_; }
+
+    private:
+      std::string fileName_;
+      int lineNumber_;
+      std::string functionName_;
+    };
+
+    inline std::ostream& operator<<(std::ostream& out,
+				    const ExceptionOrigin& origin) {
+      return out << origin.functionName() << " (" << origin.fileName()
+		 << ":" << origin.lineNumber() << ")";
+    }
+
+  }
+}
+
+#define PISTIS_EX_HERE \
+  ::pistis::exceptions::ExceptionOrigin(__FILE__, __LINE__, __func__)
+
+#endif
@@ -0,0 +1,24 @@
+/** @file IOError.hpp
+ *
+ *  Stand-in for the header of the same name from pistis-exceptions.  See
+ *  ExceptionOrigin.hpp.
+ */
+#ifndef __PISTIS__EXCEPTIONS__IOERROR_HPP__
+#define __PISTIS__EXCEPTIONS__IOERROR_HPP__
+
+#include <pistis/exceptions/PistisException.hpp>
+
+namespace pistis {
+  namespace exceptions {
+
+    class IOError : public PistisException {
+    public:
+      IOError(const std::string& details,
+	      const ExceptionOrigin& origin):
+	  PistisException(details, origin) {
+      }
+    };
+
+  }
+}
+#endif
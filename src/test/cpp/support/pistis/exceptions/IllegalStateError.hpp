@@ -0,0 +1,24 @@
+/** @file IllegalStateError.hpp
+ *
+ *  Stand-in for the header of the same name from pistis-exceptions.  See
+ *  ExceptionOrigin.hpp.
+ */
+#ifndef __PISTIS__EXCEPTIONS__ILLEGALSTATEERROR_HPP__
+#define __PISTIS__EXCEPTIONS__ILLEGALSTATEERROR_HPP__
+
+#include <pistis/exceptions/PistisException.hpp>
+
+namespace pistis {
+  namespace exceptions {
+
+    class IllegalStateError : public PistisException {
+    public:
+      IllegalStateError(const std::string& details,
+	                const ExceptionOrigin& origin):
+	  PistisException(details, origin) {
+      }
+    };
+
+  }
+}
+#endif
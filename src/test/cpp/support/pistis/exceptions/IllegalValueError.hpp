@@ -0,0 +1,24 @@
+/** @file IllegalValueError.hpp
+ *
+ *  Stand-in for the header of the same name from pistis-exceptions.  See
+ *  ExceptionOrigin.hpp.
+ */
+#ifndef __PISTIS__EXCEPTIONS__ILLEGALVALUEERROR_HPP__
+#define __PISTIS__EXCEPTIONS__ILLEGALVALUEERROR_HPP__
+
+#include <pistis/exceptions/PistisException.hpp>
+
+namespace pistis {
+  namespace exceptions {
+
+    class IllegalValueError : public PistisException {
+    public:
+      IllegalValueError(const std::string& details,
+	                const ExceptionOrigin& origin):
+	  PistisException(details, origin) {
+      }
+    };
+
+  }
+}
+#endif
@@ -0,0 +1,46 @@
+/** @file PistisException.hpp
+ *
+ *  Stand-in for the header of the same name from pistis-exceptions.  See
+ *  ExceptionOrigin.hpp.
+ */
+#ifndef __PISTIS__EXCEPTIONS__PISTISEXCEPTION_HPP__
+#define __PISTIS__EXCEPTIONS__PISTISEXCEPTION_HPP__
+
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <exception>
+#include <sstream>
+#include <string>
+
+namespace pistis {
+  namespace exceptions {
+
+    class PistisException : public std::exception {
+    public:
+      PistisException(const std::string& details,
+		      const ExceptionOrigin& origin):
+	  details_(details), exceptionOrigin_(origin),
+	  what_(createMessage_(details, origin)) {
+      }
+
+      const std::string& details() const { return details_; }
+      const ExceptionOrigin& exceptionOrigin() const {
+	return exceptionOrigin_;
+      }
+      virtual const char* what() const noexcept { return what_.c_str(); }
+
+    private:
+      std::string details_;
+      ExceptionOrigin exceptionOrigin_;
+      std::string what_;
+
+      static std::string createMessage_(const std::string& details,
+					const ExceptionOrigin& origin) {
+	std::ostringstream msg;
+	msg << details << " [from " << origin << "]";
+	return msg.str();
+      }
+    };
+
+  }
+}
+#endif
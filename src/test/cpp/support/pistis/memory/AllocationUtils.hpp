@@ -0,0 +1,49 @@
+/** @file AllocationUtils.hpp
+ *
+ *  Stand-in for the header of the same name from pistis-memory, so the
+ *  library and its tests build when pistis-memory is not installed.
+ *  Only declares what pistis-json uses.
+ */
+#ifndef __PISTIS__MEMORY__ALLOCATIONUTILS_HPP__
+#define __PISTIS__MEMORY__ALLOCATIONUTILS_HPP__
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <stddef.h>
+#include <string.h>
+
+namespace pistis {
+  namespace memory {
+
+    /** @brief Grow the block [begin, eos), which holds data in
+     *         [begin, end), to twice its size, but at least
+     *         @c initialSize and at most @c maxSize bytes.
+     *
+     *  Returns the new begin, end and eos.  Throws std::length_error if
+     *  the block is already @c maxSize bytes long.
+     */
+    template <typename Allocator>
+    std::tuple<char*, char*, char*> increaseAllocation(
+	Allocator& allocator, size_t initialSize, size_t maxSize,
+	char* begin, char* end, char* eos
+    ) {
+      const size_t currentSize = eos - begin;
+      if (currentSize >= maxSize) {
+	throw std::length_error("Allocation is already at its maximum size");
+      }
+
+      const size_t newSize =
+	  std::min(std::max(initialSize, currentSize * 2), maxSize);
+      char* const newBegin = allocator.allocate(newSize);
+      if (begin) {
+	::memcpy(newBegin, begin, end - begin);
+	allocator.deallocate(begin, currentSize);
+      }
+      return std::make_tuple(newBegin, newBegin + (end - begin),
+			     newBegin + newSize);
+    }
+
+  }
+}
+#endif